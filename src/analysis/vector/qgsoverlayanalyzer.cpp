@@ -20,6 +20,7 @@
 #include "qgsapplication.h"
 #include "qgsfield.h"
 #include "qgsfeature.h"
+#include "qgsgeometry.h"
 #include "qgslogger.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsvectorfilewriter.h"
@@ -155,6 +156,7 @@ void QgsOverlayAnalyzer::intersectFeature( QgsFeature& f, QgsVectorFileWriter* v
   intersects = index->intersects( featureGeometry->boundingBox() );
   QList<QgsFeatureId>::const_iterator it = intersects.constBegin();
   QgsFeature outFeature;
+  QgsPreparedGeometry preparedGeometry( *featureGeometry );
   for ( ; it != intersects.constEnd(); ++it )
   {
     if ( !vl->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( overlayFeature ) )
@@ -162,7 +164,7 @@ void QgsOverlayAnalyzer::intersectFeature( QgsFeature& f, QgsVectorFileWriter* v
       continue;
     }
 
-    if ( featureGeometry->intersects( overlayFeature.geometry() ) )
+    if ( preparedGeometry.intersects( overlayFeature.geometry() ) )
     {
       intersectGeometry = featureGeometry->intersection( overlayFeature.geometry() );
 
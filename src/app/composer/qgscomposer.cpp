@@ -27,6 +27,7 @@
 #include "qgscompositionwidget.h"
 #include "qgscomposermodel.h"
 #include "qgsatlascompositionwidget.h"
+#include "qgsatlasexporter.h"
 #include "qgscomposerarrow.h"
 #include "qgscomposerarrowwidget.h"
 #include "qgscomposerattributetablewidget.h"
@@ -1941,73 +1942,14 @@ void QgsComposer::exportCompositionAsImage( QgsComposer::OutputMode mode )
 
     QProgressDialog progress( tr( "Rendering maps..." ), tr( "Abort" ), 0, atlasMap->numFeatures(), this );
 
-    for ( int feature = 0; feature < atlasMap->numFeatures(); ++feature )
+    // the pages are written by worker threads while the next ones are rendered
+    QgsAtlasExporter exporter( mComposition );
+    if ( !exporter.exportImages( dir, format, fileExt, &progress ) && !progress.wasCanceled() )
     {
-      progress.setValue( feature );
-      // process input events in order to allow cancelling
-      QCoreApplication::processEvents();
-
-      if ( progress.wasCanceled() )
-      {
-        atlasMap->endRender();
-        break;
-      }
-      if ( ! atlasMap->prepareForFeature( feature ) )
-      {
-        QMessageBox::warning( this, tr( "Atlas processing error" ),
-                              tr( "Atlas processing error" ),
-                              QMessageBox::Ok,
-                              QMessageBox::Ok );
-        mView->setPaintingEnabled( true );
-        QApplication::restoreOverrideCursor();
-        return;
-      }
-
-      QString filename = QDir( dir ).filePath( atlasMap->currentFilename() ) + fileExt;
-
-      for ( int i = 0; i < mComposition->numPages(); ++i )
-      {
-        if ( !mComposition->shouldExportPage( i + 1 ) )
-        {
-          continue;
-        }
-        QImage image = mComposition->printPageAsRaster( i );
-        QString imageFilename = filename;
-
-        if ( i != 0 )
-        {
-          //append page number
-          QFileInfo fi( filename );
-          imageFilename = fi.absolutePath() + "/" + fi.baseName() + "_" + QString::number( i + 1 ) + "." + fi.suffix();
-        }
-
-        bool saveOk = image.save( imageFilename, format.toLocal8Bit().constData() );
-        if ( !saveOk )
-        {
-          QMessageBox::warning( this, tr( "Atlas processing error" ),
-                                QString( tr( "Error creating %1." ) ).arg( imageFilename ),
-                                QMessageBox::Ok,
-                                QMessageBox::Ok );
-          mView->setPaintingEnabled( true );
-          QApplication::restoreOverrideCursor();
-          return;
-        }
-      }
-
-      //
-      // Write the world file if asked to
-      if ( mComposition->generateWorldFile() )
-      {
-        double a, b, c, d, e, f;
-        mComposition->computeWorldFileParameters( a, b, c, d, e, f );
-
-        QFileInfo fi( filename );
-        // build the world file name
-        QString worldFileName = fi.absolutePath() + "/" + fi.baseName() + "."
-                                + fi.suffix()[0] + fi.suffix()[fi.suffix().size()-1] + "w";
-
-        writeWorldFile( worldFileName, a, b, c, d, e, f );
-      }
+      QMessageBox::warning( this, tr( "Atlas processing error" ),
+                            exporter.errorMessage(),
+                            QMessageBox::Ok,
+                            QMessageBox::Ok );
     }
     atlasMap->endRender();
     mView->setPaintingEnabled( true );
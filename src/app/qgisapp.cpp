@@ -5118,6 +5118,11 @@ void QgisApp::saveAsVectorFileGeneral( QgsVectorLayer* vlayer, bool symbologyOpt
     QString errorMessage;
     QString newFilename;
     QgsRectangle filterExtent = dialog->filterExtent();
+
+    QProgressDialog pd( 0, tr( "Abort..." ), 0, 0 );
+    pd.setWindowModality( Qt::WindowModal );
+    pd.setMinimumDuration( 1000 );
+
     error = QgsVectorFileWriter::writeAsVectorFormat(
               vlayer, vectorFilename, encoding, ct, format,
               dialog->onlySelected(),
@@ -5127,7 +5132,8 @@ void QgisApp::saveAsVectorFileGeneral( QgsVectorLayer* vlayer, bool symbologyOpt
               &newFilename,
               ( QgsVectorFileWriter::SymbologyExport )( dialog->symbologyExport() ),
               dialog->scaleDenominator(),
-              dialog->hasFilterExtent() ? &filterExtent : 0 );
+              dialog->hasFilterExtent() ? &filterExtent : 0,
+              &pd );
 
     delete ct;
 
@@ -5143,6 +5149,10 @@ void QgisApp::saveAsVectorFileGeneral( QgsVectorLayer* vlayer, bool symbologyOpt
                                  tr( "Export to vector file has been completed" ),
                                  QgsMessageBar::INFO, messageTimeout() );
     }
+    else if ( error == QgsVectorFileWriter::ErrUserCanceled )
+    {
+      messageBar()->pushMessage( tr( "Saving canceled" ), errorMessage, QgsMessageBar::WARNING, messageTimeout() );
+    }
     else
     {
       QgsMessageViewer *m = new QgsMessageViewer( 0 );
@@ -0,0 +1,203 @@
+/***************************************************************************
+                             qgsatlasexporter.cpp
+                             --------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsatlasexporter.h"
+
+#include "qgsatlascomposition.h"
+#include "qgscomposition.h"
+#include "qgslogger.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMutex>
+#include <QProgressDialog>
+#include <QRunnable>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+/** State shared by the image writers of one export */
+struct QgsAtlasExportJob
+{
+  QgsAtlasExportJob( const QString& format, int maxPending )
+      : format( format ), maxPending( maxPending ), pending( 0 ), stop( 0 ) {}
+
+  QString format;
+  int maxPending;                     //!< maximum number of images rendered but not written yet
+
+  QMutex mutex;
+  QWaitCondition written;
+  int pending;                        //!< images rendered but not written yet (guarded by the mutex)
+  QString errorMessage;               //!< first error (guarded by the mutex)
+  QAtomicInt stop;                    //!< set on error
+
+  void setError( const QString& message )
+  {
+    QMutexLocker locker( &mutex );
+    if ( errorMessage.isEmpty() )
+      errorMessage = message;
+    stop = 1;
+  }
+
+  //! Wait until another image may be queued for writing
+  void acquire()
+  {
+    QMutexLocker locker( &mutex );
+    while ( pending >= maxPending )
+      written.wait( &mutex );
+    pending++;
+  }
+
+  void release()
+  {
+    QMutexLocker locker( &mutex );
+    pending--;
+    written.wakeAll();
+  }
+};
+
+/** Writes a rendered page of an atlas feature */
+class QgsAtlasImageWriter : public QRunnable
+{
+  public:
+    QgsAtlasImageWriter( QgsAtlasExportJob* job, const QImage& image, const QString& filename )
+        : mJob( job ), mImage( image ), mFilename( filename ) {}
+
+    void run()
+    {
+      if ( !mJob->stop && !mImage.save( mFilename, mJob->format.toLocal8Bit().constData() ) )
+        mJob->setError( QObject::tr( "Error creating %1." ).arg( mFilename ) );
+
+      // free the image before the next one may be rendered
+      mImage = QImage();
+      mJob->release();
+    }
+
+  private:
+    QgsAtlasExportJob* mJob;
+    QImage mImage;
+    QString mFilename;
+};
+
+static void writeWorldFile( QgsComposition* composition, const QString& filename )
+{
+  double a, b, c, d, e, f;
+  composition->computeWorldFileParameters( a, b, c, d, e, f );
+
+  QFileInfo fi( filename );
+  QString worldFileName = fi.absolutePath() + "/" + fi.baseName() + "."
+                          + fi.suffix()[0] + fi.suffix()[fi.suffix().size()-1] + "w";
+
+  QFile worldFile( worldFileName );
+  if ( worldFile.open( QIODevice::WriteOnly | QIODevice::Text ) )
+  {
+    // QString::number does not use locale settings (for the decimal point)
+    QTextStream fout( &worldFile );
+    fout << QString::number( a, 'f' ) << "\r\n";
+    fout << QString::number( d, 'f' ) << "\r\n";
+    fout << QString::number( b, 'f' ) << "\r\n";
+    fout << QString::number( e, 'f' ) << "\r\n";
+    fout << QString::number( c, 'f' ) << "\r\n";
+    fout << QString::number( f, 'f' ) << "\r\n";
+  }
+}
+
+
+QgsAtlasExporter::QgsAtlasExporter( QgsComposition* composition )
+    : mComposition( composition )
+    , mThreadCount( 0 )
+{
+}
+
+QgsAtlasExporter::~QgsAtlasExporter()
+{
+}
+
+bool QgsAtlasExporter::exportImages( const QString& directory, const QString& format, const QString& fileExt, QProgressDialog* progress )
+{
+  mErrorMessage.clear();
+
+  QgsAtlasComposition& atlas = mComposition->atlasComposition();
+
+  int count = mThreadCount > 0 ? mThreadCount : QThread::idealThreadCount();
+  count = qMax( 1, count );
+  QgsDebugMsg( QString( "exporting %1 atlas features with %2 writer threads" ).arg( atlas.numFeatures() ).arg( count ) );
+
+  QgsAtlasExportJob job( format, 2 * count );
+  QThreadPool pool;
+  pool.setMaxThreadCount( count );
+
+  bool canceled = false;
+  for ( int feature = 0; feature < atlas.numFeatures() && !job.stop; ++feature )
+  {
+    if ( progress )
+    {
+      progress->setValue( feature );
+      // process input events in order to allow cancelling
+      QCoreApplication::processEvents();
+      if ( progress->wasCanceled() )
+      {
+        canceled = true;
+        break;
+      }
+    }
+
+    // the coverage layer and the composition items are only used in this thread
+    if ( !atlas.prepareForFeature( feature ) )
+    {
+      job.setError( QObject::tr( "Atlas processing error" ) );
+      break;
+    }
+
+    QString filename = QDir( directory ).filePath( atlas.currentFilename() ) + fileExt;
+
+    for ( int i = 0; i < mComposition->numPages() && !job.stop; ++i )
+    {
+      if ( !mComposition->shouldExportPage( i + 1 ) )
+      {
+        continue;
+      }
+      QString imageFilename = filename;
+      if ( i != 0 )
+      {
+        //append page number
+        QFileInfo fi( filename );
+        imageFilename = fi.absolutePath() + "/" + fi.baseName() + "_" + QString::number( i + 1 ) + "." + fi.suffix();
+      }
+
+      job.acquire();
+      pool.start( new QgsAtlasImageWriter( &job, mComposition->printPageAsRaster( i ), imageFilename ) );
+    }
+
+    if ( mComposition->generateWorldFile() )
+    {
+      writeWorldFile( mComposition, filename );
+    }
+  }
+
+  pool.waitForDone();
+
+  if ( progress && !canceled )
+    progress->setValue( atlas.numFeatures() );
+
+  mErrorMessage = job.errorMessage;
+  if ( canceled && mErrorMessage.isEmpty() )
+    mErrorMessage = QObject::tr( "Export canceled" );
+
+  return !canceled && mErrorMessage.isEmpty();
+}
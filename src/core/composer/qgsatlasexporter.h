@@ -0,0 +1,68 @@
+/***************************************************************************
+                             qgsatlasexporter.h
+                             ------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************/
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSATLASEXPORTER_H
+#define QGSATLASEXPORTER_H
+
+#include <QString>
+
+class QgsComposition;
+class QProgressDialog;
+
+/** \ingroup MapComposer
+ * Exports the features of an atlas as images, one or more files per feature.
+ *
+ * The features are prepared and their pages rendered one after the other in the
+ * calling thread, which must be the thread of the composition (the GUI thread),
+ * exactly like with the sequential export. Encoding and writing the images is
+ * done by worker threads meanwhile, while the next pages are rendered. The number
+ * of rendered pages waiting to be written is bounded.
+ *
+ * @note added in 2.8
+ */
+class CORE_EXPORT QgsAtlasExporter
+{
+  public:
+    /** The composition must have an enabled atlas, which has been prepared for
+     * the export (with QgsComposition::setAtlasMode() or QgsAtlasComposition::beginRender())
+     */
+    QgsAtlasExporter( QgsComposition* composition );
+    ~QgsAtlasExporter();
+
+    //! Set the number of threads writing the images, 0 for the ideal thread count (default)
+    void setThreadCount( int count ) { mThreadCount = count; }
+    //! Return the number of threads writing the images, 0 for the ideal thread count
+    int threadCount() const { return mThreadCount; }
+
+    /** Export every page of every feature as an image, named after the atlas filename pattern
+     * (with page number appended for pages after the first one) in the given directory.
+     * A world file is written too if the composition generates one.
+     * @param directory output directory
+     * @param format image format, as used by QImage::save()
+     * @param fileExt extension of the image files including the dot, e.g. ".png"
+     * @param progress optional progress dialog, the export stops when it is canceled
+     * @returns false on error (see errorMessage()) or if canceled
+     */
+    bool exportImages( const QString& directory, const QString& format, const QString& fileExt, QProgressDialog* progress = 0 );
+
+    //! Return the error of the last export
+    QString errorMessage() const { return mErrorMessage; }
+
+  private:
+    QgsComposition* mComposition;
+    int mThreadCount;
+    QString mErrorMessage;
+};
+
+#endif // QGSATLASEXPORTER_H
@@ -24,6 +24,7 @@
 #include "qgslogger.h"
 #include "qgsmaprenderer.h"
 #include "qgsmaprenderercustompainterjob.h"
+#include "qgsmaprenderertiledjob.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaptopixel.h"
 #include "qgsproject.h"
@@ -182,14 +183,50 @@ void QgsComposerMap::draw( QPainter *painter, const QgsRectangle& extent, const
   }
 
 
+  QgsMapSettings ms = mapSettings( extent, size, dpi );
+
+  if ( useRasterRendering( painter, ms ) )
+  {
+    // Render the layers in parallel into images at the output resolution and composite them.
+    // Very large maps are rendered in tiles, so that the memory used by the images stays bounded.
+    QSettings settings;
+    QgsMapRendererTiledJob job( ms, painter, settings.value( "/qgis/composerRenderTileSize", 4096 ).toInt() );
+    job.start();
+    return;
+  }
+
   // render
-  QgsMapRendererCustomPainterJob job( mapSettings( extent, size, dpi ), painter );
+  QgsMapRendererCustomPainterJob job( ms, painter );
   // Render the map in this thread. This is done because of problems
   // with printing to printer on Windows (printing to PDF is fine though).
   // Raster images were not displayed - see #10599
   job.renderSynchronously();
 }
 
+bool QgsComposerMap::useRasterRendering( QPainter* painter, const QgsMapSettings& ms ) const
+{
+  // keep vector output for PDF, SVG and printers
+  if ( !painter->device() || painter->device()->devType() != QInternal::Image )
+    return false;
+
+  QSettings settings;
+  if ( !settings.value( "/qgis/composerParallelRendering", true ).toBool() )
+    return false;
+
+  if ( ms.testFlag( QgsMapSettings::UseAdvancedEffects ) )
+  {
+    // layer blending must be done with the items below the map, not within the map image
+    foreach ( QString layerId, ms.layers() )
+    {
+      QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+      if ( layer && layer->blendMode() != QPainter::CompositionMode_SourceOver )
+        return false;
+    }
+  }
+
+  return true;
+}
+
 QgsMapSettings QgsComposerMap::mapSettings( const QgsRectangle& extent, const QSizeF& size, int dpi ) const
 {
   const QgsMapSettings& ms = mComposition->mapSettings();
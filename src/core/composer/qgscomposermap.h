@@ -873,6 +873,10 @@ class CORE_EXPORT QgsComposerMap : public QgsComposerItem
      * center of extent remains the same */
     void adjustExtentToItemShape( double itemWidth, double itemHeight, QgsRectangle& extent ) const;
 
+    /**True if the map should be drawn with the layers rendered in parallel into images
+     * (QgsMapRendererTiledJob), false for the vector output of QgsMapRendererCustomPainterJob */
+    bool useRasterRendering( QPainter* painter, const QgsMapSettings& ms ) const;
+
     /**True if map is being controlled by an atlas*/
     bool mAtlasDriven;
     /**Current atlas scaling mode*/
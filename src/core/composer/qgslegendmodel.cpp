@@ -27,6 +27,7 @@
 #include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 #include <QApplication>
+#include <QThread>
 #include <QDomDocument>
 #include <QDomElement>
 #include <QMimeData>
@@ -43,8 +44,9 @@ QgsLegendModel::QgsLegendModel(): QStandardItemModel(), mAutoUpdate( true )
     connect( QgsMapLayerRegistry::instance(), SIGNAL( layerWasAdded( QgsMapLayer* ) ), this, SLOT( addLayer( QgsMapLayer* ) ) );
   }
 
-  QWidgetList topLevelWidgets = QApplication::topLevelWidgets();
-  mHasTopLevelWindow = ( topLevelWidgets.size() > 0 );
+  // pixmaps (and the list of top level widgets) can only be used in the GUI thread
+  mHasTopLevelWindow = QThread::currentThread() == QApplication::instance()->thread()
+                       && QApplication::topLevelWidgets().size() > 0;
 }
 
 QgsLegendModel::~QgsLegendModel()
@@ -38,11 +38,18 @@
 #include "qgsmaplayerregistry.h"
 
 #include <QIODevice>
+#include <QSet>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 
 #define DXF_HANDSEED 100
 #define DXF_HANDMAX 9999999
 #define DXF_HANDPLOTSTYLE 0xf
 
+// the output is written to the device in blocks of this size
+static const int DXF_BUFFER_SIZE = 1 << 20;
+
 //dxf color palette
 int QgsDxfExport::mDxfColors[][3] =
 {
@@ -308,6 +315,9 @@ QgsDxfExport::QgsDxfExport()
     : mSymbologyScaleDenominator( 1.0 )
     , mSymbologyExport( NoSymbology )
     , mMapUnits( QGis::Meters )
+    , mDevice( 0 )
+    , mCodec( 0 )
+    , mDeferHandles( false )
     , mSymbolLayerCounter( 0 )
     , mNextHandleId( DXF_HANDSEED )
     , mBlockCounter( 0 )
@@ -315,6 +325,9 @@ QgsDxfExport::QgsDxfExport()
 }
 
 QgsDxfExport::QgsDxfExport( const QgsDxfExport& dxfExport )
+    : mDevice( 0 )
+    , mCodec( 0 )
+    , mDeferHandles( false )
 {
   *this = dxfExport;
 }
@@ -394,27 +407,91 @@ void QgsDxfExport::writeGroup( QColor color, int exactMatchCode, int rgbCode, in
     writeGroup( transparencyCode, 0x2000000 | color.alpha() );
 }
 
+// write integer right aligned in a field of the given width, followed by a newline
+static inline int formatInt( char* buf, int i, int width )
+{
+  char digits[16];
+  int n = 0;
+  unsigned int u = i < 0 ? -( unsigned int ) i : i;
+  do
+  {
+    digits[n++] = '0' + u % 10;
+    u /= 10;
+  }
+  while ( u > 0 );
+  if ( i < 0 )
+    digits[n++] = '-';
+
+  int len = 0;
+  for ( ; len < width - n; ++len )
+    buf[len] = ' ';
+  while ( n > 0 )
+    buf[len++] = digits[--n];
+  buf[len++] = '\n';
+  return len;
+}
+
 void QgsDxfExport::writeGroupCode( int code )
 {
-  mTextStream << QString( "%1\n" ).arg( code, 3, 10, QChar( ' ' ) );
+  char buf[32];
+  write( buf, formatInt( buf, code, 3 ) );
 }
 
 void QgsDxfExport::writeInt( int i )
 {
-  mTextStream << QString( "%1\n" ).arg( i, 6, 10, QChar( ' ' ) );
+  char buf[32];
+  write( buf, formatInt( buf, i, 6 ) );
 }
 
 void QgsDxfExport::writeDouble( double d )
 {
-  QString s( qgsDoubleToString( d ) );
-  if ( !s.contains( "." ) )
-    s += ".0";
-  mTextStream << s << "\n";
+  // same as qgsDoubleToString(), without the regular expression
+  QByteArray s( QByteArray::number( d, 'f', 17 ) );
+  int len = s.size();
+  int dot = s.indexOf( '.' );
+  if ( dot >= 0 )
+  {
+    while ( len > dot + 1 && s[len - 1] == '0' )
+      --len;
+    if ( len == dot + 1 )
+      len = dot;
+  }
+  write( s.constData(), len );
+  if ( dot < 0 || len == dot )
+    write( ".0\n", 3 );
+  else
+    write( "\n", 1 );
 }
 
 void QgsDxfExport::writeString( const QString& s )
 {
-  mTextStream << s << "\n";
+  write( mCodec ? mCodec->fromUnicode( s ) : s.toLatin1() );
+  write( "\n", 1 );
+}
+
+void QgsDxfExport::write( const char* data, int len )
+{
+  if ( mDevice && len >= DXF_BUFFER_SIZE )
+  {
+    // e.g. the entities of a layer
+    flush();
+    mDevice->write( data, len );
+    return;
+  }
+
+  mBuffer.append( data, len );
+  if ( mDevice && mBuffer.size() >= DXF_BUFFER_SIZE )
+    flush();
+}
+
+void QgsDxfExport::flush()
+{
+  if ( mDevice && !mBuffer.isEmpty() )
+  {
+    mDevice->write( mBuffer );
+    mBuffer.clear();
+    mBuffer.reserve( DXF_BUFFER_SIZE + 1024 );
+  }
 }
 
 int QgsDxfExport::writeToFile( QIODevice* d )
@@ -429,8 +506,10 @@ int QgsDxfExport::writeToFile( QIODevice* d )
     return 2;
   }
 
-  mTextStream.setDevice( d );
-  mTextStream.setCodec( "Windows-1252" );
+  mDevice = d;
+  mCodec = QTextCodec::codecForName( "Windows-1252" );
+  mBuffer.clear();
+  mBuffer.reserve( DXF_BUFFER_SIZE + 1024 );
 
   writeHeader();
   writeTables();
@@ -438,6 +517,10 @@ int QgsDxfExport::writeToFile( QIODevice* d )
   writeEntities();
   writeEndFile();
 
+  flush();
+  mBuffer.clear();
+  mDevice = 0;
+
   return 0;
 }
 
@@ -488,12 +571,23 @@ void QgsDxfExport::writeHeader()
 
 int QgsDxfExport::writeHandle( int code, int handle )
 {
+  if ( handle == 0 && mDeferHandles )
+  {
+    // numbered in appendEntities()
+    writeGroupCode( code );
+    mHandleOffsets << mBuffer.size();
+    write( "\n", 1 );
+    return 0;
+  }
+
   if ( handle == 0 )
     handle = mNextHandleId++;
 
   Q_ASSERT_X( handle < DXF_HANDMAX, "QgsDxfExport::writeHandle(int, int)", "DXF handle too large" );
 
-  writeGroup( code, QString( "%1" ).arg( handle, 0, 16 ) );
+  writeGroupCode( code );
+  write( QByteArray::number( handle, 16 ) );
+  write( "\n", 1 );
   return handle;
 }
 
@@ -825,9 +919,25 @@ void QgsDxfExport::writeEntities()
   QgsDxfPalLabeling labelEngine( this, mExtent.isEmpty() ? dxfExtent() : mExtent, mSymbologyScaleDenominator, mMapUnits );
   QgsRenderContext& ctx = labelEngine.renderContext();
 
-  // iterate through the maplayers
-  QList< QPair< QgsVectorLayer*, int > >::iterator layerIt = mLayers.begin();
-  for ( ; layerIt != mLayers.end(); ++layerIt )
+  // The entities of each layer are written by a worker thread into the buffer of its own export
+  // and appended in the order of the layers. A layer which is exported more than once uses
+  // the same renderer, so then the layers are written one after another.
+  bool parallel = true;
+  QSet<QgsVectorLayer*> uniqueLayers;
+  QList< QPair< QgsVectorLayer*, int > >::const_iterator layerIt = mLayers.constBegin();
+  for ( ; layerIt != mLayers.constEnd(); ++layerIt )
+  {
+    if ( uniqueLayers.contains( layerIt->first ) )
+      parallel = false;
+    uniqueLayers << layerIt->first;
+  }
+
+  QList<QgsVectorLayer*> layers;
+  QList<int> layerAttrs;
+  QList<QStringList> layerAttributes;
+  QList<QgsDxfPalLabeling*> layerLabelEngines;
+
+  for ( layerIt = mLayers.constBegin(); layerIt != mLayers.constEnd(); ++layerIt )
   {
     QgsVectorLayer* vl = layerIt->first;
     if ( !vl || !layerIsScaleBasedVisible( vl ) )
@@ -835,7 +945,6 @@ void QgsDxfExport::writeEntities()
       continue;
     }
 
-    QgsSymbolV2RenderContext sctx( ctx, QgsSymbolV2::MM, 1.0, false, 0, 0 );
     QgsFeatureRendererV2* renderer = vl->rendererV2();
     renderer->startRender( ctx, vl->pendingFields() );
 
@@ -847,81 +956,154 @@ void QgsDxfExport::writeEntities()
         attributes << layerAttr;
     }
 
-    bool labelLayer = labelEngine.prepareLayer( vl, attributes, ctx ) != 0;
+    // the labeling engine is prepared here, the workers only register the features
+    QgsDxfPalLabeling* layerLabelEngine = labelEngine.prepareLayer( vl, attributes, ctx ) != 0 ? &labelEngine : 0;
 
-    if ( mSymbologyExport == QgsDxfExport::SymbolLayerSymbology &&
-         ( renderer->capabilities() & QgsFeatureRendererV2::SymbolLevels ) &&
-         renderer->usingSymbolLevels() )
+    if ( !parallel )
     {
-      writeEntitiesSymbolLevels( vl );
+      QgsDxfExport layerExport;
+      layerExport.initLayerEntities( *this );
+      layerExport.writeLayerEntities( vl, layerIt->second, attributes, ctx, layerLabelEngine );
       renderer->stopRender( ctx );
+      appendEntities( layerExport );
       continue;
     }
 
-    QgsFeatureRequest freq = QgsFeatureRequest().setSubsetOfAttributes( attributes, vl->pendingFields() );
-    if ( !mExtent.isEmpty() )
+    layers << vl;
+    layerAttrs << layerIt->second;
+    layerAttributes << attributes;
+    layerLabelEngines << layerLabelEngine;
+  }
+
+  // At most as many layers as there are threads in the pool are written at the same time. Each
+  // layer is appended (and written to the device) as soon as it and the layers before it are
+  // finished, so only the buffers of the layers being written are held.
+  int maxPending = qMax( QThreadPool::globalInstance()->maxThreadCount(), 1 );
+  QList<QgsDxfExport*> layerExports;
+  QList< QFuture<void> > futures;
+
+  for ( int i = 0; i < layers.size(); ++i )
+  {
+    while ( layerExports.size() < layers.size() && layerExports.size() < i + maxPending )
     {
-      freq.setFilterRect( mExtent );
+      int j = layerExports.size();
+      QgsDxfExport* layerExport = new QgsDxfExport();
+      layerExport->initLayerEntities( *this );
+      layerExports << layerExport;
+      futures << QtConcurrent::run( layerExport, &QgsDxfExport::writeLayerEntities, layers[j], layerAttrs[j], layerAttributes[j], ctx, layerLabelEngines[j] );
     }
 
-    QgsFeatureIterator featureIt = vl->getFeatures( freq );
-    QgsFeature fet;
-    while ( featureIt.nextFeature( fet ) )
-    {
-      QString layerName( dxfLayerName( layerIt->second == -1 ? vl->name() : fet.attribute( layerIt->second ).toString() ) );
+    futures[i].waitForFinished();
+    layers[i]->rendererV2()->stopRender( ctx );
+
+    appendEntities( *layerExports[i] );
+    delete layerExports[i];
+    layerExports[i] = 0;
+  }
 
-      sctx.setFeature( &fet );
-      if ( mSymbologyExport == NoSymbology )
+  labelEngine.drawLabeling( ctx );
+  endSection();
+}
+
+void QgsDxfExport::initLayerEntities( const QgsDxfExport& parent )
+{
+  *this = parent;
+  mExtent = parent.mExtent;
+  mLineStyles = parent.mLineStyles;
+  mPointSymbolBlocks = parent.mPointSymbolBlocks;
+  mModelSpaceBR = parent.mModelSpaceBR;
+  mCodec = parent.mCodec;
+  mDeferHandles = true;
+}
+
+void QgsDxfExport::writeLayerEntities( QgsVectorLayer* vl, int layerAttr, QStringList attributes, QgsRenderContext ctx, QgsDxfPalLabeling* labelEngine )
+{
+  QgsFeatureRendererV2* renderer = vl->rendererV2();
+
+  if ( mSymbologyExport == QgsDxfExport::SymbolLayerSymbology &&
+       ( renderer->capabilities() & QgsFeatureRendererV2::SymbolLevels ) &&
+       renderer->usingSymbolLevels() )
+  {
+    writeEntitiesSymbolLevels( vl );
+    return;
+  }
+
+  QgsSymbolV2RenderContext sctx( ctx, QgsSymbolV2::MM, 1.0, false, 0, 0 );
+
+  QgsFeatureRequest freq = QgsFeatureRequest().setSubsetOfAttributes( attributes, vl->pendingFields() );
+  if ( !mExtent.isEmpty() )
+  {
+    freq.setFilterRect( mExtent );
+  }
+
+  QgsFeatureIterator featureIt = vl->getFeatures( freq );
+  QgsFeature fet;
+  while ( featureIt.nextFeature( fet ) )
+  {
+    QString layerName( dxfLayerName( layerAttr == -1 ? vl->name() : fet.attribute( layerAttr ).toString() ) );
+
+    sctx.setFeature( &fet );
+    if ( mSymbologyExport == NoSymbology )
+    {
+      addFeature( sctx, layerName, 0, 0 ); //no symbology at all
+    }
+    else
+    {
+      if ( !renderer )
       {
-        addFeature( sctx, layerName, 0, 0 ); //no symbology at all
+        continue;
       }
-      else
+      QgsSymbolV2List symbolList = renderer->symbolsForFeature( fet );
+      if ( symbolList.size() < 1 )
       {
-        if ( !renderer )
-        {
-          continue;
-        }
-        QgsSymbolV2List symbolList = renderer->symbolsForFeature( fet );
-        if ( symbolList.size() < 1 )
-        {
-          continue;
-        }
+        continue;
+      }
 
-        if ( mSymbologyExport == QgsDxfExport::SymbolLayerSymbology ) //symbol layer symbology, but layer does not use symbol levels
+      if ( mSymbologyExport == QgsDxfExport::SymbolLayerSymbology ) //symbol layer symbology, but layer does not use symbol levels
+      {
+        QgsSymbolV2List::iterator symbolIt = symbolList.begin();
+        for ( ; symbolIt != symbolList.end(); ++symbolIt )
         {
-          QgsSymbolV2List::iterator symbolIt = symbolList.begin();
-          for ( ; symbolIt != symbolList.end(); ++symbolIt )
+          int nSymbolLayers = ( *symbolIt )->symbolLayerCount();
+          for ( int i = 0; i < nSymbolLayers; ++i )
           {
-            int nSymbolLayers = ( *symbolIt )->symbolLayerCount();
-            for ( int i = 0; i < nSymbolLayers; ++i )
-            {
-              addFeature( sctx, layerName, ( *symbolIt )->symbolLayer( i ), *symbolIt );
-            }
+            addFeature( sctx, layerName, ( *symbolIt )->symbolLayer( i ), *symbolIt );
           }
         }
-        else
+      }
+      else
+      {
+        //take first symbollayer from first symbol
+        QgsSymbolV2* s = symbolList.first();
+        if ( !s || s->symbolLayerCount() < 1 )
         {
-          //take first symbollayer from first symbol
-          QgsSymbolV2* s = symbolList.first();
-          if ( !s || s->symbolLayerCount() < 1 )
-          {
-            continue;
-          }
-          addFeature( sctx, layerName, s->symbolLayer( 0 ), s );
+          continue;
         }
+        addFeature( sctx, layerName, s->symbolLayer( 0 ), s );
+      }
 
-        if ( labelLayer )
-        {
-          labelEngine.registerFeature( vl->id(), fet, ctx, layerName );
-        }
+      if ( labelEngine )
+      {
+        labelEngine->registerFeature( vl->id(), fet, ctx, layerName );
       }
     }
-
-    renderer->stopRender( ctx );
   }
+}
 
-  labelEngine.drawLabeling( ctx );
-  endSection();
+void QgsDxfExport::appendEntities( const QgsDxfExport& layerExport )
+{
+  const QByteArray& data = layerExport.mBuffer;
+  int pos = 0;
+  foreach ( int offset, layerExport.mHandleOffsets )
+  {
+    write( data.constData() + pos, offset - pos );
+    pos = offset;
+
+    int handle = mNextHandleId++;
+    Q_ASSERT_X( handle < DXF_HANDMAX, "QgsDxfExport::appendEntities(const QgsDxfExport&)", "DXF handle too large" );
+    write( QByteArray::number( handle, 16 ) );
+  }
+  write( data.constData() + pos, data.size() - pos );
 }
 
 void QgsDxfExport::writeEntitiesSymbolLevels( QgsVectorLayer* layer )
@@ -1022,7 +1204,7 @@ void QgsDxfExport::writeEntitiesSymbolLevels( QgsVectorLayer* layer )
 void QgsDxfExport::writeEndFile()
 {
   // From GDAL trailer.dxf
-  mTextStream << "\
+  write( "\
   0\n\
 SECTION\n\
   2\n\
@@ -3181,7 +3363,7 @@ AcDbSavedByObjectVersion\n\
      0\n\
   0\n\
 ENDSEC\n\
-";
+" );
 
   writeGroup( 0, "EOF" );
 }
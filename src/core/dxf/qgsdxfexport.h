@@ -24,10 +24,12 @@
 #include <QList>
 #include <QTextStream>
 
+class QgsDxfPalLabeling;
 class QgsMapLayer;
 class QgsPoint;
 class QgsSymbolLayerV2;
 class QIODevice;
+class QTextCodec;
 
 class CORE_EXPORT QgsDxfExport
 {
@@ -111,7 +113,17 @@ class CORE_EXPORT QgsDxfExport
     SymbologyExport mSymbologyExport;
     QGis::UnitType mMapUnits;
 
-    QTextStream mTextStream;
+    /**Output device, the output is collected in mBuffer and written in large blocks*/
+    QIODevice* mDevice;
+    QByteArray mBuffer;
+    QTextCodec* mCodec;
+
+    /**Set for the exports which write the entities of one layer in a worker thread. Their
+      handles are only numbered when the entities are appended to the file (see appendEntities()),
+      so that the numbering is the same as with the sequential export*/
+    bool mDeferHandles;
+    /**Offsets in mBuffer where the deferred handles are inserted*/
+    QList<int> mHandleOffsets;
 
     static int mDxfColors[][3];
 
@@ -133,6 +145,17 @@ class CORE_EXPORT QgsDxfExport
     void startSection();
     void endSection();
 
+    void write( const char* data, int len );
+    void write( const QByteArray& data ) { write( data.constData(), data.size() ); }
+    void flush();
+
+    /**Prepare export of the entities of one layer into the buffer of this object*/
+    void initLayerEntities( const QgsDxfExport& parent );
+    /**Write the features of a layer (called in a worker thread), labelEngine is 0 if the layer is not labeled*/
+    void writeLayerEntities( QgsVectorLayer* vl, int layerAttr, QStringList attributes, QgsRenderContext ctx, QgsDxfPalLabeling* labelEngine );
+    /**Append the entities written by another export, numbering its deferred handles*/
+    void appendEntities( const QgsDxfExport& layerExport );
+
     void writePoint( const QgsPoint& pt, const QString& layer, QColor color, const QgsFeature* f, const QgsSymbolLayerV2* symbolLayer, const QgsSymbolV2* symbol );
     void writeVertex( const QgsPoint& pt, const QString& layer );
     void writeDefaultLinetypes();
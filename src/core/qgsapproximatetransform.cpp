@@ -0,0 +1,223 @@
+/***************************************************************************
+    qgsapproximatetransform.cpp
+    ---------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsapproximatetransform.h"
+
+#include "qgscoordinatetransform.h"
+#include "qgscsexception.h"
+#include "qgslogger.h"
+
+#include <QPolygonF>
+
+#include <limits>
+
+// the grid starts with this number of cells in each direction
+static const int INITIAL_GRID_SIZE = 8;
+// and is refined until it has this number of cells at most
+static const int MAX_GRID_SIZE = 128;
+
+/** Transforms the points in one go, points which cannot be transformed are set to infinity */
+static void _transformGridPoints( const QgsCoordinateTransform* ct, int numPoints, double* xy )
+{
+  QVector<double> orig( 2 * numPoints );
+  qCopy( xy, xy + 2 * numPoints, orig.begin() );
+  try
+  {
+    ct->transformInPlace( numPoints, xy );
+    return;
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+  }
+
+  // some points are out of the domain of the projection, find them one by one
+  for ( int i = 0; i < numPoints; ++i )
+  {
+    double x = orig[2 * i], y = orig[2 * i + 1], z = 0;
+    try
+    {
+      ct->transformInPlace( x, y, z );
+    }
+    catch ( QgsCsException &cse )
+    {
+      Q_UNUSED( cse );
+      x = y = std::numeric_limits<double>::infinity();
+    }
+    xy[2 * i] = x;
+    xy[2 * i + 1] = y;
+  }
+}
+
+QgsApproximateTransform::QgsApproximateTransform( const QgsCoordinateTransform* ct, const QgsRectangle& extent, double tolerance )
+    : mTransform( ct )
+    , mExtent( extent )
+    , mTolerance( tolerance )
+    , mCols( 0 )
+    , mRows( 0 )
+    , mCellWidth( 0 )
+    , mCellHeight( 0 )
+    , mApproximatedCells( 0 )
+{
+  if ( !ct || extent.isEmpty() || !extent.isFinite() || tolerance <= 0 )
+    return;
+
+  try
+  {
+    int size = INITIAL_GRID_SIZE;
+    while ( calc( size ) > 0 && size * 2 <= MAX_GRID_SIZE )
+      size *= 2;
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    QgsDebugMsg( "transformation of the grid failed: " + cse.what() );
+    mCellApproximated.fill( false );
+    mApproximatedCells = 0;
+  }
+
+  QgsDebugMsg( QString( "grid %1x%2, %3 cells approximated" ).arg( mCols ).arg( mRows ).arg( mApproximatedCells ) );
+}
+
+int QgsApproximateTransform::calc( int size )
+{
+  mCols = mRows = size;
+  mCellWidth = mExtent.width() / mCols;
+  mCellHeight = mExtent.height() / mRows;
+
+  // control points
+  mPoints.resize( 2 * ( mRows + 1 ) * ( mCols + 1 ) );
+  double* ptr = mPoints.data();
+  for ( int row = 0; row <= mRows; ++row )
+  {
+    for ( int col = 0; col <= mCols; ++col )
+    {
+      *ptr++ = mExtent.xMinimum() + col * mCellWidth;
+      *ptr++ = mExtent.yMinimum() + row * mCellHeight;
+    }
+  }
+  _transformGridPoints( mTransform, ( mRows + 1 ) * ( mCols + 1 ), mPoints.data() );
+
+  // centres of the cells, where the error of bilinear interpolation is estimated
+  QVector<double> centers( 2 * mRows * mCols );
+  ptr = centers.data();
+  for ( int row = 0; row < mRows; ++row )
+  {
+    for ( int col = 0; col < mCols; ++col )
+    {
+      *ptr++ = mExtent.xMinimum() + ( col + 0.5 ) * mCellWidth;
+      *ptr++ = mExtent.yMinimum() + ( row + 0.5 ) * mCellHeight;
+    }
+  }
+  _transformGridPoints( mTransform, mRows * mCols, centers.data() );
+
+  mCellApproximated.fill( false, mRows * mCols );
+  mApproximatedCells = 0;
+  double sqrTolerance = mTolerance * mTolerance;
+  for ( int row = 0; row < mRows; ++row )
+  {
+    for ( int col = 0; col < mCols; ++col )
+    {
+      const double* p0 = mPoints.constData() + 2 * ( row * ( mCols + 1 ) + col );
+      const double* p1 = p0 + 2 * ( mCols + 1 );
+      const double* c = centers.constData() + 2 * ( row * mCols + col );
+
+      double x = ( p0[0] + p0[2] + p1[0] + p1[2] ) / 4;
+      double y = ( p0[1] + p0[3] + p1[1] + p1[3] ) / 4;
+      double dx = x - c[0];
+      double dy = y - c[1];
+      // comparison fails also if any of the points could not be transformed (inf/nan)
+      if ( dx * dx + dy * dy <= sqrTolerance )
+      {
+        mCellApproximated[row * mCols + col] = true;
+        ++mApproximatedCells;
+      }
+    }
+  }
+
+  return mRows * mCols - mApproximatedCells;
+}
+
+bool QgsApproximateTransform::interpolate( double& x, double& y ) const
+{
+  if ( mApproximatedCells == 0 )
+    return false;
+
+  double fx = ( x - mExtent.xMinimum() ) / mCellWidth;
+  double fy = ( y - mExtent.yMinimum() ) / mCellHeight;
+  if ( !( fx >= 0 && fx <= mCols && fy >= 0 && fy <= mRows ) )
+    return false;
+
+  int col = qMin(( int ) fx, mCols - 1 );
+  int row = qMin(( int ) fy, mRows - 1 );
+  if ( !mCellApproximated[row * mCols + col] )
+    return false;
+
+  fx -= col;
+  fy -= row;
+  const double* p0 = mPoints.constData() + 2 * ( row * ( mCols + 1 ) + col );
+  const double* p1 = p0 + 2 * ( mCols + 1 );
+
+  double bottomX = p0[0] + ( p0[2] - p0[0] ) * fx;
+  double bottomY = p0[1] + ( p0[3] - p0[1] ) * fx;
+  double topX = p1[0] + ( p1[2] - p1[0] ) * fx;
+  double topY = p1[1] + ( p1[3] - p1[1] ) * fx;
+  x = bottomX + ( topX - bottomX ) * fy;
+  y = bottomY + ( topY - bottomY ) * fy;
+  return true;
+}
+
+void QgsApproximateTransform::transformInPlace( double& x, double& y ) const
+{
+  if ( interpolate( x, y ) )
+    return;
+
+  double z = 0;
+  mTransform->transformInPlace( x, y, z );
+}
+
+void QgsApproximateTransform::transformPolygon( QPolygonF& poly ) const
+{
+  // points which need the exact transform
+  QVector<int> indices;
+  QVector<double> xy;
+
+  QPointF* ptr = poly.data();
+  for ( int i = 0; i < poly.size(); ++i, ++ptr )
+  {
+    double x = ptr->x();
+    double y = ptr->y();
+    if ( interpolate( x, y ) )
+    {
+      ptr->rx() = x;
+      ptr->ry() = y;
+    }
+    else
+    {
+      indices << i;
+      xy << x << y;
+    }
+  }
+
+  if ( indices.isEmpty() )
+    return;
+
+  mTransform->transformInPlace( indices.count(), xy.data() );
+
+  for ( int i = 0; i < indices.count(); ++i )
+  {
+    QPointF& pt = poly[indices[i]];
+    pt.rx() = xy[2 * i];
+    pt.ry() = xy[2 * i + 1];
+  }
+}
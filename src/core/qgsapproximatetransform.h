@@ -0,0 +1,83 @@
+/***************************************************************************
+    qgsapproximatetransform.h
+    ---------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSAPPROXIMATETRANSFORM_H
+#define QGSAPPROXIMATETRANSFORM_H
+
+#include <QVector>
+
+#include "qgsrectangle.h"
+
+class QPolygonF;
+class QgsCoordinateTransform;
+
+/**
+ * Approximation of a forward coordinate transform within an extent of the source CRS.
+ *
+ * A grid of control points is transformed exactly and the points inside the grid
+ * are interpolated bilinearly from the corners of their cell. The grid is refined
+ * until the error estimated in the cell centres is below the given tolerance; cells
+ * which still do not meet it (and points outside the extent) use the exact transform.
+ *
+ * Like QgsRasterProjector, it avoids the cost of PROJ.4 for every vertex when
+ * rendering reprojected vector layers.
+ *
+ * @note added in 2.8
+ * @note not available in python bindings
+ */
+class CORE_EXPORT QgsApproximateTransform
+{
+  public:
+    /** Build grid of control points
+     * @param ct exact transform (not owned, must exist as long as this object)
+     * @param extent extent in source CRS to be covered by the grid
+     * @param tolerance maximal error of the approximation in destination CRS units
+     */
+    QgsApproximateTransform( const QgsCoordinateTransform* ct, const QgsRectangle& extent, double tolerance );
+
+    //! Return whether some points may be approximated (otherwise all use the exact transform)
+    bool isValid() const { return mApproximatedCells > 0; }
+
+    //! Return the exact transform
+    const QgsCoordinateTransform* coordinateTransform() const { return mTransform; }
+
+    //! Return number of columns and rows of the grid
+    int gridSize() const { return mCols; }
+
+    //! Transform point from source to destination CRS
+    void transformInPlace( double& x, double& y ) const;
+
+    //! Transform points from source to destination CRS, the exact transform is done in one call for all points which need it
+    void transformPolygon( QPolygonF& poly ) const;
+
+  private:
+    //! Transform grid points exactly and check the error in the cells, returns number of cells over tolerance
+    int calc( int size );
+
+    //! Interpolate point within the grid, returns false if it is outside or the cell needs the exact transform
+    bool interpolate( double& x, double& y ) const;
+
+    const QgsCoordinateTransform* mTransform;
+    QgsRectangle mExtent;
+    double mTolerance;
+
+    int mCols, mRows;
+    double mCellWidth, mCellHeight;
+    //! destination x,y of the control points, row by row from the bottom
+    QVector<double> mPoints;
+    //! whether the cells may be approximated
+    QVector<bool> mCellApproximated;
+    int mApproximatedCells;
+};
+
+#endif // QGSAPPROXIMATETRANSFORM_H
@@ -63,6 +63,8 @@ class QgsConnectionPoolGroup
     QgsConnectionPoolGroup( const QString& ci )
         : connInfo( ci )
         , sem( CONN_POOL_MAX_CONCURRENT_CONNS )
+        , maxConns( CONN_POOL_MAX_CONCURRENT_CONNS )
+        , retiredConns( 0 )
         , expirationTimer( 0 )
     {
     }
@@ -104,7 +106,8 @@ class QgsConnectionPoolGroup
       if ( !c )
       {
         // we didn't get connection for some reason, so release the lock
-        sem.release();
+        if ( !retireSlot() )
+          sem.release();
         return 0;
       }
 
@@ -127,11 +130,50 @@ class QgsConnectionPoolGroup
 
       connMutex.unlock();
 
-      sem.release(); // this can unlock a thread waiting in acquire()
+      if ( !retireSlot() )
+        sem.release(); // this can unlock a thread waiting in acquire()
     }
 
+    //! Set the maximal number of connections used at the same time (at least one).
+    //! When it is lowered, the connections in use count until they are released.
+    void setMaxConcurrentConnections( int max )
+    {
+      QMutexLocker locker( &connMutex );
+
+      max = qMax( max, 1 );
+      int delta = max - maxConns;
+      maxConns = max;
+      if ( delta > 0 )
+      {
+        // the slots still to be retired are kept instead
+        int kept = qMin( delta, retiredConns );
+        retiredConns -= kept;
+        if ( delta > kept )
+          sem.release( delta - kept );
+      }
+      else
+      {
+        // free slots are removed now, the others when their connections are released
+        while ( delta < 0 && sem.tryAcquire() )
+          ++delta;
+        retiredConns -= delta;
+      }
+    }
+
+    int maxConcurrentConnections() const { return maxConns; }
+
   protected:
 
+    //! returns true if a slot being released is retired after the maximum was lowered
+    bool retireSlot()
+    {
+      QMutexLocker locker( &connMutex );
+      if ( retiredConns == 0 )
+        return false;
+      --retiredConns;
+      return true;
+    }
+
     void initTimer( QObject* parent )
     {
       expirationTimer = new QTimer( parent );
@@ -176,6 +218,10 @@ class QgsConnectionPoolGroup
     QStack<Item> conns;
     QMutex connMutex;
     QSemaphore sem;
+    //! maximal number of concurrent connections
+    int maxConns;
+    //! number of slots of the semaphore to remove when connections are released
+    int retiredConns;
     QTimer* expirationTimer;
 };
 
@@ -194,6 +240,9 @@ class QgsConnectionPoolGroup
  * When the connections are not used for some time, they will get closed automatically
  * to save resources.
  *
+ * The limit defaults to CONN_POOL_MAX_CONCURRENT_CONNS, it can be changed for the
+ * whole pool (i.e. for a provider) and for particular connections.
+ *
  */
 template <typename T, typename T_Group>
 class QgsConnectionPool
@@ -202,6 +251,11 @@ class QgsConnectionPool
 
     typedef QMap<QString, T_Group*> T_Groups;
 
+    QgsConnectionPool()
+        : mMaxConcurrentConnections( CONN_POOL_MAX_CONCURRENT_CONNS )
+    {
+    }
+
     //! Try to acquire a connection: if no connections are available, the thread will get blocked.
     //! @return initialized connection or null on error
     T acquireConnection( const QString& connInfo )
@@ -211,6 +265,7 @@ class QgsConnectionPool
       if ( it == mGroups.end() )
       {
         it = mGroups.insert( connInfo, new T_Group( connInfo ) );
+        ( *it )->setMaxConcurrentConnections( mConnectionLimits.value( connInfo, mMaxConcurrentConnections ) );
       }
       T_Group* group = *it;
       mMutex.unlock();
@@ -230,8 +285,42 @@ class QgsConnectionPool
       group->release( conn );
     }
 
+    //! Set the maximal number of concurrent connections of the connections without their own limit
+    //! @note added in 2.8
+    void setMaxConcurrentConnections( int max )
+    {
+      QMutexLocker locker( &mMutex );
+      mMaxConcurrentConnections = max;
+      for ( typename T_Groups::iterator it = mGroups.begin(); it != mGroups.end(); ++it )
+      {
+        if ( !mConnectionLimits.contains( it.key() ) )
+          ( *it )->setMaxConcurrentConnections( max );
+      }
+    }
+
+    //! Set the maximal number of concurrent connections for one connection
+    //! @note added in 2.8
+    void setMaxConcurrentConnections( const QString& connInfo, int max )
+    {
+      QMutexLocker locker( &mMutex );
+      mConnectionLimits.insert( connInfo, max );
+      typename T_Groups::iterator it = mGroups.find( connInfo );
+      if ( it != mGroups.end() )
+        ( *it )->setMaxConcurrentConnections( max );
+    }
+
+    //! Return the maximal number of concurrent connections for a connection
+    //! @note added in 2.8
+    int maxConcurrentConnections( const QString& connInfo )
+    {
+      QMutexLocker locker( &mMutex );
+      return qMax( mConnectionLimits.value( connInfo, mMaxConcurrentConnections ), 1 );
+    }
+
   protected:
     T_Groups mGroups;
+    int mMaxConcurrentConnections;
+    QMap<QString, int> mConnectionLimits;
 
   private:
     QMutex mMutex;
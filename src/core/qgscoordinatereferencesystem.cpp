@@ -27,7 +27,9 @@
 #include <QRegExp>
 #include <QTextStream>
 #include <QFile>
+#include <QMutex>
 #include <QSettings>
+#include <QSharedPointer>
 
 #include "qgsapplication.h"
 #include "qgscrscache.h"
@@ -48,6 +50,228 @@ CUSTOM_CRS_VALIDATION QgsCoordinateReferenceSystem::mCustomSrsValidation = NULL;
 
 //--------------------------
 
+/** CRS record of srs.db. Not a part of public API. */
+struct QgsSrsDbRecord
+{
+  long srsId;
+  QString description;
+  QString projectionAcronym;
+  QString ellipsoidAcronym;
+  QString parameters;
+  long srid;
+  QString authId;
+  bool geographic;
+};
+
+/** Immutable in-memory index of the system CRS database (srs.db). It is loaded
+ * once per process on first use and shared by all threads, so that lookups of
+ * system CRS do not need to query SQLite. Not a part of public API. */
+class QgsSrsDbIndex
+{
+  public:
+    //! Return index of the current srs.db, null if it cannot be read
+    static QSharedPointer<const QgsSrsDbIndex> instance()
+    {
+      QMutexLocker locker( &sMutex );
+      QString path = QgsApplication::srsDbFilePath();
+      if ( !sInstance || sInstancePath != path )
+      {
+        QgsSrsDbIndex* index = new QgsSrsDbIndex;
+        if ( !index->load( path ) )
+        {
+          delete index;
+          index = 0;
+        }
+        sInstance = QSharedPointer<const QgsSrsDbIndex>( index );
+        sInstancePath = path;
+      }
+      return sInstance;
+    }
+
+    //! Forget the index, it will be loaded again on next use (after srs.db was modified)
+    static void invalidate()
+    {
+      QMutexLocker locker( &sMutex );
+      sInstance.clear();
+      sInstancePath.clear();
+    }
+
+    /** Find record by column of tbl_srs used by QgsCoordinateReferenceSystem::loadFromDb()
+     * @param expression "srs_id", "srid" or "lower(auth_name||':'||auth_id)"
+     * @param value value of the column
+     * @param record set to the record found (the first one by deprecation), null if there is none
+     * @returns false if the expression is not indexed
+     */
+    bool find( const QString& expression, const QString& value, const QgsSrsDbRecord*& record ) const
+    {
+      int i = -1;
+      if ( expression == "srs_id" )
+        i = mBySrsId.value( value.toLong(), -1 );
+      else if ( expression == "srid" )
+        i = mBySrid.value( value.toLong(), -1 );
+      else if ( expression == "lower(auth_name||':'||auth_id)" )
+        i = mByAuthId.value( value.toLower(), -1 );
+      else
+        return false;
+
+      record = i >= 0 ? &mRecords[i] : 0;
+      return true;
+    }
+
+    /** Return srs_id of the record matching the proj4 definition: first with the same definition,
+     * then with the same parameters in any order (the record with the same +datum is preferred,
+     * +lat_1 and +lat_2 may be swapped). Returns 0 if there is no match. */
+    long findProj4( const QString& proj4 ) const
+    {
+      long srsId = findExactProj4( proj4 );
+      if ( srsId > 0 )
+        return srsId;
+
+      QString datum;
+      QList<int> candidates = mByNormalizedParameters.value( normalizedParameters( proj4, &datum ) );
+      if ( candidates.isEmpty() )
+        return 0;
+
+      if ( !datum.isEmpty() )
+      {
+        foreach ( int i, candidates )
+        {
+          QString recordDatum;
+          normalizedParameters( mRecords[i].parameters, &recordDatum );
+          if ( recordDatum == datum )
+            return mRecords[i].srsId;
+        }
+      }
+      return mRecords[candidates.first()].srsId;
+    }
+
+    //! Return srs_id of the first record with the given proj4 definition, 0 if there is none
+    long findExactProj4( const QString& proj4 ) const
+    {
+      QList<int> exact = mByParameters.value( proj4 );
+      return exact.isEmpty() ? 0 : mRecords[exact.first()].srsId;
+    }
+
+  private:
+    bool load( const QString& path )
+    {
+      QFileInfo myInfo( path );
+      if ( !myInfo.exists() )
+      {
+        QgsDebugMsg( "failed : " + path + " does not exist!" );
+        return false;
+      }
+
+      sqlite3 *myDatabase;
+      if ( sqlite3_open_v2( path.toUtf8().data(), &myDatabase, SQLITE_OPEN_READONLY, NULL ) != SQLITE_OK )
+      {
+        QgsDebugMsg( "failed : " + path + " could not be opened!" );
+        sqlite3_close( myDatabase );
+        return false;
+      }
+
+      // records in the order of preference of the lookups
+      QString mySql = "select srs_id,description,projection_acronym,"
+                      "ellipsoid_acronym,parameters,srid,auth_name||':'||auth_id,is_geo "
+                      "from tbl_srs order by deprecated,srs_id";
+      sqlite3_stmt *myPreparedStatement;
+      const char *myTail;
+      int myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
+      if ( myResult == SQLITE_OK )
+      {
+        while ( sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
+        {
+          QgsSrsDbRecord r;
+          r.srsId = sqlite3_column_int64( myPreparedStatement, 0 );
+          r.description = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
+          r.projectionAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 2 ) );
+          r.ellipsoidAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 3 ) );
+          r.parameters = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 4 ) );
+          r.srid = sqlite3_column_int64( myPreparedStatement, 5 );
+          r.authId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 6 ) );
+          r.geographic = sqlite3_column_int( myPreparedStatement, 7 ) != 0;
+          mRecords.append( r );
+        }
+      }
+      else
+      {
+        QgsDebugMsg( "failed : " + mySql );
+      }
+      sqlite3_finalize( myPreparedStatement );
+      sqlite3_close( myDatabase );
+
+      if ( myResult != SQLITE_OK )
+        return false;
+
+      for ( int i = 0; i < mRecords.count(); ++i )
+      {
+        const QgsSrsDbRecord& r = mRecords[i];
+        if ( !mBySrsId.contains( r.srsId ) )
+          mBySrsId.insert( r.srsId, i );
+        if ( !mBySrid.contains( r.srid ) )
+          mBySrid.insert( r.srid, i );
+        QString authId = r.authId.toLower();
+        if ( !authId.isEmpty() && !mByAuthId.contains( authId ) )
+          mByAuthId.insert( authId, i );
+        mByParameters[r.parameters.trimmed()].append( i );
+        mByNormalizedParameters[normalizedParameters( r.parameters )].append( i );
+      }
+
+      QgsDebugMsg( QString( "%1 CRS loaded from %2" ).arg( mRecords.count() ).arg( path ) );
+      return true;
+    }
+
+    //! Return sorted parameters without +datum (which is returned separately), +lat_1 and +lat_2 in ascending numerical order
+    static QString normalizedParameters( const QString& proj4, QString* datum = 0 )
+    {
+      QStringList params;
+      QString lat1, lat2;
+      foreach ( QString param, proj4.split( QRegExp( "\\s+(?=\\+)" ), QString::SkipEmptyParts ) )
+      {
+        param = param.trimmed();
+        if ( param.startsWith( "+datum=" ) )
+        {
+          if ( datum )
+            *datum = param;
+        }
+        else if ( param.startsWith( "+lat_1=" ) )
+          lat1 = param.mid( LAT_PREFIX_LEN );
+        else if ( param.startsWith( "+lat_2=" ) )
+          lat2 = param.mid( LAT_PREFIX_LEN );
+        else
+          params << param;
+      }
+
+      // standard parallels may be given in any order
+      if ( !lat1.isNull() && !lat2.isNull() && lat2.toDouble() < lat1.toDouble() )
+        qSwap( lat1, lat2 );
+      if ( !lat1.isNull() )
+        params << "+lat_1=" + lat1;
+      if ( !lat2.isNull() )
+        params << "+lat_2=" + lat2;
+
+      params.sort();
+      return params.join( " " );
+    }
+
+    QVector<QgsSrsDbRecord> mRecords;
+    QHash<long, int> mBySrsId;
+    QHash<long, int> mBySrid;
+    QHash<QString, int> mByAuthId;
+    QHash<QString, QList<int> > mByParameters;
+    QHash<QString, QList<int> > mByNormalizedParameters;
+
+    static QMutex sMutex;
+    static QSharedPointer<const QgsSrsDbIndex> sInstance;
+    static QString sInstancePath;
+};
+
+QMutex QgsSrsDbIndex::sMutex;
+QSharedPointer<const QgsSrsDbIndex> QgsSrsDbIndex::sInstance;
+QString QgsSrsDbIndex::sInstancePath;
+
+//--------------------------
+
 QgsCoordinateReferenceSystem::QgsCoordinateReferenceSystem()
     : mSrsId( 0 )
     , mGeoFlag( false )
@@ -323,6 +547,25 @@ bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, Q
   mIsValidFlag = false;
   mWkt.clear();
 
+  // system CRS are looked up in the in-memory index of srs.db
+  if ( db == QgsApplication::srsDbFilePath() )
+  {
+    QSharedPointer<const QgsSrsDbIndex> index = QgsSrsDbIndex::instance();
+    const QgsSrsDbRecord* record;
+    if ( index && index->find( expression, value, record ) )
+    {
+      if ( !record )
+      {
+        QgsDebugMsgLevel( "not found in " + db, 3 );
+        return mIsValidFlag;
+      }
+
+      setFromDbRecord( record->srsId, record->description, record->projectionAcronym, record->ellipsoidAcronym,
+                       record->parameters, record->srid, record->authId, record->geographic );
+      return mIsValidFlag;
+    }
+  }
+
   QFileInfo myInfo( db );
   if ( !myInfo.exists() )
   {
@@ -363,34 +606,14 @@ bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, Q
   // XXX Need to free memory from the error msg if one is set
   if ( myResult == SQLITE_OK && sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
   {
-    mSrsId = QString::fromUtf8(( char * )sqlite3_column_text(
-                                 myPreparedStatement, 0 ) ).toLong();
-    mDescription = QString::fromUtf8(( char * )sqlite3_column_text(
-                                       myPreparedStatement, 1 ) );
-    mProjectionAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 2 ) );
-    mEllipsoidAcronym = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 3 ) );
-    mProj4 = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 4 ) );
-    mSRID = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 5 ) ).toLong();
-    mAuthId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 6 ) );
-    mGeoFlag = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 7 ) ).toInt() != 0;
-    mAxisInverted = -1;
-
-    if ( mSrsId >= USER_CRS_START_ID && mAuthId.isEmpty() )
-    {
-      mAuthId = QString( "USER:%1" ).arg( mSrsId );
-    }
-    else if ( mAuthId.startsWith( "EPSG:", Qt::CaseInsensitive ) )
-    {
-      OSRDestroySpatialReference( mCRS );
-      mCRS = OSRNewSpatialReference( NULL );
-      mIsValidFlag = OSRSetFromUserInput( mCRS, mAuthId.toLower().toAscii() ) == OGRERR_NONE;
-      setMapUnits();
-    }
-
-    if ( !mIsValidFlag )
-    {
-      setProj4String( mProj4 );
-    }
+    setFromDbRecord( QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) ).toLong(),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) ),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 2 ) ),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 3 ) ),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 4 ) ),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 5 ) ).toLong(),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 6 ) ),
+                     QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 7 ) ).toInt() != 0 );
   }
   else
   {
@@ -401,6 +624,37 @@ bool QgsCoordinateReferenceSystem::loadFromDb( QString db, QString expression, Q
   return mIsValidFlag;
 }
 
+void QgsCoordinateReferenceSystem::setFromDbRecord( long srsId, const QString& description, const QString& projectionAcronym,
+    const QString& ellipsoidAcronym, const QString& parameters, long srid, const QString& authId, bool geographic )
+{
+  mSrsId = srsId;
+  mDescription = description;
+  mProjectionAcronym = projectionAcronym;
+  mEllipsoidAcronym = ellipsoidAcronym;
+  mProj4 = parameters;
+  mSRID = srid;
+  mAuthId = authId;
+  mGeoFlag = geographic;
+  mAxisInverted = -1;
+
+  if ( mSrsId >= USER_CRS_START_ID && mAuthId.isEmpty() )
+  {
+    mAuthId = QString( "USER:%1" ).arg( mSrsId );
+  }
+  else if ( mAuthId.startsWith( "EPSG:", Qt::CaseInsensitive ) )
+  {
+    OSRDestroySpatialReference( mCRS );
+    mCRS = OSRNewSpatialReference( NULL );
+    mIsValidFlag = OSRSetFromUserInput( mCRS, mAuthId.toLower().toAscii() ) == OGRERR_NONE;
+    setMapUnits();
+  }
+
+  if ( !mIsValidFlag )
+  {
+    setProj4String( mProj4 );
+  }
+}
+
 bool QgsCoordinateReferenceSystem::axisInverted() const
 {
   if ( mAxisInverted == -1 )
@@ -563,11 +817,24 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString &theProj4Strin
   long mySrsId = 0;
   QgsCoordinateReferenceSystem::RecordMap myRecord;
 
+  /*
+   * - system CRS are matched by the precomputed tables of the in-memory index of srs.db
+   *   (whole text, then parameters in any order), the whole text search below only queries the user CRS then
+   */
+  QSharedPointer<const QgsSrsDbIndex> index = QgsSrsDbIndex::instance();
+  if ( index )
+  {
+    mySrsId = index->findProj4( myProj4String );
+    if ( mySrsId > 0 )
+      myRecord["srs_id"] = QString::number( mySrsId );
+  }
+
   /*
    * - if the above does not match perform a whole text search on proj4 string (if not null)
    */
   // QgsDebugMsg( "wholetext match on name failed, trying proj4string match" );
-  myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( myProj4String ) + " order by deprecated" );
+  if ( myRecord.empty() )
+    myRecord = getRecord( "select * from tbl_srs where parameters=" + quotedValue( myProj4String ) + " order by deprecated", !index.isNull() );
   if ( myRecord.empty() )
   {
     // Ticket #722 - aaronr
@@ -705,15 +972,15 @@ bool QgsCoordinateReferenceSystem::createFromProj4( const QString &theProj4Strin
 }
 
 //private method meant for internal use by this class only
-QgsCoordinateReferenceSystem::RecordMap QgsCoordinateReferenceSystem::getRecord( QString theSql )
+QgsCoordinateReferenceSystem::RecordMap QgsCoordinateReferenceSystem::getRecord( QString theSql, bool userDbOnly )
 {
   QString myDatabaseFileName;
   QgsCoordinateReferenceSystem::RecordMap myMap;
   QString myFieldName;
   QString myFieldValue;
-  sqlite3      *myDatabase;
+  sqlite3      *myDatabase = 0;
   const char   *myTail;
-  sqlite3_stmt *myPreparedStatement;
+  sqlite3_stmt *myPreparedStatement = 0;
   int           myResult;
 
   QgsDebugMsg( "running query: " + theSql );
@@ -726,36 +993,40 @@ QgsCoordinateReferenceSystem::RecordMap QgsCoordinateReferenceSystem::getRecord(
     return myMap;
   }
 
-  //check the db is available
-  myResult = openDb( myDatabaseFileName, &myDatabase );
-  if ( myResult != SQLITE_OK )
+  // the caller already matched the system CRS in the in-memory index of srs.db
+  if ( !userDbOnly )
   {
-    return myMap;
-  }
+    //check the db is available
+    myResult = openDb( myDatabaseFileName, &myDatabase );
+    if ( myResult != SQLITE_OK )
+    {
+      return myMap;
+    }
 
-  myResult = sqlite3_prepare( myDatabase, theSql.toUtf8(), theSql.toUtf8().length(), &myPreparedStatement, &myTail );
-  // XXX Need to free memory from the error msg if one is set
-  if ( myResult == SQLITE_OK && sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
-  {
-    QgsDebugMsg( "trying system srs.db" );
-    int myColumnCount = sqlite3_column_count( myPreparedStatement );
-    //loop through each column in the record adding its expression name and value to the map
-    for ( int myColNo = 0; myColNo < myColumnCount; myColNo++ )
+    myResult = sqlite3_prepare( myDatabase, theSql.toUtf8(), theSql.toUtf8().length(), &myPreparedStatement, &myTail );
+    // XXX Need to free memory from the error msg if one is set
+    if ( myResult == SQLITE_OK && sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
     {
-      myFieldName = QString::fromUtf8(( char * )sqlite3_column_name( myPreparedStatement, myColNo ) );
-      myFieldValue = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, myColNo ) );
-      myMap[myFieldName] = myFieldValue;
+      QgsDebugMsg( "trying system srs.db" );
+      int myColumnCount = sqlite3_column_count( myPreparedStatement );
+      //loop through each column in the record adding its expression name and value to the map
+      for ( int myColNo = 0; myColNo < myColumnCount; myColNo++ )
+      {
+        myFieldName = QString::fromUtf8(( char * )sqlite3_column_name( myPreparedStatement, myColNo ) );
+        myFieldValue = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, myColNo ) );
+        myMap[myFieldName] = myFieldValue;
+      }
+      if ( sqlite3_step( myPreparedStatement ) != SQLITE_DONE )
+      {
+        QgsDebugMsg( "Multiple records found in srs.db" );
+        myMap.clear();
+      }
     }
-    if ( sqlite3_step( myPreparedStatement ) != SQLITE_DONE )
+    else
     {
-      QgsDebugMsg( "Multiple records found in srs.db" );
-      myMap.clear();
+      QgsDebugMsg( "failed :  " + theSql );
     }
   }
-  else
-  {
-    QgsDebugMsg( "failed :  " + theSql );
-  }
 
   if ( myMap.empty() )
   {
@@ -1051,40 +1322,54 @@ long QgsCoordinateReferenceSystem::findMatchingProj()
   // Get the full path name to the sqlite3 spatial reference database.
   QString myDatabaseFileName = QgsApplication::srsDbFilePath();
 
-  //check the db is available
-  myResult = openDb( myDatabaseFileName, &myDatabase );
-  if ( myResult != SQLITE_OK )
+  // system CRS are matched in the in-memory index of srs.db
+  QSharedPointer<const QgsSrsDbIndex> index = QgsSrsDbIndex::instance();
+  if ( index )
   {
-    return 0;
+    long mySrsId = index->findExactProj4( toProj4() );
+    if ( mySrsId > 0 )
+    {
+      QgsDebugMsg( QString( "-------> MATCH FOUND in srs.db srsid: %1" ).arg( mySrsId ) );
+      return mySrsId;
+    }
   }
-
-  myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
-// XXX Need to free memory from the error msg if one is set
-  if ( myResult == SQLITE_OK )
+  else
   {
+    //check the db is available
+    myResult = openDb( myDatabaseFileName, &myDatabase );
+    if ( myResult != SQLITE_OK )
+    {
+      return 0;
+    }
 
-    while ( sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
+    myResult = sqlite3_prepare( myDatabase, mySql.toUtf8(), mySql.toUtf8().length(), &myPreparedStatement, &myTail );
+    // XXX Need to free memory from the error msg if one is set
+    if ( myResult == SQLITE_OK )
     {
-      QString mySrsId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) );
-      QString myProj4String = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
-      if ( toProj4() == myProj4String.trimmed() )
-      {
-        QgsDebugMsg( "-------> MATCH FOUND in srs.db srsid: " + mySrsId );
-        // close the sqlite3 statement
-        sqlite3_finalize( myPreparedStatement );
-        sqlite3_close( myDatabase );
-        return mySrsId.toLong();
-      }
-      else
+
+      while ( sqlite3_step( myPreparedStatement ) == SQLITE_ROW )
       {
+        QString mySrsId = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 0 ) );
+        QString myProj4String = QString::fromUtf8(( char * )sqlite3_column_text( myPreparedStatement, 1 ) );
+        if ( toProj4() == myProj4String.trimmed() )
+        {
+          QgsDebugMsg( "-------> MATCH FOUND in srs.db srsid: " + mySrsId );
+          // close the sqlite3 statement
+          sqlite3_finalize( myPreparedStatement );
+          sqlite3_close( myDatabase );
+          return mySrsId.toLong();
+        }
+        else
+        {
 // QgsDebugMsg(QString(" Not matched : %1").arg(myProj4String));
+        }
       }
     }
+    QgsDebugMsg( "no match found in srs.db, trying user db now!" );
+    // close the sqlite3 statement
+    sqlite3_finalize( myPreparedStatement );
+    sqlite3_close( myDatabase );
   }
-  QgsDebugMsg( "no match found in srs.db, trying user db now!" );
-  // close the sqlite3 statement
-  sqlite3_finalize( myPreparedStatement );
-  sqlite3_close( myDatabase );
   //
   // Try the users db now
   //
@@ -1952,6 +2237,9 @@ int QgsCoordinateReferenceSystem::syncDb()
 
   sqlite3_close( database );
 
+  // the in-memory index is loaded again with the updated records
+  QgsSrsDbIndex::invalidate();
+
   qWarning( "CRS update (inserted:%d updated:%d deleted:%d errors:%d)", inserted, updated, deleted, errors );
 
   if ( errors > 0 )
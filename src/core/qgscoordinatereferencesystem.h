@@ -416,9 +416,10 @@ class CORE_EXPORT QgsCoordinateReferenceSystem
      * @note only handles queries that return a single record.
      * @note it will first try the system srs.db then the users qgis.db!
      * @param theSql The sql query to execute
+     * @param userDbOnly skip srs.db, e.g. because the query was already answered by its in-memory index
      * @return An associative array of field name <-> value pairs
      */
-    RecordMap getRecord( QString theSql );
+    RecordMap getRecord( QString theSql, bool userDbOnly = false );
 
     // Open SQLite db and show message if cannot be opened
     // returns the same code as sqlite3_open
@@ -456,6 +457,11 @@ class CORE_EXPORT QgsCoordinateReferenceSystem
 
     bool loadFromDb( QString db, QString expression, QString value );
 
+    //! Set the CRS from a record of srs.db or qgis.db
+    void setFromDbRecord( long srsId, const QString& description, const QString& projectionAcronym,
+                          const QString& ellipsoidAcronym, const QString& parameters, long srid,
+                          const QString& authId, bool geographic );
+
     QString mValidationHint;
     mutable QString mWkt;
     mutable QString mProj4;
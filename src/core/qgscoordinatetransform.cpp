@@ -24,8 +24,10 @@
 #include <QDomNode>
 #include <QDomElement>
 #include <QApplication>
+#include <QMutex>
 #include <QPolygonF>
 #include <QStringList>
+#include <QThreadStorage>
 #include <QVector>
 
 extern "C"
@@ -34,14 +36,183 @@ extern "C"
 }
 #include <sqlite3.h>
 
+#include <cmath>
+
 // if defined shows all information about transform to stdout
 // #define COORDINATE_TRANSFORM_VERBOSE
 
+// contexts allow to use PROJ.4 from several threads at once
+#if defined(PJ_VERSION) && PJ_VERSION >= 480
+#define HAVE_PROJ_CONTEXTS
+#endif
+
+class QgsProjThreadData;
+
+//! guards the list of thread data and their released projections
+static QMutex sProjThreadDataMutex;
+//! data of all threads which use PROJ.4, for releasing projections of destroyed transforms
+static QList<QgsProjThreadData*> sAllProjThreadData;
+static QThreadStorage<QgsProjThreadData*> sProjThreadData;
+
+/** PROJ.4 context and projections of one thread: threads never share any PROJ.4 state,
+ * so that transforms may be done concurrently. Not a part of public API. */
+class QgsProjThreadData
+{
+  public:
+    QgsProjThreadData()
+        : mUseCounter( 0 )
+        , mReleasedPending( 0 )
+    {
+#ifdef HAVE_PROJ_CONTEXTS
+      mContext = pj_ctx_alloc();
+#endif
+      QMutexLocker locker( &sProjThreadDataMutex );
+      sAllProjThreadData.append( this );
+    }
+
+    ~QgsProjThreadData()
+    {
+      {
+        QMutexLocker locker( &sProjThreadDataMutex );
+        sAllProjThreadData.removeAll( this );
+      }
+
+      QHash<int, Projections>::const_iterator it = mProjections.constBegin();
+      for ( ; it != mProjections.constEnd(); ++it )
+        freeProjections( *it );
+      mProjections.clear();
+#ifdef HAVE_PROJ_CONTEXTS
+      pj_ctx_free( mContext );
+#endif
+    }
+
+    //! return projections of the transform with given id, they are created on first use
+    void projections( int id, const QString& sourceProjString, const QString& destProjString, projPJ& sourceProjection, projPJ& destProjection )
+    {
+      // free projections of transforms destroyed in other threads
+      if ( mReleasedPending.testAndSetAcquire( 1, 0 ) )
+      {
+        QList<int> released;
+        {
+          QMutexLocker locker( &sProjThreadDataMutex );
+          released.swap( mReleased );
+        }
+        foreach ( int releasedId, released )
+          remove( releasedId );
+      }
+
+      QHash<int, Projections>::iterator it = mProjections.find( id );
+      if ( it == mProjections.end() )
+      {
+        if ( mProjections.count() >= MAX_TRANSFORMS )
+          removeLeastRecentlyUsed();
+
+        Projections p;
+        p.source = init( sourceProjString );
+        p.dest = init( destProjString );
+        it = mProjections.insert( id, p );
+      }
+      it->lastUse = ++mUseCounter;
+      sourceProjection = it->source;
+      destProjection = it->dest;
+    }
+
+    //! free projections of the transform with given id
+    void remove( int id )
+    {
+      QHash<int, Projections>::iterator it = mProjections.find( id );
+      if ( it == mProjections.end() )
+        return;
+      freeProjections( *it );
+      mProjections.erase( it );
+    }
+
+    //! free projections of a destroyed transform in all threads: now in the calling thread, on next use in the others
+    static void release( int id )
+    {
+      QgsProjThreadData* current = sProjThreadData.hasLocalData() ? sProjThreadData.localData() : 0;
+      if ( current )
+        current->remove( id );
+
+      QMutexLocker locker( &sProjThreadDataMutex );
+      foreach ( QgsProjThreadData* data, sAllProjThreadData )
+      {
+        if ( data == current )
+          continue;
+        data->mReleased.append( id );
+        data->mReleasedPending.fetchAndStoreRelease( 1 );
+      }
+    }
+
+  private:
+    static const int MAX_TRANSFORMS = 256;
+
+    struct Projections
+    {
+      projPJ source;
+      projPJ dest;
+      quint64 lastUse;
+    };
+
+    projPJ init( const QString& projString )
+    {
+#ifdef HAVE_PROJ_CONTEXTS
+      return pj_init_plus_ctx( mContext, projString.toUtf8() );
+#else
+      return pj_init_plus( projString.toUtf8() );
+#endif
+    }
+
+    static void freeProjections( const Projections& p )
+    {
+      if ( p.source )
+        pj_free( p.source );
+      if ( p.dest )
+        pj_free( p.dest );
+    }
+
+    void removeLeastRecentlyUsed()
+    {
+      QHash<int, Projections>::iterator oldest = mProjections.end();
+      for ( QHash<int, Projections>::iterator it = mProjections.begin(); it != mProjections.end(); ++it )
+      {
+        if ( oldest == mProjections.end() || it->lastUse < oldest->lastUse )
+          oldest = it;
+      }
+      if ( oldest != mProjections.end() )
+      {
+        freeProjections( *oldest );
+        mProjections.erase( oldest );
+      }
+    }
+
+#ifdef HAVE_PROJ_CONTEXTS
+    projCtx mContext;
+#endif
+    QHash<int, Projections> mProjections;
+    quint64 mUseCounter;
+
+    //! ids of transforms destroyed in other threads (guarded by sProjThreadDataMutex)
+    QList<int> mReleased;
+    //! set when mReleased is not empty
+    QAtomicInt mReleasedPending;
+};
+
+static QgsProjThreadData* _projThreadData()
+{
+  if ( !sProjThreadData.hasLocalData() )
+    sProjThreadData.setLocalData( new QgsProjThreadData );
+  return sProjThreadData.localData();
+}
+
+static QAtomicInt sNextProjectionsId( 0 );
+
 QgsCoordinateTransform::QgsCoordinateTransform()
     : QObject()
     , mInitialisedFlag( false )
-    , mSourceProjection( 0 )
-    , mDestinationProjection( 0 )
+    , mSourceLatLong( false )
+    , mDestLatLong( false )
+    , mProjectionsId( -1 )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
 {
@@ -51,8 +222,9 @@ QgsCoordinateTransform::QgsCoordinateTransform()
 QgsCoordinateTransform::QgsCoordinateTransform( const QgsCoordinateReferenceSystem& source, const QgsCoordinateReferenceSystem& dest )
     : QObject()
     , mInitialisedFlag( false )
-    , mSourceProjection( 0 )
-    , mDestinationProjection( 0 )
+    , mSourceLatLong( false )
+    , mDestLatLong( false )
+    , mProjectionsId( -1 )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
 {
@@ -67,8 +239,9 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrsId, long theDes
     , mInitialisedFlag( false )
     , mSourceCRS( theSourceSrsId, QgsCoordinateReferenceSystem::InternalCrsId )
     , mDestCRS( theDestSrsId, QgsCoordinateReferenceSystem::InternalCrsId )
-    , mSourceProjection( 0 )
-    , mDestinationProjection( 0 )
+    , mSourceLatLong( false )
+    , mDestLatLong( false )
+    , mProjectionsId( -1 )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
 {
@@ -78,8 +251,9 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrsId, long theDes
 QgsCoordinateTransform::QgsCoordinateTransform( QString theSourceCRS, QString theDestCRS )
     : QObject()
     , mInitialisedFlag( false )
-    , mSourceProjection( 0 )
-    , mDestinationProjection( 0 )
+    , mSourceLatLong( false )
+    , mDestLatLong( false )
+    , mProjectionsId( -1 )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
 {
@@ -98,8 +272,9 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrid,
     QgsCoordinateReferenceSystem::CrsType theSourceCRSType )
     : QObject()
     , mInitialisedFlag( false )
-    , mSourceProjection( 0 )
-    , mDestinationProjection( 0 )
+    , mSourceLatLong( false )
+    , mDestLatLong( false )
+    , mProjectionsId( -1 )
     , mSourceDatumTransform( -1 )
     , mDestinationDatumTransform( -1 )
 {
@@ -116,14 +291,10 @@ QgsCoordinateTransform::QgsCoordinateTransform( long theSourceSrid,
 
 QgsCoordinateTransform::~QgsCoordinateTransform()
 {
-  // free the proj objects
-  if ( mSourceProjection )
-  {
-    pj_free( mSourceProjection );
-  }
-  if ( mDestinationProjection )
+  // free the proj objects of all threads
+  if ( mProjectionsId >= 0 )
   {
-    pj_free( mDestinationProjection );
+    QgsProjThreadData::release( mProjectionsId );
   }
 }
 
@@ -180,7 +351,6 @@ void QgsCoordinateTransform::initialise()
 
   // init the projections (destination and source)
 
-  pj_free( mSourceProjection );
   QString sourceProjString = mSourceCRS.toProj4();
   if ( !useDefaultDatumTransform )
   {
@@ -191,7 +361,6 @@ void QgsCoordinateTransform::initialise()
     sourceProjString += ( " " + datumTransformString( mSourceDatumTransform ) );
   }
 
-  pj_free( mDestinationProjection );
   QString destProjString = mDestCRS.toProj4();
   if ( !useDefaultDatumTransform )
   {
@@ -207,8 +376,19 @@ void QgsCoordinateTransform::initialise()
     addNullGridShifts( sourceProjString, destProjString );
   }
 
-  mSourceProjection = pj_init_plus( sourceProjString.toUtf8() );
-  mDestinationProjection = pj_init_plus( destProjString.toUtf8() );
+  // every thread creates its own projections from the strings when it needs them
+  if ( mProjectionsId >= 0 )
+  {
+    QgsProjThreadData::release( mProjectionsId );
+  }
+  mProjectionsId = sNextProjectionsId.fetchAndAddOrdered( 1 );
+  mSourceProjString = sourceProjString;
+  mDestProjString = destProjString;
+
+  projPJ sourceProjection, destProjection;
+  _projThreadData()->projections( mProjectionsId, mSourceProjString, mDestProjString, sourceProjection, destProjection );
+  mSourceLatLong = sourceProjection && pj_is_latlong( sourceProjection );
+  mDestLatLong = destProjection && pj_is_latlong( destProjection );
 
 #ifdef COORDINATE_TRANSFORM_VERBOSE
   QgsDebugMsg( "From proj : " + mSourceCRS.toProj4() );
@@ -216,11 +396,11 @@ void QgsCoordinateTransform::initialise()
 #endif
 
   mInitialisedFlag = true;
-  if ( !mDestinationProjection )
+  if ( !destProjection )
   {
     mInitialisedFlag = false;
   }
-  if ( !mSourceProjection )
+  if ( !sourceProjection )
   {
     mInitialisedFlag = false;
   }
@@ -377,6 +557,15 @@ void QgsCoordinateTransform::transformPolygon( QPolygonF& poly, TransformDirecti
   //create x, y arrays
   int nVertices = poly.size();
 
+  if ( sizeof( qreal ) == sizeof( double ) )
+  {
+    // QPointF is a pair of doubles: transform the points without copying them.
+    // Like for the copied coordinates, points which cannot be transformed are set to HUGE_VAL
+    double* xy = reinterpret_cast<double*>( poly.data() );
+    transformCoords( nVertices, 2, xy, xy + 1, 0, direction );
+    return;
+  }
+
   QVector<double> x( nVertices );
   QVector<double> y( nVertices );
   QVector<double> z( nVertices );
@@ -627,7 +816,29 @@ QgsRectangle QgsCoordinateTransform::transformBoundingBox( const QgsRectangle &r
   return bb_rect;
 }
 
+void QgsCoordinateTransform::transformInPlace( int numPoints, double* xy, TransformDirection direction ) const
+{
+  if ( mShortCircuit || !mInitialisedFlag || numPoints <= 0 )
+    return;
+
+  try
+  {
+    transformCoords( numPoints, 2, xy, xy + 1, 0, direction, true );
+  }
+  catch ( const QgsCsException & )
+  {
+    // rethrow the exception
+    QgsDebugMsg( "rethrowing exception" );
+    throw;
+  }
+}
+
 void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, double *y, double *z, TransformDirection direction ) const
+{
+  transformCoords( numPoints, 1, x, y, z, direction );
+}
+
+void QgsCoordinateTransform::transformCoords( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction, bool checkPoints ) const
 {
   // Refuse to transform the points if the srs's are invalid
   if ( !mSourceCRS.isValid() )
@@ -650,31 +861,53 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
   QgsDebugMsg( QString( "[[[[[[ Number of points to transform: %1 ]]]]]]" ).arg( numPoints ) );
 #endif
 
+  // use the projections of the calling thread
+  projPJ sourceProjection, destProjection;
+  _projThreadData()->projections( mProjectionsId, mSourceProjString, mDestProjString, sourceProjection, destProjection );
+  if ( !sourceProjection || !destProjection )
+  {
+    QgsDebugMsg( "projections not initialised" );
+    return;
+  }
+
   // use proj4 to do the transform
   QString dir;
   // if the source/destination projection is lat/long, convert the points to radians
   // prior to transforming
-  if (( pj_is_latlong( mDestinationProjection ) && ( direction == ReverseTransform ) )
-      || ( pj_is_latlong( mSourceProjection ) && ( direction == ForwardTransform ) ) )
+  if (( mDestLatLong && ( direction == ReverseTransform ) )
+      || ( mSourceLatLong && ( direction == ForwardTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= DEG_TO_RAD;
       y[i] *= DEG_TO_RAD;
-      z[i] *= DEG_TO_RAD;
+      if ( z )
+        z[i] *= DEG_TO_RAD;
     }
 
   }
   int projResult;
   if ( direction == ReverseTransform )
   {
-    projResult = pj_transform( mDestinationProjection, mSourceProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( destProjection, sourceProjection, numPoints, pointOffset, x, y, z );
   }
   else
   {
-    Q_ASSERT( mSourceProjection != 0 );
-    Q_ASSERT( mDestinationProjection != 0 );
-    projResult = pj_transform( mSourceProjection, mDestinationProjection, numPoints, 0, x, y, z );
+    projResult = pj_transform( sourceProjection, destProjection, numPoints, pointOffset, x, y, z );
+  }
+
+  // a transform of several points does not fail as a whole, PROJ.4 sets
+  // the points which cannot be transformed to HUGE_VAL instead
+  if ( projResult == 0 && checkPoints && numPoints > 1 )
+  {
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
+    {
+      if ( x[i] == HUGE_VAL || y[i] == HUGE_VAL )
+      {
+        projResult = -14; // latitude or longitude exceeded limits
+        break;
+      }
+    }
   }
 
   if ( projResult != 0 )
@@ -682,7 +915,7 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
     //something bad happened....
     QString points;
 
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       if ( direction == ForwardTransform )
       {
@@ -716,14 +949,15 @@ void QgsCoordinateTransform::transformCoords( const int& numPoints, double *x, d
 
   // if the result is lat/long, convert the results from radians back
   // to degrees
-  if (( pj_is_latlong( mDestinationProjection ) && ( direction == ForwardTransform ) )
-      || ( pj_is_latlong( mSourceProjection ) && ( direction == ReverseTransform ) ) )
+  if (( mDestLatLong && ( direction == ForwardTransform ) )
+      || ( mSourceLatLong && ( direction == ReverseTransform ) ) )
   {
-    for ( int i = 0; i < numPoints; ++i )
+    for ( int i = 0; i < numPoints * pointOffset; i += pointOffset )
     {
       x[i] *= RAD_TO_DEG;
       y[i] *= RAD_TO_DEG;
-      z[i] *= RAD_TO_DEG;
+      if ( z )
+        z[i] *= RAD_TO_DEG;
     }
   }
 #ifdef COORDINATE_TRANSFORM_VERBOSE
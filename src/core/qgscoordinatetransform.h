@@ -19,6 +19,7 @@
 
 //qt includes
 #include <QObject>
+#include <QString>
 
 //qgis includes
 #include "qgspoint.h"
@@ -44,6 +45,9 @@ class QString;
 * layer's coordinate system and the coordinate system of the map canvas, although
 * it can be used in a more general sense to transform coordinates.
 *
+* Every thread uses its own PROJ.4 context and projections, so a transform may be
+* used by several threads at once (as long as it is not being reinitialised).
+*
 * All references to source and destination coordinate systems refer to
 * layer and map canvas respectively. All operations are from the perspective
 * of the layer. For example, a forward transformation transforms coordinates from the
@@ -166,6 +170,17 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
     void transformInPlace( QVector<double>& x, QVector<double>& y, QVector<double>& z,
                            TransformDirection direction = ForwardTransform ) const;
 
+    /** Transform an array of interleaved x,y coordinates in place with a single call to PROJ.4.
+     * This is much faster than transforming the points one by one.
+     * @param numPoints number of points in the array
+     * @param xy array of 2 * numPoints coordinates (x1, y1, x2, y2, ...)
+     * @param direction TransformDirection (defaults to ForwardTransform)
+     * @throws QgsCsException if any of the points cannot be transformed
+     * @note added in 2.8
+     * @note not available in python bindings
+     */
+    void transformInPlace( int numPoints, double* xy, TransformDirection direction = ForwardTransform ) const;
+
     void transformPolygon( QPolygonF& poly, TransformDirection direction = ForwardTransform ) const;
 
 #ifdef ANDROID
@@ -277,18 +292,26 @@ class CORE_EXPORT QgsCoordinateTransform : public QObject
     QgsCoordinateReferenceSystem mDestCRS;
 
     /*!
-     * Proj4 data structure of the source projection (layer coordinate system)
+     * Proj4 definitions of the source and destination projections,
+     * each thread creates the projections from them on first use
      */
-    projPJ mSourceProjection;
+    QString mSourceProjString;
+    QString mDestProjString;
 
-    /*!
-     * Proj4 data structure of the destination projection (map canvas coordinate system)
-     */
-    projPJ mDestinationProjection;
+    //! whether the source and destination projections are lat/long
+    bool mSourceLatLong;
+    bool mDestLatLong;
+
+    //! identifier of the projections in the per-thread caches (changes with every initialisation)
+    int mProjectionsId;
 
     int mSourceDatumTransform;
     int mDestinationDatumTransform;
 
+    //! transform coordinates which are pointOffset items apart in the arrays (z may be null),
+    //! with checkPoints an exception is thrown also if only some of the points cannot be transformed
+    void transformCoords( int numPoints, int pointOffset, double *x, double *y, double *z, TransformDirection direction, bool checkPoints = false ) const;
+
     /*!
      * Finder for PROJ grid files.
      */
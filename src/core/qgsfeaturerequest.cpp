@@ -26,6 +26,9 @@ QgsFeatureRequest::QgsFeatureRequest()
     : mFilter( FilterNone )
     , mFilterExpression( 0 )
     , mFlags( 0 )
+    , mHasFidRange( false )
+    , mFidRangeMin( 0 )
+    , mFidRangeMax( 0 )
 {
 }
 
@@ -34,6 +37,9 @@ QgsFeatureRequest::QgsFeatureRequest( QgsFeatureId fid )
     , mFilterFid( fid )
     , mFilterExpression( 0 )
     , mFlags( 0 )
+    , mHasFidRange( false )
+    , mFidRangeMin( 0 )
+    , mFidRangeMax( 0 )
 {
 }
 
@@ -42,6 +48,9 @@ QgsFeatureRequest::QgsFeatureRequest( const QgsRectangle& rect )
     , mFilterRect( rect )
     , mFilterExpression( 0 )
     , mFlags( 0 )
+    , mHasFidRange( false )
+    , mFidRangeMin( 0 )
+    , mFidRangeMax( 0 )
 {
 }
 
@@ -49,6 +58,9 @@ QgsFeatureRequest::QgsFeatureRequest( const QgsExpression& expr )
     : mFilter( FilterExpression )
     , mFilterExpression( new QgsExpression( expr.expression() ) )
     , mFlags( 0 )
+    , mHasFidRange( false )
+    , mFidRangeMin( 0 )
+    , mFidRangeMax( 0 )
 {
 }
 
@@ -74,6 +86,9 @@ QgsFeatureRequest& QgsFeatureRequest::operator=( const QgsFeatureRequest & rh )
   }
   mAttrs = rh.mAttrs;
   mSimplifyMethod = rh.mSimplifyMethod;
+  mHasFidRange = rh.mHasFidRange;
+  mFidRangeMin = rh.mFidRangeMin;
+  mFidRangeMax = rh.mFidRangeMax;
   return *this;
 }
 
@@ -151,6 +166,14 @@ QgsFeatureRequest& QgsFeatureRequest::setSimplifyMethod( const QgsSimplifyMethod
   return *this;
 }
 
+QgsFeatureRequest& QgsFeatureRequest::setFilterFidRange( QgsFeatureId minFid, QgsFeatureId maxFid )
+{
+  mHasFidRange = true;
+  mFidRangeMin = minFid;
+  mFidRangeMax = maxFid;
+  return *this;
+}
+
 bool QgsFeatureRequest::acceptFeature( const QgsFeature& feature )
 {
   switch ( mFilter )
@@ -204,13 +227,21 @@ QgsAbstractFeatureSource::~QgsAbstractFeatureSource()
   }
 }
 
+QList<QgsFeatureRequest> QgsAbstractFeatureSource::partitionRequest( const QgsFeatureRequest& request, int maxParts )
+{
+  Q_UNUSED( maxParts );
+  return QList<QgsFeatureRequest>() << request;
+}
+
 void QgsAbstractFeatureSource::iteratorOpened( QgsAbstractFeatureIterator* it )
 {
+  QMutexLocker locker( &mActiveIteratorsMutex );
   mActiveIterators.insert( it );
 }
 
 void QgsAbstractFeatureSource::iteratorClosed( QgsAbstractFeatureIterator* it )
 {
+  QMutexLocker locker( &mActiveIteratorsMutex );
   mActiveIterators.remove( it );
 }
 
@@ -23,6 +23,7 @@
 #include "qgssimplifymethod.h"
 
 #include <QList>
+#include <QMutex>
 typedef QList<int> QgsAttributeList;
 
 /**
@@ -131,6 +132,19 @@ class CORE_EXPORT QgsFeatureRequest
     //! @note added in 2.2
     const QgsSimplifyMethod& simplifyMethod() const { return mSimplifyMethod; }
 
+    //! Restrict the features to the ids from minFid to maxFid (inclusive), in addition to the filter.
+    //! The range is set on the parts of a request by QgsAbstractFeatureSource::partitionRequest(),
+    //! it is only honored by the sources which partition requests.
+    //! @note added in 2.8
+    QgsFeatureRequest& setFilterFidRange( QgsFeatureId minFid, QgsFeatureId maxFid );
+    //! Return true if the features are restricted to a range of ids
+    //! @note added in 2.8
+    bool hasFilterFidRange() const { return mHasFidRange; }
+    //! @note added in 2.8
+    QgsFeatureId filterFidRangeMin() const { return mFidRangeMin; }
+    //! @note added in 2.8
+    QgsFeatureId filterFidRangeMax() const { return mFidRangeMax; }
+
     /**
      * Check if a feature is accepted by this requests filter
      *
@@ -155,6 +169,9 @@ class CORE_EXPORT QgsFeatureRequest
     Flags mFlags;
     QgsAttributeList mAttrs;
     QgsSimplifyMethod mSimplifyMethod;
+    bool mHasFidRange;
+    QgsFeatureId mFidRangeMin;
+    QgsFeatureId mFidRangeMax;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsFeatureRequest::Flags )
@@ -173,11 +190,23 @@ class CORE_EXPORT QgsAbstractFeatureSource
 
     virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request ) = 0;
 
+    /** Split a request into requests for parts of its features, so that a full scan
+     * can be read concurrently: the iterators of the parts may be used from different
+     * threads at the same time. Together the parts return the features of the request once.
+     * The default implementation returns the request itself.
+     * @param request request to split
+     * @param maxParts maximal number of parts, e.g. the number of threads
+     * @note added in 2.8
+     */
+    virtual QList<QgsFeatureRequest> partitionRequest( const QgsFeatureRequest& request, int maxParts );
+
   protected:
     void iteratorOpened( QgsAbstractFeatureIterator* it );
     void iteratorClosed( QgsAbstractFeatureIterator* it );
 
     QSet< QgsAbstractFeatureIterator* > mActiveIterators;
+    //! guards mActiveIterators, the iterators may be opened and closed in different threads
+    QMutex mActiveIteratorsMutex;
 
     template<typename> friend class QgsAbstractFeatureIteratorFromSource;
 };
@@ -2854,8 +2854,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
     {
       int nPoints;
       wkbPtr >> nPoints;
-      for ( int index = 0; index < nPoints; ++index )
-        transformVertex( wkbPtr, ct, hasZValue );
+      transformVertices( wkbPtr, nPoints, ct, hasZValue );
 
       break;
     }
@@ -2870,8 +2869,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
       {
         int nPoints;
         wkbPtr >> nPoints;
-        for ( int index2 = 0; index2 < nPoints; ++index2 )
-          transformVertex( wkbPtr, ct, hasZValue );
+        transformVertices( wkbPtr, nPoints, ct, hasZValue );
 
       }
       break;
@@ -2902,8 +2900,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
         wkbPtr += 1 + sizeof( int );
         int nPoints;
         wkbPtr >> nPoints;
-        for ( int index2 = 0; index2 < nPoints; ++index2 )
-          transformVertex( wkbPtr, ct, hasZValue );
+        transformVertices( wkbPtr, nPoints, ct, hasZValue );
 
       }
       break;
@@ -2924,8 +2921,7 @@ int QgsGeometry::transform( const QgsCoordinateTransform& ct )
         {
           int nPoints;
           wkbPtr >> nPoints;
-          for ( int index3 = 0; index3 < nPoints; ++index3 )
-            transformVertex( wkbPtr, ct, hasZValue );
+          transformVertices( wkbPtr, nPoints, ct, hasZValue );
 
         }
       }
@@ -4649,6 +4645,27 @@ void QgsGeometry::transformVertex( QgsWkbPtr &wkbPtr, const QgsCoordinateTransfo
 
 }
 
+void QgsGeometry::transformVertices( QgsWkbPtr &wkbPtr, int nPoints, const QgsCoordinateTransform& ct, bool hasZValue )
+{
+  // copy the vertices so that they are transformed in one go
+  QVector<double> xy( 2 * nPoints );
+  unsigned char* ptr = wkbPtr;
+  for ( int i = 0; i < nPoints; ++i )
+  {
+    memcpy( xy.data() + 2 * i, ptr, 2 * sizeof( double ) );
+    ptr += ( hasZValue ? 3 : 2 ) * sizeof( double );
+  }
+
+  ct.transformInPlace( nPoints, xy.data() );
+
+  for ( int i = 0; i < nPoints; ++i )
+  {
+    wkbPtr << xy[2 * i] << xy[2 * i + 1];
+    if ( hasZValue )
+      wkbPtr += sizeof( double );
+  }
+}
+
 GEOSGeometry* QgsGeometry::linePointDifference( GEOSGeometry* GEOSsplitPoint )
 {
   int type = GEOSGeomTypeId_r( geosinit.ctxt, mGeos );
@@ -6577,3 +6594,160 @@ QgsGeometry *QgsGeometry::unaryUnion( const QList<QgsGeometry*> &geometryList )
   ret->fromGeos( geomUnion );
   return ret;
 }
+
+QgsPreparedGeometry::QgsPreparedGeometry( const QgsGeometry& geometry )
+    : mGeometry( geometry )
+    , mPrepared( 0 )
+{
+  prepare();
+}
+
+QgsPreparedGeometry::QgsPreparedGeometry( const QgsRectangle& rect )
+    : mPrepared( 0 )
+{
+  QgsGeometry* g = QgsGeometry::fromRect( rect );
+  if ( g )
+  {
+    mGeometry = *g;
+    delete g;
+  }
+  prepare();
+}
+
+QgsPreparedGeometry::~QgsPreparedGeometry()
+{
+  if ( mPrepared )
+    GEOSPreparedGeom_destroy_r( geosinit.ctxt, mPrepared );
+}
+
+void QgsPreparedGeometry::prepare()
+{
+  const GEOSGeometry* geos = mGeometry.asGeos();
+  if ( !geos )
+  {
+    QgsDebugMsg( "GEOS geometry not available!" );
+    return;
+  }
+
+  try
+  {
+    mPrepared = GEOSPrepare_r( geosinit.ctxt, geos );
+  }
+  catch ( GEOSException &e )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Exception: %1" ).arg( e.what() ), QObject::tr( "GEOS" ) );
+    mPrepared = 0;
+  }
+}
+
+bool QgsPreparedGeometry::preparedOp(
+  char( *op )( GEOSContextHandle_t handle, const GEOSPreparedGeometry*, const GEOSGeometry * ),
+  char( *fallbackOp )( GEOSContextHandle_t handle, const GEOSGeometry*, const GEOSGeometry * ),
+  const QgsGeometry* geometry ) const
+{
+  if ( !mPrepared || !geometry )
+    return false;
+
+  try // geos might throw exception on error
+  {
+    // the GEOS geometry is kept in the tested geometry for further tests
+    const GEOSGeometry* geos = geometry->asGeos();
+    if ( !geos )
+    {
+      QgsDebugMsg( "GEOS geometry not available!" );
+      return false;
+    }
+
+    // the predicates return 2 on exception
+    if ( op )
+      return op( geosinit.ctxt, mPrepared, geos ) == 1;
+    else
+      return fallbackOp( geosinit.ctxt, mGeometry.asGeos(), geos ) == 1;
+  }
+  CATCH_GEOS( false )
+}
+
+bool QgsPreparedGeometry::intersects( const QgsGeometry* geometry ) const
+{
+  return preparedOp( GEOSPreparedIntersects_r, GEOSIntersects_r, geometry );
+}
+
+bool QgsPreparedGeometry::contains( const QgsPoint& point ) const
+{
+  if ( !mPrepared )
+    return false;
+
+  GEOSGeometry *geosPoint = 0;
+  bool returnval = false;
+
+  try
+  {
+    geosPoint = createGeosPoint( point );
+    returnval = GEOSPreparedContains_r( geosinit.ctxt, mPrepared, geosPoint ) == 1;
+  }
+  catch ( GEOSException &e )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Exception: %1" ).arg( e.what() ), QObject::tr( "GEOS" ) );
+    returnval = false;
+  }
+
+  if ( geosPoint )
+    GEOSGeom_destroy_r( geosinit.ctxt, geosPoint );
+
+  return returnval;
+}
+
+bool QgsPreparedGeometry::contains( const QgsGeometry* geometry ) const
+{
+  return preparedOp( GEOSPreparedContains_r, GEOSContains_r, geometry );
+}
+
+bool QgsPreparedGeometry::containsProperly( const QgsGeometry* geometry ) const
+{
+  return preparedOp( GEOSPreparedContainsProperly_r, 0, geometry );
+}
+
+bool QgsPreparedGeometry::covers( const QgsGeometry* geometry ) const
+{
+  return preparedOp( GEOSPreparedCovers_r, 0, geometry );
+}
+
+bool QgsPreparedGeometry::equals( const QgsGeometry* geometry ) const
+{
+  return preparedOp( 0, GEOSEquals_r, geometry );
+}
+
+// the remaining prepared predicates are available since GEOS 3.3
+#if defined(GEOS_VERSION_MAJOR) && defined(GEOS_VERSION_MINOR) && \
+ ((GEOS_VERSION_MAJOR>3) || ((GEOS_VERSION_MAJOR==3) && (GEOS_VERSION_MINOR>=3)))
+#define PREPARED_OP(op) op
+#else
+#define PREPARED_OP(op) 0
+#endif
+
+bool QgsPreparedGeometry::disjoint( const QgsGeometry* geometry ) const
+{
+  return preparedOp( PREPARED_OP( GEOSPreparedDisjoint_r ), GEOSDisjoint_r, geometry );
+}
+
+bool QgsPreparedGeometry::touches( const QgsGeometry* geometry ) const
+{
+  return preparedOp( PREPARED_OP( GEOSPreparedTouches_r ), GEOSTouches_r, geometry );
+}
+
+bool QgsPreparedGeometry::overlaps( const QgsGeometry* geometry ) const
+{
+  return preparedOp( PREPARED_OP( GEOSPreparedOverlaps_r ), GEOSOverlaps_r, geometry );
+}
+
+bool QgsPreparedGeometry::within( const QgsGeometry* geometry ) const
+{
+  return preparedOp( PREPARED_OP( GEOSPreparedWithin_r ), GEOSWithin_r, geometry );
+}
+
+bool QgsPreparedGeometry::crosses( const QgsGeometry* geometry ) const
+{
+  return preparedOp( PREPARED_OP( GEOSPreparedCrosses_r ), GEOSCrosses_r, geometry );
+}
+
+#undef PREPARED_OP
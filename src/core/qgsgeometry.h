@@ -578,6 +578,13 @@ class CORE_EXPORT QgsGeometry
     @param hasZValue 25D type?*/
     void transformVertex( QgsWkbPtr &wkbPtr, const QgsCoordinateTransform& ct, bool hasZValue );
 
+    /**Transforms consecutive vertices by ct with a single call.
+    @param wkbPtr pointer to the first vertex in wkb. Is increased automatically by the function
+    @param nPoints number of vertices
+    @param ct the QgsCoordinateTransform
+    @param hasZValue 25D type?*/
+    void transformVertices( QgsWkbPtr &wkbPtr, int nPoints, const QgsCoordinateTransform& ct, bool hasZValue );
+
     //helper functions for geometry splitting
 
     /**Splits line/multiline geometries
@@ -663,6 +670,65 @@ class CORE_EXPORT QgsGeometry
 
 Q_DECLARE_METATYPE( QgsGeometry );
 
+/** \ingroup core
+ * A geometry prepared for repeated spatial predicate tests against many other geometries.
+ * It keeps the GEOS prepared geometry (with its spatial index of segments), so testing e.g.
+ * many points against one polygon is much faster than with the QgsGeometry predicates.
+ * The GEOS representation of the tested geometries is cached in them and reused by later tests.
+ * @note added in 2.8
+ */
+class CORE_EXPORT QgsPreparedGeometry
+{
+  public:
+    /** Prepare a copy of the geometry */
+    QgsPreparedGeometry( const QgsGeometry& geometry );
+    /** Prepare the polygon of the rectangle */
+    QgsPreparedGeometry( const QgsRectangle& rect );
+    ~QgsPreparedGeometry();
+
+    /** Return the prepared geometry */
+    const QgsGeometry& geometry() const { return mGeometry; }
+
+    /** Return whether the geometry could be prepared, all tests return false otherwise */
+    bool isValid() const { return mPrepared != 0; }
+
+    /** Test for intersection with a geometry */
+    bool intersects( const QgsGeometry* geometry ) const;
+    /** Test for containment of a point */
+    bool contains( const QgsPoint& point ) const;
+    /** Test for containment of a geometry */
+    bool contains( const QgsGeometry* geometry ) const;
+    /** Test for containment of a geometry without touching the boundary */
+    bool containsProperly( const QgsGeometry* geometry ) const;
+    /** Test whether no point of the geometry lies outside the prepared geometry */
+    bool covers( const QgsGeometry* geometry ) const;
+    /** Test for disjointness with a geometry */
+    bool disjoint( const QgsGeometry* geometry ) const;
+    /** Test for equality with a geometry (not accelerated by the preparation) */
+    bool equals( const QgsGeometry* geometry ) const;
+    /** Test whether the geometries touch */
+    bool touches( const QgsGeometry* geometry ) const;
+    /** Test whether the geometries overlap */
+    bool overlaps( const QgsGeometry* geometry ) const;
+    /** Test whether the prepared geometry is within the geometry */
+    bool within( const QgsGeometry* geometry ) const;
+    /** Test whether the geometries cross */
+    bool crosses( const QgsGeometry* geometry ) const;
+
+  private:
+    QgsPreparedGeometry( const QgsPreparedGeometry& );
+    QgsPreparedGeometry& operator=( const QgsPreparedGeometry& );
+
+    void prepare();
+
+    bool preparedOp( char( *op )( GEOSContextHandle_t handle, const GEOSPreparedGeometry*, const GEOSGeometry * ),
+                     char( *fallbackOp )( GEOSContextHandle_t handle, const GEOSGeometry*, const GEOSGeometry * ),
+                     const QgsGeometry* geometry ) const;
+
+    QgsGeometry mGeometry;
+    const GEOSPreparedGeometry* mPrepared;
+};
+
 class CORE_EXPORT QgsWkbPtr
 {
     mutable unsigned char *mP;
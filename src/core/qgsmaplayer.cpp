@@ -158,12 +158,8 @@ void QgsMapLayer::drawLabels( QgsRenderContext& rendererContext )
   Q_UNUSED( rendererContext );
 }
 
-bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
+QString QgsMapLayer::dataSourceFromXML( const QDomElement& layerElement )
 {
-  QgsCoordinateReferenceSystem savedCRS;
-  CUSTOM_CRS_VALIDATION savedValidation;
-  bool layerError;
-
   QDomNode mnl;
   QDomElement mne;
 
@@ -176,41 +172,41 @@ bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
   // set data source
   mnl = layerElement.namedItem( "datasource" );
   mne = mnl.toElement();
-  mDataSource = mne.text();
+  QString dataSource = mne.text();
 
   // TODO: this should go to providers
   if ( provider == "spatialite" )
   {
-    QgsDataSourceURI uri( mDataSource );
+    QgsDataSourceURI uri( dataSource );
     uri.setDatabase( QgsProject::instance()->readPath( uri.database() ) );
-    mDataSource = uri.uri();
+    dataSource = uri.uri();
   }
   else if ( provider == "ogr" )
   {
-    QStringList theURIParts = mDataSource.split( "|" );
+    QStringList theURIParts = dataSource.split( "|" );
     theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
-    mDataSource = theURIParts.join( "|" );
+    dataSource = theURIParts.join( "|" );
   }
   else if ( provider == "gpx" )
   {
-    QStringList theURIParts = mDataSource.split( "?" );
+    QStringList theURIParts = dataSource.split( "?" );
     theURIParts[0] = QgsProject::instance()->readPath( theURIParts[0] );
-    mDataSource = theURIParts.join( "?" );
+    dataSource = theURIParts.join( "?" );
   }
   else if ( provider == "delimitedtext" )
   {
-    QUrl urlSource = QUrl::fromEncoded( mDataSource.toAscii() );
+    QUrl urlSource = QUrl::fromEncoded( dataSource.toAscii() );
 
-    if ( !mDataSource.startsWith( "file:" ) )
+    if ( !dataSource.startsWith( "file:" ) )
     {
-      QUrl file = QUrl::fromLocalFile( mDataSource.left( mDataSource.indexOf( "?" ) ) );
+      QUrl file = QUrl::fromLocalFile( dataSource.left( dataSource.indexOf( "?" ) ) );
       urlSource.setScheme( "file" );
       urlSource.setPath( file.path() );
     }
 
     QUrl urlDest = QUrl::fromLocalFile( QgsProject::instance()->readPath( urlSource.toLocalFile() ) );
     urlDest.setQueryItems( urlSource.queryItems() );
-    mDataSource = QString::fromAscii( urlDest.toEncoded() );
+    dataSource = QString::fromAscii( urlDest.toEncoded() );
   }
   else if ( provider == "wms" )
   {
@@ -225,13 +221,13 @@ bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
     // This is modified version of old QgsWmsProvider::parseUri
     // The new format has always params crs,format,layers,styles and that params
     // should not appear in old format url -> use them to identify version
-    if ( !mDataSource.contains( "crs=" ) && !mDataSource.contains( "format=" ) )
+    if ( !dataSource.contains( "crs=" ) && !dataSource.contains( "format=" ) )
     {
       QgsDebugMsg( "Old WMS URI format detected -> converting to new format" );
       QgsDataSourceURI uri;
-      if ( !mDataSource.startsWith( "http:" ) )
+      if ( !dataSource.startsWith( "http:" ) )
       {
-        QStringList parts = mDataSource.split( "," );
+        QStringList parts = dataSource.split( "," );
         QStringListIterator iter( parts );
         while ( iter.hasNext() )
         {
@@ -280,9 +276,9 @@ bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
       }
       else
       {
-        uri.setParam( "url", mDataSource );
+        uri.setParam( "url", dataSource );
       }
-      mDataSource = uri.encodedUri();
+      dataSource = uri.encodedUri();
       // At this point, the URI is obviously incomplete, we add additional params
       // in QgsRasterLayer::readXml
     }
@@ -290,9 +286,23 @@ bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
   }
   else
   {
-    mDataSource = QgsProject::instance()->readPath( mDataSource );
+    dataSource = QgsProject::instance()->readPath( dataSource );
   }
 
+  return dataSource;
+}
+
+bool QgsMapLayer::readLayerXML( const QDomElement& layerElement )
+{
+  QgsCoordinateReferenceSystem savedCRS;
+  CUSTOM_CRS_VALIDATION savedValidation;
+  bool layerError;
+
+  QDomNode mnl;
+  QDomElement mne;
+
+  mDataSource = dataSourceFromXML( layerElement );
+
   // Set the CRS from project file, asking the user if necessary.
   // Make it the saved CRS to have WMS layer projected correctly.
   // We will still overwrite whatever GDAL etc picks up anyway
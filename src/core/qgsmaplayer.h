@@ -197,6 +197,12 @@ class CORE_EXPORT QgsMapLayer : public QObject
      */
     bool readLayerXML( const QDomElement& layerElement );
 
+    /** Return the data source stored in the layer's Dom node, with paths resolved
+     * the same way as by readLayerXML() (the provider may still adjust it in readXml())
+     * @note added in 2.8
+     */
+    static QString dataSourceFromXML( const QDomElement& layerElement );
+
 
     /** stores state in Dom node
        @param layerElement is a Dom element corresponding to ``maplayer'' tag
@@ -18,7 +18,18 @@
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayer.h"
 
+#include <QPainter>
+
+#include <cmath>
+
+//! tolerance (in pixels) for a shift between two views to be considered as a whole number of pixels
+static const double SHIFT_TOLERANCE = 0.01;
+
 QgsMapRendererCache::QgsMapRendererCache()
+    : mMaxImagesPerLayer( 4 )
+    , mMaxLayerCacheSize( 64 * 1024 * 1024 )
+    , mMaxCacheSize( 256 * 1024 * 1024 )
+    , mUseCounter( 0 )
 {
   clear();
 }
@@ -33,6 +44,7 @@ void QgsMapRendererCache::clearInternal()
 {
   mExtent.setMinimal();
   mScale = 0;
+  mRotation = 0;
 
   // make sure we are disconnected from all layers
   foreach ( QString layerId, mCachedImages.keys() )
@@ -47,19 +59,24 @@ void QgsMapRendererCache::clearInternal()
 }
 
 bool QgsMapRendererCache::init( QgsRectangle extent, double scale )
+{
+  return init( extent, scale, 0 );
+}
+
+bool QgsMapRendererCache::init( QgsRectangle extent, double scale, double rotation )
 {
   QMutexLocker lock( &mMutex );
 
   // check whether the params are the same
   if ( extent == mExtent &&
-       scale == mScale )
+       scale == mScale &&
+       rotation == mRotation )
     return true;
 
-  clearInternal();
-
   // set new params
   mExtent = extent;
   mScale = scale;
+  mRotation = rotation;
 
   return false;
 }
@@ -67,20 +84,218 @@ bool QgsMapRendererCache::init( QgsRectangle extent, double scale )
 void QgsMapRendererCache::setCacheImage( QString layerId, const QImage& img )
 {
   QMutexLocker lock( &mMutex );
-  mCachedImages[layerId] = img;
+
+  QList<QgsMapRendererCacheEntry>& entries = mCachedImages[layerId];
+  for ( int i = 0; i < entries.count(); ++i )
+  {
+    const QgsMapRendererCacheEntry& e = entries[i];
+    if ( e.extent == mExtent && e.scale == mScale && e.rotation == mRotation )
+    {
+      entries.removeAt( i );
+      break;
+    }
+  }
+
+  QgsMapRendererCacheEntry entry;
+  entry.extent = mExtent;
+  entry.scale = mScale;
+  entry.rotation = mRotation;
+  entry.image = img;
+  entry.lastUsed = ++mUseCounter;
+  entries.prepend( entry );
+  trimLayerImages( entries );
+  trimCache();
 
   // connect to the layer to listen to layer's repaintRequested() signals
   QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
   if ( layer )
   {
-    connect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ) );
+    connect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ), Qt::UniqueConnection );
   }
 }
 
 QImage QgsMapRendererCache::cacheImage( QString layerId )
 {
   QMutexLocker lock( &mMutex );
-  return mCachedImages.value( layerId );
+
+  if ( !mCachedImages.contains( layerId ) )
+    return QImage();
+
+  QList<QgsMapRendererCacheEntry>& entries = mCachedImages[layerId];
+  for ( int i = 0; i < entries.count(); ++i )
+  {
+    const QgsMapRendererCacheEntry& e = entries[i];
+    if ( e.extent == mExtent && e.scale == mScale && e.rotation == mRotation )
+    {
+      // move to front as the most recently used
+      if ( i > 0 )
+        entries.move( i, 0 );
+      entries[0].lastUsed = ++mUseCounter;
+      return entries[0].image;
+    }
+  }
+  return QImage();
+}
+
+QImage QgsMapRendererCache::shiftedCacheImage( QString layerId, QSize size, QPoint& offset )
+{
+  QMutexLocker lock( &mMutex );
+
+  // only plain shifts of unrotated views can be reused as they are
+  if ( mRotation != 0 || size.isEmpty() )
+    return QImage();
+
+  double mupp = mExtent.width() / size.width();
+  int bestArea = 0;
+  QImage bestImage;
+
+  foreach ( const QgsMapRendererCacheEntry& e, mCachedImages.value( layerId ) )
+  {
+    if ( e.scale != mScale || e.rotation != 0 || e.image.size() != size )
+      continue;
+
+    double dx = ( e.extent.xMinimum() - mExtent.xMinimum() ) / mupp;
+    double dy = ( mExtent.yMaximum() - e.extent.yMaximum() ) / mupp;
+    if ( fabs( dx - qRound( dx ) ) > SHIFT_TOLERANCE || fabs( dy - qRound( dy ) ) > SHIFT_TOLERANCE )
+      continue;
+
+    QRect overlap = QRect( QPoint( qRound( dx ), qRound( dy ) ), size ).intersected( QRect( QPoint( 0, 0 ), size ) );
+    int area = overlap.width() * overlap.height();
+    if ( area > bestArea )
+    {
+      bestArea = area;
+      bestImage = e.image;
+      offset = QPoint( qRound( dx ), qRound( dy ) );
+    }
+  }
+
+  return bestImage;
+}
+
+QImage QgsMapRendererCache::previewImage( QString layerId, QSize size )
+{
+  QMutexLocker lock( &mMutex );
+
+  if ( mRotation != 0 || size.isEmpty() || mScale <= 0 )
+    return QImage();
+
+  // pick the overlapping image with the scale closest to the current one
+  const QList<QgsMapRendererCacheEntry> entries = mCachedImages.value( layerId );
+  const QgsMapRendererCacheEntry* best = 0;
+  double bestRatio = 0;
+  for ( int i = 0; i < entries.count(); ++i )
+  {
+    const QgsMapRendererCacheEntry& e = entries.at( i );
+    if ( e.rotation != 0 || e.scale <= 0 || e.image.isNull() || !e.extent.intersects( mExtent ) )
+      continue;
+
+    double ratio = fabs( log( e.scale / mScale ) );
+    if ( !best || ratio < bestRatio )
+    {
+      best = &e;
+      bestRatio = ratio;
+    }
+  }
+
+  if ( !best )
+    return QImage();
+
+  double mupp = mExtent.width() / size.width();
+  QRectF target(( best->extent.xMinimum() - mExtent.xMinimum() ) / mupp,
+                ( mExtent.yMaximum() - best->extent.yMaximum() ) / mupp,
+                best->extent.width() / mupp,
+                best->extent.height() / mupp );
+
+  QImage preview( size, QImage::Format_ARGB32_Premultiplied );
+  preview.fill( 0 );
+  QPainter painter( &preview );
+  painter.drawImage( target, best->image );
+  painter.end();
+  return preview;
+}
+
+void QgsMapRendererCache::setMaximumImagesPerLayer( int count )
+{
+  QMutexLocker lock( &mMutex );
+  mMaxImagesPerLayer = qMax( 1, count );
+  for ( QMap<QString, QList<QgsMapRendererCacheEntry> >::iterator it = mCachedImages.begin(); it != mCachedImages.end(); ++it )
+    trimLayerImages( it.value() );
+}
+
+void QgsMapRendererCache::setMaximumLayerCacheSize( int bytes )
+{
+  QMutexLocker lock( &mMutex );
+  mMaxLayerCacheSize = bytes;
+  for ( QMap<QString, QList<QgsMapRendererCacheEntry> >::iterator it = mCachedImages.begin(); it != mCachedImages.end(); ++it )
+    trimLayerImages( it.value() );
+}
+
+void QgsMapRendererCache::setMaximumCacheSize( int bytes )
+{
+  QMutexLocker lock( &mMutex );
+  mMaxCacheSize = bytes;
+  trimCache();
+}
+
+void QgsMapRendererCache::trimCache()
+{
+  qint64 total = 0;
+  for ( QMap<QString, QList<QgsMapRendererCacheEntry> >::const_iterator it = mCachedImages.constBegin(); it != mCachedImages.constEnd(); ++it )
+  {
+    foreach ( const QgsMapRendererCacheEntry& e, it.value() )
+      total += e.image.byteCount();
+  }
+
+  while ( total > mMaxCacheSize )
+  {
+    // find the least recently used image which is not of the current view
+    QMap<QString, QList<QgsMapRendererCacheEntry> >::iterator oldestLayer = mCachedImages.end();
+    int oldestIndex = -1;
+    for ( QMap<QString, QList<QgsMapRendererCacheEntry> >::iterator it = mCachedImages.begin(); it != mCachedImages.end(); ++it )
+    {
+      const QList<QgsMapRendererCacheEntry>& entries = it.value();
+      for ( int i = 0; i < entries.count(); ++i )
+      {
+        const QgsMapRendererCacheEntry& e = entries[i];
+        if ( e.extent == mExtent && e.scale == mScale && e.rotation == mRotation )
+          continue;
+        if ( oldestIndex < 0 || e.lastUsed < oldestLayer.value()[oldestIndex].lastUsed )
+        {
+          oldestLayer = it;
+          oldestIndex = i;
+        }
+      }
+    }
+    if ( oldestIndex < 0 )
+      break;
+
+    total -= oldestLayer.value()[oldestIndex].image.byteCount();
+    oldestLayer.value().removeAt( oldestIndex );
+    if ( oldestLayer.value().isEmpty() )
+    {
+      QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( oldestLayer.key() );
+      if ( layer )
+      {
+        disconnect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ) );
+      }
+      mCachedImages.erase( oldestLayer );
+    }
+  }
+}
+
+void QgsMapRendererCache::trimLayerImages( QList<QgsMapRendererCacheEntry>& entries )
+{
+  // the first image (the most recent one) is always kept
+  int size = 0;
+  for ( int i = 0; i < entries.count(); ++i )
+  {
+    size += entries[i].image.byteCount();
+    if ( i > 0 && ( i >= mMaxImagesPerLayer || size > mMaxLayerCacheSize ) )
+    {
+      entries.erase( entries.begin() + i, entries.end() );
+      break;
+    }
+  }
 }
 
 void QgsMapRendererCache::layerRequestedRepaint()
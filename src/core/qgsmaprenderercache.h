@@ -19,16 +19,36 @@
 #include <QMap>
 #include <QImage>
 #include <QMutex>
+#include <QList>
 
 #include "qgsrectangle.h"
 
+/**
+ * Rendered image of a layer in the map renderer cache together with
+ * the view it has been rendered for.
+ * @note added in 2.8
+ * @note not available in python bindings
+ */
+struct QgsMapRendererCacheEntry
+{
+  QgsRectangle extent;
+  double scale;
+  double rotation;
+  QImage image;
+  uint lastUsed; //!< value of the use counter of the cache when the image was last used
+};
 
 /**
  * This class is responsible for keeping cache of rendered images of individual layers.
  *
  * Once a layer has rendered image stored in the cache (using setCacheImage(...)),
  * the cache listens to repaintRequested() signals from layer. If triggered, the cache
- * removes the rendered image (and disconnects from the layer).
+ * removes the rendered images (and disconnects from the layer).
+ *
+ * Several recently rendered images are kept for each layer, each one for the extent
+ * and scale it was rendered at. Images of other views are used to avoid a full
+ * rendering after a pan (see shiftedCacheImage()) and to show a preview while
+ * the layer is rendered after a zoom (see previewImage()).
  *
  * The class is thread-safe (multiple classes can access the same instance safely).
  *
@@ -44,19 +64,56 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     //! invalidate the cache contents
     void clear();
 
-    //! initialize cache: set new parameters and erase cache if parameters have changed
+    //! initialize cache: set new parameters. Images of other views are kept for reuse.
     //! @return flag whether the parameters are the same as last time
     bool init( QgsRectangle extent, double scale );
 
+    //! initialize cache: set new parameters including the map rotation
+    //! @note added in 2.8
+    bool init( QgsRectangle extent, double scale, double rotation );
+
     //! set cached image for the specified layer ID
     void setCacheImage( QString layerId, const QImage& img );
 
     //! get cached image for the specified layer ID. Returns null image if it is not cached.
     QImage cacheImage( QString layerId );
 
+    //! Get an image of the layer rendered at the current scale, whose extent overlaps
+    //! the current extent and is shifted by a whole number of pixels (e.g. after a pan).
+    //! Returns null image if there is no such image.
+    //! @param layerId ID of the layer
+    //! @param size size of the output image in pixels
+    //! @param offset position of the cached image within the current view, in pixels
+    //! @note added in 2.8
+    QImage shiftedCacheImage( QString layerId, QSize size, QPoint& offset );
+
+    //! Get a preview of the layer for the current extent, resampled from the cached image
+    //! whose scale is the closest one to the current scale. Returns null image if there is none.
+    //! @note added in 2.8
+    QImage previewImage( QString layerId, QSize size );
+
     //! remove layer from the cache
     void clearCacheImage( QString layerId );
 
+    //! Set the maximal number of images kept for one layer (default 4)
+    //! @note added in 2.8
+    void setMaximumImagesPerLayer( int count );
+    //! @note added in 2.8
+    int maximumImagesPerLayer() const { return mMaxImagesPerLayer; }
+
+    //! Set the maximal memory used by cached images of one layer in bytes (default 64 MB)
+    //! @note added in 2.8
+    void setMaximumLayerCacheSize( int bytes );
+    //! @note added in 2.8
+    int maximumLayerCacheSize() const { return mMaxLayerCacheSize; }
+
+    //! Set the maximal memory used by the cached images of all layers in bytes (default 256 MB).
+    //! The images of the current view are always kept.
+    //! @note added in 2.8
+    void setMaximumCacheSize( int bytes );
+    //! @note added in 2.8
+    int maximumCacheSize() const { return mMaxCacheSize; }
+
   protected slots:
     //! remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
@@ -65,12 +122,23 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     //! invalidate cache contents (without locking)
     void clearInternal();
 
+    //! remove the least recently used images of a layer above the limits (without locking)
+    void trimLayerImages( QList<QgsMapRendererCacheEntry>& entries );
+
+    //! remove the least recently used images of other views above the overall limit (without locking)
+    void trimCache();
+
   protected:
     QMutex mMutex;
     QgsRectangle mExtent;
     double mScale;
-    QMap<QString, QImage> mCachedImages;
+    double mRotation;
+    int mMaxImagesPerLayer;
+    int mMaxLayerCacheSize;
+    int mMaxCacheSize;
+    uint mUseCounter;
+    //! cached images of each layer, the most recently used first
+    QMap<QString, QList<QgsMapRendererCacheEntry> > mCachedImages;
 };
 
-
 #endif // QGSMAPRENDERERCACHE_H
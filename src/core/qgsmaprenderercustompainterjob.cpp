@@ -227,6 +227,7 @@ void QgsMapRendererCustomPainterJob::doRender()
 
     if ( !job.cached )
       job.renderer->render();
+    job.finished.fetchAndStoreRelease( 1 );
 
     if ( job.img )
     {
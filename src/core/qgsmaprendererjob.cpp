@@ -16,6 +16,7 @@
 #include "qgsmaprendererjob.h"
 
 #include <QPainter>
+#include <QRegion>
 #include <QTime>
 #include <QTimer>
 #include <QtConcurrentMap>
@@ -29,8 +30,13 @@
 #include "qgsmaplayerrenderer.h"
 #include "qgsmaprenderercache.h"
 #include "qgspallabeling.h"
+#include "qgsrendererv2.h"
+#include "qgsvectorlayer.h"
 #include "qgsvectorlayerrenderer.h"
 
+//! margin (in pixels) around the exposed area of a partially rendered layer
+static const int PARTIAL_RENDER_MARGIN = 64;
+
 
 QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings& settings )
     : mSettings( settings )
@@ -134,6 +140,28 @@ bool QgsMapRendererJob::reprojectToLayerExtent( const QgsCoordinateTransform* ct
 
 
 
+bool QgsMapRendererJob::canRenderPartially( QgsMapLayer* ml )
+{
+  if ( ml->type() == QgsMapLayer::RasterLayer )
+    return true;
+
+  if ( ml->type() == QgsMapLayer::VectorLayer )
+  {
+    // renderers which combine features (e.g. heatmap, point displacement)
+    // would produce visible seams along the exposed area
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+    QgsFeatureRendererV2* renderer = vl->rendererV2();
+    if ( !renderer )
+      return false;
+    QString type = renderer->type();
+    return type == "singleSymbol" || type == "categorizedSymbol" ||
+           type == "graduatedSymbol" || type == "RuleRenderer";
+  }
+
+  return false;
+}
+
+
 LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabeling* labelingEngine )
 {
   LayerRenderJobs layerJobs;
@@ -144,7 +172,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
 
   if ( mCache )
   {
-    bool cacheValid = mCache->init( mSettings.visibleExtent(), mSettings.scale() );
+    bool cacheValid = mCache->init( mSettings.visibleExtent(), mSettings.scale(), mSettings.rotation() );
     QgsDebugMsg( QString( "CACHE VALID: %1" ).arg( cacheValid ) );
     Q_UNUSED( cacheValid );
   }
@@ -180,7 +208,38 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
       continue;
     }
 
+    // Force render of layers that are being edited
+    // or if there's a labeling engine that needs the layer to register features
+    if ( mCache && ml->type() == QgsMapLayer::VectorLayer )
+    {
+      QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
+      if ( vl->isEditable() || ( labelingEngine && labelingEngine->willUseLayer( vl ) ) )
+        mCache->clearCacheImage( ml->id() );
+    }
+
+    // after a pan, reuse the overlapping part of the previous image of the layer
+    // and only render the exposed area
+    QImage shiftedImage;
+    QPoint shiftedOffset;
+    QRegion exposedRegion;
     QgsRectangle r1 = mSettings.visibleExtent(), r2;
+    if ( mCache && mCache->cacheImage( ml->id() ).isNull() && canRenderPartially( ml ) )
+    {
+      shiftedImage = mCache->shiftedCacheImage( ml->id(), mSettings.outputSize(), shiftedOffset );
+      if ( !shiftedImage.isNull() )
+      {
+        QRect outputRect( QPoint( 0, 0 ), mSettings.outputSize() );
+        exposedRegion = QRegion( outputRect ).subtracted( QRegion( QRect( shiftedOffset, shiftedImage.size() ) ) );
+
+        // add a margin so that symbols of features just outside the exposed area are drawn too
+        QRect exposedRect = exposedRegion.boundingRect().adjusted( -PARTIAL_RENDER_MARGIN, -PARTIAL_RENDER_MARGIN,
+                            PARTIAL_RENDER_MARGIN, PARTIAL_RENDER_MARGIN ).intersected( outputRect );
+        const QgsMapToPixel& mtp = mSettings.mapToPixel();
+        r1 = QgsRectangle( mtp.toMapCoordinates( exposedRect.topLeft() ), mtp.toMapCoordinates( exposedRect.bottomRight() ) );
+        r1.normalize();
+      }
+    }
+
     const QgsCoordinateTransform* ct = 0;
 
     if ( mSettings.hasCrsTransformEnabled() )
@@ -198,19 +257,12 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
       }
     }
 
-    // Force render of layers that are being edited
-    // or if there's a labeling engine that needs the layer to register features
-    if ( mCache && ml->type() == QgsMapLayer::VectorLayer )
-    {
-      QgsVectorLayer* vl = qobject_cast<QgsVectorLayer *>( ml );
-      if ( vl->isEditable() || ( labelingEngine && labelingEngine->willUseLayer( vl ) ) )
-        mCache->clearCacheImage( ml->id() );
-    }
-
     layerJobs.append( LayerRenderJob() );
     LayerRenderJob& job = layerJobs.last();
     job.cached = false;
+    job.finished = 0;
     job.img = 0;
+    job.previewImg = 0;
     job.blendMode = ml->blendMode();
     job.layerId = ml->id();
 
@@ -252,6 +304,18 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
       job.img = mypFlattenedImage;
       QPainter* mypPainter = new QPainter( job.img );
       mypPainter->setRenderHint( QPainter::Antialiasing, mSettings.testFlag( QgsMapSettings::Antialiasing ) );
+      if ( !shiftedImage.isNull() )
+      {
+        mypPainter->drawImage( shiftedOffset, shiftedImage );
+        mypPainter->setClipRegion( exposedRegion );
+      }
+      else if ( mCache )
+      {
+        // after a zoom, show the layer resampled from another scale until it is rendered
+        QImage preview = mCache->previewImage( ml->id(), mSettings.outputSize() );
+        if ( !preview.isNull() )
+          job.previewImg = new QImage( preview );
+      }
       job.context.setPainter( mypPainter );
     }
 
@@ -291,6 +355,9 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
       job.img = 0;
     }
 
+    delete job.previewImg;
+    job.previewImg = 0;
+
     if ( job.renderer )
     {
       foreach ( QString message, job.renderer->errors() )
@@ -310,7 +377,7 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
 QImage QgsMapRendererJob::composeImage( const QgsMapSettings& settings, const LayerRenderJobs& jobs )
 {
   QImage image( settings.outputSize(), settings.outputImageFormat() );
-  image.fill( settings.backgroundColor().rgb() );
+  image.fill( settings.backgroundColor() );
 
   QPainter painter( &image );
 
@@ -320,6 +387,9 @@ QImage QgsMapRendererJob::composeImage( const QgsMapSettings& settings, const La
 
     painter.setCompositionMode( job.blendMode );
 
+    if ( job.previewImg && job.finished.fetchAndAddAcquire( 0 ) == 0 )
+      painter.drawImage( 0, 0, *job.previewImg );
+
     Q_ASSERT( job.img != 0 );
     painter.drawImage( 0, 0, *job.img );
   }
@@ -18,6 +18,7 @@
 
 #include <QtConcurrentRun>
 #include <QFutureWatcher>
+#include <QAtomicInt>
 #include <QImage>
 #include <QPainter>
 #include <QObject>
@@ -46,6 +47,10 @@ struct LayerRenderJob
   QPainter::CompositionMode blendMode;
   bool cached; // if true, img already contains cached image from previous rendering
   QString layerId;
+  QImage* previewImg; // may be null, preview resampled from the cache shown until the layer is rendered
+  // non-zero when the renderer has finished rendering the layer: it is set in the
+  // rendering thread and read while the image is composed in the GUI thread
+  mutable QAtomicInt finished;
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -158,6 +163,10 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     bool needTemporaryImage( QgsMapLayer* ml );
 
+    //! whether the layer can be rendered only in a part of the map, reusing a shifted cached image for the rest
+    //! @note added in 2.8
+    bool canRenderPartially( QgsMapLayer* ml );
+
     static void drawLabeling( const QgsMapSettings& settings, QgsRenderContext& renderContext, QgsPalLabeling* labelingEngine, QPainter* painter );
     static void drawOldLabeling( const QgsMapSettings& settings, QgsRenderContext& renderContext );
     static void drawNewLabeling( const QgsMapSettings& settings, QgsRenderContext& renderContext, QgsPalLabeling* labelingEngine );
@@ -0,0 +1,242 @@
+/***************************************************************************
+  qgsmaprenderertiledjob.cpp
+  --------------------------------------
+  Date                 : October 2014
+  Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsmaprenderertiledjob.h"
+
+#include "qgsexception.h"
+#include "qgslogger.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsmaplayerrenderer.h"
+#include "qgspallabeling.h"
+#include "qgsrendererv2.h"
+#include "qgssymbollayerv2.h"
+#include "qgssymbolv2.h"
+#include "qgsvectorlayer.h"
+
+#include <QtConcurrentMap>
+
+#include <cmath>
+
+//! convert a symbol distance to output pixels
+static double symbolDistanceToPixels( double distance, QgsSymbolV2::OutputUnit unit, const QgsMapSettings& settings )
+{
+  if ( unit == QgsSymbolV2::MapUnit )
+    return distance / settings.mapUnitsPerPixel();
+  if ( unit == QgsSymbolV2::Pixel )
+    return distance;
+  // millimeters (also taken for mixed units)
+  return distance * settings.outputDpi() / 25.4;
+}
+
+static void renderTileLayer( LayerRenderJob& job )
+{
+  try
+  {
+    job.renderer->render();
+  }
+  catch ( QgsException & e )
+  {
+    QgsDebugMsg( "Caught unhandled QgsException: " + e.what() );
+  }
+  catch ( std::exception & e )
+  {
+    QgsDebugMsg( "Caught unhandled std::exception: " + QString::fromAscii( e.what() ) );
+  }
+  catch ( ... )
+  {
+    QgsDebugMsg( "Caught unhandled unknown exception" );
+  }
+
+  job.finished.fetchAndStoreRelease( 1 );
+}
+
+
+QgsMapRendererTiledJob::QgsMapRendererTiledJob( const QgsMapSettings& settings, QPainter* painter, int tileSize )
+    : QgsMapRendererJob( settings )
+    , mPainter( painter )
+    , mTileSize( qMax( tileSize, 1 ) )
+    , mTileMargin( 0 )
+    , mActive( false )
+    , mCanceled( 0 )
+    , mLabelingEngine( 0 )
+    , mLabelingResults( 0 )
+{
+}
+
+QgsMapRendererTiledJob::~QgsMapRendererTiledJob()
+{
+  delete mLabelingEngine;
+  mLabelingEngine = 0;
+
+  delete mLabelingResults;
+  mLabelingResults = 0;
+}
+
+void QgsMapRendererTiledJob::start()
+{
+  if ( isActive() )
+    return;
+
+  mRenderingStart.start();
+
+  mActive = true;
+  mCanceled = 0;
+
+  mErrors.clear();
+
+  delete mLabelingEngine;
+  mLabelingEngine = 0;
+  delete mLabelingResults;
+  mLabelingResults = 0;
+
+  QSize size = mSettings.outputSize();
+  int cols = ( size.width() + mTileSize - 1 ) / mTileSize;
+  int rows = ( size.height() + mTileSize - 1 ) / mTileSize;
+
+  if ( mSettings.rotation() != 0 )
+  {
+    // the tile extents would need to be rotated too
+    cols = rows = 1;
+  }
+
+  mTileMargin = cols * rows > 1 ? tileMargin() : 0;
+
+  QgsDebugMsg( QString( "TILED %1x%2 tiles, margin %3 px" ).arg( cols ).arg( rows ).arg( mTileMargin ) );
+
+  if ( mSettings.testFlag( QgsMapSettings::DrawLabeling ) )
+  {
+    // the layers of all tiles register their features here
+    mLabelingEngine = new QgsPalLabeling;
+    mLabelingEngine->loadEngineSettings();
+    mLabelingEngine->init( mSettings );
+  }
+
+  for ( int row = 0; row < rows && !mCanceled; ++row )
+  {
+    for ( int col = 0; col < cols && !mCanceled; ++col )
+    {
+      QRect tileRect( col * mTileSize, row * mTileSize, mTileSize, mTileSize );
+      renderTile( tileRect.intersected( QRect( QPoint( 0, 0 ), size ) ) );
+    }
+  }
+
+  if ( mLabelingEngine && !mCanceled )
+  {
+    drawLabeling( mSettings, mLabelingRenderContext, mLabelingEngine, mPainter );
+    mLabelingResults = mLabelingEngine->takeResults();
+  }
+
+  mActive = false;
+  mRenderingTime = mRenderingStart.elapsed();
+
+  QgsDebugMsg( QString( "TILED finished in %1 ms" ).arg( mRenderingTime ) );
+
+  emit finished();
+}
+
+void QgsMapRendererTiledJob::cancel()
+{
+  if ( !isActive() )
+    return;
+
+  mCanceled = 1;
+  mLabelingRenderContext.setRenderingStopped( true );
+}
+
+void QgsMapRendererTiledJob::waitForFinished()
+{
+  // the rendering is done in start()
+}
+
+bool QgsMapRendererTiledJob::isActive() const
+{
+  return mActive;
+}
+
+QgsLabelingResults* QgsMapRendererTiledJob::takeLabelingResults()
+{
+  QgsLabelingResults* results = mLabelingResults;
+  mLabelingResults = 0;
+  return results;
+}
+
+int QgsMapRendererTiledJob::tileMargin() const
+{
+  // the largest distance from its feature a symbol is drawn at, at least a
+  // pixel or two for antialiasing and raster resampling
+  double margin = 2;
+
+  foreach ( QString layerId, mSettings.layers() )
+  {
+    QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( QgsMapLayerRegistry::instance()->mapLayer( layerId ) );
+    if ( !vl || !vl->rendererV2() )
+      continue;
+
+    foreach ( QgsSymbolV2* symbol, vl->rendererV2()->symbols() )
+    {
+      for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+      {
+        QgsSymbolLayerV2* layer = symbol->symbolLayer( i );
+        double distance = symbolDistanceToPixels( layer->estimateMaxBleed(), layer->outputUnit(), mSettings );
+
+        QgsMarkerSymbolLayerV2* marker = dynamic_cast<QgsMarkerSymbolLayerV2*>( layer );
+        if ( marker )
+        {
+          QPointF offset = marker->offset();
+          distance = symbolDistanceToPixels( marker->size() / 2, marker->sizeUnit(), mSettings )
+                     + symbolDistanceToPixels( qMax( qAbs( offset.x() ), qAbs( offset.y() ) ), marker->offsetUnit(), mSettings );
+        }
+
+        margin = qMax( margin, distance );
+      }
+    }
+  }
+
+  // symbols in map units may be huge, they are cut rather than rendering much more than a tile
+  return qMin(( int ) std::ceil( margin ) + 1, mTileSize );
+}
+
+void QgsMapRendererTiledJob::renderTile( const QRect& tileRect )
+{
+  bool wholeMap = tileRect.size() == mSettings.outputSize();
+  QRect renderRect = wholeMap ? tileRect : tileRect.adjusted( -mTileMargin, -mTileMargin, mTileMargin, mTileMargin );
+
+  QgsMapSettings tileSettings = mSettings;
+  if ( !wholeMap )
+  {
+    QgsRectangle extent = mSettings.visibleExtent();
+    double mupp = mSettings.mapUnitsPerPixel();
+
+    tileSettings.setExtent( QgsRectangle( extent.xMinimum() + renderRect.left() * mupp,
+                                          extent.yMaximum() - ( renderRect.top() + renderRect.height() ) * mupp,
+                                          extent.xMinimum() + ( renderRect.left() + renderRect.width() ) * mupp,
+                                          extent.yMaximum() - renderRect.top() * mupp ) );
+    tileSettings.setOutputSize( renderRect.size() );
+  }
+
+  // render the layers in parallel into images, like QgsMapRendererParallelJob, but
+  // with the labeling engine of the whole map (a feature is registered only once,
+  // even if it is rendered in several tiles)
+  QgsMapSettings settings = mSettings;
+  mSettings = tileSettings;
+  LayerRenderJobs jobs = prepareJobs( 0, mLabelingEngine );
+  mSettings = settings;
+
+  QtConcurrent::blockingMap( jobs, renderTileLayer );
+
+  QImage image = composeImage( tileSettings, jobs );
+  cleanupJobs( jobs );
+
+  mPainter->drawImage( tileRect.topLeft(), image, QRect( tileRect.topLeft() - renderRect.topLeft(), tileRect.size() ) );
+}
@@ -0,0 +1,77 @@
+/***************************************************************************
+  qgsmaprenderertiledjob.h
+  --------------------------------------
+  Date                 : October 2014
+  Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSMAPRENDERERTILEDJOB_H
+#define QGSMAPRENDERERTILEDJOB_H
+
+#include "qgsmaprendererjob.h"
+
+/** Job implementation that renders the map in tiles onto a custom painter.
+ *
+ * The layers of each tile are rendered in parallel into images (like with
+ * QgsMapRendererParallelJob), which are then composited in the layer order and
+ * drawn onto the painter. The tiles are rendered one after another, so the memory
+ * used for the layer images stays bounded by the tile size even for very large outputs.
+ *
+ * The layers register their features with one labeling engine for the whole map while
+ * the tiles are rendered (the features which cross the tiles are labeled only once),
+ * the labels are drawn onto the painter after the tiles.
+ *
+ * The output is raster, for vector output (PDF, SVG) use QgsMapRendererCustomPainterJob.
+ * The rendering is done in start(), which returns when the map is finished.
+ *
+ * @note added in 2.8
+ */
+class CORE_EXPORT QgsMapRendererTiledJob : public QgsMapRendererJob
+{
+  public:
+    /** Constructor
+     * @param settings map settings
+     * @param painter destination painter
+     * @param tileSize maximal width and height of the tiles in pixels
+     */
+    QgsMapRendererTiledJob( const QgsMapSettings& settings, QPainter* painter, int tileSize = 4096 );
+    ~QgsMapRendererTiledJob();
+
+    virtual void start();
+    //! The tile which is being rendered is finished first
+    virtual void cancel();
+    virtual void waitForFinished();
+    virtual bool isActive() const;
+
+    virtual QgsLabelingResults* takeLabelingResults();
+
+    //! Return the maximal width and height of the tiles in pixels
+    int tileSize() const { return mTileSize; }
+
+  protected:
+    //! return the margin (in output pixels) of the tiles, so that symbols of features just outside a tile are drawn in it too
+    int tileMargin() const;
+
+    //! render one tile (given in output pixels) and draw it onto the painter
+    void renderTile( const QRect& tileRect );
+
+  protected:
+    QPainter* mPainter;
+    int mTileSize;
+    int mTileMargin;
+    bool mActive;
+    QAtomicInt mCanceled;
+
+    QgsPalLabeling* mLabelingEngine;
+    QgsRenderContext mLabelingRenderContext;
+    QgsLabelingResults* mLabelingResults;
+};
+
+#endif // QGSMAPRENDERERTILEDJOB_H
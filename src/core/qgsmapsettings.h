@@ -127,6 +127,8 @@ class CORE_EXPORT QgsMapSettings
       DrawLabeling       = 0x10,  //!< Enable drawing of labels on top of the map
       UseRenderingOptimization = 0x20, //!< Enable vector simplification and other rendering optimizations
       DrawSelection      = 0x40,  //!< Whether vector selections should be shown in the rendered map
+      ApproximateTransform = 0x80, //!< Reproject vector features by interpolation in a grid of exactly transformed points (error below a fraction of pixel)
+      DrawMarkerSprites  = 0x100, //!< Draw simple marker symbols from pre-rendered sprites in raster output
       // TODO: ignore scale-based visibility (overview)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
@@ -3149,6 +3149,25 @@ int QgsPalLabeling::prepareLayer( QgsVectorLayer* layer, QStringList& attrNames,
 
   QgsDebugMsgLevel( "PREPARE LAYER " + layer->id(), 4 );
 
+  if ( mActiveLayers.contains( layer->id() ) )
+  {
+    // the layer is rendered in several parts (e.g. map tiles): keep the features
+    // registered so far, only the attributes are needed again
+    QgsPalLayerSettings& lyr = mActiveLayers[layer->id()];
+    if ( lyr.isExpression )
+      attrNames << lyr.getLabelExpression()->referencedColumns();
+    else
+      attrNames << lyr.fieldName;
+
+    QMap< QgsPalLayerSettings::DataDefinedProperties, QgsDataDefined* >::const_iterator dIt = lyr.dataDefinedProperties.constBegin();
+    for ( ; dIt != lyr.dataDefinedProperties.constEnd(); ++dIt )
+    {
+      if ( dIt.value()->isActive() )
+        attrNames << dIt.value()->referencedColumns( layer );
+    }
+    return 1;
+  }
+
   // start with a temporary settings class, find out labeling info
   QgsPalLayerSettings lyrTmp;
   lyrTmp.readFromLayer( layer );
@@ -3342,6 +3361,10 @@ int QgsPalLabeling::prepareLayer( QgsVectorLayer* layer, QStringList& attrNames,
 
 int QgsPalLabeling::addDiagramLayer( QgsVectorLayer* layer, const QgsDiagramLayerSettings *s )
 {
+  // already added for another part of the map (e.g. map tiles)
+  if ( mActiveDiagramLayers.contains( layer->id() ) )
+    return 1;
+
   Layer* l = mPal->addLayer( layer->id().append( "d" ).toUtf8().data(), -1, -1, pal::Arrangement( s->placement ), METER, s->priority, s->obstacle, true, true );
   l->setArrangementFlags( s->placementFlags );
 
@@ -763,8 +763,9 @@ class CORE_EXPORT QgsPalLabeling : public QgsLabelingEngineInterface
     //! clears data defined objects from PAL layer settings for a registered layer
     virtual void clearActiveLayer( const QString& layerID );
     //! hook called when drawing layer before issuing select()
+    //! @note a layer which is already prepared keeps its registered features (rendered in several parts)
     virtual int prepareLayer( QgsVectorLayer* layer, QStringList &attrNames, QgsRenderContext& ctx );
-    //! adds a diagram layer to the labeling engine
+    //! adds a diagram layer to the labeling engine (once, it is kept if it is already added)
     virtual int addDiagramLayer( QgsVectorLayer* layer, const QgsDiagramLayerSettings *s );
     //! hook called when drawing for every feature in a layer
     virtual void registerFeature( const QString& layerID, QgsFeature& feat, const QgsRenderContext& context = QgsRenderContext(), QString dxfLayer = QString::null );
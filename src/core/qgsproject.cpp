@@ -32,6 +32,7 @@
 #include "qgsprojectfiletransform.h"
 #include "qgsprojectproperty.h"
 #include "qgsprojectversion.h"
+#include "qgsproviderregistry.h"
 #include "qgsrasterlayer.h"
 #include "qgsrectangle.h"
 #include "qgsrelationmanager.h"
@@ -707,6 +708,19 @@ QPair< bool, QList<QDomNode> > QgsProject::_getMapLayers( QDomDocument const &do
   //They need to refresh join caches and symbology infos after all layers are loaded
   QList< QPair< QgsVectorLayer*, QDomElement > > vLayerList;
 
+  //Open the data providers concurrently first (that is where most of the time is spent).
+  //The layers are then created with these providers in the original order.
+  QList< QPair<QString, QString> > sources;
+  for ( int i = 0; i < nl.count(); i++ )
+  {
+    QDomElement element = nl.item( i ).toElement();
+    QString type = element.attribute( "type" );
+    QString provider = element.namedItem( "provider" ).toElement().text();
+    if ( element.attribute( "embedded" ) != "1" && ( type == "vector" || type == "raster" ) && !provider.isEmpty() )
+      sources << qMakePair( provider, QgsMapLayer::dataSourceFromXML( element ) );
+  }
+  QgsProviderRegistry::instance()->preloadProviders( sources );
+
   for ( int i = 0; i < nl.count(); i++ )
   {
     QDomNode node = nl.item( i );
@@ -731,6 +745,9 @@ QPair< bool, QList<QDomNode> > QgsProject::_getMapLayers( QDomDocument const &do
     emit layerLoaded( i + 1, nl.count() );
   }
 
+  //Providers of layers which were not created (e.g. invalid ones)
+  QgsProviderRegistry::instance()->clearPreloadedProviders();
+
   //Update field map of layers with joins and create join caches if necessary
   //Needs to be done here once all dependent layers are loaded
   QList< QPair< QgsVectorLayer*, QDomElement > >::iterator vIt = vLayerList.begin();
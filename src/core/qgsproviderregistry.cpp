@@ -20,10 +20,15 @@
 
 #include <QString>
 #include <QDir>
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QLibrary>
+#include <QThread>
+#include <QtConcurrentMap>
 
 #include "qgis.h"
 #include "qgsdataprovider.h"
+#include "qgsdatasourceuri.h"
 #include "qgslogger.h"
 #include "qgsmessageoutput.h"
 #include "qgsmessagelog.h"
@@ -322,6 +327,27 @@ QgsDataProvider *QgsProviderRegistry::provider( QString const & providerKey, QSt
   // XXX should I check for and possibly delete any pre-existing providers?
   // XXX How often will that scenario occur?
 
+  {
+    QMutexLocker locker( &mPreloadedProvidersMutex );
+    if ( !mPreloadedProviders.isEmpty() )
+    {
+      QString key = providerKey + '\n' + dataSource;
+      QMultiHash<QString, QgsDataProvider*>::iterator it = mPreloadedProviders.find( key );
+      if ( it != mPreloadedProviders.end() )
+      {
+        QgsDataProvider *dataProvider = it.value();
+        mPreloadedProviders.erase( it );
+        QgsDebugMsg( "Using preloaded provider for " + dataSource );
+        return dataProvider;
+      }
+    }
+  }
+
+  return createProvider( providerKey, dataSource );
+}
+
+QgsDataProvider *QgsProviderRegistry::createProvider( QString const & providerKey, QString const & dataSource )
+{
   // load the plugin
   QString lib = library( providerKey );
 
@@ -369,7 +395,86 @@ QgsDataProvider *QgsProviderRegistry::provider( QString const & providerKey, QSt
 
   QgsDebugMsg( QString( "Instantiated the data provider plugin: %1" ).arg( dataProvider->name() ) );
   return dataProvider;
-} // QgsProviderRegistry::setDataProvider
+} // QgsProviderRegistry::createProvider
+
+
+/** Creates the providers of a group of data sources in a worker thread */
+class QgsProviderPreloader
+{
+  public:
+    typedef void result_type;
+
+    QgsProviderPreloader( QgsProviderRegistry* registry, QThread* thread,
+                          QMultiHash<QString, QgsDataProvider*>* providers, QMutex* mutex )
+        : mRegistry( registry ), mThread( thread ), mProviders( providers ), mMutex( mutex ) {}
+
+    void operator()( const QList< QPair<QString, QString> >& group )
+    {
+      QList< QPair<QString, QString> >::const_iterator it = group.constBegin();
+      for ( ; it != group.constEnd(); ++it )
+      {
+        QgsDataProvider *dataProvider = mRegistry->createProvider( it->first, it->second );
+        if ( !dataProvider )
+          continue;
+
+        // the provider is used by the layer in the thread which requested it;
+        // its child objects (e.g. file system watchers) are moved along with it
+        dataProvider->moveToThread( mThread );
+
+        QMutexLocker locker( mMutex );
+        mProviders->insert( it->first + '\n' + it->second, dataProvider );
+      }
+    }
+
+  private:
+    QgsProviderRegistry* mRegistry;
+    QThread* mThread;
+    QMultiHash<QString, QgsDataProvider*>* mProviders;
+    QMutex* mMutex;
+};
+
+void QgsProviderRegistry::preloadProviders( const QList< QPair<QString, QString> >& sources )
+{
+  // data sources of the same database may share its connection,
+  // so they are put into one group and opened one after another
+  QList< QList< QPair<QString, QString> > > groups;
+  QHash<QString, int> groupIndex;
+  QList< QPair<QString, QString> >::const_iterator it = sources.constBegin();
+  for ( ; it != sources.constEnd(); ++it )
+  {
+    QgsDataSourceURI uri( it->second );
+    QString connection = uri.database().isEmpty() && uri.service().isEmpty() ? it->second : uri.connectionInfo();
+    QString key = it->first + '\n' + connection;
+
+    if ( !groupIndex.contains( key ) )
+    {
+      groupIndex.insert( key, groups.count() );
+      groups.append( QList< QPair<QString, QString> >() );
+    }
+    groups[groupIndex[key]].append( *it );
+  }
+
+  if ( groups.count() < 2 )
+    return; // nothing to run in parallel
+
+  QgsDebugMsg( QString( "preloading %1 providers in %2 groups" ).arg( sources.count() ).arg( groups.count() ) );
+
+  // wait in an event loop: providers may need the main thread (e.g. to ask for credentials)
+  QFutureWatcher<void> watcher;
+  QEventLoop loop;
+  QObject::connect( &watcher, SIGNAL( finished() ), &loop, SLOT( quit() ) );
+  watcher.setFuture( QtConcurrent::map( groups, QgsProviderPreloader( this, QThread::currentThread(), &mPreloadedProviders, &mPreloadedProvidersMutex ) ) );
+  if ( !watcher.isFinished() )
+    loop.exec( QEventLoop::ExcludeUserInputEvents );
+  watcher.waitForFinished();
+}
+
+void QgsProviderRegistry::clearPreloadedProviders()
+{
+  QMutexLocker locker( &mPreloadedProvidersMutex );
+  qDeleteAll( mPreloadedProviders );
+  mPreloadedProviders.clear();
+}
 
 int QgsProviderRegistry::providerCapabilities( const QString &providerKey ) const
 {
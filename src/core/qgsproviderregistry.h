@@ -23,6 +23,9 @@
 
 #include <QDir>
 #include <QLibrary>
+#include <QMultiHash>
+#include <QMutex>
+#include <QPair>
 #include <QString>
 
 
@@ -30,6 +33,7 @@ class QgsDataProvider;
 class QgsProviderMetadata;
 class QgsVectorLayer;
 class QgsCoordinateReferenceSystem;
+class QgsProviderPreloader;
 
 
 /** \ingroup core
@@ -68,6 +72,24 @@ class CORE_EXPORT QgsProviderRegistry
     QgsDataProvider *provider( const QString & providerKey,
                                const QString & dataSource );
 
+    /** Create providers for the data sources concurrently on a thread pool.
+     * The providers are kept and returned by subsequent calls of provider() with the
+     * same key and data source, e.g. when the layers of a project are constructed.
+     * Data sources which may share a database connection are opened one after another.
+     * Events other than user input are processed while waiting for the providers.
+     * The providers are moved to the calling thread afterwards, so any QObject a provider
+     * creates in its constructor must be one of its children to follow it there.
+     * @param sources list of provider key and data source pairs
+     * @note added in 2.8
+     * @note not available in python bindings
+     */
+    void preloadProviders( const QList< QPair<QString, QString> >& sources );
+
+    /** Delete the preloaded providers which were not requested by provider()
+     * @note added in 2.8
+     */
+    void clearPreloadedProviders();
+
     /** Return the provider capabilities
         @param providerKey identificator of the provider
         @note Added in 2.6
@@ -167,12 +189,22 @@ class CORE_EXPORT QgsProviderRegistry
     /** ctor private since instance() creates it */
     QgsProviderRegistry( QString pluginPath );
 
+    /** Create an instance of the provider, without looking at the preloaded providers */
+    QgsDataProvider *createProvider( const QString & providerKey,
+                                     const QString & dataSource );
+
     /** associative container of provider metadata handles */
     Providers mProviders;
 
     /** directory in which provider plugins are installed */
     QDir mLibraryDirectory;
 
+    friend class QgsProviderPreloader;
+
+    /** providers created by preloadProviders(), by provider key and data source */
+    QMultiHash<QString, QgsDataProvider*> mPreloadedProviders;
+    QMutex mPreloadedProvidersMutex;
+
     /** file filter string for vector files
 
         Built once when registry is constructed by appending strings returned
@@ -32,7 +32,10 @@ QgsRenderContext::QgsRenderContext()
     mRendererScale( 1.0 ),
     mLabelingEngine( NULL ),
     mShowSelection( true ),
-    mUseRenderingOptimization( true )
+    mUseRenderingOptimization( true ),
+    mUseApproximateTransform( false ),
+    mUseMarkerSprites( false ),
+    mApproximateTransform( 0 )
 {
   mVectorSimplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
 }
@@ -50,6 +53,8 @@ QgsRenderContext QgsRenderContext::fromMapSettings( const QgsMapSettings& mapSet
   ctx.setForceVectorOutput( mapSettings.testFlag( QgsMapSettings::ForceVectorOutput ) );
   ctx.setUseAdvancedEffects( mapSettings.testFlag( QgsMapSettings::UseAdvancedEffects ) );
   ctx.setUseRenderingOptimization( mapSettings.testFlag( QgsMapSettings::UseRenderingOptimization ) );
+  ctx.setUseApproximateTransform( mapSettings.testFlag( QgsMapSettings::ApproximateTransform ) );
+  ctx.setUseMarkerSprites( mapSettings.testFlag( QgsMapSettings::DrawMarkerSprites ) );
   ctx.setCoordinateTransform( 0 );
   ctx.setSelectionColor( mapSettings.selectionColor() );
   ctx.setShowSelection( mapSettings.testFlag( QgsMapSettings::DrawSelection ) );
@@ -67,4 +72,5 @@ QgsRenderContext QgsRenderContext::fromMapSettings( const QgsMapSettings& mapSet
 void QgsRenderContext::setCoordinateTransform( const QgsCoordinateTransform* t )
 {
   mCoordTransform = t;
+  mApproximateTransform = 0;
 }
@@ -27,6 +27,7 @@
 
 class QPainter;
 
+class QgsApproximateTransform;
 class QgsLabelingEngineInterface;
 class QgsMapSettings;
 
@@ -118,6 +119,30 @@ class CORE_EXPORT QgsRenderContext
     const QgsVectorSimplifyMethod& vectorSimplifyMethod() const { return mVectorSimplifyMethod; }
     void setVectorSimplifyMethod( const QgsVectorSimplifyMethod& simplifyMethod ) { mVectorSimplifyMethod = simplifyMethod; }
 
+    /**Returns true if vector features may be reprojected approximately (see QgsMapSettings::ApproximateTransform)
+     * @note added in 2.8
+     */
+    bool useApproximateTransform() const { return mUseApproximateTransform; }
+    void setUseApproximateTransform( bool enabled ) { mUseApproximateTransform = enabled; }
+
+    /**Returns true if marker symbols should be drawn from pre-rendered sprites where possible
+     * (see QgsMapSettings::DrawMarkerSprites and QgsMarkerSymbolV2::setSpriteRenderingEnabled)
+     * @note added in 2.8
+     */
+    bool useMarkerSprites() const { return mUseMarkerSprites; }
+    void setUseMarkerSprites( bool enabled ) { mUseMarkerSprites = enabled; }
+
+    /**Returns approximation of the coordinate transform used to draw features, may be null
+     * @note added in 2.8
+     * @note not available in python bindings
+     */
+    const QgsApproximateTransform* approximateTransform() const { return mApproximateTransform; }
+    /**Sets approximation of the coordinate transform used to draw features. QgsRenderContext does not take ownership
+     * @note added in 2.8
+     * @note not available in python bindings
+     */
+    void setApproximateTransform( const QgsApproximateTransform* t ) { mApproximateTransform = t; }
+
   private:
 
     /**Painter for rendering operations*/
@@ -165,6 +190,15 @@ class CORE_EXPORT QgsRenderContext
 
     /**Simplification object which holds the information about how to simplify the features for fast rendering */
     QgsVectorSimplifyMethod mVectorSimplifyMethod;
+
+    /**True if vector features may be reprojected approximately*/
+    bool mUseApproximateTransform;
+
+    /**True if marker symbols should be drawn from sprites*/
+    bool mUseMarkerSprites;
+
+    /**Approximation of mCoordTransform for drawing of features (can be NULL)*/
+    const QgsApproximateTransform* mApproximateTransform;
 };
 
 #endif
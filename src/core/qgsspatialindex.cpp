@@ -23,6 +23,16 @@
 
 #include "SpatialIndex.h"
 
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QTextStream>
+
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
 using namespace SpatialIndex;
 
 
@@ -129,26 +139,319 @@ class QgsFeatureIteratorDataStream : public IDataStream
 };
 
 
+/** Bounding box and id of an indexed feature. Not a part of public API. */
+struct QgsSpatialIndexEntry
+{
+  double xMin, yMin, xMax, yMax;
+  QgsFeatureId id;
+};
+
+// number of children of a node of the static tree
+static const int STATIC_NODE_CAPACITY = 16;
+
+static bool _entryCenterXLessThan( const QgsSpatialIndexEntry& a, const QgsSpatialIndexEntry& b )
+{
+  return a.xMin + a.xMax < b.xMin + b.xMax;
+}
+
+static bool _entryCenterYLessThan( const QgsSpatialIndexEntry& a, const QgsSpatialIndexEntry& b )
+{
+  return a.yMin + a.yMax < b.yMin + b.yMax;
+}
+
+static inline bool _entryIntersects( const QgsSpatialIndexEntry& e, const QgsRectangle& rect )
+{
+  return e.xMin <= rect.xMaximum() && e.xMax >= rect.xMinimum() && e.yMin <= rect.yMaximum() && e.yMax >= rect.yMinimum();
+}
+
+static inline double _entryDistance( const QgsSpatialIndexEntry& e, const QgsPoint& point )
+{
+  double dx = qMax( qMax( e.xMin - point.x(), point.x() - e.xMax ), 0.0 );
+  double dy = qMax( qMax( e.yMin - point.y(), point.y() - e.yMax ), 0.0 );
+  return sqrt( dx * dx + dy * dy );
+}
+
+/** Read-only R-tree packed with the sort-tile-recursive algorithm. It is never modified once built,
+ * so any number of threads may query it at once. Not a part of public API. */
+class QgsSpatialIndexStaticTree
+{
+  public:
+    explicit QgsSpatialIndexStaticTree( QVector<QgsSpatialIndexEntry> entries )
+        : mEntries( entries )
+    {
+      // sort-tile-recursive order of the entries
+      int n = mEntries.count();
+      int leafCount = ( n + STATIC_NODE_CAPACITY - 1 ) / STATIC_NODE_CAPACITY;
+      int sliceCount = qMax( 1, ( int ) ceil( sqrt(( double ) leafCount ) ) );
+      int sliceSize = sliceCount * STATIC_NODE_CAPACITY;
+      qSort( mEntries.begin(), mEntries.end(), _entryCenterXLessThan );
+      for ( int i = 0; i < n; i += sliceSize )
+        qSort( mEntries.begin() + i, mEntries.begin() + qMin( i + sliceSize, n ), _entryCenterYLessThan );
+
+      // the level above the entries, then the levels above the nodes until there is the root only
+      QVector<QgsSpatialIndexEntry>* children = &mEntries;
+      while ( children->count() > 1 || mLevels.isEmpty() )
+      {
+        QVector<QgsSpatialIndexEntry> level;
+        for ( int i = 0; i < children->count(); i += STATIC_NODE_CAPACITY )
+        {
+          QgsSpatialIndexEntry node = children->at( i );
+          int last = qMin( i + STATIC_NODE_CAPACITY, children->count() );
+          for ( int j = i + 1; j < last; ++j )
+          {
+            const QgsSpatialIndexEntry& child = children->at( j );
+            node.xMin = qMin( node.xMin, child.xMin );
+            node.yMin = qMin( node.yMin, child.yMin );
+            node.xMax = qMax( node.xMax, child.xMax );
+            node.yMax = qMax( node.yMax, child.yMax );
+          }
+          node.id = i; // index of the first child
+          level.append( node );
+        }
+        mLevels.append( level );
+        children = &mLevels.last();
+        if ( level.isEmpty() )
+          break;
+      }
+    }
+
+    int count() const { return mEntries.count(); }
+
+    void intersects( const QgsRectangle& rect, const QSet<QgsFeatureId>& deletedIds, QList<QgsFeatureId>& list ) const
+    {
+      if ( mLevels.isEmpty() || mLevels.last().isEmpty() )
+        return;
+      intersects( mLevels.count() - 1, 0, rect, deletedIds, list );
+    }
+
+    /** visits entries by increasing distance from the point */
+    class NearestIterator
+    {
+      public:
+        NearestIterator( const QgsSpatialIndexStaticTree& tree, const QgsPoint& point )
+            : mTree( tree ), mPoint( point )
+        {
+          if ( !tree.mLevels.isEmpty() && !tree.mLevels.last().isEmpty() )
+            push( tree.mLevels.count() - 1, 0 );
+        }
+
+        //! return false when all entries were visited
+        bool next( QgsSpatialIndexEntry& entry, double& distance )
+        {
+          while ( !mQueue.empty() )
+          {
+            Item item = mQueue.top();
+            mQueue.pop();
+            if ( item.level < 0 )
+            {
+              entry = mTree.mEntries[item.index];
+              distance = item.distance;
+              return true;
+            }
+            const QgsSpatialIndexEntry& node = mTree.mLevels[item.level][item.index];
+            int childLevel = item.level - 1;
+            int childCount = childLevel < 0 ? mTree.mEntries.count() : mTree.mLevels[childLevel].count();
+            int last = qMin(( int ) node.id + STATIC_NODE_CAPACITY, childCount );
+            for ( int i = node.id; i < last; ++i )
+              push( childLevel, i );
+          }
+          return false;
+        }
+
+        //! distance of the next entry or node, negative if there is none
+        double nextDistance() const { return mQueue.empty() ? -1 : mQueue.top().distance; }
+
+      private:
+        struct Item
+        {
+          double distance;
+          int level;   //!< -1 for entries
+          int index;
+          bool operator<( const Item& other ) const { return distance > other.distance; } // closest first
+        };
+
+        void push( int level, int index )
+        {
+          Item item;
+          item.level = level;
+          item.index = index;
+          item.distance = _entryDistance( level < 0 ? mTree.mEntries[index] : mTree.mLevels[level][index], mPoint );
+          mQueue.push( item );
+        }
+
+        const QgsSpatialIndexStaticTree& mTree;
+        QgsPoint mPoint;
+        std::priority_queue<Item> mQueue;
+    };
+
+  private:
+    void intersects( int level, int index, const QgsRectangle& rect, const QSet<QgsFeatureId>& deletedIds, QList<QgsFeatureId>& list ) const
+    {
+      const QgsSpatialIndexEntry& node = mLevels[level][index];
+      if ( !_entryIntersects( node, rect ) )
+        return;
+
+      if ( level == 0 )
+      {
+        int last = qMin(( int ) node.id + STATIC_NODE_CAPACITY, mEntries.count() );
+        for ( int i = node.id; i < last; ++i )
+        {
+          const QgsSpatialIndexEntry& e = mEntries[i];
+          if ( _entryIntersects( e, rect ) && !deletedIds.contains( e.id ) )
+            list.append( e.id );
+        }
+        return;
+      }
+
+      int last = qMin(( int ) node.id + STATIC_NODE_CAPACITY, mLevels[level - 1].count() );
+      for ( int i = node.id; i < last; ++i )
+        intersects( level - 1, i, rect, deletedIds, list );
+    }
+
+    QVector<QgsSpatialIndexEntry> mEntries;
+    //! node levels, the first one above the entries, the last one with the root only
+    QList< QVector<QgsSpatialIndexEntry> > mLevels;
+};
+
+/** Immutable state of the index for concurrent queries: a static tree and the changes
+ * done since it was built. Not a part of public API. */
+struct QgsSpatialIndexSnapshot
+{
+  QSharedPointer<const QgsSpatialIndexStaticTree> tree;
+  QVector<QgsSpatialIndexEntry> addedEntries;
+  QSet<QgsFeatureId> deletedIds;  //!< features of the static tree which are not valid anymore
+
+  void intersects( const QgsRectangle& rect, QList<QgsFeatureId>& list ) const
+  {
+    tree->intersects( rect, deletedIds, list );
+    for ( int i = 0; i < addedEntries.count(); ++i )
+    {
+      if ( _entryIntersects( addedEntries[i], rect ) )
+        list.append( addedEntries[i].id );
+    }
+  }
+
+  void nearestNeighbor( const QgsPoint& point, int neighbors, QList<QgsFeatureId>& list ) const
+  {
+    // merge the entries of the static tree with the added ones, both by increasing distance
+    QList< QPair<double, QgsFeatureId> > added;
+    for ( int i = 0; i < addedEntries.count(); ++i )
+      added.append( qMakePair( _entryDistance( addedEntries[i], point ), addedEntries[i].id ) );
+    qSort( added );
+
+    QgsSpatialIndexStaticTree::NearestIterator it( *tree, point );
+    QgsSpatialIndexEntry entry;
+    double distance = 0;
+    bool hasEntry = it.next( entry, distance );
+    while ( hasEntry && deletedIds.contains( entry.id ) )
+      hasEntry = it.next( entry, distance );
+    int addedIndex = 0;
+
+    // like libspatialindex, entries in the same distance as the last neighbor are returned too
+    double lastDistance = -1;
+    while ( hasEntry || addedIndex < added.count() )
+    {
+      bool useAdded = !hasEntry || ( addedIndex < added.count() && added[addedIndex].first < distance );
+      double d = useAdded ? added[addedIndex].first : distance;
+      if ( list.count() >= neighbors && d > lastDistance )
+        break;
+
+      lastDistance = d;
+      if ( useAdded )
+      {
+        list.append( added[addedIndex++].second );
+      }
+      else
+      {
+        list.append( entry.id );
+        do
+        {
+          hasEntry = it.next( entry, distance );
+        }
+        while ( hasEntry && deletedIds.contains( entry.id ) );
+      }
+    }
+  }
+};
+
+// custom visitor that collects entries of the R-tree
+class QgsSpatialIndexEntryVisitor : public SpatialIndex::IVisitor
+{
+  public:
+    QgsSpatialIndexEntryVisitor( QVector<QgsSpatialIndexEntry>& entries )
+        : mEntries( entries ) {}
+
+    void visitNode( const INode& n )
+    { Q_UNUSED( n ); }
+
+    void visitData( const IData& d )
+    {
+      SpatialIndex::IShape* shape;
+      d.getShape( &shape );
+      SpatialIndex::Region r;
+      shape->getMBR( r );
+      delete shape;
+
+      QgsSpatialIndexEntry e;
+      e.xMin = r.getLow( 0 );
+      e.yMin = r.getLow( 1 );
+      e.xMax = r.getHigh( 0 );
+      e.yMax = r.getHigh( 1 );
+      e.id = d.getIdentifier();
+      mEntries.append( e );
+    }
+
+    void visitData( std::vector<const IData*>& v )
+    { Q_UNUSED( v ); }
+
+  private:
+    QVector<QgsSpatialIndexEntry>& mEntries;
+};
+
+
 /** Data of spatial index that may be implicitly shared */
 class QgsSpatialIndexData : public QSharedData
 {
   public:
     QgsSpatialIndexData()
+        : mBuffer( 0 )
+        , mMetadataOnDisk( false )
+        , mConcurrentQueries( false )
     {
       initTree();
     }
 
     explicit QgsSpatialIndexData( const QgsFeatureIterator& fi )
+        : mBuffer( 0 )
+        , mMetadataOnDisk( false )
+        , mConcurrentQueries( false )
     {
       QgsFeatureIteratorDataStream fids( fi );
       initTree( &fids );
     }
 
+    //! prepares data without R-tree, createDiskTree() or loadDiskTree() must follow
+    explicit QgsSpatialIndexData( const QString& fileBase )
+        : mStorage( 0 )
+        , mBuffer( 0 )
+        , mRTree( 0 )
+        , mFileBase( fileBase )
+        , mMetadataOnDisk( false )
+        , mConcurrentQueries( false )
+    {
+    }
+
     QgsSpatialIndexData( const QgsSpatialIndexData& other )
         : QSharedData( other )
+        , mBuffer( 0 )
+        , mMetadataOnDisk( false )
+        , mConcurrentQueries( other.mConcurrentQueries )
     {
+      // the copy is always kept in memory
       initTree();
 
+      QMutexLocker locker( &other.mMutex );
+
       // copy R-tree data one by one (is there a faster way??)
       double low[]  = { DBL_MIN, DBL_MIN };
       double high[] = { DBL_MAX, DBL_MAX };
@@ -159,8 +462,24 @@ class QgsSpatialIndexData : public QSharedData
 
     ~QgsSpatialIndexData()
     {
+      // the R-tree and the buffer flush their data on deletion, so they go first
       delete mRTree;
+      delete mBuffer;
       delete mStorage;
+
+      // the metadata mark the index files as complete, so they are written last
+      if ( !mMetadata.isEmpty() )
+      {
+        QFile metadataFile( QgsSpatialIndex::metadataFileName( mFileBase ) );
+        if ( metadataFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        {
+          metadataFile.write( mMetadata );
+        }
+        else
+        {
+          QgsDebugMsg( "cannot write spatial index metadata to " + metadataFile.fileName() );
+        }
+      }
     }
 
     void initTree( IDataStream* inputStream = 0 )
@@ -168,6 +487,179 @@ class QgsSpatialIndexData : public QSharedData
       // for now only memory manager
       mStorage = StorageManager::createNewMemoryStorageManager();
 
+      // create R-tree
+      SpatialIndex::id_type indexId;
+      mRTree = createTree( *mStorage, inputStream, indexId );
+    }
+
+    //! create a new tree in the disk files and bulk load it from the stream
+    bool createDiskTree( IDataStream* inputStream, SpatialIndex::id_type& indexId )
+    {
+      try
+      {
+        std::string baseName = QFile::encodeName( mFileBase ).constData();
+        mStorage = StorageManager::createNewDiskStorageManager( baseName, DISK_PAGE_SIZE );
+        mBuffer = StorageManager::createNewRandomEvictionsBuffer( *mStorage, DISK_BUFFER_CAPACITY, false );
+        mRTree = createTree( *mBuffer, inputStream && inputStream->hasNext() ? inputStream : 0, indexId );
+        return true;
+      }
+      catch ( Tools::Exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+      }
+      catch ( const std::exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "std::exception caught: %1" ).arg( e.what() ) );
+      }
+      catch ( ... )
+      {
+        QgsDebugMsg( "unknown spatial index exception caught" );
+      }
+
+      releaseTree();
+      return false;
+    }
+
+    //! open a tree stored in the disk files
+    bool loadDiskTree( SpatialIndex::id_type indexId )
+    {
+      try
+      {
+        std::string baseName = QFile::encodeName( mFileBase ).constData();
+        mStorage = StorageManager::loadDiskStorageManager( baseName );
+        mBuffer = StorageManager::createNewRandomEvictionsBuffer( *mStorage, DISK_BUFFER_CAPACITY, false );
+        mRTree = RTree::loadRTree( *mBuffer, indexId );
+        return true;
+      }
+      catch ( Tools::Exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "Tools::Exception caught: %1" ).arg( e.what().c_str() ) );
+      }
+      catch ( const std::exception &e )
+      {
+        Q_UNUSED( e );
+        QgsDebugMsg( QString( "std::exception caught: %1" ).arg( e.what() ) );
+      }
+      catch ( ... )
+      {
+        QgsDebugMsg( "unknown spatial index exception caught" );
+      }
+
+      releaseTree();
+      return false;
+    }
+
+    /** storage manager */
+    SpatialIndex::IStorageManager* mStorage;
+
+    /** page buffer on top of the disk storage manager (null for memory storage) */
+    SpatialIndex::StorageManager::IBuffer* mBuffer;
+
+    /** R-tree containing spatial index */
+    SpatialIndex::ISpatialIndex* mRTree;
+
+    /** base name of the index files if the index is stored on disk */
+    QString mFileBase;
+
+    /** metadata to be written once the index files are complete */
+    QByteArray mMetadata;
+
+    /** whether the metadata file of an opened index still marks the files as complete */
+    bool mMetadataOnDisk;
+
+    /** guards the R-tree (which may not be queried by several threads at once) and the snapshot */
+    mutable QMutex mMutex;
+
+    /** whether queries use snapshots instead of the R-tree */
+    bool mConcurrentQueries;
+
+    /** static tree of the last snapshot */
+    mutable QSharedPointer<const QgsSpatialIndexStaticTree> mStaticTree;
+    /** entries added since the static tree was built */
+    mutable QVector<QgsSpatialIndexEntry> mAddedEntries;
+    /** features of the static tree deleted since it was built */
+    mutable QSet<QgsFeatureId> mDeletedIds;
+    /** current snapshot, null if the index changed since the last query */
+    mutable QSharedPointer<const QgsSpatialIndexSnapshot> mSnapshot;
+
+    //! return snapshot of the current state for concurrent queries (with the lock held)
+    QSharedPointer<const QgsSpatialIndexSnapshot> snapshot() const
+    {
+      if ( mSnapshot )
+        return mSnapshot;
+
+      // rebuild the static tree once the changes are too many to be checked one by one
+      if ( !mStaticTree || mAddedEntries.count() + mDeletedIds.count() > qMax( 256, mStaticTree->count() / 16 ) )
+      {
+        QVector<QgsSpatialIndexEntry> entries;
+        double low[]  = { -DBL_MAX, -DBL_MAX };
+        double high[] = { DBL_MAX, DBL_MAX };
+        SpatialIndex::Region query( low, high, 2 );
+        QgsSpatialIndexEntryVisitor visitor( entries );
+        mRTree->intersectsWithQuery( query, visitor );
+
+        mStaticTree = QSharedPointer<const QgsSpatialIndexStaticTree>( new QgsSpatialIndexStaticTree( entries ) );
+        mAddedEntries.clear();
+        mDeletedIds.clear();
+      }
+
+      QgsSpatialIndexSnapshot* snapshot = new QgsSpatialIndexSnapshot;
+      snapshot->tree = mStaticTree;
+      snapshot->addedEntries = mAddedEntries;
+      snapshot->deletedIds = mDeletedIds;
+      mSnapshot = QSharedPointer<const QgsSpatialIndexSnapshot>( snapshot );
+      return mSnapshot;
+    }
+
+    //! invalidate the metadata file of an opened index before its files are changed (with the lock held)
+    void prepareWrite()
+    {
+      if ( !mMetadataOnDisk )
+        return;
+
+      // the files are incomplete until the index is closed and the metadata are written again
+      if ( !QFile::remove( QgsSpatialIndex::metadataFileName( mFileBase ) ) )
+        QgsDebugMsg( "cannot remove spatial index metadata of " + mFileBase );
+      mMetadataOnDisk = false;
+    }
+
+    //! record an added entry for the snapshots (with the lock held)
+    void entryAdded( const SpatialIndex::Region& r, QgsFeatureId id )
+    {
+      if ( !mStaticTree )
+        return;
+
+      QgsSpatialIndexEntry e;
+      e.xMin = r.getLow( 0 );
+      e.yMin = r.getLow( 1 );
+      e.xMax = r.getHigh( 0 );
+      e.yMax = r.getHigh( 1 );
+      e.id = id;
+      mAddedEntries.append( e );
+      mSnapshot.clear();
+    }
+
+    //! record a deleted entry for the snapshots (with the lock held)
+    void entryDeleted( QgsFeatureId id )
+    {
+      if ( !mStaticTree )
+        return;
+
+      for ( int i = mAddedEntries.count() - 1; i >= 0; --i )
+      {
+        if ( mAddedEntries[i].id == id )
+          mAddedEntries.remove( i );
+      }
+      mDeletedIds.insert( id );
+      mSnapshot.clear();
+    }
+
+  private:
+    static SpatialIndex::ISpatialIndex* createTree( SpatialIndex::IStorageManager& storage, IDataStream* inputStream, SpatialIndex::id_type& indexId )
+    {
       // R-Tree parameters
       double fillFactor = 0.7;
       unsigned long indexCapacity = 10;
@@ -175,22 +667,26 @@ class QgsSpatialIndexData : public QSharedData
       unsigned long dimension = 2;
       RTree::RTreeVariant variant = RTree::RV_RSTAR;
 
-      // create R-tree
-      SpatialIndex::id_type indexId;
-
       if ( inputStream )
-        mRTree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, *mStorage, fillFactor, indexCapacity,
-                 leafCapacity, dimension, variant, indexId );
+        return RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, *inputStream, storage, fillFactor, indexCapacity,
+               leafCapacity, dimension, variant, indexId );
       else
-        mRTree = RTree::createNewRTree( *mStorage, fillFactor, indexCapacity,
-                                        leafCapacity, dimension, variant, indexId );
+        return RTree::createNewRTree( storage, fillFactor, indexCapacity,
+                                      leafCapacity, dimension, variant, indexId );
     }
 
-    /** storage manager */
-    SpatialIndex::IStorageManager* mStorage;
+    void releaseTree()
+    {
+      delete mRTree;
+      mRTree = 0;
+      delete mBuffer;
+      mBuffer = 0;
+      delete mStorage;
+      mStorage = 0;
+    }
 
-    /** R-tree containing spatial index */
-    SpatialIndex::ISpatialIndex* mRTree;
+    static const uint32_t DISK_PAGE_SIZE = 4096;
+    static const uint32_t DISK_BUFFER_CAPACITY = 1024;
 };
 
 // -------------------------------------------------------------------------
@@ -222,6 +718,106 @@ QgsSpatialIndex& QgsSpatialIndex::operator=( const QgsSpatialIndex & other )
   return *this;
 }
 
+// version of the on-disk format, increase when the stored data change
+static const int DISK_FORMAT_VERSION = 1;
+
+static QString _timestampString( const QDateTime& sourceTimestamp )
+{
+  return sourceTimestamp.isValid() ? sourceTimestamp.toUTC().toString( Qt::ISODate ) : QString( "none" );
+}
+
+bool QgsSpatialIndex::createOnDisk( const QgsFeatureIterator& fi, const QString& fileBase, const QDateTime& sourceTimestamp )
+{
+  // an existing index is not valid anymore
+  QFile::remove( metadataFileName( fileBase ) );
+
+  QgsSpatialIndexData* data = new QgsSpatialIndexData( fileBase );
+  QgsFeatureIteratorDataStream fids( fi );
+  SpatialIndex::id_type indexId;
+  if ( !data->createDiskTree( &fids, indexId ) )
+  {
+    delete data;
+    d = new QgsSpatialIndexData;
+    return false;
+  }
+
+  QString metadata;
+  QTextStream ts( &metadata );
+  ts << "QGIS spatial index\n";
+  ts << "version=" << DISK_FORMAT_VERSION << "\n";
+  ts << "timestamp=" << _timestampString( sourceTimestamp ) << "\n";
+  ts << "indexId=" << ( qlonglong ) indexId << "\n";
+  ts.flush();
+  data->mMetadata = metadata.toUtf8();
+
+  d = data;
+  return true;
+}
+
+bool QgsSpatialIndex::openOnDisk( const QString& fileBase, const QDateTime& sourceTimestamp )
+{
+  QFile metadataFile( metadataFileName( fileBase ) );
+  if ( !metadataFile.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QByteArray metadata = metadataFile.readAll();
+  QStringList lines = QString::fromUtf8( metadata ).split( "\n", QString::SkipEmptyParts );
+  if ( lines.isEmpty() || lines[0] != "QGIS spatial index" )
+  {
+    QgsDebugMsg( "not a spatial index metadata file: " + metadataFile.fileName() );
+    return false;
+  }
+
+  QMap<QString, QString> values;
+  for ( int i = 1; i < lines.count(); ++i )
+  {
+    int pos = lines[i].indexOf( '=' );
+    if ( pos > 0 )
+      values.insert( lines[i].left( pos ), lines[i].mid( pos + 1 ) );
+  }
+
+  if ( values.value( "version" ).toInt() != DISK_FORMAT_VERSION )
+  {
+    QgsDebugMsg( "spatial index written with unsupported version: " + values.value( "version" ) );
+    return false;
+  }
+
+  if ( values.value( "timestamp" ) != _timestampString( sourceTimestamp ) )
+  {
+    QgsDebugMsg( "spatial index is out of date: " + fileBase );
+    return false;
+  }
+
+  bool ok;
+  SpatialIndex::id_type indexId = values.value( "indexId" ).toLongLong( &ok );
+  if ( !ok )
+    return false;
+
+  QgsSpatialIndexData* data = new QgsSpatialIndexData( fileBase );
+  if ( !data->loadDiskTree( indexId ) )
+  {
+    delete data;
+    return false;
+  }
+
+  // the metadata are removed on the first change and written back when the index is closed
+  data->mMetadata = metadata;
+  data->mMetadataOnDisk = true;
+
+  d = data;
+  return true;
+}
+
+bool QgsSpatialIndex::isOnDisk() const
+{
+  return !d->mFileBase.isEmpty();
+}
+
+QString QgsSpatialIndex::metadataFileName( const QString& fileBase )
+{
+  return fileBase + ".meta";
+}
+
 Region QgsSpatialIndex::rectToRegion( QgsRectangle rect )
 {
   double pt1[2], pt2[2];
@@ -251,10 +847,14 @@ bool QgsSpatialIndex::insertFeature( const QgsFeature& f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  QMutexLocker locker( &d->mMutex );
+  d->prepareWrite();
+
   // TODO: handle possible exceptions correctly
   try
   {
     d->mRTree->insertData( 0, 0, r, FID_TO_NUMBER( id ) );
+    d->entryAdded( r, id );
     return true;
   }
   catch ( Tools::Exception &e )
@@ -282,13 +882,48 @@ bool QgsSpatialIndex::deleteFeature( const QgsFeature& f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  QMutexLocker locker( &d->mMutex );
+  d->prepareWrite();
+
   // TODO: handle exceptions
-  return d->mRTree->deleteData( r, FID_TO_NUMBER( id ) );
+  if ( !d->mRTree->deleteData( r, FID_TO_NUMBER( id ) ) )
+    return false;
+
+  d->entryDeleted( id );
+  return true;
+}
+
+void QgsSpatialIndex::setConcurrentQueriesEnabled( bool enabled )
+{
+  QMutexLocker locker( &d->mMutex );
+  d->mConcurrentQueries = enabled;
+  if ( !enabled )
+  {
+    d->mSnapshot.clear();
+    d->mStaticTree.clear();
+    d->mAddedEntries.clear();
+    d->mDeletedIds.clear();
+  }
+}
+
+bool QgsSpatialIndex::concurrentQueriesEnabled() const
+{
+  return d->mConcurrentQueries;
 }
 
 QList<QgsFeatureId> QgsSpatialIndex::intersects( QgsRectangle rect ) const
 {
   QList<QgsFeatureId> list;
+
+  QMutexLocker locker( &d->mMutex );
+  if ( d->mConcurrentQueries )
+  {
+    QSharedPointer<const QgsSpatialIndexSnapshot> snapshot = d->snapshot();
+    locker.unlock();
+    snapshot->intersects( rect, list );
+    return list;
+  }
+
   QgisVisitor visitor( list );
 
   Region r = rectToRegion( rect );
@@ -298,9 +933,46 @@ QList<QgsFeatureId> QgsSpatialIndex::intersects( QgsRectangle rect ) const
   return list;
 }
 
+QList< QList<QgsFeatureId> > QgsSpatialIndex::intersects( const QList<QgsRectangle>& rects ) const
+{
+  QList< QList<QgsFeatureId> > lists;
+
+  QMutexLocker locker( &d->mMutex );
+  if ( d->mConcurrentQueries )
+  {
+    QSharedPointer<const QgsSpatialIndexSnapshot> snapshot = d->snapshot();
+    locker.unlock();
+    foreach ( const QgsRectangle& rect, rects )
+    {
+      lists.append( QList<QgsFeatureId>() );
+      snapshot->intersects( rect, lists.last() );
+    }
+    return lists;
+  }
+
+  foreach ( const QgsRectangle& rect, rects )
+  {
+    lists.append( QList<QgsFeatureId>() );
+    QgisVisitor visitor( lists.last() );
+    d->mRTree->intersectsWithQuery( rectToRegion( rect ), visitor );
+  }
+
+  return lists;
+}
+
 QList<QgsFeatureId> QgsSpatialIndex::nearestNeighbor( QgsPoint point, int neighbors ) const
 {
   QList<QgsFeatureId> list;
+
+  QMutexLocker locker( &d->mMutex );
+  if ( d->mConcurrentQueries )
+  {
+    QSharedPointer<const QgsSpatialIndexSnapshot> snapshot = d->snapshot();
+    locker.unlock();
+    snapshot->nearestNeighbor( point, neighbors, list );
+    return list;
+  }
+
   QgisVisitor visitor( list );
 
   double pt[2];
@@ -34,8 +34,10 @@ class QgsFeature;
 class QgsRectangle;
 class QgsPoint;
 
+#include <QDateTime>
 #include <QList>
 #include <QSharedDataPointer>
+#include <QString>
 
 #include "qgsfeature.h"
 
@@ -68,6 +70,43 @@ class CORE_EXPORT QgsSpatialIndex
     /** implement assignment operator */
     QgsSpatialIndex& operator=( const QgsSpatialIndex& other );
 
+    /* persistent index */
+
+    /** Create R-tree stored on disk and bulk load it with features from the iterator.
+     * The tree is kept in files with the given base name (".idx" and ".dat" are appended).
+     * A metadata file (see metadataFileName()) records the format version and the modification
+     * time of the indexed data once the index is complete, i.e. when it is destroyed, so that
+     * later sessions may use openOnDisk() instead of a full scan of the features.
+     * Later changes of the index are written to the files as well.
+     * @param fi iterator over the features to index
+     * @param fileBase base name of the index files
+     * @param sourceTimestamp modification time of the indexed data
+     * @returns true on success, otherwise the index is empty and kept in memory
+     * @note added in 2.8
+     */
+    bool createOnDisk( const QgsFeatureIterator& fi, const QString& fileBase, const QDateTime& sourceTimestamp );
+
+    /** Open R-tree stored on disk by createOnDisk() without scanning the features.
+     * The first change of the opened index removes the metadata file, so that the files
+     * are not used by other sessions until the index is destroyed and the metadata are written again.
+     * @param fileBase base name of the index files
+     * @param sourceTimestamp modification time of the indexed data, the index must have been created for the same time
+     * @returns false if the index does not exist, is incomplete, outdated or written with another format version;
+     * the index is left unchanged then
+     * @note added in 2.8
+     */
+    bool openOnDisk( const QString& fileBase, const QDateTime& sourceTimestamp );
+
+    /** Return whether the index is stored on disk (copies of the index are always kept in memory)
+     * @note added in 2.8
+     */
+    bool isOnDisk() const;
+
+    /** Return name of the metadata file of an index stored on disk
+     * @note added in 2.8
+     */
+    static QString metadataFileName( const QString& fileBase );
+
     /* operations */
 
     /** add feature to index */
@@ -76,12 +115,31 @@ class CORE_EXPORT QgsSpatialIndex
     /** remove feature from index */
     bool deleteFeature( const QgsFeature& f );
 
+    /** Enable queries from several threads at once while the index is being modified.
+     * Queries are then answered from an immutable snapshot of the index which is shared by all
+     * readers and updated after modifications, so that readers do not wait for each other.
+     * Otherwise queries and modifications are serialized. Either way, a single index may be used
+     * by several threads (but its copies must not be created while it is being modified).
+     * @note added in 2.8
+     */
+    void setConcurrentQueriesEnabled( bool enabled );
+
+    /** Return whether queries from several threads run concurrently
+     * @note added in 2.8
+     */
+    bool concurrentQueriesEnabled() const;
+
 
     /* queries */
 
     /** returns features that intersect the specified rectangle */
     QList<QgsFeatureId> intersects( QgsRectangle rect ) const;
 
+    /** returns features that intersect each of the specified rectangles, in the same order
+     * @note added in 2.8
+     */
+    QList< QList<QgsFeatureId> > intersects( const QList<QgsRectangle>& rects ) const;
+
     /** returns nearest neighbors (their count is specified by second parameter) */
     QList<QgsFeatureId> nearestNeighbor( QgsPoint point, int neighbors ) const;
 
@@ -36,6 +36,11 @@
 #include <QTextStream>
 #include <QSet>
 #include <QMetaType>
+#include <QProgressDialog>
+#include <QQueue>
+#include <QThread>
+#include <QTime>
+#include <QtConcurrentRun>
 
 #include <cassert>
 #include <cstdlib> // size_t
@@ -1804,7 +1809,8 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
     QString *newFilename,
     SymbologyExport symbologyExport,
     double symbologyScale,
-    const QgsRectangle* filterExtent )
+    const QgsRectangle* filterExtent,
+    QProgressDialog* progress )
 {
   QgsCoordinateTransform* ct = 0;
   if ( destCRS && layer )
@@ -1813,11 +1819,66 @@ QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
   }
 
   QgsVectorFileWriter::WriterError error = writeAsVectorFormat( layer, fileName, fileEncoding, ct, driverName, onlySelected,
-      errorMessage, datasourceOptions, layerOptions, skipAttributeCreation, newFilename, symbologyExport, symbologyScale, filterExtent );
+      errorMessage, datasourceOptions, layerOptions, skipAttributeCreation, newFilename, symbologyExport, symbologyScale, filterExtent, progress );
   delete ct;
   return error;
 }
 
+// features are fetched and prepared for writing in chunks of this size
+static const int WRITE_CHUNK_SIZE = 1000;
+
+/** Chunk of features being exported by writeAsVectorFormat() */
+struct QgsVectorFileWriterChunk
+{
+  QList<QgsFeature> features;
+  int fetched;             //!< number of features fetched from the layer (before filtering)
+  QString errorMessage;    //!< set if a geometry could not be transformed, the features from it on are dropped
+};
+
+// transform, filter and convert the geometries of a chunk (runs in a worker thread)
+static void prepareChunk( QgsVectorFileWriterChunk* chunk, const QgsCoordinateTransform* ct, const QgsRectangle* filterExtent, QGis::WkbType wkbType )
+{
+  QList<QgsFeature>::iterator it = chunk->features.begin();
+  while ( it != chunk->features.end() )
+  {
+    QgsGeometry* geom = it->geometry();
+    if ( !geom )
+    {
+      ++it;
+      continue;
+    }
+
+    if ( ct )
+    {
+      try
+      {
+        geom->transform( *ct );
+      }
+      catch ( QgsCsException &e )
+      {
+        chunk->errorMessage = QObject::tr( "Failed to transform a point while drawing a feature with ID '%1'. Writing stopped. (Exception: %2)" )
+                              .arg( it->id() ).arg( e.what() );
+        chunk->features.erase( it, chunk->features.end() );
+        return;
+      }
+    }
+
+    if ( filterExtent && !geom->intersects( *filterExtent ) )
+    {
+      it = chunk->features.erase( it );
+      continue;
+    }
+
+    // done by createFeature() otherwise
+    if ( geom->wkbType() != wkbType && geom->wkbType() == QGis::singleType( wkbType ) )
+    {
+      geom->convertToMultiType();
+    }
+
+    ++it;
+  }
+}
+
 QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVectorLayer* layer,
     const QString& fileName,
     const QString& fileEncoding,
@@ -1831,7 +1892,8 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
     QString *newFilename,
     SymbologyExport symbologyExport,
     double symbologyScale,
-    const QgsRectangle* filterExtent )
+    const QgsRectangle* filterExtent,
+    QProgressDialog* progress )
 {
   if ( !layer )
   {
@@ -1911,7 +1973,6 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
   }
 
   QgsAttributeList allAttr = skipAttributeCreation ? QgsAttributeList() : layer->pendingAllAttributesList();
-  QgsFeature fet;
 
   //add possible attributes needed by renderer
   writer->addRendererAttributes( layer, allAttr );
@@ -1955,7 +2016,10 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
 
   writer->startRender( layer );
 
-  // enabling transaction on databases that support it
+  // enabling transaction on databases that support it,
+  // committed every transactionSize features (0 for a single transaction)
+  QSettings settings;
+  int transactionSize = settings.value( "/qgis/vectorFileWriterTransactionSize", 100000 ).toInt();
   bool transactionsEnabled = true;
 
   if ( OGRERR_NONE != OGR_L_StartTransaction( writer->mLayer ) )
@@ -1964,68 +2028,157 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
     transactionsEnabled = false;
   }
 
-  // write all features
-  while ( fit.nextFeature( fet ) )
+  if ( progress )
   {
-    if ( onlySelected && !ids.contains( fet.id() ) )
-      continue;
+    // featureCount() may be unknown (-1): show a busy indicator
+    progress->setRange( 0, qMax( onlySelected ? ids.size() : ( int ) layer->featureCount(), 0 ) );
+    progress->setValue( 0 );
+    progress->setLabelText( QObject::tr( "Writing features" ) );
+  }
+
+  // The features are fetched in chunks on this thread, geometries are transformed
+  // and filtered in worker threads, and the chunks are written here again in the
+  // order they have been fetched. The renderer (for symbology) and the OGR layer
+  // are only used by this thread.
+  QQueue< QPair<QgsVectorFileWriterChunk*, QFuture<void> > > pending;
+  int maxPending = 2 * QThread::idealThreadCount();
+  bool moreFeatures = true;
+  bool canceled = false;
+  QString transformError;
+  int fetched = 0;
+  QTime time;
+  time.start();
 
-    if ( shallTransform )
+  // write all features
+  while ( true )
+  {
+    // keep the workers busy
+    while ( moreFeatures && pending.size() < maxPending )
     {
-      try
+      QgsVectorFileWriterChunk* chunk = new QgsVectorFileWriterChunk;
+      chunk->fetched = 0;
+      while ( chunk->features.size() < WRITE_CHUNK_SIZE )
       {
-        if ( fet.geometry() )
+        // fetch directly into the list, copying the feature would copy its geometry
+        chunk->features.append( QgsFeature() );
+        QgsFeature& fet = chunk->features.last();
+        if ( !fit.nextFeature( fet ) )
         {
-          fet.geometry()->transform( *ct );
+          chunk->features.removeLast();
+          moreFeatures = false;
+          break;
         }
-      }
-      catch ( QgsCsException &e )
-      {
-        delete writer;
 
-        QString msg = QObject::tr( "Failed to transform a point while drawing a feature with ID '%1'. Writing stopped. (Exception: %2)" )
-                      .arg( fet.id() ).arg( e.what() );
-        QgsLogger::warning( msg );
-        if ( errorMessage )
-          *errorMessage = msg;
+        if ( onlySelected && !ids.contains( fet.id() ) )
+        {
+          chunk->features.removeLast();
+          continue;
+        }
 
-        return ErrProjection;
+        if ( allAttr.size() < 1 && skipAttributeCreation )
+        {
+          fet.initAttributes( 0 );
+        }
+        chunk->fetched++;
       }
+
+      pending.enqueue( qMakePair( chunk, QtConcurrent::run( prepareChunk, chunk, shallTransform ? ct : 0, filterExtent, writer->mWkbType ) ) );
     }
 
-    if ( fet.geometry() && filterExtent && !fet.geometry()->intersects( *filterExtent ) )
-      continue;
+    if ( pending.isEmpty() )
+      break;
 
-    if ( allAttr.size() < 1 && skipAttributeCreation )
-    {
-      fet.initAttributes( 0 );
-    }
+    QPair<QgsVectorFileWriterChunk*, QFuture<void> > next = pending.dequeue();
+    next.second.waitForFinished();
+    QgsVectorFileWriterChunk* chunk = next.first;
 
-    if ( !writer->addFeature( fet, layer->rendererV2(), mapUnits ) )
+    bool stop = false;
+    for ( QList<QgsFeature>::iterator it = chunk->features.begin(); it != chunk->features.end(); ++it )
     {
-      WriterError err = writer->hasError();
-      if ( err != NoError && errorMessage )
+      if ( !writer->addFeature( *it, layer->rendererV2(), mapUnits ) )
       {
-        if ( errorMessage->isEmpty() )
+        WriterError err = writer->hasError();
+        if ( err != NoError && errorMessage )
+        {
+          if ( errorMessage->isEmpty() )
+          {
+            *errorMessage = QObject::tr( "Feature write errors:" );
+          }
+          *errorMessage += "\n" + writer->errorMessage();
+        }
+        errors++;
+
+        if ( errors > 1000 )
         {
-          *errorMessage = QObject::tr( "Feature write errors:" );
+          if ( errorMessage )
+          {
+            *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
+          }
+
+          n = -1;
+          stop = true;
+          break;
         }
-        *errorMessage += "\n" + writer->errorMessage();
       }
-      errors++;
+      n++;
 
-      if ( errors > 1000 )
+      if ( transactionsEnabled && transactionSize > 0 && n % transactionSize == 0 )
       {
-        if ( errorMessage )
+        if ( OGRERR_NONE != OGR_L_CommitTransaction( writer->mLayer ) )
+        {
+          QgsDebugMsg( "Error while committing transaction on OGRLayer." );
+        }
+        if ( OGRERR_NONE != OGR_L_StartTransaction( writer->mLayer ) )
         {
-          *errorMessage += QObject::tr( "Stopping after %1 errors" ).arg( errors );
+          QgsDebugMsg( "Error when trying to restart transaction on OGRLayer." );
+          transactionsEnabled = false;
         }
+      }
+    }
 
-        n = -1;
-        break;
+    fetched += chunk->fetched;
+    transformError = chunk->errorMessage;
+    delete chunk;
+
+    if ( !transformError.isEmpty() )
+      stop = true;
+
+    if ( progress )
+    {
+      int elapsed = qMax( time.elapsed(), 1 );
+      progress->setValue( qMin( fetched, progress->maximum() ) );
+      progress->setLabelText( QObject::tr( "%1 features written (%2 features/s)" ).arg( n ).arg( qRound( n * 1000.0 / elapsed ) ) );
+      QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
+      if ( progress->wasCanceled() )
+      {
+        canceled = true;
+        stop = true;
       }
     }
-    n++;
+
+    if ( stop )
+      break;
+  }
+
+  // drop the chunks still being prepared
+  while ( !pending.isEmpty() )
+  {
+    QPair<QgsVectorFileWriterChunk*, QFuture<void> > next = pending.dequeue();
+    next.second.waitForFinished();
+    delete next.first;
+  }
+
+  QgsDebugMsg( QString( "%1 features written in %2 ms" ).arg( n ).arg( time.elapsed() ) );
+
+  if ( !transformError.isEmpty() )
+  {
+    delete writer;
+
+    QgsLogger::warning( transformError );
+    if ( errorMessage )
+      *errorMessage = transformError;
+
+    return ErrProjection;
   }
 
   if ( transactionsEnabled )
@@ -2044,6 +2197,13 @@ QgsVectorFileWriter::WriterError QgsVectorFileWriter::writeAsVectorFormat( QgsVe
     *errorMessage += QObject::tr( "\nOnly %1 of %2 features written." ).arg( n - errors ).arg( n );
   }
 
+  if ( canceled )
+  {
+    if ( errorMessage )
+      *errorMessage = QObject::tr( "Export canceled after %1 features" ).arg( n );
+    return ErrUserCanceled;
+  }
+
   return errors == 0 ? NoError : ErrFeatureWriteFailed;
 }
 
@@ -29,6 +29,7 @@
 
 class QgsSymbolLayerV2;
 class QTextCodec;
+class QProgressDialog;
 
 /** \ingroup core
   * A convenience class for writing vector files to disk.
@@ -151,6 +152,7 @@ class CORE_EXPORT QgsVectorFileWriter
       ErrProjection,
       ErrFeatureWriteFailed,
       ErrInvalidLayer,
+      ErrUserCanceled, // added in 2.8
     };
 
     enum SymbologyExport
@@ -175,6 +177,7 @@ class CORE_EXPORT QgsVectorFileWriter
     @param symbologyExport symbology to export
     @param symbologyScale scale of symbology
     @param filterExtent if not a null pointer, only features intersecting the extent will be saved
+    @param progress if not a null pointer, shows the progress and throughput and allows to cancel the export (added in 2.8)
     */
     static WriterError writeAsVectorFormat( QgsVectorLayer* layer,
                                             const QString& fileName,
@@ -189,7 +192,8 @@ class CORE_EXPORT QgsVectorFileWriter
                                             QString *newFilename = 0,
                                             SymbologyExport symbologyExport = NoSymbology,
                                             double symbologyScale = 1.0,
-                                            const QgsRectangle* filterExtent = 0 // added in 2.4
+                                            const QgsRectangle* filterExtent = 0, // added in 2.4
+                                            QProgressDialog* progress = 0 // added in 2.8
                                           );
 
     //! @note added in v2.2
@@ -206,7 +210,8 @@ class CORE_EXPORT QgsVectorFileWriter
                                             QString *newFilename = 0,
                                             SymbologyExport symbologyExport = NoSymbology,
                                             double symbologyScale = 1.0,
-                                            const QgsRectangle* filterExtent = 0 // added in 2.4
+                                            const QgsRectangle* filterExtent = 0, // added in 2.4
+                                            QProgressDialog* progress = 0 // added in 2.8
                                           );
 
     /** create shapefile and initialize it */
@@ -30,7 +30,10 @@
 #include <QProgressDialog>
 #include <QSettings>
 #include <QString>
+#include <QThread>
+#include <QDateTime>
 #include <QDomNode>
+#include <QFileInfo>
 #include <QVector>
 
 #include "qgsvectorlayer.h"
@@ -68,8 +71,10 @@
 #include "qgsvectorlayereditutils.h"
 #include "qgsvectorlayerfeatureiterator.h"
 #include "qgsvectorlayerjoinbuffer.h"
+#include "qgsvectorlayerrendercache.h"
 #include "qgsvectorlayerrenderer.h"
 #include "qgsvectorlayerundocommand.h"
+#include "qgsxmlutils.h"
 
 #include "qgsrendererv2.h"
 #include "qgssymbolv2.h"
@@ -117,6 +122,15 @@ typedef QString getStyleById_t(
   QString& errCause
 );
 
+//! deletes the render cache in its thread when the last renderer using it is done
+static void deleteRenderCache( QgsVectorLayerRenderCache* cache )
+{
+  if ( cache->thread() == QThread::currentThread() )
+    delete cache;
+  else
+    cache->deleteLater();
+}
+
 QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
                                 QString baseName,
                                 QString providerKey,
@@ -142,6 +156,8 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
     , mDiagramLayerSettings( 0 )
     , mValidExtent( false )
     , mLazyExtent( true )
+    , mCachedFeatureCount( -1 )
+    , mKnownFeatureCount( -1 )
     , mSymbolFeatureCounted( false )
 
 {
@@ -190,6 +206,10 @@ QgsVectorLayer::QgsVectorLayer( QString vectorLayerPath,
   mSimplifyMethod.setForceLocalOptimization( settings.value( "/qgis/simplifyLocal", mSimplifyMethod.forceLocalOptimization() ).toBool() );
   mSimplifyMethod.setMaximumScale( settings.value( "/qgis/simplifyMaxScale", mSimplifyMethod.maximumScale() ).toFloat() );
 
+  // Default metadata cache settings
+  mMetadataCacheEnabled = settings.value( "/qgis/layerMetadataCache", false ).toBool();
+  mMetadataCacheMaxAge = settings.value( "/qgis/layerMetadataCacheMaxAge", 7 * 24 * 3600 ).toInt();
+
 } // QgsVectorLayer ctor
 
 
@@ -400,6 +420,11 @@ void QgsVectorLayer::reload()
   {
     mDataProvider->reloadData();
   }
+
+  invalidateMetadataCache();
+
+  if ( mRenderCache )
+    mRenderCache->invalidate();
 }
 
 QgsMapLayerRenderer* QgsVectorLayer::createMapRenderer( QgsRenderContext& rendererContext )
@@ -721,7 +746,20 @@ long QgsVectorLayer::featureCount() const
     return 0;
   }
 
-  return mDataProvider->featureCount();
+  // feature count from the project file
+  if ( mCachedFeatureCount >= 0 )
+    return mCachedFeatureCount;
+
+  long count = mDataProvider->featureCount();
+
+  // remembered for the metadata cache, which must not count the features itself
+  if ( count >= 0 )
+  {
+    mKnownFeatureCount = count;
+    mKnownFeatureCountTimestamp = QDateTime::currentDateTime();
+  }
+
+  return count;
 }
 
 long QgsVectorLayer::featureCount( QgsSymbolV2* symbol )
@@ -803,12 +841,105 @@ bool QgsVectorLayer::countSymbolFeatures( bool showProgress )
 void QgsVectorLayer::updateExtents()
 {
   mValidExtent = false;
+  mCachedFeatureCount = -1;
+  mKnownFeatureCount = -1;
+}
+
+void QgsVectorLayer::invalidateMetadataCache()
+{
+  // the extent is asked from the provider again (if it came from the project file)
+  if ( mLazyExtent )
+    mValidExtent = false;
+  mCachedFeatureCount = -1;
+  mKnownFeatureCount = -1;
+}
+
+void QgsVectorLayer::setMetadataCacheEnabled( bool enabled, int maxAge )
+{
+  mMetadataCacheEnabled = enabled;
+  mMetadataCacheMaxAge = maxAge;
+}
+
+void QgsVectorLayer::readMetadataCache( const QDomElement& cacheElem )
+{
+  if ( !mMetadataCacheEnabled || cacheElem.isNull() || !mDataProvider )
+    return;
+
+  // revalidation: the cached values expire after the maximal age
+  // and when a file based data source was modified after they were stored
+  QDateTime timestamp = QDateTime::fromString( cacheElem.attribute( "timestamp" ), Qt::ISODate );
+  if ( !timestamp.isValid() )
+    return;
+
+  if ( mMetadataCacheMaxAge > 0 && timestamp.secsTo( QDateTime::currentDateTime() ) > mMetadataCacheMaxAge )
+  {
+    QgsDebugMsg( "metadata cache expired for " + id() );
+    return;
+  }
+
+  QFileInfo fi( mDataSource.split( "|" ).first() );
+  if ( fi.exists() && fi.lastModified() > timestamp )
+  {
+    QgsDebugMsg( "data source modified since metadata were cached for " + id() );
+    return;
+  }
+
+  if ( cacheElem.attribute( "wkbType" ).toInt() != ( int ) mWkbType )
+    return;
+
+  QDomElement extentElem = cacheElem.firstChildElement( "extent" );
+  if ( !extentElem.isNull() )
+  {
+    // stays lazy, so that the provider is asked when the layer is updated
+    setExtent( QgsXmlUtils::readRectangle( extentElem ) );
+    mExtentTimestamp = timestamp;
+  }
+
+  bool ok;
+  long count = cacheElem.attribute( "featureCount" ).toLong( &ok );
+  if ( ok && count >= 0 )
+  {
+    mCachedFeatureCount = count;
+    mKnownFeatureCount = count;
+    mKnownFeatureCountTimestamp = timestamp;
+  }
+}
+
+void QgsVectorLayer::writeMetadataCache( QDomNode& layer_node, QDomDocument& document )
+{
+  // uncommitted changes are not stored
+  if ( !mMetadataCacheEnabled || !mDataProvider || mEditBuffer )
+    return;
+
+  // only values which are already known are stored, with the time they were
+  // obtained, so that values read from the project file keep their age
+  QDomElement cacheElem = document.createElement( "metadatacache" );
+  QDateTime timestamp;
+  if ( mValidExtent )
+  {
+    cacheElem.appendChild( QgsXmlUtils::writeRectangle( QgsMapLayer::extent(), document ) );
+    timestamp = mExtentTimestamp;
+  }
+  if ( mKnownFeatureCount >= 0 )
+  {
+    cacheElem.setAttribute( "featureCount", QString::number( mKnownFeatureCount ) );
+    if ( !timestamp.isValid() || mKnownFeatureCountTimestamp < timestamp )
+      timestamp = mKnownFeatureCountTimestamp;
+  }
+
+  if ( !timestamp.isValid() )
+    return;
+
+  cacheElem.setAttribute( "timestamp", timestamp.toString( Qt::ISODate ) );
+  cacheElem.setAttribute( "wkbType", ( int ) mWkbType );
+  layer_node.appendChild( cacheElem );
 }
 
 void QgsVectorLayer::setExtent( const QgsRectangle &r )
 {
   QgsMapLayer::setExtent( r );
   mValidExtent = true;
+  mExtentTimestamp = QDateTime::currentDateTime();
 }
 
 QgsRectangle QgsVectorLayer::extent()
@@ -917,12 +1048,31 @@ bool QgsVectorLayer::setSubsetString( QString subset )
   mDataSource = mDataProvider->dataSourceUri();
   updateExtents();
 
+  if ( mRenderCache )
+    mRenderCache->invalidate();
+
   if ( res )
     emit repaintRequested();
 
   return res;
 }
 
+void QgsVectorLayer::setRenderCacheEnabled( bool enabled )
+{
+  if ( enabled == isRenderCacheEnabled() )
+    return;
+
+  if ( enabled )
+  {
+    mRenderCache = QSharedPointer<QgsVectorLayerRenderCache>( new QgsVectorLayerRenderCache( this ), deleteRenderCache );
+  }
+  else
+  {
+    // renderers still drawing from the cache keep it alive
+    mRenderCache.clear();
+  }
+}
+
 bool QgsVectorLayer::simplifyDrawingCanbeApplied( const QgsRenderContext& renderContext, QgsVectorSimplifyMethod::SimplifyHint simplifyHint ) const
 {
   if ( mDataProvider && !mEditBuffer && ( hasGeometryType() && geometryType() != QGis::Point ) && ( mSimplifyMethod.simplifyHints() & simplifyHint ) && renderContext.useRenderingOptimization() )
@@ -1330,6 +1480,8 @@ bool QgsVectorLayer::readXml( const QDomNode& layer_node )
 
   setLegend( QgsMapLayerLegend::defaultVectorLegend( this ) );
 
+  readMetadataCache( layer_node.firstChildElement( "metadatacache" ) );
+
   return mValid;               // should be true if read successfully
 
 } // void QgsVectorLayer::readXml
@@ -1357,6 +1509,7 @@ bool QgsVectorLayer::setDataProvider( QString const & provider )
     {
       // TODO: Check if the provider has the capability to send fullExtentCalculated
       connect( mDataProvider, SIGNAL( fullExtentCalculated() ), this, SLOT( updateExtents() ) );
+      connect( mDataProvider, SIGNAL( dataChanged() ), this, SLOT( invalidateMetadataCache() ) );
 
       // get and store the feature type
       mWkbType = mDataProvider->geometryType();
@@ -1478,6 +1631,9 @@ bool QgsVectorLayer::writeXml( QDomNode & layer_node,
   // save expression fields
   mExpressionFieldBuffer->writeXml( layer_node, document );
 
+  // extent and feature count to be used on next load
+  writeMetadataCache( layer_node, document );
+
   // renderer specific settings
   QString errorMsg;
   return writeSymbology( layer_node, document, errorMsg );
@@ -18,9 +18,11 @@
 #ifndef QGSVECTORLAYER_H
 #define QGSVECTORLAYER_H
 
+#include <QDateTime>
 #include <QMap>
 #include <QSet>
 #include <QList>
+#include <QSharedPointer>
 #include <QStringList>
 
 #include "qgis.h"
@@ -48,6 +50,7 @@ class QgsFeatureRendererV2;
 class QgsFeatureRequest;
 class QgsGeometry;
 class QgsGeometryCache;
+class QgsVectorLayerRenderCache;
 class QgsGeometryVertexIndex;
 class QgsLabel;
 class QgsMapToPixel;
@@ -1466,6 +1469,40 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
      */
     bool simplifyDrawingCanbeApplied( const QgsRenderContext& renderContext, QgsVectorSimplifyMethod::SimplifyHint simplifyHint ) const;
 
+    /** Enable the cache of features transformed into the destination CRS and simplified for
+     *  rendering, so that redraws of a static layer do not need to fetch features from the provider.
+     *  The cache is disabled by default.
+     *  @note added in 2.8
+     */
+    void setRenderCacheEnabled( bool enabled );
+    /** Returns whether the render cache is enabled
+     *  @note added in 2.8
+     */
+    bool isRenderCacheEnabled() const { return !mRenderCache.isNull(); }
+    /** Returns the render cache of the layer or null if it is not enabled
+     *  @note added in 2.8
+     */
+    QgsVectorLayerRenderCache* renderCache() const { return mRenderCache.data(); }
+
+    /** Enable use of the extent and feature count stored in the project file, so that
+     *  the provider does not need to compute them when the project is loaded. The cached
+     *  values are used until the layer data change or the layer is reloaded. They are
+     *  ignored if they are older than the maximal age or if the data source file was
+     *  modified after they were stored. By default the cache is configured from settings.
+     *  @param enabled whether the cache is written to and read from the project file
+     *  @param maxAge maximal age of the cached values in seconds, 0 for no limit
+     *  @note added in 2.8
+     */
+    void setMetadataCacheEnabled( bool enabled, int maxAge = 0 );
+    /** Returns whether the metadata cache in the project file is used
+     *  @note added in 2.8
+     */
+    bool isMetadataCacheEnabled() const { return mMetadataCacheEnabled; }
+    /** Returns the maximal age of the cached metadata in seconds, 0 for no limit
+     *  @note added in 2.8
+     */
+    int metadataCacheMaxAge() const { return mMetadataCacheMaxAge; }
+
   public slots:
     /**
      * Select feature by its ID
@@ -1648,6 +1685,8 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
   private slots:
     void onRelationsLoaded();
     void onJoinedFieldsChanged();
+    //! Forget the metadata read from the project file
+    void invalidateMetadataCache();
 
   protected:
     /** Set the extent */
@@ -1691,6 +1730,12 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     /** Read labeling from SLD */
     void readSldLabeling( const QDomNode& node );
 
+    /** Use the extent and feature count stored in the project file if they are still valid */
+    void readMetadataCache( const QDomElement& cacheElem );
+
+    /** Store the extent and feature count into the project file */
+    void writeMetadataCache( QDomNode& layer_node, QDomDocument& document );
+
   private:                       // Private attributes
 
     /** Pointer to data provider derived from the abastract base class QgsDataProvider */
@@ -1790,6 +1835,10 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     //! cache for some vector layer data - currently only geometries for faster editing
     QgsGeometryCache* mCache;
 
+    //! cache of features transformed and simplified for rendering (null if disabled),
+    //! shared with the renderers using it
+    QSharedPointer<QgsVectorLayerRenderCache> mRenderCache;
+
     //! stores information about uncommitted changes to layer
     QgsVectorLayerEditBuffer* mEditBuffer;
     friend class QgsVectorLayerEditBuffer;
@@ -1809,6 +1858,21 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     bool mValidExtent;
     bool mLazyExtent;
 
+    //! feature count read from the project file, -1 if not known
+    long mCachedFeatureCount;
+
+    //! when the extent was obtained (from the provider or the project file)
+    QDateTime mExtentTimestamp;
+
+    //! last feature count obtained from the provider or the project file, -1 if not known
+    mutable long mKnownFeatureCount;
+
+    //! when mKnownFeatureCount was obtained
+    mutable QDateTime mKnownFeatureCountTimestamp;
+
+    bool mMetadataCacheEnabled;
+    int mMetadataCacheMaxAge;
+
     // Features in renderer classes counted
     bool mSymbolFeatureCounted;
 
@@ -1816,6 +1880,7 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
     QMap<QgsSymbolV2*, long> mSymbolFeatureCountMap;
 
     friend class QgsVectorLayerFeatureSource;
+    friend class QgsVectorLayerRenderer;
 };
 
 #endif
@@ -84,6 +84,15 @@ QgsFeatureIterator QgsVectorLayerFeatureSource::getFeatures( const QgsFeatureReq
   return QgsFeatureIterator( new QgsVectorLayerFeatureIterator( this, false, request ) );
 }
 
+QList<QgsFeatureRequest> QgsVectorLayerFeatureSource::partitionRequest( const QgsFeatureRequest& request, int maxParts )
+{
+  // the added features and the virtual fields are not split between the parts
+  if ( mHasEditBuffer || mJoinBuffer->containsJoins() || !mExpressionFieldBuffer->expressions().isEmpty() )
+    return QgsAbstractFeatureSource::partitionRequest( request, maxParts );
+
+  return mProviderFeatureSource->partitionRequest( request, maxParts );
+}
+
 
 QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource( source, ownSource, request )
@@ -30,7 +30,7 @@ struct QgsVectorJoinInfo;
 class QgsVectorLayerFeatureIterator;
 
 /** Partial snapshot of vector layer's state (only the members necessary for access to features) */
-class QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
+class CORE_EXPORT QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
 {
   public:
     QgsVectorLayerFeatureSource( QgsVectorLayer* layer );
@@ -38,6 +38,9 @@ class QgsVectorLayerFeatureSource : public QgsAbstractFeatureSource
 
     virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request );
 
+    //! The request is split by the provider if the layer has no edits, joins or expression fields
+    virtual QList<QgsFeatureRequest> partitionRequest( const QgsFeatureRequest& request, int maxParts );
+
     friend class QgsVectorLayerFeatureIterator;
 
   protected:
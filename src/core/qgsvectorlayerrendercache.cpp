@@ -0,0 +1,654 @@
+/***************************************************************************
+    qgsvectorlayerrendercache.cpp
+    ---------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsvectorlayerrendercache.h"
+
+#include "qgsapplication.h"
+#include "qgscoordinatetransform.h"
+#include "qgscsexception.h"
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgslogger.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
+#include "qgsrendercontext.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
+
+#include <QMutexLocker>
+
+#include <cmath>
+#include <limits>
+
+//! part of the extent added on each side of the rendered extent when a band is filled
+static const double COVERAGE_BUFFER = 0.25;
+
+/** Reads a sequence of points from WKB and appends them to the band */
+static void appendPoints( QgsConstWkbPtr& wkbPtr, int nPoints, bool hasZValue, QgsRenderCacheBand& band, double* bbox )
+{
+  double x, y;
+  for ( int i = 0; i < nPoints; ++i )
+  {
+    wkbPtr >> x >> y;
+    if ( hasZValue )
+      wkbPtr += sizeof( double );
+
+    band.coords << x << y;
+    bbox[0] = qMin( bbox[0], x );
+    bbox[1] = qMin( bbox[1], y );
+    bbox[2] = qMax( bbox[2], x );
+    bbox[3] = qMax( bbox[3], y );
+  }
+}
+
+/** Reads the rings of a polygon from WKB (after the header) */
+static void appendPolygon( QgsConstWkbPtr& wkbPtr, bool hasZValue, QgsRenderCacheBand& band, double* bbox )
+{
+  int nRings;
+  wkbPtr >> nRings;
+  band.structure << nRings;
+  for ( int r = 0; r < nRings; ++r )
+  {
+    int nPoints;
+    wkbPtr >> nPoints;
+    band.structure << nPoints;
+    appendPoints( wkbPtr, nPoints, hasZValue, band, bbox );
+  }
+}
+
+/** Appends the geometry to the band, returns false for unsupported geometry types */
+static bool encodeGeometry( const QgsGeometry& geom, QgsRenderCacheBand& band, QgsRenderCacheFeature& cf )
+{
+  const unsigned char* wkb = geom.asWkb();
+  if ( !wkb || geom.wkbSize() < 5 )
+    return false;
+
+  QgsConstWkbPtr wkbPtr( wkb + 1 );
+  QGis::WkbType wkbType;
+  wkbPtr >> wkbType;
+  bool hasZValue = QGis::wkbDimensions( wkbType ) == 3;
+
+  cf.wkbType = QGis::flatType( wkbType );
+  cf.structureOffset = band.structure.size();
+  cf.coordOffset = band.coords.size();
+  cf.bbox[0] = cf.bbox[1] = std::numeric_limits<double>::max();
+  cf.bbox[2] = cf.bbox[3] = -std::numeric_limits<double>::max();
+
+  switch ( cf.wkbType )
+  {
+    case QGis::WKBPoint:
+      appendPoints( wkbPtr, 1, hasZValue, band, cf.bbox );
+      return true;
+
+    case QGis::WKBLineString:
+    {
+      int nPoints;
+      wkbPtr >> nPoints;
+      band.structure << nPoints;
+      appendPoints( wkbPtr, nPoints, hasZValue, band, cf.bbox );
+      return true;
+    }
+
+    case QGis::WKBPolygon:
+      appendPolygon( wkbPtr, hasZValue, band, cf.bbox );
+      return true;
+
+    case QGis::WKBMultiPoint:
+    case QGis::WKBMultiLineString:
+    case QGis::WKBMultiPolygon:
+    {
+      int nParts;
+      wkbPtr >> nParts;
+      band.structure << nParts;
+
+      for ( int p = 0; p < nParts; ++p )
+      {
+        // skip byte order and type of the part
+        wkbPtr += 1 + sizeof( int );
+        if ( cf.wkbType == QGis::WKBMultiPoint )
+        {
+          appendPoints( wkbPtr, 1, hasZValue, band, cf.bbox );
+        }
+        else if ( cf.wkbType == QGis::WKBMultiLineString )
+        {
+          int nPoints;
+          wkbPtr >> nPoints;
+          band.structure << nPoints;
+          appendPoints( wkbPtr, nPoints, hasZValue, band, cf.bbox );
+        }
+        else
+        {
+          appendPolygon( wkbPtr, hasZValue, band, cf.bbox );
+        }
+      }
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+/** Writes points of the band as WKB coordinates */
+static void writePoints( QgsWkbPtr& wkbPtr, const double*& coords, int nPoints )
+{
+  for ( int i = 0; i < nPoints; ++i, coords += 2 )
+  {
+    wkbPtr << coords[0] << coords[1];
+  }
+}
+
+/** Rebuilds the WKB of a cached feature */
+static void decodeGeometry( const QgsRenderCacheBand& band, const QgsRenderCacheFeature& cf, QgsFeature& f )
+{
+  const int* structure = band.structure.constData() + cf.structureOffset;
+  const double* coords = band.coords.constData() + cf.coordOffset;
+  char byteOrder = QgsApplication::endian();
+
+  // compute the size first
+  size_t size = 1 + sizeof( int );
+  const int* s = structure;
+  switch ( cf.wkbType )
+  {
+    case QGis::WKBPoint:
+      size += 2 * sizeof( double );
+      break;
+    case QGis::WKBLineString:
+      size += sizeof( int ) + *s * 2 * sizeof( double );
+      break;
+    case QGis::WKBPolygon:
+    {
+      int nRings = *s++;
+      size += sizeof( int );
+      for ( int r = 0; r < nRings; ++r )
+        size += sizeof( int ) + *s++ * 2 * sizeof( double );
+      break;
+    }
+    case QGis::WKBMultiPoint:
+      size += sizeof( int ) + *s * ( 1 + sizeof( int ) + 2 * sizeof( double ) );
+      break;
+    case QGis::WKBMultiLineString:
+    {
+      int nParts = *s++;
+      size += sizeof( int );
+      for ( int p = 0; p < nParts; ++p )
+        size += 1 + 2 * sizeof( int ) + *s++ * 2 * sizeof( double );
+      break;
+    }
+    case QGis::WKBMultiPolygon:
+    {
+      int nParts = *s++;
+      size += sizeof( int );
+      for ( int p = 0; p < nParts; ++p )
+      {
+        int nRings = *s++;
+        size += 1 + 2 * sizeof( int );
+        for ( int r = 0; r < nRings; ++r )
+          size += sizeof( int ) + *s++ * 2 * sizeof( double );
+      }
+      break;
+    }
+    default:
+      return;
+  }
+
+  unsigned char* wkb = new unsigned char[size];
+  QgsWkbPtr wkbPtr( wkb );
+  wkbPtr << byteOrder << cf.wkbType;
+
+  s = structure;
+  switch ( cf.wkbType )
+  {
+    case QGis::WKBPoint:
+      writePoints( wkbPtr, coords, 1 );
+      break;
+    case QGis::WKBLineString:
+    {
+      int nPoints = *s++;
+      wkbPtr << nPoints;
+      writePoints( wkbPtr, coords, nPoints );
+      break;
+    }
+    case QGis::WKBPolygon:
+    {
+      int nRings = *s++;
+      wkbPtr << nRings;
+      for ( int r = 0; r < nRings; ++r )
+      {
+        int nPoints = *s++;
+        wkbPtr << nPoints;
+        writePoints( wkbPtr, coords, nPoints );
+      }
+      break;
+    }
+    case QGis::WKBMultiPoint:
+    {
+      int nParts = *s++;
+      wkbPtr << nParts;
+      for ( int p = 0; p < nParts; ++p )
+      {
+        wkbPtr << byteOrder << QGis::WKBPoint;
+        writePoints( wkbPtr, coords, 1 );
+      }
+      break;
+    }
+    case QGis::WKBMultiLineString:
+    {
+      int nParts = *s++;
+      wkbPtr << nParts;
+      for ( int p = 0; p < nParts; ++p )
+      {
+        int nPoints = *s++;
+        wkbPtr << byteOrder << QGis::WKBLineString << nPoints;
+        writePoints( wkbPtr, coords, nPoints );
+      }
+      break;
+    }
+    case QGis::WKBMultiPolygon:
+    {
+      int nParts = *s++;
+      wkbPtr << nParts;
+      for ( int p = 0; p < nParts; ++p )
+      {
+        int nRings = *s++;
+        wkbPtr << byteOrder << QGis::WKBPolygon << nRings;
+        for ( int r = 0; r < nRings; ++r )
+        {
+          int nPoints = *s++;
+          wkbPtr << nPoints;
+          writePoints( wkbPtr, coords, nPoints );
+        }
+      }
+      break;
+    }
+    default:
+      break;
+  }
+
+  f.setGeometryAndOwnership( wkb, size );
+}
+
+
+/**
+ * Delivers features of a render cache band intersecting the filter rectangle of the request.
+ * Features are served from a shared snapshot of the band, so that the cache
+ * can be invalidated while the iterator is in use.
+ */
+class QgsRenderCacheFeatureIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsRenderCacheFeatureIterator( QSharedPointer<QgsRenderCacheBand> band, const QgsFields& fields, const QgsFeatureRequest& request )
+        : QgsAbstractFeatureIterator( request )
+        , mBand( band )
+        , mFields( &fields )
+        , mIndex( 0 )
+    {
+      QgsRectangle r = mRequest.filterRect();
+      mFilter[0] = r.xMinimum();
+      mFilter[1] = r.yMinimum();
+      mFilter[2] = r.xMaximum();
+      mFilter[3] = r.yMaximum();
+    }
+
+    ~QgsRenderCacheFeatureIterator()
+    {
+      close();
+    }
+
+    virtual bool rewind()
+    {
+      if ( mClosed )
+        return false;
+      mIndex = 0;
+      return true;
+    }
+
+    virtual bool close()
+    {
+      mClosed = true;
+      return true;
+    }
+
+  protected:
+    virtual bool fetchFeature( QgsFeature& f )
+    {
+      if ( mClosed )
+        return false;
+
+      const QVector<QgsRenderCacheFeature>& features = mBand->features;
+      while ( mIndex < features.size() )
+      {
+        const QgsRenderCacheFeature& cf = features.at( mIndex++ );
+        if ( cf.bbox[0] > mFilter[2] || cf.bbox[2] < mFilter[0] || cf.bbox[1] > mFilter[3] || cf.bbox[3] < mFilter[1] )
+          continue;
+
+        f.setFeatureId( cf.fid );
+        f.setFields( mFields );
+        f.setAttributes( cf.attributes );
+        decodeGeometry( *mBand, cf, f );
+        f.setValid( true );
+        return true;
+      }
+
+      close();
+      return false;
+    }
+
+  private:
+    QSharedPointer<QgsRenderCacheBand> mBand;
+    const QgsFields* mFields;
+    int mIndex;
+    double mFilter[4];
+};
+
+
+/**
+ * Delivers features of the source transformed into destination CRS and simplified,
+ * recording them into a new band at the same time. The band is handed over to the
+ * cache once the source is exhausted, so that a miss fetches the features only once.
+ * Recording stops (but features are still delivered) when the band exceeds the memory
+ * budget or the cache gets invalidated.
+ */
+class QgsRenderCacheFillingIterator : public QgsAbstractFeatureIterator
+{
+  public:
+    QgsRenderCacheFillingIterator( QgsVectorLayerRenderCache* cache, const QString& key, int generation, int maxSize,
+                                   QSharedPointer<QgsRenderCacheBand> band, const QgsFeatureIterator& source,
+                                   const QgsCoordinateTransform* ct, double tolerance, const QgsFeatureRequest& request )
+        : QgsAbstractFeatureIterator( request )
+        , mCache( cache )
+        , mKey( key )
+        , mGeneration( generation )
+        , mMaxSize( maxSize )
+        , mBand( band )
+        , mSource( source )
+        , mTransform( ct )
+        , mTolerance( tolerance )
+    {
+    }
+
+    ~QgsRenderCacheFillingIterator()
+    {
+      close();
+    }
+
+    virtual bool rewind()
+    {
+      // the band would get features twice
+      mBand.clear();
+      return !mClosed && mSource.rewind();
+    }
+
+    virtual bool close()
+    {
+      mSource.close();
+      mClosed = true;
+      return true;
+    }
+
+  protected:
+    virtual bool fetchFeature( QgsFeature& f )
+    {
+      if ( mClosed )
+        return false;
+
+      while ( mSource.nextFeature( f ) )
+      {
+        if ( !f.geometry() )
+          continue;
+
+        QgsGeometry geom( *f.geometry() );
+        try
+        {
+          if ( mTransform )
+            geom.transform( *mTransform );
+        }
+        catch ( QgsCsException &cse )
+        {
+          Q_UNUSED( cse );
+          continue;
+        }
+
+        if ( mTolerance > 0 )
+          QgsMapToPixelSimplifier::simplifyGeometry( &geom, QgsMapToPixelSimplifier::SimplifyGeometry, mTolerance );
+
+        if ( mBand && !mCache->isCurrent( mGeneration ) )
+          mBand.clear();
+
+        if ( mBand )
+        {
+          QgsRenderCacheFeature cf;
+          cf.fid = f.id();
+          cf.attributes = f.attributes();
+          if ( !encodeGeometry( geom, *mBand, cf ) )
+            continue;
+          mBand->features << cf;
+
+          // rough estimate of the memory: coordinates, structure and attributes
+          mBand->size = mBand->coords.size() * sizeof( double ) + mBand->structure.size() * sizeof( int )
+                        + mBand->features.size() * ( sizeof( QgsRenderCacheFeature ) + cf.attributes.size() * sizeof( QVariant ) );
+          if ( mBand->size > mMaxSize )
+          {
+            QgsDebugMsg( "render cache band exceeds the memory budget" );
+            mCache->setOversized( mKey, mGeneration );
+            mBand.clear();
+          }
+        }
+
+        // the band covers more than the rendered extent
+        if ( !geom.boundingBox().intersects( mRequest.filterRect() ) )
+          continue;
+
+        f.setGeometry( geom );
+        return true;
+      }
+
+      if ( mBand )
+      {
+        mBand->features.squeeze();
+        mBand->structure.squeeze();
+        mBand->coords.squeeze();
+        mCache->insertBand( mKey, mBand, mGeneration );
+        mBand.clear();
+      }
+
+      close();
+      return false;
+    }
+
+  private:
+    QgsVectorLayerRenderCache* mCache;
+    QString mKey;
+    int mGeneration;
+    int mMaxSize;
+    QSharedPointer<QgsRenderCacheBand> mBand;
+    QgsFeatureIterator mSource;
+    const QgsCoordinateTransform* mTransform;
+    double mTolerance;
+};
+
+
+QgsVectorLayerRenderCache::QgsVectorLayerRenderCache( QgsVectorLayer* layer )
+    : QObject()
+    , mMaxSize( 128 * 1024 * 1024 )
+    , mGeneration( 0 )
+{
+  connect( layer, SIGNAL( dataChanged() ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( layerModified() ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( editingStopped() ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( featureAdded( QgsFeatureId ) ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( featureDeleted( QgsFeatureId ) ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( geometryChanged( QgsFeatureId, QgsGeometry& ) ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( attributeValueChanged( QgsFeatureId, int, const QVariant& ) ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( updatedFields() ), this, SLOT( invalidate() ) );
+  connect( layer, SIGNAL( layerCrsChanged() ), this, SLOT( invalidate() ) );
+}
+
+QgsVectorLayerRenderCache::~QgsVectorLayerRenderCache()
+{
+}
+
+void QgsVectorLayerRenderCache::setMaximumSize( int bytes )
+{
+  QMutexLocker locker( &mMutex );
+  mMaxSize = bytes;
+  mOversizedKeys.clear();
+  makeRoom( 0 );
+}
+
+int QgsVectorLayerRenderCache::size()
+{
+  QMutexLocker locker( &mMutex );
+  int total = 0;
+  foreach ( const QSharedPointer<QgsRenderCacheBand>& band, mBands )
+    total += band->size;
+  return total;
+}
+
+void QgsVectorLayerRenderCache::invalidate()
+{
+  QMutexLocker locker( &mMutex );
+  mGeneration++;
+  mBands.clear();
+  mRecentlyUsed.clear();
+  mOversizedKeys.clear();
+}
+
+void QgsVectorLayerRenderCache::makeRoom( int bytes )
+{
+  int total = 0;
+  foreach ( const QSharedPointer<QgsRenderCacheBand>& band, mBands )
+    total += band->size;
+
+  while ( total + bytes > mMaxSize && !mRecentlyUsed.isEmpty() )
+  {
+    QString key = mRecentlyUsed.takeLast();
+    total -= mBands.value( key )->size;
+    mBands.remove( key );
+  }
+}
+
+bool QgsVectorLayerRenderCache::getFeatures( QgsVectorLayerFeatureSource* source, const QgsRenderContext& context,
+    const QgsRectangle& requestExtent, const QStringList& attrNames, const QgsFields& fields, double simplifyThreshold,
+    QgsFeatureIterator& fit, QgsRectangle& destExtent )
+{
+  const QgsCoordinateTransform* ct = context.coordinateTransform();
+  QgsRectangle destRequestExtent;
+  try
+  {
+    destExtent = ct ? ct->transformBoundingBox( context.extent() ) : context.extent();
+    destRequestExtent = ct ? ct->transformBoundingBox( requestExtent ) : requestExtent;
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    return false;
+  }
+  if ( destExtent.isEmpty() || !destExtent.isFinite() || destRequestExtent.isEmpty() || !destRequestExtent.isFinite() )
+    return false;
+
+  // geometries are simplified with the finest tolerance of the zoom band,
+  // so that they can be drawn at any scale of the band
+  double mupp = context.mapToPixel().mapUnitsPerPixel();
+  if ( mupp <= 0 )
+    return false;
+  int zoomBand = ( int ) floor( log( mupp ) / log( 2.0 ) );
+  double tolerance = simplifyThreshold > 0 ? simplifyThreshold * pow( 2.0, zoomBand ) : 0;
+
+  QString key = QString( "%1|%2|%3|%4" )
+                .arg( ct ? ct->destCRS().srsid() : -1 )
+                .arg( zoomBand )
+                .arg( tolerance > 0 ? 1 : 0 )
+                .arg( attrNames.join( "," ) );
+
+  QSharedPointer<QgsRenderCacheBand> band;
+  int generation, maxSize;
+  {
+    QMutexLocker locker( &mMutex );
+    if ( mOversizedKeys.contains( key ) )
+      return false;
+
+    band = mBands.value( key );
+    if ( band && !band->coverage.contains( destRequestExtent ) )
+      band.clear();
+    if ( band )
+    {
+      mRecentlyUsed.removeAll( key );
+      mRecentlyUsed.prepend( key );
+    }
+    generation = mGeneration;
+    maxSize = mMaxSize;
+  }
+
+  QgsFeatureRequest request;
+  request.setFilterRect( destRequestExtent );
+
+  if ( band )
+  {
+    fit = QgsFeatureIterator( new QgsRenderCacheFeatureIterator( band, fields, request ) );
+    return true;
+  }
+
+  // on a miss, the features of the buffered extent are fetched once and recorded
+  // into a new band while they are drawn
+  QgsRectangle coverage;
+  double bx = destRequestExtent.width() * COVERAGE_BUFFER, by = destRequestExtent.height() * COVERAGE_BUFFER;
+  coverage.set( destRequestExtent.xMinimum() - bx, destRequestExtent.yMinimum() - by,
+                destRequestExtent.xMaximum() + bx, destRequestExtent.yMaximum() + by );
+
+  QgsRectangle layerRect;
+  try
+  {
+    layerRect = ct ? ct->transformBoundingBox( coverage, QgsCoordinateTransform::ReverseTransform ) : coverage;
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    return false;
+  }
+
+  band = QSharedPointer<QgsRenderCacheBand>( new QgsRenderCacheBand );
+  band->coverage = coverage;
+  band->size = 0;
+
+  QgsFeatureIterator sourceIt = source->getFeatures( QgsFeatureRequest()
+                                .setFilterRect( layerRect )
+                                .setSubsetOfAttributes( attrNames, fields ) );
+  fit = QgsFeatureIterator( new QgsRenderCacheFillingIterator( this, key, generation, maxSize, band, sourceIt, ct, tolerance, request ) );
+  return true;
+}
+
+bool QgsVectorLayerRenderCache::isCurrent( int generation )
+{
+  QMutexLocker locker( &mMutex );
+  return generation == mGeneration;
+}
+
+void QgsVectorLayerRenderCache::setOversized( const QString& key, int generation )
+{
+  QMutexLocker locker( &mMutex );
+  if ( generation == mGeneration )
+    mOversizedKeys.insert( key );
+}
+
+void QgsVectorLayerRenderCache::insertBand( const QString& key, QSharedPointer<QgsRenderCacheBand> band, int generation )
+{
+  QMutexLocker locker( &mMutex );
+  if ( generation != mGeneration || band->size > mMaxSize )
+    return;
+
+  mBands.remove( key );
+  mRecentlyUsed.removeAll( key );
+  makeRoom( band->size );
+  mBands.insert( key, band );
+  mRecentlyUsed.prepend( key );
+}
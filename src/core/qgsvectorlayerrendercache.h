@@ -0,0 +1,136 @@
+/***************************************************************************
+    qgsvectorlayerrendercache.h
+    ---------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSVECTORLAYERRENDERCACHE_H
+#define QGSVECTORLAYERRENDERCACHE_H
+
+#include <QObject>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+class QgsFeatureIterator;
+class QgsFields;
+class QgsRenderContext;
+class QgsVectorLayer;
+class QgsVectorLayerFeatureSource;
+
+/**
+ * Feature of the render cache. Its geometry is stored in the coordinate array
+ * of the band, together with the structure (number of parts, rings and vertices)
+ * needed to rebuild it as WKB.
+ * @note not available in python bindings
+ */
+struct QgsRenderCacheFeature
+{
+  QgsFeatureId fid;
+  QgsAttributes attributes;
+  QGis::WkbType wkbType;     //!< single or multi 2D type
+  double bbox[4];            //!< xmin, ymin, xmax, ymax
+  int structureOffset;       //!< index of the first item in QgsRenderCacheBand::structure
+  int coordOffset;           //!< index of the first coordinate in QgsRenderCacheBand::coords
+};
+
+/**
+ * Features of a layer cached for one destination CRS, zoom band and set of attributes.
+ * @note not available in python bindings
+ */
+struct QgsRenderCacheBand
+{
+  QgsRectangle coverage;               //!< extent (in destination CRS) where all features are cached
+  QVector<QgsRenderCacheFeature> features;
+  QVector<int> structure;              //!< part, ring and vertex counts of all features
+  QVector<double> coords;              //!< x,y pairs of all features
+  int size;                            //!< estimated memory used, in bytes
+};
+
+/**
+ * Opt-in cache of the features of a vector layer as they are drawn: geometries
+ * already transformed into the destination CRS and simplified for a zoom band,
+ * stored as flat coordinate arrays.
+ *
+ * Redraws of a static layer within the cached area do not need to fetch nor
+ * transform features again. The cache is invalidated whenever the layer data
+ * change and keeps the bands within a memory budget.
+ *
+ * The layer holds the cache through a shared pointer, so that renderers running
+ * in other threads keep it alive if it is disabled meanwhile.
+ *
+ * @note added in 2.8
+ */
+class CORE_EXPORT QgsVectorLayerRenderCache : public QObject
+{
+    Q_OBJECT
+  public:
+    QgsVectorLayerRenderCache( QgsVectorLayer* layer );
+    ~QgsVectorLayerRenderCache();
+
+    //! Set the maximal memory used by the cache in bytes (default 128 MB)
+    void setMaximumSize( int bytes );
+    //! Return the maximal memory used by the cache in bytes
+    int maximumSize() const { return mMaxSize; }
+
+    //! Return the memory currently used by the cache in bytes
+    int size();
+
+    /** Prepare an iterator over the cached features intersecting the request extent.
+     * On a miss the iterator fetches the features from the source and fills the band
+     * while they are drawn. The returned features have their
+     * geometry in destination CRS, the context's coordinate transform must not be applied.
+     * @param source source to fetch features from on cache miss
+     * @param context render context (its extent is in layer CRS)
+     * @param requestExtent extent of the features to draw in layer CRS, i.e. the extent
+     * of the context grown by the renderer for symbols reaching into it
+     * @param attrNames attributes needed for rendering
+     * @param fields fields of the layer
+     * @param simplifyThreshold simplification threshold in pixels, 0 for no simplification
+     * @param fit set to the iterator over cached features
+     * @param destExtent set to the extent of the context in destination CRS
+     * @returns false if the features cannot be served from the cache (e.g. too many features)
+     * @note not available in python bindings
+     */
+    bool getFeatures( QgsVectorLayerFeatureSource* source, const QgsRenderContext& context,
+                      const QgsRectangle& requestExtent, const QStringList& attrNames, const QgsFields& fields, double simplifyThreshold,
+                      QgsFeatureIterator& fit, QgsRectangle& destExtent );
+
+  public slots:
+    //! Remove all cached features
+    void invalidate();
+
+  private:
+    //! Whether the cache was not invalidated since the given generation
+    bool isCurrent( int generation );
+    //! Remember that the band of the key does not fit into the budget
+    void setOversized( const QString& key, int generation );
+    //! Store a completely filled band, unless the cache was invalidated meanwhile
+    void insertBand( const QString& key, QSharedPointer<QgsRenderCacheBand> band, int generation );
+
+    //! Evict least recently used bands so that the given amount of memory is available (without locking)
+    void makeRoom( int bytes );
+
+    QMutex mMutex;
+    int mMaxSize;
+    int mGeneration;
+    QMap<QString, QSharedPointer<QgsRenderCacheBand> > mBands;
+    QStringList mRecentlyUsed;       //!< band keys, the most recently used first
+    QSet<QString> mOversizedKeys;    //!< bands which do not fit into the budget
+
+    friend class QgsRenderCacheFillingIterator;
+};
+
+#endif // QGSVECTORLAYERRENDERCACHE_H
@@ -17,6 +17,7 @@
 
 //#include "qgsfeatureiterator.h"
 #include "diagram/qgsdiagram.h"
+#include "qgsapproximatetransform.h"
 #include "qgsdiagramrendererv2.h"
 #include "qgsgeometrycache.h"
 #include "qgsmessagelog.h"
@@ -28,12 +29,17 @@
 #include "qgssymbolv2.h"
 #include "qgsvectorlayer.h"
 #include "qgsvectorlayerfeatureiterator.h"
+#include "qgsvectorlayerrendercache.h"
 
+#include <QScopedPointer>
 #include <QSettings>
 
 // TODO:
 // - passing of cache to QgsVectorLayer
 
+// maximal error of approximate reprojection (in pixels)
+static const double APPROXIMATE_TRANSFORM_TOLERANCE = 0.25;
+
 
 QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRenderContext& context )
     : QgsMapLayerRenderer( layer->id() )
@@ -52,6 +58,10 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
 
   mDrawVertexMarkers = ( layer->editBuffer() != 0 );
 
+  // features being edited are always fetched from the layer
+  if ( !layer->editBuffer() )
+    mRenderCache = layer->mRenderCache;
+
   mGeometryType = layer->geometryType();
 
   mLayerTransparency = layer->layerTransparency();
@@ -125,8 +135,72 @@ bool QgsVectorLayerRenderer::render()
     mContext.painter()->setCompositionMode( mFeatureBlendMode );
   }
 
+  // try to draw features already transformed and simplified by previous renderings.
+  // Labeling and diagrams register features with the original coordinate transform,
+  // so they always need features from the provider
+  QgsFeatureIterator fit;
+  bool fromRenderCache = false;
+  if ( mRenderCache && !mLabeling && !mDiagrams && !mCache )
+  {
+    QgsRectangle requestExtent = mContext.extent();
+    mRendererV2->modifyRequestExtent( requestExtent, mContext );
+
+    QgsRectangle destExtent;
+    double threshold = mSimplifyGeometry ? mSimplifyMethod.threshold() : 0;
+    if ( mRenderCache->getFeatures( mSource, mContext, requestExtent, mAttrNames, mFields, threshold, fit, destExtent ) )
+    {
+      // cached geometries are in destination CRS and already simplified
+      mContext.setCoordinateTransform( 0 );
+      mContext.setExtent( destExtent );
+      QgsVectorSimplifyMethod vectorMethod;
+      vectorMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
+      mContext.setVectorSimplifyMethod( vectorMethod );
+      fromRenderCache = true;
+    }
+  }
+
+  // interpolate reprojected vertices in a grid covering the extent (and the margin
+  // kept when clipping) instead of transforming them one by one
+  QScopedPointer<QgsApproximateTransform> approxTransform;
+  if ( mContext.useApproximateTransform() && mContext.coordinateTransform() )
+  {
+    const QgsRectangle& e = mContext.extent();
+    double cw = e.width() / 10; double ch = e.height() / 10;
+    QgsRectangle gridExtent( e.xMinimum() - cw, e.yMinimum() - ch, e.xMaximum() + cw, e.yMaximum() + ch );
+    approxTransform.reset( new QgsApproximateTransform( mContext.coordinateTransform(), gridExtent,
+                           mContext.mapToPixel().mapUnitsPerPixel() * APPROXIMATE_TRANSFORM_TOLERANCE ) );
+    if ( approxTransform->isValid() )
+      mContext.setApproximateTransform( approxTransform.data() );
+  }
+
   mRendererV2->startRender( mContext, mFields );
 
+  if ( !fromRenderCache )
+    fit = createFeatureIterator();
+
+  if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels() )
+    drawRendererV2Levels( fit );
+  else
+    drawRendererV2( fit );
+
+  //apply layer transparency for vector layers
+  if ( mContext.useAdvancedEffects() && mLayerTransparency != 0 )
+  {
+    // a layer transparency has been set, so update the alpha for the flattened layer
+    // by combining it with the layer transparency
+    QColor transparentFillColor = QColor( 0, 0, 0, 255 - ( 255 * mLayerTransparency / 100 ) );
+    // use destination in composition mode to merge source's alpha with destination
+    mContext.painter()->setCompositionMode( QPainter::CompositionMode_DestinationIn );
+    mContext.painter()->fillRect( 0, 0, mContext.painter()->device()->width(),
+                                  mContext.painter()->device()->height(), transparentFillColor );
+  }
+
+  mContext.setApproximateTransform( 0 );
+  return true;
+}
+
+QgsFeatureIterator QgsVectorLayerRenderer::createFeatureIterator()
+{
   QgsRectangle requestExtent = mContext.extent();
   mRendererV2->modifyRequestExtent( requestExtent, mContext );
 
@@ -208,26 +282,7 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
-  QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
-
-  if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels() )
-    drawRendererV2Levels( fit );
-  else
-    drawRendererV2( fit );
-
-  //apply layer transparency for vector layers
-  if ( mContext.useAdvancedEffects() && mLayerTransparency != 0 )
-  {
-    // a layer transparency has been set, so update the alpha for the flattened layer
-    // by combining it with the layer transparency
-    QColor transparentFillColor = QColor( 0, 0, 0, 255 - ( 255 * mLayerTransparency / 100 ) );
-    // use destination in composition mode to merge source's alpha with destination
-    mContext.painter()->setCompositionMode( QPainter::CompositionMode_DestinationIn );
-    mContext.painter()->fillRect( 0, 0, mContext.painter()->device()->width(),
-                                  mContext.painter()->device()->height(), transparentFillColor );
-  }
-
-  return true;
+  return mSource->getFeatures( featureRequest );
 }
 
 void QgsVectorLayerRenderer::setGeometryCachePointer( QgsGeometryCache* cache )
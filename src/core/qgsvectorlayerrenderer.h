@@ -25,11 +25,13 @@ class QgsDiagramRendererV2;
 class QgsDiagramLayerSettings;
 
 class QgsGeometryCache;
+class QgsVectorLayerRenderCache;
 class QgsFeatureIterator;
 class QgsSingleSymbolRendererV2;
 
 #include <QList>
 #include <QPainter>
+#include <QSharedPointer>
 
 typedef QList<int> QgsAttributeList;
 
@@ -68,6 +70,11 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     void prepareLabeling( QgsVectorLayer* layer, QStringList& attributeNames );
     void prepareDiagrams( QgsVectorLayer* layer, QStringList& attributeNames );
 
+    /** Create iterator over features of the rendered extent, with simplification set up if enabled.
+     * QgsFeatureRenderer::startRender() needs to be called before using this method
+     */
+    QgsFeatureIterator createFeatureIterator();
+
     /** Draw layer with renderer V2. QgsFeatureRenderer::startRender() needs to be called before using this method
      */
     void drawRendererV2( QgsFeatureIterator& fit );
@@ -95,6 +102,9 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     bool mCacheFeatures;
     QgsGeometryCache* mCache;
 
+    //! cache of transformed and simplified features of the layer, may be null
+    QSharedPointer<QgsVectorLayerRenderCache> mRenderCache;
+
     bool mDrawVertexMarkers;
     bool mVertexMarkerOnlyForSelection;
     int mVertexMarkerStyle, mVertexMarkerSize;
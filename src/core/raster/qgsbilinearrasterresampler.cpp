@@ -34,5 +34,11 @@ QgsRasterResampler * QgsBilinearRasterResampler::clone() const
 
 void QgsBilinearRasterResampler::resample( const QImage& srcImage, QImage& dstImage )
 {
-  dstImage = srcImage.scaled( dstImage.width(), dstImage.height(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+  resampleSeparable( srcImage, dstImage, triangleKernel, 1.0 );
+}
+
+double QgsBilinearRasterResampler::triangleKernel( double distance )
+{
+  distance = fabs( distance );
+  return distance < 1.0 ? 1.0 - distance : 0.0;
 }
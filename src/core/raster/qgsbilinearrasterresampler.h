@@ -33,6 +33,10 @@ class CORE_EXPORT QgsBilinearRasterResampler: public QgsRasterResampler
     void resample( const QImage& srcImage, QImage& dstImage );
     QString type() const { return "bilinear"; }
     QgsRasterResampler * clone() const;
+
+  private:
+    //! linear interpolation between the two nearest pixels (averaging when zooming out)
+    static double triangleKernel( double distance );
 };
 
 #endif // QGSBILINEARRASTERRESAMPLER_H
@@ -65,34 +65,44 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
       continue;
     }
 
-    QImage img = block->image();
+    drawBlock( p, viewPort, block, topLeftCol, topLeftRow, theQgsMapToPixel );
 
-    // Because of bug in Acrobat Reader we must use "white" transparent color instead
-    // of "black" for PDF. See #9101.
-    QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
-    if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
-    {
-      QgsDebugMsg( "PdfFormat" );
+    delete block;
+  }
+}
+
+void QgsRasterDrawer::drawBlock( QPainter* p, QgsRasterViewPort* viewPort, QgsRasterBlock* block, int topLeftCol, int topLeftRow, const QgsMapToPixel* theQgsMapToPixel ) const
+{
+  if ( !p || !block )
+  {
+    return;
+  }
 
-      img = img.convertToFormat( QImage::Format_ARGB32 );
-      QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
-      QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
-      for ( int x = 0; x < img.width(); x++ )
+  QImage img = block->image();
+
+  // Because of bug in Acrobat Reader we must use "white" transparent color instead
+  // of "black" for PDF. See #9101.
+  QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
+  if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+  {
+    QgsDebugMsg( "PdfFormat" );
+
+    img = img.convertToFormat( QImage::Format_ARGB32 );
+    QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
+    QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
+    for ( int x = 0; x < img.width(); x++ )
+    {
+      for ( int y = 0; y < img.height(); y++ )
       {
-        for ( int y = 0; y < img.height(); y++ )
+        if ( img.pixel( x, y ) == transparentBlack )
         {
-          if ( img.pixel( x, y ) == transparentBlack )
-          {
-            img.setPixel( x, y, transparentWhite );
-          }
+          img.setPixel( x, y, transparentWhite );
         }
       }
     }
-
-    drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
-
-    delete block;
   }
+
+  drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
 }
 
 void QgsRasterDrawer::drawImage( QPainter* p, QgsRasterViewPort* viewPort, const QImage& img, int topLeftCol, int topLeftRow, const QgsMapToPixel* theQgsMapToPixel ) const
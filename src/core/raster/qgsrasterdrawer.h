@@ -26,6 +26,7 @@ class QImage;
 class QgsMapToPixel;
 struct QgsRasterViewPort;
 class QgsRasterIterator;
+class QgsRasterBlock;
 
 /** \ingroup core
  * The drawing pipe for raster layers.
@@ -38,6 +39,16 @@ class CORE_EXPORT QgsRasterDrawer
 
     void draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel );
 
+    /**Draws a raster part which was read elsewhere, e.g. in another thread
+      @param p the painter to draw to
+      @param viewPort view port to draw to
+      @param block block with image data of the last pipe filter
+      @param topLeftCol Left position relative to left border of viewport
+      @param topLeftRow Top position relative to top border of viewport
+      @param theQgsMapToPixel map to device coordinate transformation info
+      @note added in 2.8 */
+    void drawBlock( QPainter* p, QgsRasterViewPort* viewPort, QgsRasterBlock* block, int topLeftCol, int topLeftRow, const QgsMapToPixel* theQgsMapToPixel ) const;
+
   protected:
     /**Draws raster part
       @param p the painter to draw to
@@ -17,7 +17,6 @@
 #include "qgsrasterfilewriter.h"
 #include "qgsproviderregistry.h"
 #include "qgsrasterinterface.h"
-#include "qgsrasteriterator.h"
 #include "qgsrasterlayer.h"
 #include "qgsrasterprojector.h"
 
@@ -25,6 +24,9 @@
 #include <QProgressDialog>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QThread>
+#include <QTime>
+#include <QtConcurrentRun>
 
 QgsRasterFileWriter::QgsRasterFileWriter( const QString& outputUrl ):
     mMode( Raw ), mOutputUrl( outputUrl ), mOutputProviderKey( "gdal" ), mOutputFormat( "GTiff" ),
@@ -85,8 +87,6 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeRaster( const QgsRast
 
   mProgressDialog = progressDialog;
 
-  QgsRasterIterator iter( pipe->last() );
-
   //create directory for output files
   if ( mTiledMode )
   {
@@ -104,26 +104,22 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeRaster( const QgsRast
 
   if ( mMode == Image )
   {
-    WriterError e = writeImageRaster( &iter, nCols, nRows, outputExtent, crs, progressDialog );
+    WriterError e = writeImageRaster( pipe, nCols, nRows, outputExtent, crs, progressDialog );
     mProgressDialog = 0;
     return e;
   }
   else
   {
     mProgressDialog = 0;
-    WriterError e = writeDataRaster( pipe, &iter, nCols, nRows, outputExtent, crs, progressDialog );
+    WriterError e = writeDataRaster( pipe, nCols, nRows, outputExtent, crs, progressDialog );
     return e;
   }
 }
 
-QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const QgsRasterPipe* pipe, QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent,
+QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const QgsRasterPipe* pipe, int nCols, int nRows, const QgsRectangle& outputExtent,
     const QgsCoordinateReferenceSystem& crs, QProgressDialog* progressDialog )
 {
   QgsDebugMsg( "Entered" );
-  if ( !iter )
-  {
-    return SourceProviderError;
-  }
 
   const QgsRasterInterface* iface = pipe->last();
   if ( !iface )
@@ -138,9 +134,6 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
     return SourceProviderError;
   }
 
-  iter->setMaximumTileWidth( mMaxTileWidth );
-  iter->setMaximumTileHeight( mMaxTileHeight );
-
   int nBands = iface->bandCount();
   if ( nBands < 1 )
   {
@@ -256,7 +249,7 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
   // initOutput() returns 0 in tile mode!
   destProvider = initOutput( nCols, nRows, crs, geoTransform, nBands, destDataType, destHasNoDataValueList, destNoDataValueList );
 
-  WriterError error = writeDataRaster( pipe, iter, nCols, nRows, outputExtent, crs, destDataType, destHasNoDataValueList, destNoDataValueList, destProvider, progressDialog );
+  WriterError error = writeDataRaster( pipe, nCols, nRows, outputExtent, crs, destDataType, destHasNoDataValueList, destNoDataValueList, destProvider, progressDialog );
 
   if ( error == NoDataConflict )
   {
@@ -284,7 +277,7 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
 
     // Try again
     destProvider = initOutput( nCols, nRows, crs, geoTransform, nBands, destDataType, destHasNoDataValueList, destNoDataValueList );
-    error = writeDataRaster( pipe, iter, nCols, nRows, outputExtent, crs, destDataType, destHasNoDataValueList, destNoDataValueList, destProvider, progressDialog );
+    error = writeDataRaster( pipe, nCols, nRows, outputExtent, crs, destDataType, destHasNoDataValueList, destNoDataValueList, destProvider, progressDialog );
   }
 
   if ( destProvider )
@@ -295,7 +288,6 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
 
 QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
   const QgsRasterPipe* pipe,
-  QgsRasterIterator* iter,
   int nCols, int nRows,
   const QgsRectangle& outputExtent,
   const QgsCoordinateReferenceSystem& crs,
@@ -305,215 +297,265 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
   QgsRasterDataProvider* destProvider,
   QProgressDialog* progressDialog )
 {
-  Q_UNUSED( pipe );
   Q_UNUSED( destHasNoDataValueList );
   QgsDebugMsg( "Entered" );
 
-  const QgsRasterInterface* iface = iter->input();
-  const QgsRasterDataProvider* srcProvider = dynamic_cast<const QgsRasterDataProvider*>( iface->srcInput() );
-  int nBands = iface->bandCount();
+  int nBands = pipe->last()->bandCount();
   QgsDebugMsg( QString( "nBands = %1" ).arg( nBands ) );
 
-  //Get output map units per pixel
-  int iterLeft = 0;
-  int iterTop = 0;
-  int iterCols = 0;
-  int iterRows = 0;
-
-  QList<QgsRasterBlock*> blockList;
-  for ( int i = 1; i <= nBands; ++i )
+  if ( destProvider ) // no tiles
   {
-    iter->startRasterRead( i, nCols, nRows, outputExtent );
-    blockList.push_back( 0 );
-    if ( destProvider ) // no tiles
+    for ( int i = 1; i <= nBands; ++i )
     {
       destProvider->setNoDataValue( i, destNoDataValueList.value( i - 1 ) );
     }
   }
 
-  int nParts = 0;
-  int fileIndex = 0;
+  PartJob job;
+  job.outputExtent = outputExtent;
+  job.nCols = nCols;
+  job.nRows = nRows;
+  job.nBands = nBands;
+  job.destDataType = destDataType;
+  job.destNoDataValueList = destNoDataValueList;
+  job.crs = crs;
+
+  // TODO: verify if NoDataConflict happened, to do that we need the whole pipe or nuller interface
+  return writeParts( pipe, job, destProvider, progressDialog );
+}
+
+QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( const QgsRasterPipe* pipe, int nCols, int nRows, const QgsRectangle& outputExtent,
+    const QgsCoordinateReferenceSystem& crs, QProgressDialog* progressDialog )
+{
+  QgsDebugMsg( "Entered" );
+
+  const QgsRasterInterface* iface = pipe->last();
+  if ( !iface || ( iface->dataType( 1 ) != QGis::ARGB32 &&
+                   iface->dataType( 1 ) != QGis::ARGB32_Premultiplied ) )
+  {
+    return SourceProviderError;
+  }
+
+  //create destProvider for whole dataset here
+  QgsRasterDataProvider* destProvider = 0;
+  double pixelSize;
+  double geoTransform[6];
+  globalOutputParameters( outputExtent, nCols, nRows, geoTransform, pixelSize );
+
+  destProvider = initOutput( nCols, nRows, crs, geoTransform, 4, QGis::Byte );
+
+  PartJob job;
+  job.outputExtent = outputExtent;
+  job.nCols = nCols;
+  job.nRows = nRows;
+  job.nBands = 4;
+  job.destDataType = QGis::Byte;
+  job.crs = crs;
+
+  WriterError error = writeParts( pipe, job, destProvider, progressDialog );
+
+  if ( destProvider )
+    delete destProvider;
+
+  return error;
+}
+
+QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeParts( const QgsRasterPipe* pipe, const PartJob& job, QgsRasterDataProvider* destProvider, QProgressDialog* progressDialog )
+{
+  // the parts are split like by QgsRasterIterator
+  int maxTileWidth = qMax(( int ) mMaxTileWidth, 1 );
+  int maxTileHeight = qMax(( int ) mMaxTileHeight, 1 );
+  QList<QRect> parts;
+  for ( int top = 0; top < job.nRows; top += maxTileHeight )
+  {
+    for ( int left = 0; left < job.nCols; left += maxTileWidth )
+    {
+      parts << QRect( left, top, qMin( maxTileWidth, job.nCols - left ), qMin( maxTileHeight, job.nRows - top ) );
+    }
+  }
+  int nParts = parts.size();
+
+  // Only local files are read in parallel, other providers (e.g. WMS) would
+  // send the requests from each copy of the pipe and are read in this thread.
+  const QgsRasterDataProvider* srcProvider = dynamic_cast<const QgsRasterDataProvider*>( pipe->last()->srcInput() );
+  bool parallel = srcProvider && srcProvider->name() == "gdal";
+  int threadCount = parallel ? qBound( 1, QThread::idealThreadCount(), qMax( nParts, 1 ) ) : 1;
+  QgsDebugMsg( QString( "%1 parts in %2 threads" ).arg( nParts ).arg( threadCount ) );
+
+  // each thread reads through its own copy of the pipe (with its own provider)
+  QList<QgsRasterPipe*> pipes;
+  pipes << const_cast<QgsRasterPipe*>( pipe );
+  for ( int t = 1; t < threadCount; ++t )
+    pipes << new QgsRasterPipe( *pipe );
+
+  // Part i is read with the pipe i % threadCount
+  QList<PartJob> jobs;
+  for ( int i = 0; i < nParts; ++i )
+  {
+    PartJob partJob = job;
+    partJob.pipe = pipes[i % threadCount];
+    partJob.index = i;
+    partJob.rect = parts[i];
+    jobs << partJob;
+  }
+
   if ( progressDialog )
   {
-    int nPartsX = nCols / iter->maximumTileWidth() + 1;
-    int nPartsY = nRows / iter->maximumTileHeight() + 1;
-    nParts = nPartsX * nPartsY;
     progressDialog->setMaximum( nParts );
     progressDialog->show();
-    progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 1 ).arg( nParts ) );
+    progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( 1 ).arg( nParts ) );
   }
 
-  // hmm why is there a for(;;) here ..
-  // not good coding practice IMHO, it might be better to use [ for() and break ] or  [ while (test) ]
-  for ( ;; )
+  // The parts are written in order and the next part for a pipe is started when
+  // the previous one is written, so at most threadCount parts are in memory.
+  QList< QFuture<PartResult> > futures;
+  for ( int i = 0; parallel && i < threadCount && i < nParts; ++i )
   {
-    for ( int i = 1; i <= nBands; ++i )
+    futures << QtConcurrent::run( this, &QgsRasterFileWriter::processPart, jobs[i] );
+  }
+
+  QTime time;
+  time.start();
+  qint64 bytesWritten = 0;
+  int typeSize = QgsRasterBlock::typeSize( job.destDataType );
+  QString pyramidsResult;
+  bool canceled = false;
+
+  for ( int i = 0; i < nParts; ++i )
+  {
+    PartResult result;
+    if ( parallel )
     {
-      if ( !iter->readNextRasterPart( i, iterCols, iterRows, &( blockList[i - 1] ), iterLeft, iterTop ) )
-      {
-        // No more parts, create VRT and return
-        if ( mTiledMode )
-        {
-          QString vrtFilePath( mOutputUrl + "/" + vrtFileName() );
-          writeVRT( vrtFilePath );
-          if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
-          {
-            buildPyramids( vrtFilePath );
-          }
-        }
-        else
-        {
-          if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
-          {
-            buildPyramids( mOutputUrl );
-          }
-        }
+      // no more parts are started once canceled, the running ones are finished and dropped
+      if ( i >= futures.size() )
+        break;
+
+      result = futures[i].result();
+      futures[i] = QFuture<PartResult>(); // release the result
 
-        QgsDebugMsg( "Done" );
-        return NoError; //reached last tile, bail out
+      if ( !canceled && i + threadCount < nParts )
+      {
+        futures << QtConcurrent::run( this, &QgsRasterFileWriter::processPart, jobs[i + threadCount] );
       }
-      // TODO: verify if NoDataConflict happened, to do that we need the whole pipe or nuller interface
     }
-
-    if ( progressDialog && fileIndex < ( nParts - 1 ) )
+    else
     {
-      progressDialog->setValue( fileIndex + 1 );
-      progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 2 ).arg( nParts ) );
-      QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
-      if ( progressDialog->wasCanceled() )
-      {
-        for ( int i = 0; i < nBands; ++i )
-        {
-          delete blockList[i];
-        }
+      if ( canceled )
         break;
-      }
+
+      result = processPart( jobs[i] );
     }
 
-    // It may happen that internal data type (dataType) is wider than destDataType
-    QList<QgsRasterBlock*> destBlockList;
-    for ( int i = 1; i <= nBands; ++i )
+    const QRect& part = parts[i];
+    if ( !canceled && result.ok )
     {
-      if ( srcProvider->dataType( i ) == destDataType )
+      if ( mTiledMode ) // the part file was written by the job
       {
-        destBlockList.push_back( blockList[i-1] );
+        for ( int band = 1; band <= job.nBands; ++band )
+        {
+          addToVRT( partFileName( i ), band, part.width(), part.height(), part.left(), part.top() );
+        }
+        if ( pyramidsResult.isNull() )
+          pyramidsResult = result.pyramidsError;
       }
-      else
+      else if ( destProvider )
       {
-        // TODO: this conversion should go to QgsRasterDataProvider::write with additional input data type param
-        blockList[i-1]->convert( destDataType );
-        destBlockList.push_back( blockList[i-1] );
-      }
-      blockList[i-1] = 0;
-    }
-
-    if ( mTiledMode ) //write to file
-    {
-      QgsRasterDataProvider* partDestProvider = createPartProvider( outputExtent,
-          nCols, iterCols, iterRows,
-          iterLeft, iterTop, mOutputUrl,
-          fileIndex, nBands, destDataType, crs );
-
-      if ( partDestProvider )
-      {
-        //write data to output file. todo: loop over the data list
-        for ( int i = 1; i <= nBands; ++i )
+        for ( int band = 1; band <= job.nBands; ++band )
         {
-          partDestProvider->setNoDataValue( i, destNoDataValueList.value( i - 1 ) );
-          partDestProvider->write( destBlockList[i - 1]->bits( 0 ), i, iterCols, iterRows, 0, 0 );
-          delete destBlockList[i - 1];
-          addToVRT( partFileName( fileIndex ), i, iterCols, iterRows, iterLeft, iterTop );
+          destProvider->write( result.blocks[band - 1]->bits(), band, part.width(), part.height(), part.left(), part.top() );
         }
-        delete partDestProvider;
       }
+      bytesWritten += ( qint64 ) part.width() * part.height() * job.nBands * typeSize;
     }
-    else if ( destProvider )
+    qDeleteAll( result.blocks );
+
+    if ( progressDialog && !canceled )
     {
-      //loop over data
-      for ( int i = 1; i <= nBands; ++i )
-      {
-        destProvider->write( destBlockList[i - 1]->bits( 0 ), i, iterCols, iterRows, iterLeft, iterTop );
-        delete destBlockList[i - 1];
-      }
+      double mbPerSecond = bytesWritten / 1048576.0 / qMax( time.elapsed(), 1 ) * 1000;
+      progressDialog->setValue( i + 1 );
+      progressDialog->setLabelText( QObject::tr( "Writing raster part %1 of %2 (%3 MB/s)" )
+                                    .arg( qMin( i + 2, nParts ) ).arg( nParts ).arg( mbPerSecond, 0, 'f', 1 ) );
+      QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
+      canceled = progressDialog->wasCanceled();
     }
-    ++fileIndex;
   }
 
-  QgsDebugMsg( "Done" );
-  return NoError;
-}
+  for ( int t = 1; t < threadCount; ++t )
+    delete pipes[t];
 
-QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent,
-    const QgsCoordinateReferenceSystem& crs, QProgressDialog* progressDialog )
-{
-  QgsDebugMsg( "Entered" );
-  if ( !iter )
+  QgsDebugMsg( QString( "%1 MB written in %2 ms (%3 MB/s)" ).arg( bytesWritten / 1048576.0, 0, 'f', 1 ).arg( time.elapsed() )
+               .arg( bytesWritten / 1048576.0 / qMax( time.elapsed(), 1 ) * 1000, 0, 'f', 1 ) );
+
+  if ( canceled )
   {
-    return SourceProviderError;
+    return NoError;
   }
 
-  const QgsRasterInterface* iface = iter->input();
-  QGis::DataType inputDataType = iface->dataType( 1 );
-  if ( !iface || ( inputDataType != QGis::ARGB32 &&
-                   inputDataType != QGis::ARGB32_Premultiplied ) )
+  if ( mTiledMode )
   {
-    return SourceProviderError;
+    QString vrtFilePath( mOutputUrl + "/" + vrtFileName() );
+    writeVRT( vrtFilePath );
+    if ( buildPartPyramids() )
+    {
+      if ( !pyramidsResult.isNull() )
+        pyramidsError( pyramidsResult );
+    }
+    else if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
+    {
+      buildPyramids( vrtFilePath );
+    }
+  }
+  else
+  {
+    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
+    {
+      buildPyramids( mOutputUrl );
+    }
   }
 
-  iter->setMaximumTileWidth( mMaxTileWidth );
-  iter->setMaximumTileHeight( mMaxTileHeight );
-
-  void* redData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* greenData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* blueData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* alphaData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  QgsRectangle mapRect;
-  int iterLeft = 0, iterTop = 0, iterCols = 0, iterRows = 0;
-  int fileIndex = 0;
-
-  //create destProvider for whole dataset here
-  QgsRasterDataProvider* destProvider = 0;
-  double pixelSize;
-  double geoTransform[6];
-  globalOutputParameters( outputExtent, nCols, nRows, geoTransform, pixelSize );
-
-  destProvider = initOutput( nCols, nRows, crs, geoTransform, 4, QGis::Byte );
-
-  iter->startRasterRead( 1, nCols, nRows, outputExtent );
-
-  int nParts = 0;
   if ( progressDialog )
   {
-    int nPartsX = nCols / iter->maximumTileWidth() + 1;
-    int nPartsY = nRows / iter->maximumTileHeight() + 1;
-    nParts = nPartsX * nPartsY;
-    progressDialog->setMaximum( nParts );
-    progressDialog->show();
-    progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 1 ).arg( nParts ) );
+    progressDialog->setValue( progressDialog->maximum() );
   }
 
-  QgsRasterBlock *inputBlock = 0;
-  while ( iter->readNextRasterPart( 1, iterCols, iterRows, &inputBlock, iterLeft, iterTop ) )
+  QgsDebugMsg( "Done" );
+  return NoError;
+}
+
+QgsRasterFileWriter::PartResult QgsRasterFileWriter::processPart( const PartJob& job ) const
+{
+  PartResult result;
+  result.ok = false;
+  const QRect& part = job.rect;
+
+  //get subrectangle
+  const QgsRectangle& extent = job.outputExtent;
+  QgsRectangle partExtent( extent.xMinimum() + part.left() / ( double )job.nCols * extent.width(),
+                           extent.yMaximum() - ( part.top() + part.height() ) / ( double )job.nRows * extent.height(),
+                           extent.xMinimum() + ( part.left() + part.width() ) / ( double )job.nCols * extent.width(),
+                           extent.yMaximum() - part.top() / ( double )job.nRows * extent.height() );
+
+  QgsRasterInterface* iface = job.pipe->last();
+  if ( mMode == Image )
   {
+    QgsRasterBlock* inputBlock = iface->block( 1, partExtent, part.width(), part.height() );
     if ( !inputBlock )
     {
-      continue;
+      return result;
     }
+    QGis::DataType inputDataType = iface->dataType( 1 );
 
-    if ( progressDialog && fileIndex < ( nParts - 1 ) )
+    //fill into red/green/blue/alpha channels
+    for ( int i = 0; i < 4; ++i )
     {
-      progressDialog->setValue( fileIndex + 1 );
-      progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 2 ).arg( nParts ) );
-      QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
-      if ( progressDialog->wasCanceled() )
-      {
-        delete inputBlock;
-        break;
-      }
+      result.blocks << new QgsRasterBlock( QGis::Byte, part.width(), part.height() );
     }
+    char* redData = result.blocks[0]->bits();
+    char* greenData = result.blocks[1]->bits();
+    char* blueData = result.blocks[2]->bits();
+    char* alphaData = result.blocks[3]->bits();
 
-    //fill into red/green/blue/alpha channels
-    qgssize nPixels = ( qgssize )iterCols * iterRows;
+    qgssize nPixels = ( qgssize )part.width() * part.height();
     // TODO: should be char not int? we are then copying 1 byte
     int red = 0;
     int green = 0;
@@ -528,80 +570,73 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRaste
       if ( inputDataType == QGis::ARGB32_Premultiplied )
       {
         double a = alpha / 255.;
-        QgsDebugMsgLevel( QString( "red = %1 green = %2 blue = %3 alpha = %4 p = %5 a = %6" ).arg( red ).arg( green ).arg( blue ).arg( alpha ).arg(( int )c, 0, 16 ).arg( a ), 5 );
         red /= a;
         green /= a;
         blue /= a;
       }
-      memcpy(( char* )redData + i, &red, 1 );
-      memcpy(( char* )greenData + i, &green, 1 );
-      memcpy(( char* )blueData + i, &blue, 1 );
-      memcpy(( char* )alphaData + i, &alpha, 1 );
+      memcpy( redData + i, &red, 1 );
+      memcpy( greenData + i, &green, 1 );
+      memcpy( blueData + i, &blue, 1 );
+      memcpy( alphaData + i, &alpha, 1 );
     }
     delete inputBlock;
-
-    //create output file
-    if ( mTiledMode )
+  }
+  else
+  {
+    for ( int i = 1; i <= job.nBands; ++i )
     {
-      //delete destProvider;
-      QgsRasterDataProvider* partDestProvider = createPartProvider( outputExtent,
-          nCols, iterCols, iterRows,
-          iterLeft, iterTop, mOutputUrl, fileIndex,
-          4, QGis::Byte, crs );
-
-      if ( partDestProvider )
+      QgsRasterBlock* block = iface->block( i, partExtent, part.width(), part.height() );
+      if ( !block )
       {
-        //write data to output file
-        partDestProvider->write( redData, 1, iterCols, iterRows, 0, 0 );
-        partDestProvider->write( greenData, 2, iterCols, iterRows, 0, 0 );
-        partDestProvider->write( blueData, 3, iterCols, iterRows, 0, 0 );
-        partDestProvider->write( alphaData, 4, iterCols, iterRows, 0, 0 );
-
-        addToVRT( partFileName( fileIndex ), 1, iterCols, iterRows, iterLeft, iterTop );
-        addToVRT( partFileName( fileIndex ), 2, iterCols, iterRows, iterLeft, iterTop );
-        addToVRT( partFileName( fileIndex ), 3, iterCols, iterRows, iterLeft, iterTop );
-        addToVRT( partFileName( fileIndex ), 4, iterCols, iterRows, iterLeft, iterTop );
-        delete partDestProvider;
+        qDeleteAll( result.blocks );
+        result.blocks.clear();
+        return result;
       }
+      // It may happen that internal data type (dataType) is wider than destDataType
+      // TODO: this conversion should go to QgsRasterDataProvider::write with additional input data type param
+      if ( block->dataType() != job.destDataType )
+      {
+        block->convert( job.destDataType );
+      }
+      result.blocks << block;
     }
-    else if ( destProvider )
-    {
-      destProvider->write( redData, 1, iterCols, iterRows, iterLeft, iterTop );
-      destProvider->write( greenData, 2, iterCols, iterRows, iterLeft, iterTop );
-      destProvider->write( blueData, 3, iterCols, iterRows, iterLeft, iterTop );
-      destProvider->write( alphaData, 4, iterCols, iterRows, iterLeft, iterTop );
-    }
-
-    ++fileIndex;
   }
 
-  if ( destProvider )
-    delete destProvider;
-
-  qgsFree( redData ); qgsFree( greenData ); qgsFree( blueData ); qgsFree( alphaData );
-
-  if ( progressDialog )
+  if ( mTiledMode ) //write to file
   {
-    progressDialog->setValue( progressDialog->maximum() );
-  }
+    QgsRasterDataProvider* partDestProvider = createPartProvider( job.outputExtent,
+        job.nCols, part.width(), part.height(),
+        part.left(), part.top(), mOutputUrl,
+        job.index, job.nBands, job.destDataType, job.crs );
 
-  if ( mTiledMode )
-  {
-    QString vrtFilePath( mOutputUrl + "/" + vrtFileName() );
-    writeVRT( vrtFilePath );
-    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
+    result.ok = partDestProvider != 0;
+    if ( partDestProvider )
     {
-      buildPyramids( vrtFilePath );
+      //write data to output file
+      for ( int i = 1; i <= job.nBands; ++i )
+      {
+        if ( mMode == Raw )
+        {
+          partDestProvider->setNoDataValue( i, job.destNoDataValueList.value( i - 1 ) );
+        }
+        partDestProvider->write( result.blocks[i - 1]->bits(), i, part.width(), part.height(), 0, 0 );
+      }
+      delete partDestProvider;
+
+      if ( buildPartPyramids() )
+      {
+        result.pyramidsError = createPyramids( mOutputUrl + "/" + partFileName( job.index ) );
+      }
     }
+    qDeleteAll( result.blocks );
+    result.blocks.clear();
   }
   else
   {
-    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
-    {
-      buildPyramids( mOutputUrl );
-    }
+    result.ok = true;
   }
-  return NoError;
+
+  return result;
 }
 
 void QgsRasterFileWriter::addToVRT( const QString& filename, int band, int xSize, int ySize, int xOffset, int yOffset )
@@ -654,48 +689,24 @@ void QgsRasterFileWriter::addToVRT( const QString& filename, int band, int xSize
 #if 0
 void QgsRasterFileWriter::buildPyramids( const QString& filename )
 {
-  GDALDatasetH dataSet;
-  GDALAllRegister();
-  dataSet = GDALOpen( filename.toLocal8Bit().data(), GA_Update );
-  if ( !dataSet )
-  {
-    return;
-  }
-
-  //2,4,8,16,32,64
-  int overviewList[6];
-  overviewList[0] = 2;
-  overviewList[1] = 4;
-  overviewList[2] = 8;
-  overviewList[3] = 16;
-  overviewList[4] = 32;
-  overviewList[5] = 64;
-
-#if 0
-  if ( mProgressDialog )
+  QString res = createPyramids( filename );
+  if ( !res.isNull() )
   {
-    mProgressDialog->setLabelText( QObject::tr( "Building Pyramids..." ) );
-    mProgressDialog->setValue( 0 );
-    mProgressDialog->setWindowModality( Qt::WindowModal );
-    mProgressDialog->show();
+    pyramidsError( res );
   }
-#endif
-  GDALBuildOverviews( dataSet, "AVERAGE", 6, overviewList, 0, 0, /*pyramidsProgress*/ 0, /*mProgressDialog*/ 0 );
 }
-#endif
 
-void QgsRasterFileWriter::buildPyramids( const QString& filename )
+QString QgsRasterFileWriter::createPyramids( const QString& filename ) const
 {
   QgsDebugMsg( "filename = " + filename );
   // open new dataProvider so we can build pyramids with it
   QgsRasterDataProvider* destProvider = ( QgsRasterDataProvider* ) QgsProviderRegistry::instance()->provider( mOutputProviderKey, filename );
   if ( !destProvider )
   {
-    return;
+    return QString();
   }
 
   // TODO progress report
-  // TODO test mTiledMode - not tested b/c segfault at line # 289
   // connect( provider, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
   QList< QgsRasterPyramid> myPyramidList;
   if ( ! mPyramidsList.isEmpty() )
@@ -711,40 +722,53 @@ void QgsRasterFileWriter::buildPyramids( const QString& filename )
                 mPyramidsFormat, mPyramidsConfigOptions );
   // QApplication::restoreOverrideCursor();
 
+  delete destProvider;
+  return res;
+}
+
+void QgsRasterFileWriter::pyramidsError( const QString& res )
+{
   // TODO put this in provider or elsewhere
-  if ( !res.isNull() )
+  QString title, message;
+  if ( res == "ERROR_WRITE_ACCESS" )
   {
-    QString title, message;
-    if ( res == "ERROR_WRITE_ACCESS" )
-    {
-      title = QObject::tr( "Building pyramids failed - write access denied" );
-      message = QObject::tr( "Write access denied. Adjust the file permissions and try again." );
-    }
-    else if ( res == "ERROR_WRITE_FORMAT" )
-    {
-      title = QObject::tr( "Building pyramids failed." );
-      message = QObject::tr( "The file was not writable. Some formats do not "
-                             "support pyramid overviews. Consult the GDAL documentation if in doubt." );
-    }
-    else if ( res == "FAILED_NOT_SUPPORTED" )
-    {
-      title = QObject::tr( "Building pyramids failed." );
-      message = QObject::tr( "Building pyramid overviews is not supported on this type of raster." );
-    }
-    else if ( res == "ERROR_JPEG_COMPRESSION" )
-    {
-      title = QObject::tr( "Building pyramids failed." );
-      message = QObject::tr( "Building internal pyramid overviews is not supported on raster layers with JPEG compression and your current libtiff library." );
-    }
-    else if ( res == "ERROR_VIRTUAL" )
-    {
-      title = QObject::tr( "Building pyramids failed." );
-      message = QObject::tr( "Building pyramid overviews is not supported on this type of raster." );
-    }
-    QMessageBox::warning( 0, title, message );
-    QgsDebugMsg( res + " - " + message );
+    title = QObject::tr( "Building pyramids failed - write access denied" );
+    message = QObject::tr( "Write access denied. Adjust the file permissions and try again." );
   }
-  delete destProvider;
+  else if ( res == "ERROR_WRITE_FORMAT" )
+  {
+    title = QObject::tr( "Building pyramids failed." );
+    message = QObject::tr( "The file was not writable. Some formats do not "
+                           "support pyramid overviews. Consult the GDAL documentation if in doubt." );
+  }
+  else if ( res == "FAILED_NOT_SUPPORTED" )
+  {
+    title = QObject::tr( "Building pyramids failed." );
+    message = QObject::tr( "Building pyramid overviews is not supported on this type of raster." );
+  }
+  else if ( res == "ERROR_JPEG_COMPRESSION" )
+  {
+    title = QObject::tr( "Building pyramids failed." );
+    message = QObject::tr( "Building internal pyramid overviews is not supported on raster layers with JPEG compression and your current libtiff library." );
+  }
+  else if ( res == "ERROR_VIRTUAL" )
+  {
+    title = QObject::tr( "Building pyramids failed." );
+    message = QObject::tr( "Building pyramid overviews is not supported on this type of raster." );
+  }
+  QMessageBox::warning( 0, title, message );
+  QgsDebugMsg( res + " - " + message );
+}
+
+bool QgsRasterFileWriter::buildPartPyramids() const
+{
+  // The overviews of the part files are built in parallel and used by GDAL when the vrt is
+  // read at a lower resolution. Erdas overviews are switched on with a global GDAL option,
+  // which the threads would set and restore concurrently, and the other providers may not
+  // build pyramids from several threads; the vrt overviews are built for them.
+  return mTiledMode && mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes &&
+         mOutputProviderKey == "gdal" && mPyramidsFormat != QgsRaster::PyramidsErdas &&
+         mPyramidsConfigOptions.isEmpty();
 }
 
 #if 0
@@ -861,7 +885,7 @@ bool QgsRasterFileWriter::writeVRT( const QString& file )
 
 QgsRasterDataProvider* QgsRasterFileWriter::createPartProvider( const QgsRectangle& extent, int nCols, int iterCols,
     int iterRows, int iterLeft, int iterTop, const QString& outputUrl, int fileIndex, int nBands, QGis::DataType type,
-    const QgsCoordinateReferenceSystem& crs )
+    const QgsCoordinateReferenceSystem& crs ) const
 {
   double mup = extent.width() / nCols;
   double mapLeft = extent.xMinimum() + iterLeft * mup;
@@ -936,7 +960,7 @@ void QgsRasterFileWriter::globalOutputParameters( const QgsRectangle& extent, in
   geoTransform[5] = -( extent.height() / nRows );
 }
 
-QString QgsRasterFileWriter::partFileName( int fileIndex )
+QString QgsRasterFileWriter::partFileName( int fileIndex ) const
 {
   // .tif for now
   QFileInfo outputInfo( mOutputUrl );
@@ -21,13 +21,17 @@
 #include "qgsrectangle.h"
 #include <QDomDocument>
 #include <QDomElement>
+#include <QRect>
 #include <QString>
 
 class QProgressDialog;
-class QgsRasterIterator;
 
 /** \ingroup core
  * The raster file writer which allows you to save a raster to a new file.
+ *
+ * The parts of the output are read (and converted) in several threads, each with its
+ * own copy of the pipe, and written in order. In tiled mode the part files and their
+ * pyramids are written by the threads too.
  */
 class CORE_EXPORT QgsRasterFileWriter
 {
@@ -95,13 +99,42 @@ class CORE_EXPORT QgsRasterFileWriter
     QStringList pyramidsConfigOptions() const { return mPyramidsConfigOptions; }
 
   private:
+    //! Parameters of one part of the output, processed in a worker thread
+    struct PartJob
+    {
+      //! pipe used only by this job while it runs
+      QgsRasterPipe* pipe;
+      //! part number (the part file index in tiled mode)
+      int index;
+      //! part in output pixels
+      QRect rect;
+      QgsRectangle outputExtent;
+      int nCols;
+      int nRows;
+      //! number of output bands (4 in image mode)
+      int nBands;
+      QGis::DataType destDataType;
+      QList<double> destNoDataValueList;
+      QgsCoordinateReferenceSystem crs;
+    };
+
+    //! Result of a part job
+    struct PartResult
+    {
+      //! false if the part could not be read or its file could not be created
+      bool ok;
+      //! output bands of the part, empty in tiled mode (the part file is written)
+      QList<QgsRasterBlock*> blocks;
+      //! null or the error returned by the provider when building the pyramids of the part file
+      QString pyramidsError;
+    };
+
     QgsRasterFileWriter(); //forbidden
-    WriterError writeDataRaster( const QgsRasterPipe* pipe, QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent,
+    WriterError writeDataRaster( const QgsRasterPipe* pipe, int nCols, int nRows, const QgsRectangle& outputExtent,
                                  const QgsCoordinateReferenceSystem& crs, QProgressDialog* progressDialog = 0 );
 
     // Helper method used by previous one
     WriterError writeDataRaster( const QgsRasterPipe* pipe,
-                                 QgsRasterIterator* iter,
                                  int nCols, int nRows,
                                  const QgsRectangle& outputExtent,
                                  const QgsCoordinateReferenceSystem& crs,
@@ -111,9 +144,24 @@ class CORE_EXPORT QgsRasterFileWriter
                                  QgsRasterDataProvider* destProvider,
                                  QProgressDialog* progressDialog );
 
-    WriterError writeImageRaster( QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent,
+    WriterError writeImageRaster( const QgsRasterPipe* pipe, int nCols, int nRows, const QgsRectangle& outputExtent,
                                   const QgsCoordinateReferenceSystem& crs, QProgressDialog* progressDialog = 0 );
 
+    /** Read all the parts of the output in parallel and write them in order, then write
+     *  the vrt (tiled mode) and build the pyramids
+     *  @param pipe source pipe, copied for each additional thread
+     *  @param job parameters common to all the parts
+     *  @param destProvider output provider (single-file mode) or 0 (tiled mode)
+     *  @param progressDialog dialog to show progress in, or 0
+     */
+    WriterError writeParts( const QgsRasterPipe* pipe, const PartJob& job, QgsRasterDataProvider* destProvider, QProgressDialog* progressDialog );
+
+    /** Read one part with the pipe of the job, convert it to the destination data type
+     *  (or split the colors to RGBA bands in image mode). In tiled mode the part file is
+     *  written and its pyramids are built. Called from worker threads.
+     */
+    PartResult processPart( const PartJob& job ) const;
+
     /** \brief Initialize vrt member variables
      *  @param xSize width of vrt
      *  @param ySize height of vrt
@@ -129,12 +177,18 @@ class CORE_EXPORT QgsRasterFileWriter
     //add file entry to vrt
     void addToVRT( const QString& filename, int band, int xSize, int ySize, int xOffset, int yOffset );
     void buildPyramids( const QString& filename );
+    //! build the pyramids of a file, returns null on success or the error of the provider
+    QString createPyramids( const QString& filename ) const;
+    //! show the error returned by the provider when building pyramids
+    static void pyramidsError( const QString& res );
+    //! whether the pyramids of the part files are built by the worker threads (tiled mode)
+    bool buildPartPyramids() const;
 
     /**Create provider and datasource for a part image (vrt mode)*/
     QgsRasterDataProvider* createPartProvider( const QgsRectangle& extent, int nCols, int iterCols, int iterRows,
         int iterLeft, int iterTop,
         const QString& outputUrl, int fileIndex, int nBands, QGis::DataType type,
-        const QgsCoordinateReferenceSystem& crs );
+        const QgsCoordinateReferenceSystem& crs ) const;
 
     /** \brief Init VRT (for tiled mode) or create global output provider (single-file mode)
      *  @param nCols number of tile columns
@@ -154,7 +208,7 @@ class CORE_EXPORT QgsRasterFileWriter
     /**Calculate nRows, geotransform and pixel size for output*/
     void globalOutputParameters( const QgsRectangle& extent, int nCols, int& nRows, double* geoTransform, double& pixelSize );
 
-    QString partFileName( int fileIndex );
+    QString partFileName( int fileIndex ) const;
     QString vrtFileName();
 
     Mode mMode;
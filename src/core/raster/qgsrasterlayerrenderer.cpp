@@ -15,16 +15,103 @@
 
 #include "qgsrasterlayerrenderer.h"
 
+#include "qgsapplication.h"
 #include "qgsmessagelog.h"
 #include "qgsrasterdrawer.h"
 #include "qgsrasteriterator.h"
 #include "qgsrasterlayer.h"
 
+#include <QMutex>
+#include <QQueue>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+//! width and height of the tiles read in parallel (in output pixels)
+static const int RASTER_TILE_SIZE = 512;
+
+//! tiles shared by the reading threads and the drawing thread
+struct RasterTileQueue
+{
+  QMutex mutex;
+  //! signalled when a block was read
+  QWaitCondition blockRead;
+  //! signalled when a block was drawn
+  QWaitCondition blockDrawn;
+
+  QList<QRect> tiles;
+  int nextTile;
+  //! blocks read and not drawn yet
+  QQueue< QPair<QRect, QgsRasterBlock*> > blocks;
+  //! tiles being read plus blocks waiting in the queue
+  int tilesInFlight;
+  int maxTilesInFlight;
+  //! tiles being read by the reader threads
+  int tilesReading;
+};
+
+//! reads a tile of the viewport through the pipe
+static QgsRasterBlock* readRasterTile( QgsRasterPipe* pipe, const QRect& tile, const QgsRasterViewPort* viewPort )
+{
+  const QgsRectangle& extent = viewPort->mDrawnExtent;
+  QgsRectangle tileExtent( extent.xMinimum() + tile.left() / ( double )viewPort->mWidth * extent.width(),
+                           extent.yMaximum() - ( tile.top() + tile.height() ) / ( double )viewPort->mHeight * extent.height(),
+                           extent.xMinimum() + ( tile.left() + tile.width() ) / ( double )viewPort->mWidth * extent.width(),
+                           extent.yMaximum() - tile.top() / ( double )viewPort->mHeight * extent.height() );
+
+  // last pipe filter has only 1 band
+  return pipe->last()->block( 1, tileExtent, tile.width(), tile.height() );
+}
+
+/** Reads the tiles of the viewport through its own copy of the pipe and queues them for drawing */
+class QgsRasterTileReader : public QRunnable
+{
+  public:
+    QgsRasterTileReader( QgsRasterPipe* pipe, RasterTileQueue* queue, const QgsRasterViewPort* viewPort, const QgsRenderContext* context )
+        : mPipe( pipe ), mQueue( queue ), mViewPort( viewPort ), mContext( context ) {}
+
+    void run()
+    {
+      while ( true )
+      {
+        QRect tile;
+        {
+          QMutexLocker locker( &mQueue->mutex );
+          while ( mQueue->tilesInFlight >= mQueue->maxTilesInFlight )
+            mQueue->blockDrawn.wait( &mQueue->mutex );
+
+          // the remaining tiles are not read if the rendering was stopped
+          if ( mContext->renderingStopped() || mQueue->nextTile >= mQueue->tiles.size() )
+            return;
+
+          tile = mQueue->tiles[mQueue->nextTile++];
+          mQueue->tilesInFlight++;
+          mQueue->tilesReading++;
+        }
+
+        QgsRasterBlock* block = readRasterTile( mPipe, tile, mViewPort );
+
+        QMutexLocker locker( &mQueue->mutex );
+        mQueue->blocks.enqueue( qMakePair( tile, block ) );
+        mQueue->tilesReading--;
+        mQueue->blockRead.wakeAll();
+      }
+    }
+
+  private:
+    QgsRasterPipe* mPipe;
+    RasterTileQueue* mQueue;
+    const QgsRasterViewPort* mViewPort;
+    const QgsRenderContext* mContext;
+};
+
 
 QgsRasterLayerRenderer::QgsRasterLayerRenderer( QgsRasterLayer* layer, QgsRenderContext& rendererContext )
     : QgsMapLayerRenderer( layer->id() )
     , mRasterViewPort( 0 )
     , mPipe( 0 )
+    , mContext( rendererContext )
 {
 
   mPainter = rendererContext.painter();
@@ -206,12 +293,112 @@ bool QgsRasterLayerRenderer::render()
     projector->setCRS( mRasterViewPort->mSrcCRS, mRasterViewPort->mDestCRS );
   }
 
-  // Drawer to pipe?
-  QgsRasterIterator iterator( mPipe->last() );
-  QgsRasterDrawer drawer( &iterator );
-  drawer.draw( mPainter, mRasterViewPort, mMapToPixel );
+  if ( !renderTiles() )
+  {
+    // Drawer to pipe?
+    QgsRasterIterator iterator( mPipe->last() );
+    QgsRasterDrawer drawer( &iterator );
+    drawer.draw( mPainter, mRasterViewPort, mMapToPixel );
+  }
 
   QgsDebugMsg( QString( "total raster draw time (ms):     %1" ).arg( time.elapsed(), 5 ) );
 
   return true;
 }
+
+bool QgsRasterLayerRenderer::renderTiles()
+{
+  int cols = ( mRasterViewPort->mWidth + RASTER_TILE_SIZE - 1 ) / RASTER_TILE_SIZE;
+  int rows = ( mRasterViewPort->mHeight + RASTER_TILE_SIZE - 1 ) / RASTER_TILE_SIZE;
+  int maxThreads = QgsApplication::maxThreads() > 0 ? QgsApplication::maxThreads() : QThread::idealThreadCount();
+  int threadCount = qMin( maxThreads, cols * rows );
+
+  // Only local files are read in parallel, other providers (e.g. WMS) would
+  // send a request for each tile from each copy of the pipe.
+  if ( threadCount < 2 || !mPipe->provider() || mPipe->provider()->name() != "gdal" )
+    return false;
+
+  QgsDebugMsg( QString( "reading %1x%2 tiles in %3 threads" ).arg( cols ).arg( rows ).arg( threadCount ) );
+
+  // the tiles are read in row order and drawn as soon as they are read,
+  // at most a few tiles per thread are held in memory
+  RasterTileQueue queue;
+  QRect viewPortRect( 0, 0, mRasterViewPort->mWidth, mRasterViewPort->mHeight );
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int col = 0; col < cols; ++col )
+    {
+      QRect tile( col * RASTER_TILE_SIZE, row * RASTER_TILE_SIZE, RASTER_TILE_SIZE, RASTER_TILE_SIZE );
+      queue.tiles << tile.intersected( viewPortRect );
+    }
+  }
+  queue.nextTile = 0;
+  queue.tilesInFlight = 0;
+  queue.maxTilesInFlight = 2 * threadCount;
+  queue.tilesReading = 0;
+
+  // This thread reads tiles with the layer's pipe as well, the other readers get their own
+  // copy of the pipe (with its own provider). They run in a pool of their own, because the
+  // layer renderers themselves may occupy all threads of the global pool.
+  QList<QgsRasterPipe*> pipes;
+  QThreadPool pool;
+  pool.setMaxThreadCount( threadCount - 1 );
+  for ( int t = 1; t < threadCount; ++t )
+  {
+    pipes << new QgsRasterPipe( *mPipe );
+    pool.start( new QgsRasterTileReader( pipes.last(), &queue, mRasterViewPort, &mContext ) );
+  }
+
+  // the painter is used only from this thread
+  QgsRasterDrawer drawer( 0 );
+  while ( true )
+  {
+    QRect tile;
+    QgsRasterBlock* block = 0;
+    bool readTile = false;
+    {
+      QMutexLocker locker( &queue.mutex );
+      while ( queue.blocks.isEmpty() )
+      {
+        // take the next tile rather than wait for readers which have not started yet
+        if ( !mContext.renderingStopped() && queue.nextTile < queue.tiles.size() && queue.tilesInFlight < queue.maxTilesInFlight )
+        {
+          tile = queue.tiles[queue.nextTile++];
+          queue.tilesInFlight++;
+          readTile = true;
+          break;
+        }
+
+        if ( queue.tilesReading == 0 )
+          break;
+
+        queue.blockRead.wait( &queue.mutex );
+      }
+
+      if ( !readTile )
+      {
+        if ( queue.blocks.isEmpty() )
+          break;
+
+        QPair<QRect, QgsRasterBlock*> tileBlock = queue.blocks.dequeue();
+        tile = tileBlock.first;
+        block = tileBlock.second;
+      }
+    }
+
+    if ( readTile )
+      block = readRasterTile( mPipe, tile, mRasterViewPort );
+
+    drawer.drawBlock( mPainter, mRasterViewPort, block, tile.left(), tile.top(), mMapToPixel );
+    delete block;
+
+    QMutexLocker locker( &queue.mutex );
+    queue.tilesInFlight--;
+    queue.blockDrawn.wakeAll();
+  }
+
+  pool.waitForDone();
+  qDeleteAll( pipes );
+
+  return true;
+}
@@ -40,12 +40,16 @@ class QgsRasterLayerRenderer : public QgsMapLayerRenderer
     virtual bool render();
 
   protected:
+    //! read the viewport in tiles in several threads, each with its own copy of the pipe
+    bool renderTiles();
 
     QPainter* mPainter;
     const QgsMapToPixel* mMapToPixel;
     QgsRasterViewPort* mRasterViewPort;
 
     QgsRasterPipe* mPipe;
+
+    QgsRenderContext& mContext;
 };
 
 #endif // QGSRASTERLAYERRENDERER_H
@@ -0,0 +1,245 @@
+/***************************************************************************
+                         qgsrasterresampler.cpp
+                         ----------------------
+    begin                : October 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterresampler.h"
+
+#include <QFuture>
+#include <QImage>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentRun>
+#include <cmath>
+
+// the weights are fixed point numbers with this number of fractional bits
+static const int WEIGHT_BITS = 14;
+// fractional bits kept in the values filtered by rows
+static const int EXTRA_BITS = 7;
+// minimal number of destination rows resampled by a thread
+static const int MIN_BAND_ROWS = 64;
+
+// byte of the alpha channel in a pixel of ARGB32 image data
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+static const int ALPHA_BYTE = 3;
+#else
+static const int ALPHA_BYTE = 0;
+#endif
+
+// Source pixels contributing to each destination pixel along one axis. The
+// contributions of the pixels outside of the source are added to the edge pixels,
+// so the source pixels of a destination pixel are consecutive.
+struct FilterTaps
+{
+  QVector<int> first;   // first source pixel
+  QVector<int> count;   // number of source pixels
+  QVector<int> offset;  // offset of the first weight in weights
+  QVector<int> weights; // fixed point, the sum for a destination pixel is 1 << WEIGHT_BITS
+};
+
+static FilterTaps filterTaps( int srcSize, int dstSize, QgsRasterResampler::Kernel kernel, double radius )
+{
+  FilterTaps taps;
+  taps.first.resize( dstSize );
+  taps.count.resize( dstSize );
+  taps.offset.resize( dstSize );
+
+  double scale = ( double ) srcSize / dstSize;
+  double stretch = qMax( scale, 1.0 );
+  double support = radius * stretch;
+
+  QVector<double> weights;
+  for ( int dst = 0; dst < dstSize; ++dst )
+  {
+    // position of the destination pixel center in source pixels
+    double center = ( dst + 0.5 ) * scale - 0.5;
+    int left = ( int ) floor( center - support ) + 1;
+    int right = ( int ) ceil( center + support ) - 1;
+    if ( right < left )
+    {
+      left = right = qRound( center );
+    }
+
+    int first = qBound( 0, left, srcSize - 1 );
+    int last = qBound( 0, right, srcSize - 1 );
+    weights.fill( 0.0, last - first + 1 );
+    double sum = 0;
+    for ( int i = left; i <= right; ++i )
+    {
+      double w = kernel(( i - center ) / stretch );
+      weights[ qBound( 0, i, srcSize - 1 ) - first ] += w;
+      sum += w;
+    }
+    if ( sum == 0 )
+    {
+      weights.fill( 0.0 );
+      weights[ qBound( 0, qRound( center ), srcSize - 1 ) - first ] = 1;
+      sum = 1;
+    }
+
+    // the rounding error goes to the largest weight
+    int fixedSum = 0;
+    int largest = 0;
+    taps.offset[dst] = taps.weights.size();
+    for ( int i = 0; i < weights.size(); ++i )
+    {
+      int w = qRound( weights[i] / sum * ( 1 << WEIGHT_BITS ) );
+      taps.weights << w;
+      fixedSum += w;
+      if ( qAbs( w ) > qAbs( taps.weights[ taps.offset[dst] + largest ] ) )
+        largest = i;
+    }
+    taps.weights[ taps.offset[dst] + largest ] += ( 1 << WEIGHT_BITS ) - fixedSum;
+
+    taps.first[dst] = first;
+    taps.count[dst] = weights.size();
+  }
+  return taps;
+}
+
+// a band of destination rows, resampled in one thread
+struct ResampleBand
+{
+  const uchar* srcBits;
+  int srcBytesPerLine;
+  uchar* dstBits;
+  int dstBytesPerLine;
+  int dstWidth;
+  int firstRow;
+  int lastRow;
+  const FilterTaps* xTaps;
+  const FilterTaps* yTaps;
+};
+
+static void resampleBand( const ResampleBand& band )
+{
+  const FilterTaps& xTaps = *band.xTaps;
+  const FilterTaps& yTaps = *band.yTaps;
+  int values = band.dstWidth * 4;
+
+  // the source rows used by the band (the taps move down with the rows)
+  int firstSrcRow = yTaps.first[ band.firstRow ];
+  int lastSrcRow = yTaps.first[ band.lastRow ] + yTaps.count[ band.lastRow ] - 1;
+
+  // filter the source rows horizontally, the channels are processed alike
+  // whatever their order in the pixel
+  QVector<int> rows(( lastSrcRow - firstSrcRow + 1 ) * values );
+  int* out = rows.data();
+  const int shift = WEIGHT_BITS - EXTRA_BITS;
+  const int round = 1 << ( shift - 1 );
+  for ( int srcRow = firstSrcRow; srcRow <= lastSrcRow; ++srcRow )
+  {
+    const uchar* line = band.srcBits + srcRow * band.srcBytesPerLine;
+    for ( int x = 0; x < band.dstWidth; ++x )
+    {
+      const uchar* px = line + xTaps.first[x] * 4;
+      const int* w = xTaps.weights.constData() + xTaps.offset[x];
+      int count = xTaps.count[x];
+      int c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+      for ( int k = 0; k < count; ++k, px += 4 )
+      {
+        c0 += w[k] * px[0];
+        c1 += w[k] * px[1];
+        c2 += w[k] * px[2];
+        c3 += w[k] * px[3];
+      }
+      out[0] = ( c0 + round ) >> shift;
+      out[1] = ( c1 + round ) >> shift;
+      out[2] = ( c2 + round ) >> shift;
+      out[3] = ( c3 + round ) >> shift;
+      out += 4;
+    }
+  }
+
+  // filter the columns, one destination row at a time
+  QVector<int> sums( values );
+  int* acc = sums.data();
+  const int finalShift = WEIGHT_BITS + EXTRA_BITS;
+  const int finalRound = 1 << ( finalShift - 1 );
+  for ( int row = band.firstRow; row <= band.lastRow; ++row )
+  {
+    const int* w = yTaps.weights.constData() + yTaps.offset[row];
+    int count = yTaps.count[row];
+
+    const int* in = rows.constData() + ( yTaps.first[row] - firstSrcRow ) * values;
+    for ( int i = 0; i < values; ++i )
+      acc[i] = finalRound + w[0] * in[i];
+    for ( int k = 1; k < count; ++k )
+    {
+      in += values;
+      for ( int i = 0; i < values; ++i )
+        acc[i] += w[k] * in[i];
+    }
+
+    uchar* dst = band.dstBits + row * band.dstBytesPerLine;
+    for ( int i = 0; i < values; ++i )
+      dst[i] = qBound( 0, acc[i] >> finalShift, 255 );
+
+    // the overshoot of the filter must not make the colors exceed the alpha
+    for ( uchar* px = dst; px < dst + values; px += 4 )
+    {
+      uchar alpha = px[ALPHA_BYTE];
+      for ( int c = 0; c < 4; ++c )
+        px[c] = qMin( px[c], alpha );
+    }
+  }
+}
+
+void QgsRasterResampler::resampleSeparable( const QImage& srcImage, QImage& dstImage, Kernel kernel, double radius )
+{
+  int dstWidth = dstImage.width();
+  int dstHeight = dstImage.height();
+  if ( srcImage.isNull() || dstWidth < 1 || dstHeight < 1 )
+  {
+    return;
+  }
+
+  QImage src = srcImage.format() == QImage::Format_ARGB32_Premultiplied ? srcImage : srcImage.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+  if ( dstImage.format() != QImage::Format_ARGB32_Premultiplied )
+  {
+    dstImage = QImage( dstWidth, dstHeight, QImage::Format_ARGB32_Premultiplied );
+  }
+
+  FilterTaps xTaps = filterTaps( src.width(), dstWidth, kernel, radius );
+  FilterTaps yTaps = filterTaps( src.height(), dstHeight, kernel, radius );
+
+  ResampleBand band;
+  band.srcBits = src.constBits();
+  band.srcBytesPerLine = src.bytesPerLine();
+  band.dstBits = dstImage.bits(); // detaches the image before the threads write to it
+  band.dstBytesPerLine = dstImage.bytesPerLine();
+  band.dstWidth = dstWidth;
+  band.xTaps = &xTaps;
+  band.yTaps = &yTaps;
+
+  int bandCount = qBound( 1, qMin( QThread::idealThreadCount(), dstHeight / MIN_BAND_ROWS ), dstHeight );
+  int bandRows = ( dstHeight + bandCount - 1 ) / bandCount;
+
+  // the last band is resampled in this thread
+  QList< QFuture<void> > futures;
+  for ( int firstRow = 0; firstRow < dstHeight; firstRow += bandRows )
+  {
+    band.firstRow = firstRow;
+    band.lastRow = qMin( firstRow + bandRows, dstHeight ) - 1;
+    if ( band.lastRow == dstHeight - 1 )
+      resampleBand( band );
+    else
+      futures << QtConcurrent::run( resampleBand, band );
+  }
+
+  for ( int i = 0; i < futures.size(); ++i )
+  {
+    futures[i].waitForFinished();
+  }
+}
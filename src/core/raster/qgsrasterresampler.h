@@ -25,13 +25,29 @@ class QImage;
 /** \ingroup core
   * Interface for resampling rasters (e.g. to have a smoother appearance)
   */
-class QgsRasterResampler
+class CORE_EXPORT QgsRasterResampler
 {
   public:
     virtual ~QgsRasterResampler() {}
     virtual void resample( const QImage& srcImage, QImage& dstImage ) = 0;
     virtual QString type() const = 0;
     virtual QgsRasterResampler * clone() const = 0;
+
+    //! Filter function: weight of a source pixel at a distance (in source pixels) from the sampled position
+    typedef double ( *Kernel )( double distance );
+
+  protected:
+    /** Resample a premultiplied ARGB32 image with a separable filter. The rows are filtered
+     *  first, then the columns, on the raw pixels with fixed point weights. Bands of
+     *  destination rows are resampled in parallel.
+     *  @param srcImage source image, converted to ARGB32_Premultiplied if necessary
+     *  @param dstImage destination, its size is kept and its format becomes ARGB32_Premultiplied
+     *  @param kernel filter function, 0 outside of [-radius, radius]
+     *  @param radius support of the kernel; it is widened by the scale factor when zooming
+     *  out so that all the source pixels contribute
+     *  @note added in 2.8
+     */
+    static void resampleSeparable( const QImage& srcImage, QImage& dstImage, Kernel kernel, double radius );
 };
 
 #endif // QGSRASTERRESAMPLER_H
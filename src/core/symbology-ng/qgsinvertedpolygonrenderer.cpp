@@ -23,13 +23,89 @@
 #include "qgsvectorlayer.h"
 #include "qgssymbollayerv2.h"
 #include "qgsogcutils.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
 
 #include <QDomDocument>
 #include <QDomElement>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QtConcurrentRun>
+
+/** number of geometries unioned together in one background task */
+static const int UNION_BATCH_SIZE = 64;
+
+/** maximum memory used by cached inverted masks, in bytes */
+static const int MASK_CACHE_MAX_COST = 32 * 1024 * 1024;
+
+/** maximum number of views whose masks are looked up in the cache */
+static const int MASK_CACHE_MAX_VIEWS = 64;
+
+/**
+ * Cache of the final inverted masks, keyed by the view (extent and scale)
+ * and a digest of the geometries of a category.
+ * It is shared between all clones of a renderer, which can be used by
+ * several rendering jobs at the same time.
+ */
+class QgsInvertedPolygonMaskCache
+{
+  public:
+    QgsInvertedPolygonMaskCache() { mMasks.setMaxCost( MASK_CACHE_MAX_COST ); }
+
+    bool hasView( const QString& viewKey )
+    {
+      QMutexLocker locker( &mMutex );
+      // the views are kept in the order of their last use
+      if ( !mViews.removeOne( viewKey ) )
+        return false;
+      mViews.prepend( viewKey );
+      return true;
+    }
+
+    /** returns a copy of the cached mask, or 0 if there is none */
+    QgsGeometry* mask( const QString& key )
+    {
+      QMutexLocker locker( &mMutex );
+      QgsGeometry* g = mMasks.object( key );
+      return g ? new QgsGeometry( *g ) : 0;
+    }
+
+    void insert( const QString& viewKey, const QString& key, const QgsGeometry& mask )
+    {
+      QMutexLocker locker( &mMutex );
+      mMasks.insert( key, new QgsGeometry( mask ), mask.wkbSize() );
+      mViews.removeOne( viewKey );
+      mViews.prepend( viewKey );
+      while ( mViews.count() > MASK_CACHE_MAX_VIEWS )
+        mViews.removeLast();
+    }
+
+  private:
+    QMutex mMutex;
+    QCache<QString, QgsGeometry> mMasks;
+    QList<QString> mViews;
+};
+
+static QgsGeometry* unionGeometries( QList<QgsGeometry*> geometries )
+{
+  QList<QgsGeometry*> valid;
+  foreach ( QgsGeometry* g, geometries )
+  {
+    if ( g && g->asGeos() )
+      valid << g;
+  }
+  QgsGeometry* unioned = valid.isEmpty() ? 0 : QgsGeometry::unaryUnion( valid );
+  qDeleteAll( geometries );
+  return unioned;
+}
 
 QgsInvertedPolygonRenderer::QgsInvertedPolygonRenderer( const QgsFeatureRendererV2* subRenderer )
     : QgsFeatureRendererV2( "invertedPolygonRenderer" )
     , mPreprocessingEnabled( false )
+    , mIncrementalUnion( true )
+    , mSimplifyTolerance( 0 )
+    , mMaskCache( new QgsInvertedPolygonMaskCache )
 {
   if ( subRenderer )
   {
@@ -43,6 +119,7 @@ QgsInvertedPolygonRenderer::QgsInvertedPolygonRenderer( const QgsFeatureRenderer
 
 QgsInvertedPolygonRenderer::~QgsInvertedPolygonRenderer()
 {
+  clearCategories();
 }
 
 void QgsInvertedPolygonRenderer::setEmbeddedRenderer( const QgsFeatureRendererV2* subRenderer )
@@ -72,7 +149,7 @@ void QgsInvertedPolygonRenderer::startRender( QgsRenderContext& context, const Q
   // first call start render on the sub renderer
   mSubRenderer->startRender( context, fields );
 
-  mFeaturesCategories.clear();
+  clearCategories();
   mSymbolCategories.clear();
   mFeatureDecorations.clear();
   mFields = fields;
@@ -118,6 +195,91 @@ void QgsInvertedPolygonRenderer::startRender( QgsRenderContext& context, const Q
 
   mExtentPolygon.clear();
   mExtentPolygon.append( exteriorRing );
+
+  mSimplifyTolerance = 0;
+  if ( mPreprocessingEnabled && context.vectorSimplifyMethod().simplifyHints().testFlag( QgsVectorSimplifyMethod::GeometrySimplification ) )
+  {
+    // geometries are in destination CRS here, so the tolerance is expressed in map units of the destination
+    mSimplifyTolerance = context.vectorSimplifyMethod().threshold() * mtp.mapUnitsPerPixel();
+  }
+
+  // when the mask of this view may already be cached, collect geometries
+  // and only compute the union in stopRender() if the checksum does not match
+  mCacheKey = QString( "%1|%2|%3" ).arg( mContext.extent().toString( 8 ) ).arg( context.rendererScale(), 0, 'g', 10 ).arg( mSimplifyTolerance, 0, 'g', 10 );
+  mIncrementalUnion = !mMaskCache->hasView( mCacheKey );
+}
+
+void QgsInvertedPolygonRenderer::clearCategories()
+{
+  for ( FeatureCategoryVector::iterator cit = mFeaturesCategories.begin(); cit != mFeaturesCategories.end(); ++cit )
+  {
+    qDeleteAll( cit->geometries );
+    foreach ( PartialUnion p, cit->partials )
+    {
+      delete p.future.result();
+    }
+  }
+  mFeaturesCategories.clear();
+}
+
+void QgsInvertedPolygonRenderer::submitBatch( CombinedFeature& cFeat )
+{
+  if ( cFeat.geometries.isEmpty() )
+    return;
+
+  PartialUnion p;
+  p.level = 0;
+  p.future = QtConcurrent::run( unionGeometries, cFeat.geometries );
+  cFeat.geometries.clear();
+  cFeat.partials.append( p );
+
+  mergePartials( cFeat );
+}
+
+void QgsInvertedPolygonRenderer::mergePartials( CombinedFeature& cFeat )
+{
+  // merge unions of the same level, like a binary counter, so that
+  // the geometries unioned together always have comparable sizes.
+  // Unfinished unions stay on the stack, they are merged by a later batch
+  // or by collectUnion(), so no task of the pool blocks on another one
+  int n = cFeat.partials.count();
+  while ( n >= 2 && cFeat.partials[n - 1].level == cFeat.partials[n - 2].level
+          && cFeat.partials[n - 1].future.isFinished() && cFeat.partials[n - 2].future.isFinished() )
+  {
+    PartialUnion b = cFeat.partials.takeLast();
+    PartialUnion a = cFeat.partials.takeLast();
+    PartialUnion p;
+    p.level = a.level + 1;
+    p.future = QtConcurrent::run( unionGeometries, QList<QgsGeometry*>() << a.future.result() << b.future.result() );
+    cFeat.partials.append( p );
+    n = cFeat.partials.count();
+  }
+}
+
+QString QgsInvertedPolygonRenderer::maskKey( const CombinedFeature& cFeat ) const
+{
+  // the digests are sorted, the order of the features does not matter
+  QList<QByteArray> digests = cFeat.digests;
+  qSort( digests );
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  foreach ( const QByteArray& digest, digests )
+  {
+    hash.addData( digest );
+  }
+  return QString( "%1|%2|%3" ).arg( mCacheKey ).arg( digests.count() ).arg( QString( hash.result().toHex() ) );
+}
+
+QgsGeometry* QgsInvertedPolygonRenderer::collectUnion( CombinedFeature& cFeat )
+{
+  submitBatch( cFeat );
+
+  QList<QgsGeometry*> parts;
+  foreach ( PartialUnion p, cFeat.partials )
+  {
+    parts << p.future.result();
+  }
+  cFeat.partials.clear();
+  return unionGeometries( parts );
 }
 
 bool QgsInvertedPolygonRenderer::renderFeature( QgsFeature& feature, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker )
@@ -206,9 +368,29 @@ bool QgsInvertedPolygonRenderer::renderFeature( QgsFeature& feature, QgsRenderCo
   if ( !geom )
     return false; // do not let invalid geometries sneak in!
 
+  if ( mPreprocessingEnabled )
+  {
+    if ( mSimplifyTolerance > 0 )
+    {
+      QgsMapToPixelSimplifier::simplifyGeometry( geom.data(), QgsMapToPixelSimplifier::SimplifyGeometry, mSimplifyTolerance );
+    }
+
+    const unsigned char* wkb = geom->asWkb();
+    if ( wkb )
+    {
+      cFeat.digests << QCryptographicHash::hash( QByteArray::fromRawData( reinterpret_cast<const char*>( wkb ), geom->wkbSize() ), QCryptographicHash::Md5 );
+    }
+  }
+
   // add the geometry to the list of geometries for this feature
   cFeat.geometries.append( geom.take() );
 
+  if ( mPreprocessingEnabled && mIncrementalUnion && cFeat.geometries.count() >= UNION_BATCH_SIZE )
+  {
+    // union this batch in the background while the next features are fetched
+    submitBatch( cFeat );
+  }
+
   return true;
 }
 
@@ -228,11 +410,30 @@ void QgsInvertedPolygonRenderer::stopRender( QgsRenderContext& context )
     QgsFeature feat = cit->feature; // just a copy, so that we do not accumulate geometries again
     if ( mPreprocessingEnabled )
     {
-      // compute the unary union on the polygons
-      QScopedPointer<QgsGeometry> unioned( QgsGeometry::unaryUnion( cit->geometries ) );
-      // compute the difference with the extent
-      QScopedPointer<QgsGeometry> rect( QgsGeometry::fromPolygon( mExtentPolygon ) );
-      QgsGeometry *final = rect->difference( const_cast<QgsGeometry*>( unioned.data() ) );
+      QString key = maskKey( *cit );
+      QgsGeometry *final = mIncrementalUnion ? 0 : mMaskCache->mask( key );
+      if ( !final )
+      {
+        if ( !mIncrementalUnion )
+        {
+          // cache miss: union what has been collected
+          QList<QgsGeometry*> collected = cit->geometries;
+          for ( int i = 0; i < collected.count(); i += UNION_BATCH_SIZE )
+          {
+            cit->geometries = collected.mid( i, UNION_BATCH_SIZE );
+            submitBatch( *cit );
+          }
+        }
+        // compute the unary union on the polygons
+        QScopedPointer<QgsGeometry> unioned( collectUnion( *cit ) );
+        // compute the difference with the extent
+        QScopedPointer<QgsGeometry> rect( QgsGeometry::fromPolygon( mExtentPolygon ) );
+        final = unioned ? rect->difference( unioned.data() ) : rect.take();
+        if ( final )
+        {
+          mMaskCache->insert( mCacheKey, key, *final );
+        }
+      }
       feat.setGeometry( final );
     }
     else
@@ -287,13 +488,6 @@ void QgsInvertedPolygonRenderer::stopRender( QgsRenderContext& context )
     if ( feat.geometry() )
       mSubRenderer->renderFeature( feat, mContext );
   }
-  for ( FeatureCategoryVector::iterator cit = mFeaturesCategories.begin(); cit != mFeaturesCategories.end(); ++cit )
-  {
-    foreach ( QgsGeometry* g, cit->geometries )
-    {
-      delete g;
-    }
-  }
 
   // when no features are visible, we still have to draw the exterior rectangle
   // warning: when sub renderers have more than one possible symbols,
@@ -314,6 +508,8 @@ void QgsInvertedPolygonRenderer::stopRender( QgsRenderContext& context )
   }
 
   mSubRenderer->stopRender( mContext );
+
+  clearCategories();
 }
 
 QString QgsInvertedPolygonRenderer::dump() const
@@ -337,6 +533,7 @@ QgsFeatureRendererV2* QgsInvertedPolygonRenderer::clone() const
     newRenderer = new QgsInvertedPolygonRenderer( mSubRenderer->clone() );
   }
   newRenderer->setPreprocessingEnabled( preprocessingEnabled() );
+  newRenderer->mMaskCache = mMaskCache;
   return newRenderer;
 }
 
@@ -22,6 +22,10 @@
 #include "qgsfeature.h"
 #include "qgsgeometry.h"
 #include <QScopedPointer>
+#include <QSharedPointer>
+#include <QFuture>
+
+class QgsInvertedPolygonMaskCache;
 
 /**
  * QgsInvertedPolygonRenderer is a polygon-only feature renderer used to
@@ -119,6 +123,8 @@ class CORE_EXPORT QgsInvertedPolygonRenderer : public QgsFeatureRendererV2
         When enabled, geometries will be merged with an union before being rendered.
         It allows fixing some rendering artefacts (when rendering overlapping polygons for instance).
         This will involve some CPU-demanding computations and is thus disabled by default.
+        The union is computed by batches in background threads while features are collected,
+        and the resulting mask is cached for the current extent and scale.
     */
     void setPreprocessingEnabled( bool enabled ) { mPreprocessingEnabled = enabled; }
 
@@ -137,11 +143,24 @@ class CORE_EXPORT QgsInvertedPolygonRenderer : public QgsFeatureRendererV2
     /** Embedded renderer */
     QScopedPointer<QgsFeatureRendererV2> mSubRenderer;
 
+    /** Union of a batch of geometries, computed in the background.
+     * The level is the depth in the binary merge tree, so that only unions of
+     * similar size are merged together. Unions are only merged once both are
+     * finished, so that the background tasks never wait for each other
+     */
+    struct PartialUnion
+    {
+      int level;
+      QFuture<QgsGeometry*> future;
+    };
+
     /** Structure where the reversed geometry is built during renderFeature */
     struct CombinedFeature
     {
-      QList<QgsGeometry*> geometries; //< list of geometries
+      QList<QgsGeometry*> geometries; //< list of geometries (pending batch when preprocessing)
       QgsFeature feature;             //< one feature (for attriute-based rendering)
+      QList<PartialUnion> partials;   //< stack of partial unions (preprocessing only)
+      QList<QByteArray> digests;      //< digests of the collected geometries (preprocessing only)
     };
     typedef QVector<CombinedFeature> FeatureCategoryVector;
     /** where features are stored, based on the index of their symbol category @see mSymbolCategories */
@@ -175,6 +194,32 @@ class CORE_EXPORT QgsInvertedPolygonRenderer : public QgsFeatureRendererV2
 
     /** whether to preprocess (merge) geometries before rendering*/
     bool mPreprocessingEnabled;
+
+    /** whether batches are unioned while features are collected.
+     * It is disabled when the mask cache may already hold the result for the current view,
+     * the union is then deferred to stopRender() and only computed on a cache miss
+     */
+    bool mIncrementalUnion;
+
+    /** tolerance used to simplify geometries before the union, 0 to disable simplification */
+    double mSimplifyTolerance;
+
+    /** key of the current view (extent and scale) in the mask cache */
+    QString mCacheKey;
+
+    /** cache of inverted masks, shared with the clones of this renderer */
+    QSharedPointer<QgsInvertedPolygonMaskCache> mMaskCache;
+
+    /** submits the pending batch of a category to the thread pool */
+    void submitBatch( CombinedFeature& cFeat );
+    /** submits the union of the finished partial unions of the same level */
+    void mergePartials( CombinedFeature& cFeat );
+    /** key of the mask of a category in the mask cache */
+    QString maskKey( const CombinedFeature& cFeat ) const;
+    /** waits for the partial unions of a category and returns their union */
+    QgsGeometry* collectUnion( CombinedFeature& cFeat );
+    /** deletes geometries collected or computed for all categories */
+    void clearCategories();
 };
 
 
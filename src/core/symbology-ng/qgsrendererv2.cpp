@@ -23,6 +23,7 @@
 #include "qgsrendererv2registry.h"
 
 #include "qgsrendercontext.h"
+#include "qgsapproximatetransform.h"
 #include "qgsclipper.h"
 #include "qgsgeometry.h"
 #include "qgsfeature.h"
@@ -47,7 +48,11 @@ const unsigned char* QgsFeatureRendererV2::_getPoint( QPointF& pt, QgsRenderCont
   if ( wkbType == QGis::WKBPoint25D )
     wkbPtr += sizeof( double );
 
-  if ( context.coordinateTransform() )
+  if ( context.approximateTransform() )
+  {
+    context.approximateTransform()->transformInPlace( x, y );
+  }
+  else if ( context.coordinateTransform() )
   {
     double z = 0; // dummy variable for coordiante transform
     context.coordinateTransform()->transformInPlace( x, y, z );
@@ -95,7 +100,11 @@ const unsigned char* QgsFeatureRendererV2::_getLineString( QPolygonF& pts, QgsRe
   }
 
   //transform the QPolygonF to screen coordinates
-  if ( ct )
+  if ( context.approximateTransform() )
+  {
+    context.approximateTransform()->transformPolygon( pts );
+  }
+  else if ( ct )
   {
     ct->transformPolygon( pts );
   }
@@ -156,7 +165,11 @@ const unsigned char* QgsFeatureRendererV2::_getPolygon( QPolygonF& pts, QList<QP
     if ( !context.extent().contains( ptsRect ) ) QgsClipper::trimPolygon( poly, clipRect );
 
     //transform the QPolygonF to screen coordinates
-    if ( ct )
+    if ( context.approximateTransform() )
+    {
+      context.approximateTransform()->transformPolygon( poly );
+    }
+    else if ( ct )
     {
       ct->transformPolygon( poly );
     }
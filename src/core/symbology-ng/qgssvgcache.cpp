@@ -35,14 +35,16 @@
 #include <QFileInfo>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QtConcurrentRun>
 
 QgsSvgCacheEntry::QgsSvgCacheEntry(): file( QString() ), size( 0.0 ), outlineWidth( 0 ), widthScaleFactor( 1.0 ), rasterScaleFactor( 1.0 ), fill( Qt::black ),
-    outline( Qt::black ), image( 0 ), picture( 0 )
+    outline( Qt::black ), image( 0 ), picture( 0 ), nextEntry( 0 ), previousEntry( 0 ), busy( false ), users( 0 )
 {
 }
 
 QgsSvgCacheEntry::QgsSvgCacheEntry( const QString& f, double s, double ow, double wsf, double rsf, const QColor& fi, const QColor& ou ): file( f ), size( s ), outlineWidth( ow ),
-    widthScaleFactor( wsf ), rasterScaleFactor( rsf ), fill( fi ), outline( ou ), image( 0 ), picture( 0 )
+    widthScaleFactor( wsf ), rasterScaleFactor( rsf ), fill( fi ), outline( ou ), image( 0 ), picture( 0 ), nextEntry( 0 ), previousEntry( 0 ),
+    busy( false ), users( 0 )
 {
 }
 
@@ -92,12 +94,22 @@ QgsSvgCache::QgsSvgCache( QObject *parent )
     , mTotalSize( 0 )
     , mLeastRecentEntry( 0 )
     , mMostRecentEntry( 0 )
+    , mHits( 0 )
+    , mMisses( 0 )
+    , mPendingJobs( 0 )
 {
   mMissingSvg = QString( "<svg width='10' height='10'><text x='5' y='10' font-size='10' text-anchor='middle'>?</text></svg>" ).toAscii();
 }
 
 QgsSvgCache::~QgsSvgCache()
 {
+  mMutex.lock();
+  while ( mPendingJobs > 0 )
+  {
+    mEntryFinished.wait( &mMutex );
+  }
+  mMutex.unlock();
+
   QMultiHash< QString, QgsSvgCacheEntry* >::iterator it = mEntryLookup.begin();
   for ( ; it != mEntryLookup.end(); ++it )
   {
@@ -106,19 +118,32 @@ QgsSvgCache::~QgsSvgCache()
 }
 
 
-const QImage& QgsSvgCache::svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
-                                       double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache )
+QImage QgsSvgCache::svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                                double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache )
 {
   QMutexLocker locker( &mMutex );
 
   fitsInCache = true;
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
+  acquireEntry( currentEntry );
 
   //if current entry image is 0: cache image for entry
   // checks to see if image will fit into cache
   //update stats for memory usage
   if ( !currentEntry->image )
   {
+    ++mMisses;
+
+    //load and render the svg without the lock, other threads wait for this entry only
+    currentEntry->busy = true;
+    int previousDataSize = currentEntry->dataSize();
+    locker.unlock();
+
+    if ( currentEntry->svgContent.isEmpty() )
+    {
+      replaceParamsAndCacheSvg( currentEntry );
+    }
+
     QSvgRenderer r( currentEntry->svgContent );
     double hwRatio = 1.0;
     if ( r.viewBoxF().width() > 0 )
@@ -145,28 +170,171 @@ const QImage& QgsSvgCache::svgAsImage( const QString& file, double size, const Q
     {
       cacheImage( currentEntry );
     }
-    trimToMaximumSize();
+
+    locker.relock();
+    finishEntry( currentEntry, previousDataSize );
+  }
+  else
+  {
+    ++mHits;
   }
 
-  return *( currentEntry->image );
+  //entries too big for the cache only have a picture
+  QImage image;
+  if ( currentEntry->image )
+    image = *( currentEntry->image );
+  else
+    fitsInCache = false;
+
+  //the entry may be removed once it is released
+  trimToMaximumSize();
+  releaseEntry( currentEntry );
+
+  return image;
 }
 
-const QPicture& QgsSvgCache::svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
-    double widthScaleFactor, double rasterScaleFactor, bool forceVectorOutput )
+QPicture QgsSvgCache::svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                                    double widthScaleFactor, double rasterScaleFactor, bool forceVectorOutput )
 {
   QMutexLocker locker( &mMutex );
 
   QgsSvgCacheEntry* currentEntry = cacheEntry( file, size, fill, outline, outlineWidth, widthScaleFactor, rasterScaleFactor );
+  acquireEntry( currentEntry );
 
   //if current entry picture is 0: cache picture for entry
   //update stats for memory usage
   if ( !currentEntry->picture )
   {
+    ++mMisses;
+
+    currentEntry->busy = true;
+    int previousDataSize = currentEntry->dataSize();
+    locker.unlock();
+
+    if ( currentEntry->svgContent.isEmpty() )
+    {
+      replaceParamsAndCacheSvg( currentEntry );
+    }
     cachePicture( currentEntry, forceVectorOutput );
-    trimToMaximumSize();
+
+    locker.relock();
+    finishEntry( currentEntry, previousDataSize );
+  }
+  else
+  {
+    ++mHits;
+  }
+
+  QPicture picture = *( currentEntry->picture );
+
+  //the entry may be removed once it is released
+  trimToMaximumSize();
+  releaseEntry( currentEntry );
+
+  return picture;
+}
+
+void QgsSvgCache::prepareImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                                double widthScaleFactor, double rasterScaleFactor )
+{
+  //do not download remote files in a background thread
+  if ( file.contains( "://" ) && !file.startsWith( "file://", Qt::CaseInsensitive ) )
+  {
+    return;
+  }
+
+  QMutexLocker locker( &mMutex );
+
+  QList<QgsSvgCacheEntry*> entries = mEntryLookup.values( file );
+  QList<QgsSvgCacheEntry*>::const_iterator entryIt = entries.constBegin();
+  for ( ; entryIt != entries.constEnd(); ++entryIt )
+  {
+    QgsSvgCacheEntry* entry = *entryIt;
+    if ( qgsDoubleNear( entry->size, size ) && entry->fill == fill && entry->outline == outline &&
+         entry->outlineWidth == outlineWidth && entry->widthScaleFactor == widthScaleFactor && entry->rasterScaleFactor == rasterScaleFactor )
+    {
+      if ( entry->image || entry->picture || entry->busy )
+      {
+        return; // already cached, too big for an image or being rendered
+      }
+      break;
+    }
   }
 
-  return *( currentEntry->picture );
+  PrepareRequest request;
+  request.file = file;
+  request.size = size;
+  request.fill = fill;
+  request.outline = outline;
+  request.outlineWidth = outlineWidth;
+  request.widthScaleFactor = widthScaleFactor;
+  request.rasterScaleFactor = rasterScaleFactor;
+
+  ++mPendingJobs;
+  QtConcurrent::run( this, &QgsSvgCache::prepareImageJob, request );
+}
+
+void QgsSvgCache::prepareImageJob( PrepareRequest request )
+{
+  bool fitsInCache;
+  svgAsImage( request.file, request.size, request.fill, request.outline, request.outlineWidth,
+              request.widthScaleFactor, request.rasterScaleFactor, fitsInCache );
+
+  QMutexLocker locker( &mMutex );
+  --mPendingJobs;
+  mEntryFinished.wakeAll();
+}
+
+qint64 QgsSvgCache::cacheHits() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHits;
+}
+
+qint64 QgsSvgCache::cacheMisses() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMisses;
+}
+
+int QgsSvgCache::entryCount() const
+{
+  QMutexLocker locker( &mMutex );
+  return mEntryLookup.size();
+}
+
+long QgsSvgCache::totalSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return mTotalSize;
+}
+
+void QgsSvgCache::resetStatistics()
+{
+  QMutexLocker locker( &mMutex );
+  mHits = 0;
+  mMisses = 0;
+}
+
+void QgsSvgCache::acquireEntry( QgsSvgCacheEntry* entry )
+{
+  ++entry->users;
+  while ( entry->busy )
+  {
+    mEntryFinished.wait( &mMutex );
+  }
+}
+
+void QgsSvgCache::releaseEntry( QgsSvgCacheEntry* entry )
+{
+  --entry->users;
+}
+
+void QgsSvgCache::finishEntry( QgsSvgCacheEntry* entry, int previousDataSize )
+{
+  mTotalSize += entry->dataSize() - previousDataSize;
+  entry->busy = false;
+  mEntryFinished.wakeAll();
 }
 
 QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
@@ -177,7 +345,7 @@ QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, double size, cons
 
   QgsSvgCacheEntry* entry = new QgsSvgCacheEntry( path, size, outlineWidth, widthScaleFactor, rasterScaleFactor, fill, outline );
 
-  replaceParamsAndCacheSvg( entry );
+  //svg content is loaded later without holding the lock
 
   mEntryLookup.insert( file, entry );
 
@@ -197,7 +365,6 @@ QgsSvgCacheEntry* QgsSvgCache::insertSVG( const QString& file, double size, cons
     mMostRecentEntry = entry;
   }
 
-  trimToMaximumSize();
   return entry;
 }
 
@@ -236,7 +403,6 @@ void QgsSvgCache::replaceParamsAndCacheSvg( QgsSvgCacheEntry* entry )
   replaceElemParams( docElem, entry->fill, entry->outline, entry->outlineWidth );
 
   entry->svgContent = svgDoc.toByteArray();
-  mTotalSize += entry->svgContent.size();
 }
 
 QByteArray QgsSvgCache::getImageData( const QString &path ) const
@@ -400,7 +566,6 @@ void QgsSvgCache::cacheImage( QgsSvgCacheEntry* entry )
   }
 
   entry->image = image;
-  mTotalSize += ( image->width() * image->height() * 32 );
 }
 
 void QgsSvgCache::cachePicture( QgsSvgCacheEntry *entry, bool forceVectorOutput )
@@ -433,7 +598,6 @@ void QgsSvgCache::cachePicture( QgsSvgCacheEntry *entry, bool forceVectorOutput
   QPainter p( picture );
   r.render( &p, rect );
   entry->picture = picture;
-  mTotalSize += entry->picture->size();
 }
 
 QgsSvgCacheEntry* QgsSvgCache::cacheEntry( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
@@ -701,6 +865,12 @@ void QgsSvgCache::trimToMaximumSize()
     QgsSvgCacheEntry* bkEntry = entry;
     entry = entry->nextEntry;
 
+    //entries in use by other threads are kept
+    if ( bkEntry->busy || bkEntry->users > 0 )
+    {
+      continue;
+    }
+
     takeEntryFromList( bkEntry );
     mEntryLookup.remove( bkEntry->file, bkEntry );
     mTotalSize -= bkEntry->dataSize();
@@ -24,6 +24,7 @@
 #include <QMutex>
 #include <QString>
 #include <QUrl>
+#include <QWaitCondition>
 
 class QDomElement;
 class QImage;
@@ -61,6 +62,11 @@ class CORE_EXPORT QgsSvgCacheEntry
     QgsSvgCacheEntry* nextEntry;
     QgsSvgCacheEntry* previousEntry;
 
+    //! true while a thread loads or renders the entry without holding the cache lock (added in 2.8)
+    bool busy;
+    //! number of threads using or waiting for the entry, which must not be removed meanwhile (added in 2.8)
+    int users;
+
     /**Don't consider image, picture, last used timestamp for comparison*/
     bool operator==( const QgsSvgCacheEntry& other ) const;
     /**Return memory usage in bytes*/
@@ -69,7 +75,10 @@ class CORE_EXPORT QgsSvgCacheEntry
 
 /**A cache for images / pictures derived from svg files. This class supports parameter replacement in svg files
 according to the svg params specification (http://www.w3.org/TR/2009/WD-SVGParamPrimer-20090616/). Supported are
-the parameters 'fill-color', 'pen-color', 'outline-width', 'stroke-width'. E.g. <circle fill="param(fill-color red)" stroke="param(pen-color black)" stroke-width="param(outline-width 1)"*/
+the parameters 'fill-color', 'pen-color', 'outline-width', 'stroke-width'. E.g. <circle fill="param(fill-color red)" stroke="param(pen-color black)" stroke-width="param(outline-width 1)"
+
+The cache is thread safe. The lock is only held for lookups, SVG files are loaded and rendered without it, so that
+different entries may be rendered concurrently. Requests for an entry which is being rendered wait for that job.*/
 class CORE_EXPORT QgsSvgCache : public QObject
 {
     Q_OBJECT
@@ -87,10 +96,11 @@ class CORE_EXPORT QgsSvgCache : public QObject
      * @param outlineWidth width of outline
      * @param widthScaleFactor width scale factor
      * @param rasterScaleFactor raster scale factor
-     * @param fitsInCache
+     * @param fitsInCache set to false if the image is too big for the cache, a null image is returned then
+     * @note returns a (shallow) copy of the cached image since 2.8, the entry may be removed by other threads
      */
-    const QImage& svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
-                              double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache );
+    QImage svgAsImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                       double widthScaleFactor, double rasterScaleFactor, bool& fitsInCache );
     /** Get SVG  as QPicture&.
      * @param file Absolute or relative path to SVG file.
      * @param size size of cached image
@@ -100,9 +110,10 @@ class CORE_EXPORT QgsSvgCache : public QObject
      * @param widthScaleFactor width scale factor
      * @param rasterScaleFactor raster scale factor
      * @param forceVectorOutput
+     * @note returns a (shallow) copy of the cached picture since 2.8, the entry may be removed by other threads
      */
-    const QPicture& svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
-                                  double widthScaleFactor, double rasterScaleFactor, bool forceVectorOutput = false );
+    QPicture svgAsPicture( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                           double widthScaleFactor, double rasterScaleFactor, bool forceVectorOutput = false );
 
     /**Tests if an svg file contains parameters for fill, outline color, outline width. If yes, possible default values are returned. If there are several
       default values in the svg file, only the first one is considered*/
@@ -112,6 +123,25 @@ class CORE_EXPORT QgsSvgCache : public QObject
     /**Get image data*/
     QByteArray getImageData( const QString &path ) const;
 
+    /** Render the SVG image for the given parameters in a background thread, unless it is already cached.
+     * Later calls to svgAsImage() with the same parameters use the prepared image (or wait for it if it is not finished yet).
+     * Remote SVG files are not prepared.
+     * @note added in 2.8
+     */
+    void prepareImage( const QString& file, double size, const QColor& fill, const QColor& outline, double outlineWidth,
+                       double widthScaleFactor, double rasterScaleFactor );
+
+    //! Return number of requests served from already rendered images or pictures (added in 2.8)
+    qint64 cacheHits() const;
+    //! Return number of requests which needed to render an image or picture (added in 2.8)
+    qint64 cacheMisses() const;
+    //! Return number of cached entries (added in 2.8)
+    int entryCount() const;
+    //! Return estimated memory used by the cache in bytes (added in 2.8)
+    long totalSize() const;
+    //! Reset hit and miss counters (added in 2.8)
+    void resetStatistics();
+
   signals:
     /** Emit a signal to be caught by qgisapp and display a msg on status bar */
     void statusChanged( const QString&  theStatusQString );
@@ -150,6 +180,27 @@ class CORE_EXPORT QgsSvgCache : public QObject
     void downloadProgress( qint64, qint64 );
 
   private:
+    struct PrepareRequest
+    {
+      QString file;
+      double size;
+      QColor fill;
+      QColor outline;
+      double outlineWidth;
+      double widthScaleFactor;
+      double rasterScaleFactor;
+    };
+
+    //! Background job of prepareImage()
+    void prepareImageJob( PrepareRequest request );
+
+    //! Mark entry as used and wait until no other thread works on it (with the lock held)
+    void acquireEntry( QgsSvgCacheEntry* entry );
+    //! Release entry acquired by acquireEntry()
+    void releaseEntry( QgsSvgCacheEntry* entry );
+    //! Update cache size after the entry has been updated without the lock and wake up waiting threads (with the lock held)
+    void finishEntry( QgsSvgCacheEntry* entry, int previousDataSize );
+
     /**Entry pointers accessible by file name*/
     QMultiHash< QString, QgsSvgCacheEntry* > mEntryLookup;
     /**Estimated total size of all images, pictures and svgContent*/
@@ -179,7 +230,14 @@ class CORE_EXPORT QgsSvgCache : public QObject
     QByteArray mMissingSvg;
 
     //! Mutex to prevent concurrent access to the class from multiple threads at once (may corrupt the entries otherwise).
-    QMutex mMutex;
+    mutable QMutex mMutex;
+    //! Signalled when an entry stops being busy or a background job finishes
+    QWaitCondition mEntryFinished;
+
+    qint64 mHits;
+    qint64 mMisses;
+    //! Number of background jobs started by prepareImage() which did not finish yet
+    int mPendingJobs;
 };
 
 #endif // QGSSVGCACHE_H
@@ -923,6 +923,10 @@ QgsSymbolV2* QgsSymbolLayerV2Utils::loadSymbol( QDomElement& element )
     symbol->setMapUnitScale( mapUnitScale );
   }
   symbol->setAlpha( element.attribute( "alpha", "1.0" ).toDouble() );
+  if ( symbol->type() == QgsSymbolV2::Marker )
+  {
+    static_cast<QgsMarkerSymbolV2*>( symbol )->setSpriteRenderingEnabled( element.attribute( "sprites", "0" ).toInt() );
+  }
 
   return symbol;
 }
@@ -969,6 +973,10 @@ QDomElement QgsSymbolLayerV2Utils::saveSymbol( QString name, QgsSymbolV2* symbol
   symEl.setAttribute( "type", _nameForSymbolType( symbol->type() ) );
   symEl.setAttribute( "name", name );
   symEl.setAttribute( "alpha", QString::number( symbol->alpha() ) );
+  if ( symbol->type() == QgsSymbolV2::Marker && static_cast<QgsMarkerSymbolV2*>( symbol )->isSpriteRenderingEnabled() )
+  {
+    symEl.setAttribute( "sprites", "1" );
+  }
   QgsDebugMsg( "num layers " + QString::number( symbol->symbolLayerCount() ) );
 
   for ( int i = 0; i < symbol->symbolLayerCount(); i++ )
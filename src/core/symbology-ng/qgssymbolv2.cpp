@@ -18,6 +18,7 @@
 
 #include "qgslinesymbollayerv2.h"
 #include "qgsmarkersymbollayerv2.h"
+#include "qgsellipsesymbollayerv2.h"
 #include "qgsfillsymbollayerv2.h"
 
 #include "qgslogger.h"
@@ -251,6 +252,9 @@ void QgsSymbolV2::startRender( QgsRenderContext& context, const QgsFields* field
 
   for ( QgsSymbolLayerV2List::iterator it = mLayers.begin(); it != mLayers.end(); ++it )
     ( *it )->startRender( symbolContext );
+
+  if ( mType == Marker )
+    static_cast<QgsMarkerSymbolV2*>( this )->startSpriteRendering( context );
 }
 
 void QgsSymbolV2::stopRender( QgsRenderContext& context )
@@ -260,6 +264,13 @@ void QgsSymbolV2::stopRender( QgsRenderContext& context )
   for ( QgsSymbolLayerV2List::iterator it = mLayers.begin(); it != mLayers.end(); ++it )
     ( *it )->stopRender( symbolContext );
 
+  if ( mType == Marker )
+  {
+    QgsMarkerSymbolV2* markerSymbol = static_cast<QgsMarkerSymbolV2*>( this );
+    markerSymbol->mUseSprites = false;
+    markerSymbol->mSprites.clear();
+  }
+
   mLayer = NULL;
 }
 
@@ -497,6 +508,9 @@ QgsFillSymbolV2* QgsFillSymbolV2::createSimple( const QgsStringMap& properties )
 
 QgsMarkerSymbolV2::QgsMarkerSymbolV2( QgsSymbolLayerV2List layers )
     : QgsSymbolV2( Marker, layers )
+    , mSpriteRenderingEnabled( false )
+    , mUseSprites( false )
+    , mSpriteDrawCount( 0 )
 {
   if ( mLayers.count() == 0 )
     mLayers.append( new QgsSimpleMarkerSymbolLayerV2() );
@@ -581,6 +595,9 @@ QgsSymbolV2::ScaleMethod QgsMarkerSymbolV2::scaleMethod()
 
 void QgsMarkerSymbolV2::renderPoint( const QPointF& point, const QgsFeature* f, QgsRenderContext& context, int layer, bool selected )
 {
+  if ( mUseSprites && renderSprite( point, context, layer, selected ) )
+    return;
+
   QgsSymbolV2RenderContext symbolContext( context, outputUnit(), mAlpha, selected, mRenderHints, f, 0, mapUnitScale() );
 
   if ( layer != -1 )
@@ -599,11 +616,173 @@ void QgsMarkerSymbolV2::renderPoint( const QPointF& point, const QgsFeature* f,
 
 QgsSymbolV2* QgsMarkerSymbolV2::clone() const
 {
-  QgsSymbolV2* cloneSymbol = new QgsMarkerSymbolV2( cloneLayers() );
+  QgsMarkerSymbolV2* cloneSymbol = new QgsMarkerSymbolV2( cloneLayers() );
   cloneSymbol->setAlpha( mAlpha );
+  cloneSymbol->setSpriteRenderingEnabled( mSpriteRenderingEnabled );
   return cloneSymbol;
 }
 
+// maximal number of sprites kept during a rendering (sizes and rotations may vary per feature)
+static const int MAX_SPRITE_COUNT = 1024;
+
+void QgsMarkerSymbolV2::startSpriteRendering( QgsRenderContext& context )
+{
+  mSprites.clear();
+  mUseSprites = false;
+  mSpriteDrawCount = 0;
+
+  if ( !( mSpriteRenderingEnabled || context.useMarkerSprites() ) || context.forceVectorOutput() || !context.painter() )
+    return;
+
+  // printers, PDF and SVG generators get the exact vector output
+  QPaintDevice* device = context.painter()->device();
+  if ( !device || ( device->devType() != QInternal::Image && device->devType() != QInternal::Pixmap ) )
+    return;
+
+  for ( QgsSymbolLayerV2List::const_iterator it = mLayers.constBegin(); it != mLayers.constEnd(); ++it )
+  {
+    QgsSymbolLayerV2* layer = *it;
+    if ( layer->hasDataDefinedProperties() )
+      return;
+
+    // other marker types may depend on the feature (e.g. vector field markers)
+    QString type = layer->layerType();
+    if ( type != "SimpleMarker" && type != "SvgMarker" && type != "FontMarker" && type != "EllipseMarker" )
+      return;
+  }
+
+  mUseSprites = true;
+}
+
+bool QgsMarkerSymbolV2::renderSprite( const QPointF& point, QgsRenderContext& context, int layer, bool selected )
+{
+  QPainter* p = context.painter();
+  if ( !p || p->worldTransform().type() > QTransform::TxTranslate )
+    return false;
+
+  // rotations are bucketed to whole degrees
+  int angleBucket = qRound( angle() ) % 360;
+  if ( angleBucket < 0 )
+    angleBucket += 360;
+
+  // sprites are rendered at the sub-pixel position of the point (in quarters of a pixel)
+  // and copied to whole pixels, so that antialiased edges match the direct rendering
+  QPointF devicePoint = point + QPointF( p->worldTransform().dx(), p->worldTransform().dy() );
+  int quarterX = qRound( devicePoint.x() * 4 ), quarterY = qRound( devicePoint.y() * 4 );
+  int subX = quarterX & 3, subY = quarterY & 3;
+  QPointF pixel(( quarterX - subX ) / 4, ( quarterY - subY ) / 4 );
+
+  quint64 key = ( quint64 )qRound64( size() * 1000 ) << 32
+                | ( quint64 )( qRound( mAlpha * 255 ) & 0xff ) << 24
+                | ( quint64 )(( layer + 1 ) & 0x3ff ) << 14
+                | ( quint64 )subY << 12
+                | ( quint64 )subX << 10
+                | ( quint64 )angleBucket << 1
+                | ( selected ? 1 : 0 );
+
+  QHash<quint64, Sprite>::const_iterator it = mSprites.constFind( key );
+  if ( it == mSprites.constEnd() )
+  {
+    if ( mSprites.count() >= MAX_SPRITE_COUNT )
+      return false;
+
+    it = mSprites.insert( key, createSprite( context, layer, selected, QPointF( subX / 4.0, subY / 4.0 ) ) );
+  }
+
+  const Sprite& sprite = it.value();
+  if ( !sprite.valid )
+    return false;
+
+  if ( !sprite.image.isNull() )
+    p->drawImage( pixel - QPointF( p->worldTransform().dx(), p->worldTransform().dy() ) + sprite.offset, sprite.image );
+  mSpriteDrawCount++;
+  return true;
+}
+
+QgsMarkerSymbolV2::Sprite QgsMarkerSymbolV2::createSprite( QgsRenderContext& context, int layer, bool selected, const QPointF& subPixel )
+{
+  Sprite sprite;
+  sprite.valid = false;
+
+  // estimate the extent of the symbol layers, the rendered image is cropped afterwards
+  double extent = 0;
+  for ( QgsSymbolLayerV2List::const_iterator it = mLayers.constBegin(); it != mLayers.constEnd(); ++it )
+  {
+    QgsMarkerSymbolLayerV2* markerLayer = static_cast<QgsMarkerSymbolLayerV2*>( *it );
+    double layerSize = markerLayer->size() * QgsSymbolLayerV2Utils::lineWidthScaleFactor( context, markerLayer->sizeUnit(), markerLayer->sizeMapUnitScale() );
+    if ( markerLayer->layerType() == "EllipseMarker" )
+    {
+      // the ellipse has its own width and height
+      QgsEllipseSymbolLayerV2* ellipseLayer = static_cast<QgsEllipseSymbolLayerV2*>( markerLayer );
+      layerSize = qMax( ellipseLayer->symbolWidth() * QgsSymbolLayerV2Utils::lineWidthScaleFactor( context, ellipseLayer->symbolWidthUnit(), ellipseLayer->symbolWidthMapUnitScale() ),
+                        ellipseLayer->symbolHeight() * QgsSymbolLayerV2Utils::lineWidthScaleFactor( context, ellipseLayer->symbolHeightUnit(), ellipseLayer->symbolHeightMapUnitScale() ) );
+    }
+    double offsetScale = QgsSymbolLayerV2Utils::lineWidthScaleFactor( context, markerLayer->offsetUnit(), markerLayer->offsetMapUnitScale() );
+    double layerOffset = qMax( qAbs( markerLayer->offset().x() ), qAbs( markerLayer->offset().y() ) ) * offsetScale;
+    extent = qMax( extent, layerSize + layerOffset );
+  }
+
+  int imageSize = ( int ) ceil( extent * 3 ) + 8;
+  if ( imageSize > 1000 )
+    return sprite; // huge symbols are drawn directly
+
+  QImage image( imageSize, imageSize, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+
+  QPainter* origPainter = context.painter();
+  QPainter p( &image );
+  p.setRenderHints( origPainter->renderHints() );
+  context.setPainter( &p );
+
+  QPointF origin( imageSize / 2, imageSize / 2 );
+  QPointF center = origin + subPixel;
+  QgsSymbolV2RenderContext symbolContext( context, outputUnit(), mAlpha, selected, mRenderHints, 0, 0, mapUnitScale() );
+  if ( layer != -1 )
+  {
+    if ( layer >= 0 && layer < mLayers.count() )
+      (( QgsMarkerSymbolLayerV2* ) mLayers[layer] )->renderPoint( center, symbolContext );
+  }
+  else
+  {
+    for ( QgsSymbolLayerV2List::iterator it = mLayers.begin(); it != mLayers.end(); ++it )
+      (( QgsMarkerSymbolLayerV2* ) * it )->renderPoint( center, symbolContext );
+  }
+
+  p.end();
+  context.setPainter( origPainter );
+
+  // crop to the painted pixels
+  int left = imageSize, top = imageSize, right = -1, bottom = -1;
+  for ( int y = 0; y < imageSize; ++y )
+  {
+    const QRgb* line = ( const QRgb* ) image.constScanLine( y );
+    for ( int x = 0; x < imageSize; ++x )
+    {
+      if ( qAlpha( line[x] ) == 0 )
+        continue;
+      left = qMin( left, x );
+      right = qMax( right, x );
+      top = qMin( top, y );
+      bottom = qMax( bottom, y );
+    }
+  }
+
+  if ( right < 0 )
+  {
+    sprite.valid = true; // nothing is drawn
+    return sprite;
+  }
+
+  // the symbol may have been clipped
+  if ( left == 0 || top == 0 || right == imageSize - 1 || bottom == imageSize - 1 )
+    return sprite;
+
+  sprite.image = image.copy( left, top, right - left + 1, bottom - top + 1 );
+  sprite.offset = QPointF( left - origin.x(), top - origin.y() );
+  sprite.valid = true;
+  return sprite;
+}
+
 
 ///////////////////
 // LINE
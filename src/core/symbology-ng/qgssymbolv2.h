@@ -17,8 +17,11 @@
 #define QGSSYMBOLV2_H
 
 #include "qgis.h"
+#include <QHash>
+#include <QImage>
 #include <QList>
 #include <QMap>
+#include <QPointF>
 #include "qgsmapunitscale.h"
 
 class QColor;
@@ -262,7 +265,44 @@ class CORE_EXPORT QgsMarkerSymbolV2 : public QgsSymbolV2
 
     void renderPoint( const QPointF& point, const QgsFeature* f, QgsRenderContext& context, int layer = -1, bool selected = false );
 
+    /** Enable or disable drawing of the symbol from pre-rendered sprites (disabled by default).
+     * Sprites are also used when the render context asks for them (see QgsMapSettings::DrawMarkerSprites),
+     * the flag is saved with the symbol.
+     * Sprites are only used for raster output when all symbol layers are simple, SVG, font or ellipse markers
+     * without data defined properties. Each combination of size, rotation and selection is rendered once
+     * for each quarter pixel position and then copied to the output, vector outputs (print, PDF, SVG)
+     * always render the symbol layers.
+     * @note added in 2.8
+     */
+    void setSpriteRenderingEnabled( bool enabled ) { mSpriteRenderingEnabled = enabled; }
+    //! Return whether drawing from pre-rendered sprites is enabled (added in 2.8)
+    bool isSpriteRenderingEnabled() const { return mSpriteRenderingEnabled; }
+    //! Return the number of points drawn from sprites since the rendering started (added in 2.8)
+    int spriteDrawCount() const { return mSpriteDrawCount; }
+
     virtual QgsSymbolV2* clone() const;
+
+  private:
+    friend class QgsSymbolV2;
+
+    struct Sprite
+    {
+      QImage image;      //!< rendered symbol, null if nothing is drawn
+      QPointF offset;    //!< position of the top-left corner of the image relative to the point
+      bool valid;        //!< false if the symbol does not fit into the sprite and must be drawn directly
+    };
+
+    //! Decide whether sprites can be used for the rendering which starts
+    void startSpriteRendering( QgsRenderContext& context );
+    //! Draw the point from a sprite, returns false if the symbol layers must be drawn instead
+    bool renderSprite( const QPointF& point, QgsRenderContext& context, int layer, bool selected );
+    //! Render symbol layers into a new sprite, with the point at the given sub-pixel position
+    Sprite createSprite( QgsRenderContext& context, int layer, bool selected, const QPointF& subPixel );
+
+    bool mSpriteRenderingEnabled;
+    bool mUseSprites;
+    int mSpriteDrawCount;
+    QHash<quint64, Sprite> mSprites;
 };
 
 
@@ -27,15 +27,39 @@
 #include "qgsmaplayerregistry.h"
 #include "qgsrendererv2.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
 
 #include <QVariant>
+#include <QtConcurrentRun>
 
 #include <limits>
 
+//! Maximal number of rows whose features are fetched at once
+static const int PAGE_SIZE = 256;
+
+//! Reads the features for the prefetch, runs in a worker thread
+static QgsFeatureMap fetchFeatures( QgsAbstractFeatureSource* source, const QgsFeatureRequest& request )
+{
+  QgsFeatureMap features;
+
+  QgsFeatureIterator it = source->getFeatures( request );
+  QgsFeature f;
+  while ( it.nextFeature( f ) )
+  {
+    features.insert( f.id(), f );
+  }
+  it.close();
+
+  delete source;
+  return features;
+}
+
 QgsAttributeTableModel::QgsAttributeTableModel( QgsVectorLayerCache *layerCache, QObject *parent )
     : QAbstractTableModel( parent )
     , mLayerCache( layerCache )
     , mFieldCount( 0 )
+    , mPrefetchGeneration( 0 )
+    , mRunningPrefetchGeneration( 0 )
     , mCachedField( -1 )
 {
   QgsDebugMsg( "entered." );
@@ -59,6 +83,12 @@ QgsAttributeTableModel::QgsAttributeTableModel( QgsVectorLayerCache *layerCache,
   connect( layer(), SIGNAL( editCommandEnded() ), this, SLOT( editCommandEnded() ) );
   connect( mLayerCache, SIGNAL( featureAdded( QgsFeatureId ) ), this, SLOT( featureAdded( QgsFeatureId ) ) );
   connect( mLayerCache, SIGNAL( cachedLayerDeleted() ), this, SLOT( layerDeleted() ) );
+  connect( &mPrefetchWatcher, SIGNAL( finished() ), this, SLOT( prefetchFinished() ) );
+}
+
+QgsAttributeTableModel::~QgsAttributeTableModel()
+{
+  mPrefetchWatcher.waitForFinished();
 }
 
 bool QgsAttributeTableModel::loadFeatureAtId( QgsFeatureId fid ) const
@@ -70,13 +100,120 @@ bool QgsAttributeTableModel::loadFeatureAtId( QgsFeatureId fid ) const
     return false;
   }
 
+  if ( !mLayerCache->isFidCached( fid ) )
+  {
+    int row = mIdRowMap.value( fid, -1 );
+
+    QgsFeatureMap::const_iterator it = mPrefetchedFeatures.constFind( fid );
+    if ( it != mPrefetchedFeatures.constEnd() )
+    {
+      mFeat = it.value();
+      // keep ahead of the rows being scrolled to
+      if ( row != -1 )
+        prefetchPage( row / pageSize() + 1 );
+      return true;
+    }
+
+    if ( row != -1 )
+    {
+      loadPage( row / pageSize() );
+    }
+  }
+
   return mLayerCache->featureAtId( fid, mFeat );
 }
 
+int QgsAttributeTableModel::pageSize() const
+{
+  // a page must not push the previously shown rows out of the cache
+  return qBound( 1, mLayerCache->cacheSize() / 4, PAGE_SIZE );
+}
+
+void QgsAttributeTableModel::loadPage( int page ) const
+{
+  int size = pageSize();
+
+  QgsFeatureIds fids;
+  for ( int row = page * size; row < qMin( ( page + 1 ) * size, rowCount() ); ++row )
+  {
+    QgsFeatureId fid = mRowIdMap.value( row );
+    if ( !mLayerCache->isFidCached( fid ) && !mPrefetchedFeatures.contains( fid ) )
+      fids << fid;
+  }
+
+  QgsDebugMsgLevel( QString( "loading page %1 (%2 features)" ).arg( page ).arg( fids.size() ), 3 );
+
+  if ( !fids.isEmpty() )
+  {
+    // the features are stored in the layer cache while iterating
+    QgsFeatureIterator it = mLayerCache->getFeatures( QgsFeatureRequest().setFilterFids( fids ).setFlags( QgsFeatureRequest::NoGeometry ) );
+    QgsFeature f;
+    while ( it.nextFeature( f ) )
+      ;
+  }
+
+  prefetchPage( page + 1 );
+}
+
+void QgsAttributeTableModel::prefetchPage( int page ) const
+{
+  if ( page < 0 || mPrefetchWatcher.isRunning() || !layer() )
+    return;
+
+  int size = pageSize();
+
+  QgsFeatureIds fids;
+  for ( int row = page * size; row < qMin( ( page + 1 ) * size, rowCount() ); ++row )
+  {
+    QgsFeatureId fid = mRowIdMap.value( row );
+    if ( !mLayerCache->isFidCached( fid ) && !mPrefetchedFeatures.contains( fid ) )
+      fids << fid;
+  }
+
+  if ( fids.isEmpty() )
+    return;
+
+  QgsDebugMsgLevel( QString( "prefetching page %1 (%2 features)" ).arg( page ).arg( fids.size() ), 3 );
+
+  // the feature source is a snapshot of the layer which can be read from another thread
+  QgsAbstractFeatureSource* source = new QgsVectorLayerFeatureSource( layer() );
+  QgsFeatureRequest request = QgsFeatureRequest().setFilterFids( fids ).setFlags( QgsFeatureRequest::NoGeometry );
+
+  mRunningPrefetchGeneration = mPrefetchGeneration;
+  mPrefetchWatcher.setFuture( QtConcurrent::run( fetchFeatures, source, request ) );
+}
+
+void QgsAttributeTableModel::prefetchFinished()
+{
+  if ( mRunningPrefetchGeneration != mPrefetchGeneration )
+  {
+    // the layer has changed since the features were read
+    return;
+  }
+
+  QgsFeatureMap features = mPrefetchWatcher.result();
+
+  // only a few pages around the shown rows are kept
+  if ( mPrefetchedFeatures.size() + features.size() > 4 * pageSize() )
+    mPrefetchedFeatures.clear();
+
+  for ( QgsFeatureMap::const_iterator it = features.constBegin(); it != features.constEnd(); ++it )
+  {
+    mPrefetchedFeatures.insert( it.key(), it.value() );
+  }
+}
+
+void QgsAttributeTableModel::invalidatePrefetch()
+{
+  ++mPrefetchGeneration;
+  mPrefetchedFeatures.clear();
+}
+
 void QgsAttributeTableModel::featureDeleted( QgsFeatureId fid )
 {
   QgsDebugMsgLevel( QString( "(%2) fid: %1" ).arg( fid ).arg( mFeatureRequest.filterType() ), 4 );
   mFieldCache.remove( fid );
+  invalidatePrefetch();
 
   int row = idToRow( fid );
 
@@ -155,6 +292,7 @@ void QgsAttributeTableModel::featureAdded( QgsFeatureId fid )
 void QgsAttributeTableModel::updatedFields()
 {
   QgsDebugMsg( "entered." );
+  invalidatePrefetch();
   loadAttributes();
   emit modelChanged();
 }
@@ -169,6 +307,8 @@ void QgsAttributeTableModel::editCommandEnded()
 
 void QgsAttributeTableModel::attributeDeleted( int idx )
 {
+  invalidatePrefetch();
+
   if ( idx == mCachedField )
   {
     prefetchColumnData( -1 );
@@ -179,6 +319,8 @@ void QgsAttributeTableModel::layerDeleted()
 {
   QgsDebugMsg( "entered." );
 
+  invalidatePrefetch();
+
   beginRemoveRows( QModelIndex(), 0, rowCount() - 1 );
   removeRows( 0, rowCount() );
   endRemoveRows();
@@ -192,6 +334,8 @@ void QgsAttributeTableModel::layerDeleted()
 void QgsAttributeTableModel::attributeValueChanged( QgsFeatureId fid, int idx, const QVariant &value )
 {
   QgsDebugMsgLevel( QString( "(%4) fid: %1, idx: %2, value: %3" ).arg( fid ).arg( idx ).arg( value.toString() ).arg( mFeatureRequest.filterType() ), 3 );
+  invalidatePrefetch();
+
   // No filter request: skip all possibly heavy checks
   if ( mFeatureRequest.filterType() == QgsFeatureRequest::FilterNone )
   {
@@ -294,13 +438,25 @@ void QgsAttributeTableModel::loadLayer()
     endRemoveRows();
   }
 
-  QgsFeatureIterator features = mLayerCache->getFeatures( mFeatureRequest );
+  invalidatePrefetch();
+
+  // Only the ids are read here, the attributes are fetched by data() page by page.
+  // The filter of the request is applied by the provider.
+  QgsFeatureRequest request( mFeatureRequest );
+  if ( request.filterType() != QgsFeatureRequest::FilterExpression )
+    request.setSubsetOfAttributes( QgsAttributeList() );
+  if ( request.filterType() != QgsFeatureRequest::FilterRect )
+    request.setFlags( request.flags() | QgsFeatureRequest::NoGeometry );
+
+  QgsFeatureIterator features = layer()->getFeatures( request );
 
   int i = 0;
 
   QTime t;
   t.start();
 
+  QList<QgsFeatureId> ids;
+
   QgsFeature feat;
   while ( features.nextFeature( feat ) )
   {
@@ -315,8 +471,27 @@ void QgsAttributeTableModel::loadLayer()
 
       t.restart();
     }
-    mFeat = feat;
-    featureAdded( feat.id() );
+    ids << feat.id();
+  }
+
+  if ( !ids.isEmpty() )
+  {
+    beginInsertRows( QModelIndex(), 0, ids.size() - 1 );
+
+    mIdRowMap.reserve( ids.size() );
+    mRowIdMap.reserve( ids.size() );
+    for ( int row = 0; row < ids.size(); ++row )
+    {
+      mIdRowMap.insert( ids[row], row );
+      mRowIdMap.insert( row, ids[row] );
+    }
+
+    endInsertRows();
+  }
+
+  if ( mCachedField != -1 )
+  {
+    prefetchColumnData( fieldCol( mCachedField ) );
   }
 
   emit finished();
@@ -618,7 +793,8 @@ void QgsAttributeTableModel::prefetchColumnData( int column )
     QStringList fldNames;
     fldNames << fields[ fieldId ].name();
 
-    QgsFeatureIterator it = mLayerCache->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( fldNames, fields ) );
+    // read from the layer, the cache would fetch all the attributes of every feature
+    QgsFeatureIterator it = layer()->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ).setSubsetOfAttributes( fldNames, fields ) );
 
     QgsFeature f;
     while ( it.nextFeature( f ) )
@@ -23,9 +23,11 @@
 #include <QHash>
 #include <QQueue>
 #include <QMap>
+#include <QFutureWatcher>
 
 #include "qgsvectorlayer.h" // QgsAttributeList
 #include "qgsvectorlayercache.h"
+#include "qgsvectorlayerfeatureiterator.h" // QgsFeatureMap
 #include "qgsattributeeditorcontext.h"
 
 class QgsMapCanvas;
@@ -61,10 +63,14 @@ class GUI_EXPORT QgsAttributeTableModel: public QAbstractTableModel
      * @param parent      The parent QObject (owner)
      */
     QgsAttributeTableModel( QgsVectorLayerCache *layerCache, QObject *parent = 0 );
+    ~QgsAttributeTableModel();
 
     /**
      * Loads the layer into the model
      * Preferably to be called, before basing any other models on this model
+     *
+     * Only the feature ids are read, the attributes are fetched page by page
+     * when the rows are shown.
      */
     virtual void loadLayer();
 
@@ -247,6 +253,11 @@ class GUI_EXPORT QgsAttributeTableModel: public QAbstractTableModel
      */
     virtual void attributeDeleted( int idx );
 
+    /**
+     * Called when the features of the next page have been read in the background
+     */
+    void prefetchFinished();
+
   protected slots:
     /**
      * Launched when attribute value has been changed
@@ -300,8 +311,36 @@ class GUI_EXPORT QgsAttributeTableModel: public QAbstractTableModel
      */
     virtual bool loadFeatureAtId( QgsFeatureId fid ) const;
 
+    /**
+     * Returns the number of rows whose features are fetched at once
+     */
+    int pageSize() const;
+
+    /**
+     * Fetches the features of a page of rows into the layer cache
+     */
+    void loadPage( int page ) const;
+
+    /**
+     * Starts reading the features of a page of rows in the background,
+     * unless they are cached already or another page is being read
+     */
+    void prefetchPage( int page ) const;
+
+    /**
+     * Discards the prefetched features, called whenever the features of the layer change
+     */
+    void invalidatePrefetch();
+
     QgsFeatureRequest mFeatureRequest;
 
+    /** Features of the pages read in the background */
+    mutable QgsFeatureMap mPrefetchedFeatures;
+    mutable QFutureWatcher<QgsFeatureMap> mPrefetchWatcher;
+    /** Incremented by invalidatePrefetch(), the results of older prefetches are dropped */
+    int mPrefetchGeneration;
+    mutable int mRunningPrefetchGeneration;
+
     /** The currently cached column */
     int mCachedField;
     /** Allows caching of one specific column (used for sorting) */
@@ -231,6 +231,7 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
 
   mSettings.setFlag( QgsMapSettings::DrawEditingInfo );
   mSettings.setFlag( QgsMapSettings::UseRenderingOptimization );
+  mSettings.setFlag( QgsMapSettings::DrawMarkerSprites );
 
   // class that will sync most of the changes between canvas and (legacy) map renderer
   // it is parented to map canvas, will be deleted automatically
@@ -528,6 +529,9 @@ void QgsMapCanvas::setDestinationCrs( const QgsCoordinateReferenceSystem &crs )
 
   mSettings.setDestinationCrs( crs );
 
+  // cached images of other views are not valid in the new CRS
+  clearCache();
+
   updateDatumTransformEntries();
 
   emit destinationCrsChanged();
@@ -667,6 +671,11 @@ void QgsMapCanvas::refreshMap()
 
   mJob->start();
 
+  // with the cache, the job can immediately provide cached and shifted images of layers
+  // and previews of the layers resampled from other scales
+  if ( mCache )
+    mMap->setContent( mJob->renderedImage(), mSettings.visibleExtent() );
+
   mMapUpdateTimer.start();
 
   emit renderStarting();
@@ -71,6 +71,8 @@ void QgsSpatialQuery::runQuery( QgsFeatureIds &qsetIndexResult,
 
   execQuery( qsetIndexResult, qsetIndexInvalidTarget, relation );
 
+  mGeometriesReference.clear();
+
 } // QSet<int> QgsSpatialQuery::runQuery( int relation)
 
 QMap<QString, int>* QgsSpatialQuery::getTypesOperations( QgsVectorLayer* lyrTarget, QgsVectorLayer* lyrReference )
@@ -206,6 +208,7 @@ void QgsSpatialQuery::setSpatialIndexReference( QgsFeatureIds &qsetIndexInvalidR
     }
 
     mIndexReference.insertFeature( feature );
+    mGeometriesReference.insert( feature.id(), *feature.geometry() );
   }
   delete readerFeaturesReference;
 
@@ -213,32 +216,32 @@ void QgsSpatialQuery::setSpatialIndexReference( QgsFeatureIds &qsetIndexInvalidR
 
 void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &qsetIndexInvalidTarget, int relation )
 {
-  bool ( QgsGeometry::* operation )( const QgsGeometry * ) const;
+  bool ( QgsPreparedGeometry::* operation )( const QgsGeometry * ) const;
   switch ( relation )
   {
     case Disjoint:
-      operation = &QgsGeometry::disjoint;
+      operation = &QgsPreparedGeometry::disjoint;
       break;
     case Equals:
-      operation = &QgsGeometry::equals;
+      operation = &QgsPreparedGeometry::equals;
       break;
     case Touches:
-      operation = &QgsGeometry::touches;
+      operation = &QgsPreparedGeometry::touches;
       break;
     case Overlaps:
-      operation = &QgsGeometry::overlaps;
+      operation = &QgsPreparedGeometry::overlaps;
       break;
     case Within:
-      operation = &QgsGeometry::within;
+      operation = &QgsPreparedGeometry::within;
       break;
     case Contains:
-      operation = &QgsGeometry::contains;
+      operation = &QgsPreparedGeometry::contains;
       break;
     case Crosses:
-      operation = &QgsGeometry::crosses;
+      operation = &QgsPreparedGeometry::crosses;
       break;
     case Intersects:
-      operation = &QgsGeometry::intersects;
+      operation = &QgsPreparedGeometry::intersects;
       break;
     default:
       qWarning( "undefined operation" );
@@ -250,7 +253,7 @@ void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &
   coordinateTransform->setCoordinateTransform( mLayerTarget, mLayerReference );
 
   // Set function for populate result
-  void ( QgsSpatialQuery::* funcPopulateIndexResult )( QgsFeatureIds&, QgsFeatureId, QgsGeometry *, bool ( QgsGeometry::* )( const QgsGeometry * ) const );
+  void ( QgsSpatialQuery::* funcPopulateIndexResult )( QgsFeatureIds&, QgsFeatureId, const QgsPreparedGeometry &, bool ( QgsPreparedGeometry::* )( const QgsGeometry * ) const );
   funcPopulateIndexResult = ( relation == Disjoint )
                             ? &QgsSpatialQuery::populateIndexResultDisjoint
                             : &QgsSpatialQuery::populateIndexResult;
@@ -271,30 +274,33 @@ void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &
     geomTarget = featureTarget.geometry();
     coordinateTransform->transform( geomTarget );
 
-    ( this->*funcPopulateIndexResult )( qsetIndexResult, featureTarget.id(), geomTarget, operation );
+    // the target geometry is tested against all reference candidates
+    QgsPreparedGeometry preparedTarget( *geomTarget );
+    ( this->*funcPopulateIndexResult )( qsetIndexResult, featureTarget.id(), preparedTarget, operation );
   }
   delete coordinateTransform;
 
 } // QSet<int> QgsSpatialQuery::execQuery( QSet<int> & qsetIndexResult, int relation)
 
 void QgsSpatialQuery::populateIndexResult(
-  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry * geomTarget,
-  bool ( QgsGeometry::* op )( const QgsGeometry * ) const )
+  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, const QgsPreparedGeometry &geomTarget,
+  bool ( QgsPreparedGeometry::* op )( const QgsGeometry * ) const )
 {
   QList<QgsFeatureId> listIdReference;
-  listIdReference = mIndexReference.intersects( geomTarget->boundingBox() );
+  listIdReference = mIndexReference.intersects( geomTarget.geometry().boundingBox() );
   if ( listIdReference.count() == 0 )
   {
     return;
   }
-  QgsFeature featureReference;
-  QgsGeometry * geomReference;
   QList<QgsFeatureId>::iterator iterIdReference = listIdReference.begin();
   for ( ; iterIdReference != listIdReference.end(); ++iterIdReference )
   {
-    mLayerReference->getFeatures( QgsFeatureRequest().setFilterFid( *iterIdReference ) ).nextFeature( featureReference );
-    geomReference = featureReference.geometry();
-    if (( geomTarget->*op )( geomReference ) )
+    QHash<QgsFeatureId, QgsGeometry>::const_iterator geomReference = mGeometriesReference.constFind( *iterIdReference );
+    if ( geomReference == mGeometriesReference.constEnd() )
+    {
+      continue;
+    }
+    if (( geomTarget.*op )( &geomReference.value() ) )
     {
       qsetIndexResult.insert( idTarget );
       break;
@@ -304,26 +310,27 @@ void QgsSpatialQuery::populateIndexResult(
 } // void QgsSpatialQuery::populateIndexResult(...
 
 void QgsSpatialQuery::populateIndexResultDisjoint(
-  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry * geomTarget,
-  bool ( QgsGeometry::* op )( const QgsGeometry * ) const )
+  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, const QgsPreparedGeometry &geomTarget,
+  bool ( QgsPreparedGeometry::* op )( const QgsGeometry * ) const )
 {
   QList<QgsFeatureId> listIdReference;
-  listIdReference = mIndexReference.intersects( geomTarget->boundingBox() );
+  listIdReference = mIndexReference.intersects( geomTarget.geometry().boundingBox() );
   if ( listIdReference.count() == 0 )
   {
     qsetIndexResult.insert( idTarget );
     return;
   }
-  QgsFeature featureReference;
-  QgsGeometry * geomReference;
   QList<QgsFeatureId>::iterator iterIdReference = listIdReference.begin();
   bool addIndex = true;
   for ( ; iterIdReference != listIdReference.end(); ++iterIdReference )
   {
-    mLayerReference->getFeatures( QgsFeatureRequest().setFilterFid( *iterIdReference ) ).nextFeature( featureReference );
-    geomReference = featureReference.geometry();
+    QHash<QgsFeatureId, QgsGeometry>::const_iterator geomReference = mGeometriesReference.constFind( *iterIdReference );
+    if ( geomReference == mGeometriesReference.constEnd() )
+    {
+      continue;
+    }
 
-    if ( !( geomTarget->*op )( geomReference ) )
+    if ( !( geomTarget.*op )( &geomReference.value() ) )
     {
       addIndex = false;
       break;
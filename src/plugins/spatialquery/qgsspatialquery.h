@@ -20,6 +20,7 @@
 
 #include <qgsvectorlayer.h>
 #include <qgsspatialindex.h>
+#include <qgsgeometry.h>
 
 #include "qgsmngprogressbar.h"
 #include "qgsreaderfeatures.h"
@@ -132,22 +133,22 @@ class QgsSpatialQuery
     * \brief Populate index Result
     * \param qsetIndexResult    Reference to QSet contains the result query
     * \param idTarget           Id of the feature Target
-    * \param geomTarget         Geometry the feature Target
+    * \param geomTarget         Prepared geometry the feature Target
     * \param operation          Pointer to function of GEOS operation
     */
     void populateIndexResult(
-      QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry *geomTarget,
-      bool ( QgsGeometry::* operation )( const QgsGeometry * ) const );
+      QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, const QgsPreparedGeometry &geomTarget,
+      bool ( QgsPreparedGeometry::* operation )( const QgsGeometry * ) const );
     /**
     * \brief Populate index Result Disjoint
     * \param qsetIndexResult    Reference to QSet contains the result query
     * \param idTarget           Id of the feature Target
-    * \param geomTarget         Geometry the feature Target
+    * \param geomTarget         Prepared geometry the feature Target
     * \param operation          Pointer to function of GEOS operation
     */
     void populateIndexResultDisjoint(
-      QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry *geomTarget,
-      bool ( QgsGeometry::* operation )( const QgsGeometry * ) const );
+      QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, const QgsPreparedGeometry &geomTarget,
+      bool ( QgsPreparedGeometry::* operation )( const QgsGeometry * ) const );
 
     MngProgressBar *mPb;
     bool mUseReferenceSelection;
@@ -157,6 +158,8 @@ class QgsSpatialQuery
     QgsVectorLayer * mLayerTarget;
     QgsVectorLayer * mLayerReference;
     QgsSpatialIndex  mIndexReference;
+    //! Geometries of the reference features (keeping their GEOS representation between tests)
+    QHash<QgsFeatureId, QgsGeometry> mGeometriesReference;
 };
 
 #endif // SPATIALQUERY_H
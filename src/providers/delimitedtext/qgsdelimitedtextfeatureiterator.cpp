@@ -27,6 +27,7 @@
 
 QgsDelimitedTextFeatureIterator::QgsDelimitedTextFeatureIterator( QgsDelimitedTextFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource( source, ownSource, request )
+    , mFilterRectGeom( 0 )
 {
 
   // Determine mode to use based on request...
@@ -64,6 +65,8 @@ QgsDelimitedTextFeatureIterator::QgsDelimitedTextFeatureIterator( QgsDelimitedTe
     // Exact intersection test only applies for WKT geometries
     mTestGeometryExact = mRequest.flags() & QgsFeatureRequest::ExactIntersect
                          && mSource->mGeomRep == QgsDelimitedTextProvider::GeomAsWkt;
+    if ( mTestGeometryExact )
+      mFilterRectGeom = new QgsPreparedGeometry( request.filterRect() );
 
     QgsRectangle rect = request.filterRect();
 
@@ -142,6 +145,8 @@ QgsDelimitedTextFeatureIterator::QgsDelimitedTextFeatureIterator( QgsDelimitedTe
 QgsDelimitedTextFeatureIterator::~QgsDelimitedTextFeatureIterator()
 {
   close();
+
+  delete mFilterRectGeom;
 }
 
 bool QgsDelimitedTextFeatureIterator::fetchFeature( QgsFeature& feature )
@@ -236,7 +241,7 @@ bool QgsDelimitedTextFeatureIterator::wantGeometry( QgsGeometry *geom ) const
   if ( ! mTestGeometry ) return true;
 
   if ( mTestGeometryExact )
-    return geom->intersects( mRequest.filterRect() );
+    return mFilterRectGeom->intersects( geom );
   else
     return geom->boundingBox().intersects( mRequest.filterRect() );
 }
@@ -21,6 +21,8 @@
 
 #include "qgsdelimitedtextprovider.h"
 
+class QgsPreparedGeometry;
+
 class QgsDelimitedTextFeatureSource : public QgsAbstractFeatureSource
 {
   public:
@@ -95,6 +97,7 @@ class QgsDelimitedTextFeatureIterator : public QgsAbstractFeatureIteratorFromSou
     bool mTestGeometry;
     bool mTestGeometryExact;
     bool mLoadGeometry;
+    QgsPreparedGeometry* mFilterRectGeom;
 };
 
 
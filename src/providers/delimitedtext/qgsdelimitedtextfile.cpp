@@ -111,7 +111,8 @@ bool QgsDelimitedTextFile::open()
       }
       if ( mUseWatcher )
       {
-        mWatcher = new QFileSystemWatcher();
+        // parented so it follows the file when the provider is moved to another thread
+        mWatcher = new QFileSystemWatcher( this );
         mWatcher->addPath( mFileName );
         connect( mWatcher, SIGNAL( fileChanged( QString ) ), this, SLOT( updateFile() ) );
       }
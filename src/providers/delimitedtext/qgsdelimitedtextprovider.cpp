@@ -88,6 +88,9 @@ QgsDelimitedTextProvider::QgsDelimitedTextProvider( QString uri )
 
   QUrl url = QUrl::fromEncoded( uri.toAscii() );
   mFile = new QgsDelimitedTextFile();
+  // the provider may be preloaded on a worker thread and then moved to the thread
+  // which uses it, so the file (and its file system watcher) must move along with it
+  mFile->setParent( this );
   mFile->setFromUrl( url );
 
   QString subset;
@@ -0,0 +1,90 @@
+/***************************************************************************
+      qgsgdalblockcache.cpp  -  Cache of decoded GDAL raster blocks
+                             -------------------
+    begin                : October, 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgdalblockcache.h"
+#include "qgslogger.h"
+
+#include <QMutexLocker>
+#include <QSettings>
+
+QgsGdalBlockCache* QgsGdalBlockCache::instance()
+{
+  static QgsGdalBlockCache sInstance;
+  return &sInstance;
+}
+
+QgsGdalBlockCache::QgsGdalBlockCache()
+    : mHits( 0 )
+    , mMisses( 0 )
+{
+  QSettings settings;
+  int sizeMB = settings.value( "/Raster/blockCacheSize", 64 ).toInt();
+  mBlocks.setMaxCost( qMax( sizeMB, 0 ) * 1024 );
+}
+
+QByteArray QgsGdalBlockCache::block( const QgsGdalBlockKey& key )
+{
+  QMutexLocker locker( &mMutex );
+
+  QByteArray* data = mBlocks.object( key );
+  if ( !data )
+  {
+    ++mMisses;
+    return QByteArray();
+  }
+
+  ++mHits;
+  return *data;
+}
+
+void QgsGdalBlockCache::insertBlock( const QgsGdalBlockKey& key, const QByteArray& data )
+{
+  QMutexLocker locker( &mMutex );
+
+  int cost = qMax( data.size() / 1024, 1 );
+  mBlocks.insert( key, new QByteArray( data ), cost );
+}
+
+void QgsGdalBlockCache::removeDataset( const QString& dataset )
+{
+  QMutexLocker locker( &mMutex );
+
+  foreach ( const QgsGdalBlockKey& key, mBlocks.keys() )
+  {
+    if ( key.dataset == dataset )
+      mBlocks.remove( key );
+  }
+
+  QgsDebugMsg( QString( "removed blocks of %1, hits %2 misses %3" ).arg( dataset ).arg( mHits ).arg( mMisses ) );
+}
+
+qint64 QgsGdalBlockCache::maxSize() const
+{
+  QMutexLocker locker( &mMutex );
+  return ( qint64 ) mBlocks.maxCost() * 1024;
+}
+
+int QgsGdalBlockCache::hits() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHits;
+}
+
+int QgsGdalBlockCache::misses() const
+{
+  QMutexLocker locker( &mMutex );
+  return mMisses;
+}
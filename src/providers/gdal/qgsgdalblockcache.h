@@ -0,0 +1,91 @@
+/***************************************************************************
+      qgsgdalblockcache.h  -  Cache of decoded GDAL raster blocks
+                             -------------------
+    begin                : October, 2014
+    copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGDALBLOCKCACHE_H
+#define QGSGDALBLOCKCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/** Identifies a block of a raster band, the level (full resolution or
+ * overview) is identified by its size */
+struct QgsGdalBlockKey
+{
+  QString dataset;
+  int levelWidth;
+  int levelHeight;
+  int band;
+  int xBlock;
+  int yBlock;
+
+  bool operator==( const QgsGdalBlockKey& other ) const
+  {
+    return xBlock == other.xBlock && yBlock == other.yBlock && band == other.band
+           && levelWidth == other.levelWidth && levelHeight == other.levelHeight
+           && dataset == other.dataset;
+  }
+};
+
+inline uint qHash( const QgsGdalBlockKey& key )
+{
+  return qHash( key.dataset ) ^ ( key.levelWidth * 31 + key.band ) ^ ( key.xBlock << 16 ) ^ key.yBlock;
+}
+
+/**
+  \brief Cache of decoded raster blocks shared by all GDAL providers.
+
+  The blocks are stored in the data type in which the provider reads them,
+  so that overlapping requests (also from the clones of a provider used by
+  the renderer threads) do not decode the same compressed blocks again.
+  The size of the cache is limited by the "/Raster/blockCacheSize" setting (MB).
+  The methods are thread safe.
+*/
+class QgsGdalBlockCache
+{
+  public:
+    static QgsGdalBlockCache* instance();
+
+    /** Returns the cached block or a null byte array if it is not cached */
+    QByteArray block( const QgsGdalBlockKey& key );
+
+    /** Stores a block in the cache, the least recently used blocks are dropped if the cache is full */
+    void insertBlock( const QgsGdalBlockKey& key, const QByteArray& data );
+
+    /** Removes all the blocks of a dataset, called when the data or the overviews change */
+    void removeDataset( const QString& dataset );
+
+    /** Maximal size of the cached blocks in bytes */
+    qint64 maxSize() const;
+
+    /** Number of requested blocks found in the cache */
+    int hits() const;
+
+    /** Number of requested blocks which had to be read */
+    int misses() const;
+
+  private:
+    QgsGdalBlockCache();
+
+    mutable QMutex mMutex;
+    //! cost of the blocks is in kB
+    QCache<QgsGdalBlockKey, QByteArray> mBlocks;
+    int mHits;
+    int mMisses;
+};
+
+#endif // QGSGDALBLOCKCACHE_H
@@ -19,6 +19,7 @@
 #include "qgslogger.h"
 #include "qgsgdalproviderbase.h"
 #include "qgsgdalprovider.h"
+#include "qgsgdalblockcache.h"
 #include "qgsconfig.h"
 
 #include "qgsapplication.h"
@@ -151,6 +152,27 @@ QgsGdalProvider::QgsGdalProvider( const QString &uri, bool update )
 
   QgsDebugMsg( "GdalDataset opened" );
   initBaseDataset();
+
+  // the decoded blocks of read-only datasets are shared with the other providers
+  // of the same file, e.g. the clones used by the renderer
+  if ( mValid && !mUpdate && mGdalDataset == mGdalBaseDataset && QgsGdalBlockCache::instance()->maxSize() > 0 )
+  {
+    mBlockCacheKey = dataSourceUri();
+
+    // do not use the blocks of files which were modified since, including external
+    // overviews (.ovr, .aux) rebuilt by another application; the size catches
+    // rewrites within the resolution of the modification time
+    char **fileList = GDALGetFileList( mGdalBaseDataset );
+    for ( int i = 0; fileList && fileList[i]; i++ )
+    {
+      QFileInfo fileInfo( QString::fromUtf8( fileList[i] ) );
+      if ( fileInfo.exists() )
+      {
+        mBlockCacheKey += QString( "|%1|%2" ).arg( fileInfo.lastModified().toMSecsSinceEpoch() ).arg( fileInfo.size() );
+      }
+    }
+    CSLDestroy( fileList );
+  }
 }
 
 QgsRasterInterface * QgsGdalProvider::clone() const
@@ -346,6 +368,17 @@ QString QgsGdalProvider::metadata()
     myMetadata += "</p>\n";
   }
 
+  if ( !mBlockCacheKey.isEmpty() )
+  {
+    QgsGdalBlockCache* cache = QgsGdalBlockCache::instance();
+    myMetadata += "<p class=\"glossy\">";
+    myMetadata += tr( "Block cache" );
+    myMetadata += "</p>\n";
+    myMetadata += "<p>";
+    myMetadata += tr( "%1 MB, %2 hits, %3 misses" ).arg( cache->maxSize() / ( 1024 * 1024 ) ).arg( cache->hits() ).arg( cache->misses() );
+    myMetadata += "</p>\n";
+  }
+
   return myMetadata;
 }
 
@@ -584,11 +617,15 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
   GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
   CPLErrorReset();
-  CPLErr err = gdalRasterIO( gdalBand, GF_Read,
-                             srcLeft, srcTop, srcWidth, srcHeight,
-                             ( void * )tmpBlock,
-                             tmpWidth, tmpHeight, type,
-                             0, 0 );
+  CPLErr err = CE_None;
+  if ( !readCachedRasterIO( theBandNo, srcLeft, srcTop, srcWidth, srcHeight, ( void * )tmpBlock, tmpWidth, tmpHeight ) )
+  {
+    err = gdalRasterIO( gdalBand, GF_Read,
+                        srcLeft, srcTop, srcWidth, srcHeight,
+                        ( void * )tmpBlock,
+                        tmpWidth, tmpHeight, type,
+                        0, 0 );
+  }
 
   if ( err != CPLE_None )
   {
@@ -635,6 +672,140 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   return;
 }
 
+bool QgsGdalProvider::readCachedRasterIO( int theBandNo, int xOff, int yOff, int xSize, int ySize, void *data, int bufXSize, int bufYSize )
+{
+  if ( mBlockCacheKey.isEmpty() || xSize <= 0 || ySize <= 0 || bufXSize <= 0 || bufYSize <= 0 )
+    return false;
+
+  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+  GDALDataType type = ( GDALDataType )mGdalDataType[theBandNo-1];
+  int dataSize = GDALGetDataTypeSize( type ) / 8;
+
+  // Like GDALRasterIO, read from the overview with the lowest resolution which
+  // is still (about) sufficient for the requested buffer size
+  GDALRasterBandH levelBand = gdalBand;
+  double desiredFactor = qMin(( double ) xSize / bufXSize, ( double ) ySize / bufYSize );
+  if ( desiredFactor > 1 )
+  {
+    double bestFactor = 1;
+    int overviewCount = gdalGetOverviewCount( gdalBand );
+    for ( int i = 0; i < overviewCount; i++ )
+    {
+      GDALRasterBandH overview = GDALGetOverview( gdalBand, i );
+      double factor = ( double ) mWidth / GDALGetRasterBandXSize( overview );
+      if ( factor < desiredFactor * 1.2 && factor > bestFactor )
+      {
+        levelBand = overview;
+        bestFactor = factor;
+      }
+    }
+  }
+
+  int levelWidth = GDALGetRasterBandXSize( levelBand );
+  int levelHeight = GDALGetRasterBandYSize( levelBand );
+
+  // the window in the level
+  int levelLeft = xOff, levelTop = yOff, levelXSize = xSize, levelYSize = ySize;
+  if ( levelBand != gdalBand )
+  {
+    double xFactor = ( double ) mWidth / levelWidth;
+    double yFactor = ( double ) mHeight / levelHeight;
+    levelLeft = qMin( static_cast<int>( xOff / xFactor + 0.5 ), levelWidth - 1 );
+    levelTop = qMin( static_cast<int>( yOff / yFactor + 0.5 ), levelHeight - 1 );
+    levelXSize = qBound( 1, static_cast<int>( xSize / xFactor + 0.5 ), levelWidth - levelLeft );
+    levelYSize = qBound( 1, static_cast<int>( ySize / yFactor + 0.5 ), levelHeight - levelTop );
+  }
+
+  int xBlockSize, yBlockSize;
+  GDALGetBlockSize( levelBand, &xBlockSize, &yBlockSize );
+  if ( xBlockSize <= 0 || yBlockSize <= 0 )
+    return false;
+
+  int firstXBlock = levelLeft / xBlockSize;
+  int lastXBlock = ( levelLeft + levelXSize - 1 ) / xBlockSize;
+  int firstYBlock = levelTop / yBlockSize;
+  int lastYBlock = ( levelTop + levelYSize - 1 ) / yBlockSize;
+
+  // the blocks must fit into the cache with a good margin, otherwise read directly
+  qint64 blocksSize = ( qint64 )( lastXBlock - firstXBlock + 1 ) * xBlockSize * ( lastYBlock - firstYBlock + 1 ) * yBlockSize * dataSize;
+  if ( blocksSize > QgsGdalBlockCache::instance()->maxSize() / 4 )
+    return false;
+
+  // the window is assembled directly in the output if it does not need to be resampled
+  bool resample = levelXSize != bufXSize || levelYSize != bufYSize;
+  QByteArray window;
+  char *windowData = ( char * )data;
+  if ( resample )
+  {
+    window.resize( levelXSize * levelYSize * dataSize );
+    windowData = window.data();
+  }
+
+  QgsGdalBlockKey key;
+  key.dataset = mBlockCacheKey;
+  key.levelWidth = levelWidth;
+  key.levelHeight = levelHeight;
+  key.band = theBandNo;
+
+  for ( int yBlock = firstYBlock; yBlock <= lastYBlock; yBlock++ )
+  {
+    for ( int xBlock = firstXBlock; xBlock <= lastXBlock; xBlock++ )
+    {
+      // blocks on the right and bottom edges are clipped to the level size
+      int blockLeft = xBlock * xBlockSize;
+      int blockTop = yBlock * yBlockSize;
+      int blockWidth = qMin( xBlockSize, levelWidth - blockLeft );
+      int blockHeight = qMin( yBlockSize, levelHeight - blockTop );
+
+      key.xBlock = xBlock;
+      key.yBlock = yBlock;
+      QByteArray block = QgsGdalBlockCache::instance()->block( key );
+      if ( block.isNull() )
+      {
+        block.resize( blockWidth * blockHeight * dataSize );
+        CPLErr err = gdalRasterIO( levelBand, GF_Read, blockLeft, blockTop, blockWidth, blockHeight,
+                                   block.data(), blockWidth, blockHeight, type, 0, 0 );
+        if ( err != CE_None )
+          return false;
+
+        QgsGdalBlockCache::instance()->insertBlock( key, block );
+      }
+
+      // copy the part of the block inside the window
+      int left = qMax( blockLeft, levelLeft );
+      int right = qMin( blockLeft + blockWidth, levelLeft + levelXSize );
+      int top = qMax( blockTop, levelTop );
+      int bottom = qMin( blockTop + blockHeight, levelTop + levelYSize );
+      for ( int row = top; row < bottom; row++ )
+      {
+        memcpy( windowData + (( row - levelTop ) * levelXSize + left - levelLeft ) * dataSize,
+                block.constData() + (( row - blockTop ) * blockWidth + left - blockLeft ) * dataSize,
+                ( right - left ) * dataSize );
+      }
+    }
+  }
+
+  if ( resample )
+  {
+    // nearest neighbour from the cell centers, as GDALRasterIO does
+    double xIncrement = ( double ) levelXSize / bufXSize;
+    double yIncrement = ( double ) levelYSize / bufYSize;
+    for ( int row = 0; row < bufYSize; row++ )
+    {
+      int windowRow = qMin( static_cast<int>(( row + 0.5 ) * yIncrement ), levelYSize - 1 );
+      const char *src = windowData + windowRow * levelXSize * dataSize;
+      char *dst = ( char * )data + row * bufXSize * dataSize;
+      for ( int col = 0; col < bufXSize; col++ )
+      {
+        int windowCol = qMin( static_cast<int>(( col + 0.5 ) * xIncrement ), levelXSize - 1 );
+        memcpy( dst + col * dataSize, src + windowCol * dataSize, dataSize );
+      }
+    }
+  }
+
+  return true;
+}
+
 //void * QgsGdalProvider::readBlock( int bandNo, QgsRectangle  const & extent, int width, int height )
 //{
 //  return 0;
@@ -1688,6 +1859,12 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
     mGdalDataset = mGdalBaseDataset;
   }
 
+  // the cached blocks of the overviews are not valid anymore
+  if ( !mBlockCacheKey.isEmpty() )
+  {
+    QgsGdalBlockCache::instance()->removeDataset( mBlockCacheKey );
+  }
+
   //emit drawingProgress( 0, 0 );
   return NULL; // returning null on success
 }
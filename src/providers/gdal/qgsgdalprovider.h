@@ -260,6 +260,12 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     /**Do some initialisation on the dataset (e.g. handling of south-up datasets)*/
     void initBaseDataset();
 
+    /** Reads a window of a band like GDALRasterIO, but assembles it from the blocks
+     * in the shared block cache and resamples it afterwards (nearest neighbour).
+     * Returns false if the window cannot be read through the cache.
+     */
+    bool readCachedRasterIO( int theBandNo, int xOff, int yOff, int xSize, int ySize, void *data, int bufXSize, int bufYSize );
+
     /**
     * Flag indicating if the layer data source is a valid layer
     */
@@ -303,6 +309,9 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
 
     /** \brief sublayers list saved for subsequent access */
     QStringList mSubLayers;
+
+    /** \brief identifies the dataset in the block cache, empty if the cache is not used */
+    QString mBlockCacheKey;
 };
 
 #endif
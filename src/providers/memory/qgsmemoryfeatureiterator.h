@@ -18,6 +18,7 @@
 #include "qgsfeatureiterator.h"
 
 class QgsMemoryProvider;
+class QgsPreparedGeometry;
 
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
 
@@ -63,7 +64,7 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
     bool nextFeatureUsingList( QgsFeature& feature );
     bool nextFeatureTraverseAll( QgsFeature& feature );
 
-    QgsGeometry* mSelectRectGeom;
+    QgsPreparedGeometry* mSelectRectGeom;
     QgsFeatureMap::const_iterator mSelectIterator;
     bool mUsingFeatureIdList;
     QList<QgsFeatureId> mFeatureIdList;
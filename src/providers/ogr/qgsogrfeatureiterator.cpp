@@ -24,6 +24,7 @@
 
 #include <QTextCodec>
 #include <QFile>
+#include <QThread>
 
 // using from provider:
 // - setRelevantFields(), mRelevantFieldsForNextFeature
@@ -32,6 +33,26 @@
 // - mAttributeFields
 // - mEncoding
 
+// features fetched synchronously before reading ahead in a background thread,
+// so that short requests (identify, small extents) do not pay for the thread
+static const int READ_AHEAD_THRESHOLD = 64;
+// number of features handed over to the consumer at once
+static const int READ_AHEAD_BATCH_SIZE = 256;
+// maximal number of batches queued before the background thread waits
+static const int READ_AHEAD_MAX_BATCHES = 4;
+
+class QgsOgrFeatureReadAhead : public QThread
+{
+  public:
+    QgsOgrFeatureReadAhead( QgsOgrFeatureIterator* iterator ) : mIterator( iterator ) {}
+
+  protected:
+    void run() { mIterator->readAhead(); }
+
+  private:
+    QgsOgrFeatureIterator* mIterator;
+};
+
 
 QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource( source, ownSource, request )
@@ -39,6 +60,12 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     , ogrLayer( 0 )
     , mSubsetStringSet( false )
     , mGeometrySimplifier( NULL )
+    , mFilterRectGeom( NULL )
+    , mFetchedCount( 0 )
+    , mReadAhead( 0 )
+    , mReadAheadFinished( false )
+    , mStopReadAhead( 0 )
+    , mCurrentBatchIndex( 0 )
 {
   mFeatureFetched = false;
 
@@ -60,6 +87,8 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
   }
 
   mFetchGeometry = ( mRequest.filterType() == QgsFeatureRequest::FilterRect ) || !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+  // the geometry is also needed to filter features by their geometry type
+  bool readGeometry = mFetchGeometry || mSource->mOgrGeometryTypeFilter != wkbUnknown;
   QgsAttributeList attrs = ( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes ) ? mRequest.subsetOfAttributes() : mSource->mFields.allAttributesList();
 
   // make sure we fetch just relevant fields
@@ -68,7 +97,7 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
   // filter if we choose to ignore them (fixes #11223)
   if ( mSource->mDriverName != "OGR_VRT" || mRequest.filterType() != QgsFeatureRequest::FilterRect )
   {
-    QgsOgrUtils::setRelevantFields( ogrLayer, mSource->mFields.count(), mFetchGeometry, attrs );
+    QgsOgrUtils::setRelevantFields( ogrLayer, mSource->mFields.count(), readGeometry, attrs );
   }
 
   // spatial query to select features
@@ -83,6 +112,9 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     QgsDebugMsg( "Setting spatial filter using " + wktExtent );
     OGR_L_SetSpatialFilter( ogrLayer, filter );
     OGR_G_DestroyGeometry( filter );
+
+    if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
+      mFilterRectGeom = new QgsPreparedGeometry( mRequest.filterRect() );
   }
   else
   {
@@ -95,10 +127,14 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
 
 QgsOgrFeatureIterator::~QgsOgrFeatureIterator()
 {
+  // stops reading ahead, which uses the simplifier and the filter geometry
+  close();
+
   delete mGeometrySimplifier;
   mGeometrySimplifier = NULL;
 
-  close();
+  delete mFilterRectGeom;
+  mFilterRectGeom = NULL;
 }
 
 bool QgsOgrFeatureIterator::prepareSimplification( const QgsSimplifyMethod& simplifyMethod )
@@ -179,6 +215,9 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
     return true;
   }
 
+  if ( mReadAhead )
+    return fetchFeatureReadAhead( feature );
+
   OGRFeatureH fet;
 
   while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
@@ -189,6 +228,11 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
     // we have a feature, end this cycle
     feature.setValid( true );
     OGR_F_Destroy( fet );
+
+    // the consumer iterates over many features: overlap reading with its processing
+    if ( ++mFetchedCount == READ_AHEAD_THRESHOLD )
+      startReadAhead();
+
     return true;
 
   } // while
@@ -198,11 +242,128 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
 }
 
 
+bool QgsOgrFeatureIterator::fetchFeatureReadAhead( QgsFeature& feature )
+{
+  if ( mCurrentBatchIndex >= mCurrentBatch.size() )
+  {
+    QMutexLocker locker( &mReadAheadMutex );
+    while ( mBatches.isEmpty() && !mReadAheadFinished )
+      mBatchQueued.wait( &mReadAheadMutex );
+
+    if ( mBatches.isEmpty() )
+    {
+      locker.unlock();
+      close();
+      return false;
+    }
+
+    mCurrentBatch = mBatches.dequeue();
+    mCurrentBatchIndex = 0;
+    mBatchTaken.wakeOne();
+  }
+
+  // hand over the attributes and the geometry read in the background without copying them
+  QgsFeature& f = mCurrentBatch[mCurrentBatchIndex++];
+  feature.setFeatureId( f.id() );
+  feature.setAttributes( f.attributes() );
+  feature.setFields( &mSource->mFields );
+  feature.setGeometry( f.geometryAndOwnership() );
+  feature.setValid( true );
+  return true;
+}
+
+
+void QgsOgrFeatureIterator::startReadAhead()
+{
+  mReadAheadFinished = false;
+  mStopReadAhead = 0;
+  mCurrentBatch.clear();
+  mCurrentBatchIndex = 0;
+
+  mReadAhead = new QgsOgrFeatureReadAhead( this );
+  mReadAhead->start();
+}
+
+
+void QgsOgrFeatureIterator::stopReadAhead()
+{
+  if ( !mReadAhead )
+    return;
+
+  {
+    QMutexLocker locker( &mReadAheadMutex );
+    mStopReadAhead = 1;
+    mBatchTaken.wakeAll();
+  }
+
+  mReadAhead->wait();
+  delete mReadAhead;
+  mReadAhead = 0;
+
+  mBatches.clear();
+  mCurrentBatch.clear();
+  mCurrentBatchIndex = 0;
+}
+
+
+void QgsOgrFeatureIterator::readAhead()
+{
+  bool finished = false;
+  while ( !finished )
+  {
+    // the capacity is reserved up front: growing the vector would copy the features and their geometries
+    QVector<QgsFeature> batch;
+    batch.reserve( READ_AHEAD_BATCH_SIZE );
+
+    while ( batch.size() < READ_AHEAD_BATCH_SIZE )
+    {
+      if ( mStopReadAhead )
+        return;
+
+      OGRFeatureH fet = OGR_L_GetNextFeature( ogrLayer );
+      if ( !fet )
+      {
+        finished = true;
+        break;
+      }
+
+      batch.resize( batch.size() + 1 );
+      if ( !readFeature( fet, batch.last() ) )
+      {
+        batch.resize( batch.size() - 1 );
+        continue;
+      }
+
+      OGR_F_Destroy( fet );
+    }
+
+    QMutexLocker locker( &mReadAheadMutex );
+    while ( mBatches.size() >= READ_AHEAD_MAX_BATCHES && !mStopReadAhead )
+      mBatchTaken.wait( &mReadAheadMutex );
+
+    if ( mStopReadAhead )
+      return;
+
+    if ( !batch.isEmpty() )
+    {
+      mBatches.enqueue( batch );
+      // release our reference so that the consumer does not detach (deep copy) the batch
+      batch.clear();
+    }
+    mReadAheadFinished = finished;
+    mBatchQueued.wakeOne();
+  }
+}
+
+
 bool QgsOgrFeatureIterator::rewind()
 {
   if ( mClosed )
     return false;
 
+  stopReadAhead();
+  mFetchedCount = 0;
+
   OGR_L_ResetReading( ogrLayer );
 
   return true;
@@ -214,6 +375,8 @@ bool QgsOgrFeatureIterator::close()
   if ( mClosed )
     return false;
 
+  stopReadAhead();
+
   iteratorClosed();
 
   if ( mSubsetStringSet )
@@ -279,7 +442,7 @@ bool QgsOgrFeatureIterator::readFeature( OGRFeatureH fet, QgsFeature& feature )
   feature.initAttributes( mSource->mFields.count() );
   feature.setFields( &mSource->mFields ); // allow name-based attribute lookups
 
-  bool useIntersect = mRequest.flags() & QgsFeatureRequest::ExactIntersect;
+  bool useIntersect = mFilterRectGeom != NULL;
   bool geometryTypeFilter = mSource->mOgrGeometryTypeFilter != wkbUnknown;
   if ( mFetchGeometry || useIntersect || geometryTypeFilter )
   {
@@ -301,7 +464,7 @@ bool QgsOgrFeatureIterator::readFeature( OGRFeatureH fet, QgsFeature& feature )
     else
       feature.setGeometry( 0 );
 
-    if (( useIntersect && ( !feature.geometry() || !feature.geometry()->intersects( mRequest.filterRect() ) ) )
+    if (( useIntersect && ( !feature.geometry() || !mFilterRectGeom->intersects( feature.geometry() ) ) )
         || ( geometryTypeFilter && ( !feature.geometry() || QgsOgrProvider::ogrWkbSingleFlatten(( OGRwkbGeometryType )feature.geometry()->wkbType() ) != mSource->mOgrGeometryTypeFilter ) ) )
     {
       OGR_F_Destroy( fet );
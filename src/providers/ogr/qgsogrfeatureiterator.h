@@ -17,11 +17,19 @@
 
 #include "qgsfeatureiterator.h"
 
+#include <QAtomicInt>
+#include <QMutex>
+#include <QQueue>
+#include <QVector>
+#include <QWaitCondition>
+
 #include <ogr_api.h>
 
 class QgsOgrFeatureIterator;
+class QgsOgrFeatureReadAhead;
 class QgsOgrProvider;
 class QgsOgrAbstractGeometrySimplifier;
+class QgsPreparedGeometry;
 
 class QgsOgrFeatureSource : public QgsAbstractFeatureSource
 {
@@ -69,6 +77,18 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     //! Get an attribute associated with a feature
     void getFeatureAttribute( OGRFeatureH ogrFet, QgsFeature & f, int attindex );
 
+    //! Take next feature read by the background thread, return true on success
+    bool fetchFeatureReadAhead( QgsFeature& feature );
+
+    //! Start reading features in a background thread, the layer must not be used by this thread until it is stopped
+    void startReadAhead();
+
+    //! Stop the background thread and drop the features it has queued
+    void stopReadAhead();
+
+    //! Read features in batches and queue them (runs in the background thread)
+    void readAhead();
+
     bool mFeatureFetched;
 
     OGRDataSourceH ogrDataSource;
@@ -83,8 +103,31 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     //! optional object to simplify OGR-geometries fecthed by this feature iterator
     QgsOgrAbstractGeometrySimplifier* mGeometrySimplifier;
 
+    //! prepared filter rectangle for exact intersection tests
+    QgsPreparedGeometry* mFilterRectGeom;
+
     //! returns whether the iterator supports simplify geometries on provider side
     virtual bool providerCanSimplify( QgsSimplifyMethod::MethodType methodType ) const;
+
+    //! number of features fetched synchronously since the last rewind
+    int mFetchedCount;
+
+    //! thread reading features ahead of the consumer, null while reading synchronously
+    QgsOgrFeatureReadAhead* mReadAhead;
+    QMutex mReadAheadMutex;
+    //! signalled when a batch has been queued or reading has finished
+    QWaitCondition mBatchQueued;
+    //! signalled when a batch has been taken or reading should stop
+    QWaitCondition mBatchTaken;
+    //! batches of features read ahead (features own their geometry until they are taken)
+    QQueue< QVector<QgsFeature> > mBatches;
+    bool mReadAheadFinished;
+    QAtomicInt mStopReadAhead;
+    //! batch being consumed and the index of its next feature
+    QVector<QgsFeature> mCurrentBatch;
+    int mCurrentBatchIndex;
+
+    friend class QgsOgrFeatureReadAhead;
 };
 
 #endif // QGSOGRFEATUREITERATOR_H
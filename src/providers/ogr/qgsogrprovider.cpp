@@ -469,7 +469,7 @@ bool QgsOgrProvider::setSubsetString( QString theSQL, bool updateFeatureCount )
 {
   QgsCPLErrorHandler handler;
 
-  if ( theSQL == mSubsetString && featuresCounted >= 0 )
+  if ( theSQL == mSubsetString && valid )
     return true;
 
   OGRLayerH prevLayer = ogrLayer;
@@ -522,11 +522,11 @@ bool QgsOgrProvider::setSubsetString( QString theSQL, bool updateFeatureCount )
 
   OGR_L_ResetReading( ogrLayer );
 
-  // getting the total number of features in the layer
-  // TODO: This can be expensive, do we really need it!
+  // the total number of features in the layer can be expensive to get
+  // (e.g. it needs a full scan for some formats), it is counted on first use
   if ( updateFeatureCount )
   {
-    recalculateFeatureCount();
+    featuresCounted = -1;
   }
 
   // check the validity of the layer
@@ -943,6 +943,9 @@ QGis::WkbType QgsOgrProvider::geometryType() const
  */
 long QgsOgrProvider::featureCount() const
 {
+  if ( featuresCounted < 0 && ogrLayer )
+    recalculateFeatureCount();
+
   return featuresCounted;
 }
 
@@ -1090,7 +1093,7 @@ bool QgsOgrProvider::addFeatures( QgsFeatureList & flist )
     returnvalue = false;
   }
 
-  recalculateFeatureCount();
+  featuresCounted = -1;
 
   if ( returnvalue )
     clearMinMaxCache();
@@ -1389,7 +1392,7 @@ bool QgsOgrProvider::deleteFeatures( const QgsFeatureIds & id )
     returnvalue = false;
   }
 
-  recalculateFeatureCount();
+  featuresCounted = -1;
 
   clearMinMaxCache();
 
@@ -2465,7 +2468,7 @@ bool QgsOgrProvider::syncToDisc()
   return true;
 }
 
-void QgsOgrProvider::recalculateFeatureCount()
+void QgsOgrProvider::recalculateFeatureCount() const
 {
   OGRGeometryH filter = OGR_L_GetSpatialFilter( ogrLayer );
   if ( filter )
@@ -2484,7 +2487,7 @@ void QgsOgrProvider::recalculateFeatureCount()
   {
     featuresCounted = 0;
     OGR_L_ResetReading( ogrLayer );
-    setRelevantFields( ogrLayer, true, QgsAttributeList() );
+    QgsOgrUtils::setRelevantFields( ogrLayer, mAttributeFields.count(), true, QgsAttributeList() );
     OGR_L_ResetReading( ogrLayer );
     OGRFeatureH fet;
     while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
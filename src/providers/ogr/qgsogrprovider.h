@@ -268,7 +268,7 @@ class QgsOgrProvider : public QgsVectorDataProvider
     void loadFields();
 
     /** find out the number of features of the whole layer */
-    void recalculateFeatureCount();
+    void recalculateFeatureCount() const;
 
     /** tell OGR, which fields to fetch in nextFeature/featureAtId (ie. which not to ignore) */
     void setRelevantFields( OGRLayerH ogrLayer, bool fetchGeometry, const QgsAttributeList& fetchAttributes );
@@ -326,7 +326,8 @@ class QgsOgrProvider : public QgsVectorDataProvider
     //! Flag to indicate that spatial intersect should be used in selecting features
     bool mUseIntersect;
     OGRwkbGeometryType geomType;
-    long featuresCounted;
+    //! number of features, -1 if not counted yet
+    mutable long featuresCounted;
 
     //! Data has been modified - REPACK before creating a spatialindex
     bool mDataModified;
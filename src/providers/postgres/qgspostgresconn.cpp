@@ -129,6 +129,7 @@ Oid QgsPostgresResult::PQoidValue()
 
 QMap<QString, QgsPostgresConn *> QgsPostgresConn::sConnectionsRO;
 QMap<QString, QgsPostgresConn *> QgsPostgresConn::sConnectionsRW;
+QMutex QgsPostgresConn::sConnectionsMutex;
 const int QgsPostgresConn::sGeomTypeSelectLimit = 100;
 
 QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly, bool shared )
@@ -138,6 +139,7 @@ QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly, bo
 
   if ( shared )
   {
+    QMutexLocker locker( &sConnectionsMutex );
     if ( connections.contains( conninfo ) )
     {
       QgsDebugMsg( QString( "Using cached connection for %1" ).arg( conninfo ) );
@@ -146,6 +148,7 @@ QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly, bo
     }
   }
 
+  // connecting is not done under the lock, so that other databases can be connected meanwhile
   QgsPostgresConn *conn = new QgsPostgresConn( conninfo, readonly, shared );
 
   if ( conn->mRef == 0 )
@@ -156,6 +159,15 @@ QgsPostgresConn *QgsPostgresConn::connectDb( QString conninfo, bool readonly, bo
 
   if ( shared )
   {
+    QMutexLocker locker( &sConnectionsMutex );
+    if ( connections.contains( conninfo ) )
+    {
+      // connected concurrently by another thread
+      conn->mRef = 0;
+      delete conn;
+      connections[conninfo]->mRef++;
+      return connections[conninfo];
+    }
     connections.insert( conninfo, conn );
   }
 
@@ -277,11 +289,13 @@ QgsPostgresConn::~QgsPostgresConn()
 
 void QgsPostgresConn::disconnect()
 {
-  if ( --mRef > 0 )
-    return;
-
   if ( mShared )
   {
+    // the reference count of shared connections is only changed under the lock
+    QMutexLocker locker( &sConnectionsMutex );
+    if ( --mRef > 0 )
+      return;
+
     QMap<QString, QgsPostgresConn *>& connections = mReadOnly ? sConnectionsRO : sConnectionsRW;
 
     QString key = connections.key( this, QString::null );
@@ -289,6 +303,10 @@ void QgsPostgresConn::disconnect()
     Q_ASSERT( !key.isNull() );
     connections.remove( key );
   }
+  else if ( --mRef > 0 )
+  {
+    return;
+  }
 
   delete this;
 }
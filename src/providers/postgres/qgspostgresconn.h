@@ -22,6 +22,7 @@
 #include <QStringList>
 #include <QVector>
 #include <QMap>
+#include <QMutex>
 
 #include "qgis.h"
 #include "qgsdatasourceuri.h"
@@ -315,6 +316,8 @@ class QgsPostgresConn : public QObject
 
     static QMap<QString, QgsPostgresConn *> sConnectionsRW;
     static QMap<QString, QgsPostgresConn *> sConnectionsRO;
+    //! guards the shared connections, providers may be opened concurrently (e.g. when a project is loaded)
+    static QMutex sConnectionsMutex;
 
     /** count number of spatial columns in a given relation */
     void addColumnInfo( QgsPostgresLayerProperty& layerProperty, const QString& schemaName, const QString& viewName, bool fetchPkCandidates );
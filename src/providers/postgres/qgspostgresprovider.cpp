@@ -2674,7 +2674,14 @@ bool QgsPostgresProvider::getGeometryDetails()
   mDetectedGeomType = QgsPostgresConn::wkbTypeFromPostgis( detectedType );
   mDetectedSrid     = detectedSrid;
 
-  if ( mDetectedGeomType == QGis::WKBUnknown )
+  if ( mDetectedGeomType == QGis::WKBUnknown && mUseEstimatedMetadata &&
+       mRequestedGeomType != QGis::WKBUnknown && !mRequestedSrid.isEmpty() )
+  {
+    // the type and srid stored in the uri (e.g. in the project file) are trusted
+    // instead of scanning the table for the types it contains
+    QgsDebugMsg( "Using requested type and srid of generic geometry column" );
+  }
+  else if ( mDetectedGeomType == QGis::WKBUnknown )
   {
     mDetectedSrid = "";
 
@@ -702,6 +702,7 @@ error:
 
 
 QMap < QString, QgsSqliteHandle * > QgsSqliteHandle::handles;
+QMutex QgsSqliteHandle::handlesMutex;
 
 
 bool QgsSqliteHandle::checkMetadata( sqlite3 *handle )
@@ -735,6 +736,8 @@ QgsSqliteHandle* QgsSqliteHandle::openDb( const QString & dbPath, bool shared )
 
   //QMap < QString, QgsSqliteHandle* >&handles = QgsSqliteHandle::handles;
 
+  QMutexLocker locker( &handlesMutex );
+
   if ( shared && handles.contains( dbPath ) )
   {
     QgsDebugMsg( QString( "Using cached connection for %1" ).arg( dbPath ) );
@@ -782,6 +785,8 @@ void QgsSqliteHandle::closeDb( QgsSqliteHandle * &handle )
   }
   else
   {
+    QMutexLocker locker( &handlesMutex );
+
     QMap < QString, QgsSqliteHandle * >::iterator i;
     for ( i = handles.begin(); i != handles.end() && i.value() != handle; ++i )
       ;
@@ -802,6 +807,8 @@ void QgsSqliteHandle::closeDb( QgsSqliteHandle * &handle )
 
 void QgsSqliteHandle::closeAll()
 {
+  QMutexLocker locker( &handlesMutex );
+
   QMap < QString, QgsSqliteHandle * >::iterator i;
   for ( i = handles.begin(); i != handles.end(); ++i )
   {
@@ -812,8 +819,48 @@ void QgsSqliteHandle::closeAll()
   handles.clear();
 }
 
+sqlite3_stmt *QgsSqliteHandle::prepareStatement( const QString& sql )
+{
+  QByteArray sqlUtf8 = sql.toUtf8();
+  for ( int i = 0; i < mStatements.size(); ++i )
+  {
+    if ( sqlUtf8 == sqlite3_sql( mStatements[i] ) )
+      return mStatements.takeAt( i );
+  }
+
+  sqlite3_stmt *stmt = NULL;
+  if ( sqlite3_prepare_v2( sqlite_handle, sqlUtf8.constData(), -1, &stmt, NULL ) != SQLITE_OK )
+  {
+    sqlite3_finalize( stmt );
+    return NULL;
+  }
+  return stmt;
+}
+
+void QgsSqliteHandle::releaseStatement( sqlite3_stmt *stmt )
+{
+  if ( !stmt )
+    return;
+
+  sqlite3_reset( stmt );
+  sqlite3_clear_bindings( stmt );
+  mStatements.prepend( stmt );
+
+  // a few statements are enough for the requests repeated on a connection
+  while ( mStatements.size() > 8 )
+  {
+    sqlite3_finalize( mStatements.takeLast() );
+  }
+}
+
 void QgsSqliteHandle::sqliteClose()
 {
+  foreach ( sqlite3_stmt *stmt, mStatements )
+  {
+    sqlite3_finalize( stmt );
+  }
+  mStatements.clear();
+
   if ( sqlite_handle )
   {
     sqlite3_close( sqlite_handle );
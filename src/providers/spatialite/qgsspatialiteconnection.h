@@ -17,6 +17,7 @@
 
 #include <QStringList>
 #include <QObject>
+#include <QMutex>
 
 extern "C"
 {
@@ -163,12 +164,32 @@ class QgsSqliteHandle
     static void closeAll();
     //static void closeDb( QMap < QString, QgsSqliteHandle * >&handlesRO, QgsSqliteHandle * &handle );
 
+    /**
+     * Prepare a statement, reusing one given back with releaseStatement() for the same SQL.
+     * Parameters bound to the statement make it reusable across requests.
+     * Returns NULL on error.
+     * @note added in 2.8
+     */
+    sqlite3_stmt *prepareStatement( const QString& sql );
+
+    /**
+     * Reset a statement from prepareStatement() and keep it for later,
+     * the statements used least recently are finalized.
+     * @note added in 2.8
+     */
+    void releaseStatement( sqlite3_stmt *stmt );
+
   private:
     int ref;
     sqlite3 *sqlite_handle;
     QString mDbPath;
 
+    //! prepared statements released for reuse, the most recent first
+    QList<sqlite3_stmt *> mStatements;
+
     static QMap < QString, QgsSqliteHandle * > handles;
+    //! guards handles, providers may be opened concurrently (e.g. when a project is loaded)
+    static QMutex handlesMutex;
 };
 
 
@@ -44,6 +44,17 @@ QgsSpatiaLiteFeatureIterator::QgsSpatiaLiteFeatureIterator( QgsSpatiaLiteFeature
     whereClause += whereClauseFid();
   }
 
+  if ( request.hasFilterFidRange() )
+  {
+    if ( !whereClause.isEmpty() )
+    {
+      whereClause += " AND ";
+    }
+    // the ranges come from the ROWID of the table (or the pkid of its R*Tree),
+    // which may differ from a declared primary key
+    whereClause += "ROWID BETWEEN ?5 AND ?6";
+  }
+
   if ( !mSource->mSubsetString.isEmpty() )
   {
     if ( !whereClause.isEmpty() )
@@ -85,8 +96,6 @@ bool QgsSpatiaLiteFeatureIterator::fetchFeature( QgsFeature& feature )
 
   if ( !getFeature( sqliteStatement, feature ) )
   {
-    sqlite3_finalize( sqliteStatement );
-    sqliteStatement = NULL;
     close();
     return false;
   }
@@ -120,7 +129,8 @@ bool QgsSpatiaLiteFeatureIterator::close()
 
   if ( sqliteStatement )
   {
-    sqlite3_finalize( sqliteStatement );
+    // kept by the connection for the next request with the same SQL
+    mHandle->releaseStatement( sqliteStatement );
     sqliteStatement = NULL;
   }
 
@@ -162,7 +172,8 @@ bool QgsSpatiaLiteFeatureIterator::prepareStatement( QString whereClause )
 
     if ( mFetchGeometry )
     {
-      sql += QString( ", AsBinary(%1)" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) );
+      // the native BLOB is decoded in getFeatureGeometry(), there is no need for AsBinary()
+      sql += QString( ", %1" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) );
       mGeomColIdx = colIdx;
     }
     sql += QString( " FROM %1" ).arg( mSource->mQuery );
@@ -170,12 +181,32 @@ bool QgsSpatiaLiteFeatureIterator::prepareStatement( QString whereClause )
     if ( !whereClause.isEmpty() )
       sql += QString( " WHERE %1" ).arg( whereClause );
 
-    if ( sqlite3_prepare_v2( mHandle->handle(), sql.toUtf8().constData(), -1, &sqliteStatement, NULL ) != SQLITE_OK )
+    sqliteStatement = mHandle->prepareStatement( sql );
+    if ( !sqliteStatement )
     {
       // some error occurred
       QgsMessageLog::logMessage( QObject::tr( "SQLite error: %2\nSQL: %1" ).arg( sql ).arg( sqlite3_errmsg( mHandle->handle() ) ), QObject::tr( "SpatiaLite" ) );
       return false;
     }
+
+    // the filter values are bound, so that the statement is the same for all the requests
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
+    {
+      sqlite3_bind_int64( sqliteStatement, 1, mRequest.filterFid() );
+    }
+    else if ( mRequest.filterType() == QgsFeatureRequest::FilterRect && sqlite3_bind_parameter_index( sqliteStatement, "?1" ) > 0 )
+    {
+      QgsRectangle rect = mRequest.filterRect();
+      sqlite3_bind_double( sqliteStatement, 1, rect.xMinimum() );
+      sqlite3_bind_double( sqliteStatement, 2, rect.yMinimum() );
+      sqlite3_bind_double( sqliteStatement, 3, rect.xMaximum() );
+      sqlite3_bind_double( sqliteStatement, 4, rect.yMaximum() );
+    }
+    if ( mRequest.hasFilterFidRange() )
+    {
+      sqlite3_bind_int64( sqliteStatement, 5, mRequest.filterFidRangeMin() );
+      sqlite3_bind_int64( sqliteStatement, 6, mRequest.filterFidRangeMax() );
+    }
   }
   catch ( QgsSpatiaLiteProvider::SLFieldNotFound )
   {
@@ -193,7 +224,7 @@ QString QgsSpatiaLiteFeatureIterator::quotedPrimaryKey()
 
 QString QgsSpatiaLiteFeatureIterator::whereClauseFid()
 {
-  return QString( "%1=%2" ).arg( quotedPrimaryKey() ).arg( mRequest.filterFid() );
+  return QString( "%1=?1" ).arg( quotedPrimaryKey() );
 }
 
 QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
@@ -201,25 +232,25 @@ QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
   QgsRectangle rect = mRequest.filterRect();
   QString whereClause;
 
+  // the rectangle is bound to the parameters ?1 to ?4 (xmin, ymin, xmax, ymax)
+  QString mbr = "?1, ?2, ?3, ?4";
+
   if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
   {
     // we are requested to evaluate a true INTERSECT relationship
-    whereClause += QString( "Intersects(%1, BuildMbr(%2)) AND " ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr( rect ) );
+    whereClause += QString( "Intersects(%1, BuildMbr(%2)) AND " ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr );
   }
   if ( mSource->mVShapeBased )
   {
     // handling a VirtualShape layer
-    whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr( rect ) );
+    whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr );
   }
   else if ( rect.isFinite() )
   {
     if ( mSource->spatialIndexRTree )
     {
       // using the RTree spatial index
-      QString mbrFilter = QString( "xmin <= %1 AND " ).arg( qgsDoubleToString( rect.xMaximum() ) );
-      mbrFilter += QString( "xmax >= %1 AND " ).arg( qgsDoubleToString( rect.xMinimum() ) );
-      mbrFilter += QString( "ymin <= %1 AND " ).arg( qgsDoubleToString( rect.yMaximum() ) );
-      mbrFilter += QString( "ymax >= %1" ).arg( qgsDoubleToString( rect.yMinimum() ) );
+      QString mbrFilter = "xmin <= ?3 AND xmax >= ?1 AND ymin <= ?4 AND ymax >= ?2";
       QString idxName = QString( "idx_%1_%2" ).arg( mSource->mIndexTable ).arg( mSource->mIndexGeometry );
       whereClause += QString( "%1 IN (SELECT pkid FROM %2 WHERE %3)" )
                      .arg( quotedPrimaryKey() )
@@ -233,12 +264,12 @@ QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
       whereClause += QString( "%1 IN (SELECT rowid FROM %2 WHERE mbr = FilterMbrIntersects(%3))" )
                      .arg( quotedPrimaryKey() )
                      .arg( QgsSpatiaLiteProvider::quotedIdentifier( idxName ) )
-                     .arg( mbr( rect ) );
+                     .arg( mbr );
     }
     else
     {
       // using simple MBR filtering
-      whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr( rect ) );
+      whereClause += QString( "MbrIntersects(%1, BuildMbr(%2))" ).arg( QgsSpatiaLiteProvider::quotedIdentifier( mSource->mGeometryColumn ) ).arg( mbr );
     }
   }
   else
@@ -249,16 +280,6 @@ QString QgsSpatiaLiteFeatureIterator::whereClauseRect()
 }
 
 
-QString QgsSpatiaLiteFeatureIterator::mbr( const QgsRectangle& rect )
-{
-  return QString( "%1, %2, %3, %4" )
-         .arg( qgsDoubleToString( rect.xMinimum() ) )
-         .arg( qgsDoubleToString( rect.yMinimum() ) )
-         .arg( qgsDoubleToString( rect.xMaximum() ) )
-         .arg( qgsDoubleToString( rect.yMaximum() ) );
-}
-
-
 QString QgsSpatiaLiteFeatureIterator::fieldName( const QgsField& fld )
 {
   QString fieldname = QgsSpatiaLiteProvider::quotedIdentifier( fld.name() );
@@ -368,8 +389,8 @@ void QgsSpatiaLiteFeatureIterator::getFeatureGeometry( sqlite3_stmt* stmt, int i
     size_t geom_size = 0;
     const void *blob = sqlite3_column_blob( stmt, ic );
     size_t blob_size = sqlite3_column_bytes( stmt, ic );
-    QgsSpatiaLiteProvider::convertToGeosWKB(( const unsigned char * )blob, blob_size,
-                                            &featureGeom, &geom_size );
+    QgsSpatiaLiteProvider::convertSpatiaLiteBlobToGeosWKB(( const unsigned char * )blob, blob_size,
+        &featureGeom, &geom_size );
     if ( featureGeom )
       feature.setGeometryAndOwnership( featureGeom, geom_size );
     else
@@ -389,6 +410,7 @@ QgsSpatiaLiteFeatureSource::QgsSpatiaLiteFeatureSource( const QgsSpatiaLiteProvi
     , mFields( p->attributeFields )
     , mQuery( p->mQuery )
     , isQuery( p->isQuery )
+    , mTableBased( p->mTableBased )
     , mVShapeBased( p->mVShapeBased )
     , mIndexTable( p->mIndexTable )
     , mIndexGeometry( p->mIndexGeometry )
@@ -407,3 +429,85 @@ QgsFeatureIterator QgsSpatiaLiteFeatureSource::getFeatures( const QgsFeatureRequ
 {
   return QgsFeatureIterator( new QgsSpatiaLiteFeatureIterator( this, false, request ) );
 }
+
+QList<QgsFeatureRequest> QgsSpatiaLiteFeatureSource::partitionRequest( const QgsFeatureRequest& request, int maxParts )
+{
+  // each part is read on its own pooled connection
+  int partCount = qMin( maxParts, QgsSpatiaLiteConnPool::instance()->maxConcurrentConnections( mSqlitePath ) );
+
+  // only the tables can be read by ranges of ROWID efficiently
+  if ( partCount < 2 || !mTableBased || isQuery || mVShapeBased
+       || request.filterType() == QgsFeatureRequest::FilterFid
+       || request.filterType() == QgsFeatureRequest::FilterFids )
+    return QgsAbstractFeatureSource::partitionRequest( request, maxParts );
+
+  // range of the ROWID of the features, the R*Tree gives it for the requested rectangle
+  QString sql;
+  bool bindRect = false;
+  if ( request.filterType() == QgsFeatureRequest::FilterRect && !mGeometryColumn.isNull()
+       && spatialIndexRTree && request.filterRect().isFinite() )
+  {
+    QString idxName = QString( "idx_%1_%2" ).arg( mIndexTable ).arg( mIndexGeometry );
+    sql = QString( "SELECT min(pkid), max(pkid) FROM %1 WHERE xmin <= ?3 AND xmax >= ?1 AND ymin <= ?4 AND ymax >= ?2" )
+          .arg( QgsSpatiaLiteProvider::quotedIdentifier( idxName ) );
+    bindRect = true;
+  }
+  else
+  {
+    sql = QString( "SELECT min(ROWID), max(ROWID) FROM %1" ).arg( mQuery );
+  }
+
+  QgsSqliteHandle* handle = QgsSpatiaLiteConnPool::instance()->acquireConnection( mSqlitePath );
+  if ( !handle )
+    return QgsAbstractFeatureSource::partitionRequest( request, maxParts );
+
+  bool found = false;
+  QgsFeatureId minFid = 0;
+  QgsFeatureId maxFid = 0;
+  sqlite3_stmt *stmt = handle->prepareStatement( sql );
+  if ( stmt )
+  {
+    if ( bindRect )
+    {
+      QgsRectangle rect = request.filterRect();
+      sqlite3_bind_double( stmt, 1, rect.xMinimum() );
+      sqlite3_bind_double( stmt, 2, rect.yMinimum() );
+      sqlite3_bind_double( stmt, 3, rect.xMaximum() );
+      sqlite3_bind_double( stmt, 4, rect.yMaximum() );
+    }
+    if ( sqlite3_step( stmt ) == SQLITE_ROW && sqlite3_column_type( stmt, 0 ) == SQLITE_INTEGER )
+    {
+      minFid = sqlite3_column_int64( stmt, 0 );
+      maxFid = sqlite3_column_int64( stmt, 1 );
+      found = true;
+    }
+    handle->releaseStatement( stmt );
+  }
+  else
+  {
+    QgsMessageLog::logMessage( QObject::tr( "SQLite error: %2\nSQL: %1" ).arg( sql ).arg( sqlite3_errmsg( handle->handle() ) ), QObject::tr( "SpatiaLite" ) );
+  }
+  QgsSpatiaLiteConnPool::instance()->releaseConnection( handle );
+
+  if ( request.hasFilterFidRange() )
+  {
+    minFid = qMax( minFid, request.filterFidRangeMin() );
+    maxFid = qMin( maxFid, request.filterFidRangeMax() );
+  }
+
+  // small ranges are not worth the additional connections
+  quint64 span = ( quint64 ) maxFid - ( quint64 ) minFid + 1;
+  if ( !found || maxFid < minFid || span / partCount < 1000 )
+    return QgsAbstractFeatureSource::partitionRequest( request, maxParts );
+
+  QList<QgsFeatureRequest> parts;
+  quint64 step = span / partCount;
+  for ( int i = 0; i < partCount; ++i )
+  {
+    QgsFeatureId first = minFid + ( qint64 )( step * i );
+    QgsFeatureId last = i == partCount - 1 ? maxFid : first + ( qint64 ) step - 1;
+    parts << QgsFeatureRequest( request ).setFilterFidRange( first, last );
+  }
+  QgsDebugMsg( QString( "%1 parts of about %2 ids" ).arg( partCount ).arg( step ) );
+  return parts;
+}
@@ -34,12 +34,16 @@ class QgsSpatiaLiteFeatureSource : public QgsAbstractFeatureSource
 
     virtual QgsFeatureIterator getFeatures( const QgsFeatureRequest& request );
 
+    //! Split the request of a table into ranges of ROWID (found with the R*Tree for rectangles)
+    virtual QList<QgsFeatureRequest> partitionRequest( const QgsFeatureRequest& request, int maxParts );
+
   protected:
     QString mGeometryColumn;
     QString mSubsetString;
     QgsFields mFields;
     QString mQuery;
     bool isQuery;
+    bool mTableBased;
     bool mVShapeBased;
     QString mIndexTable;
     QString mIndexGeometry;
@@ -71,7 +75,6 @@ class QgsSpatiaLiteFeatureIterator : public QgsAbstractFeatureIteratorFromSource
 
     QString whereClauseRect();
     QString whereClauseFid();
-    QString mbr( const QgsRectangle& rect );
     bool prepareStatement( QString whereClause );
     QString quotedPrimaryKey();
     bool getFeature( sqlite3_stmt *stmt, QgsFeature &feature );
@@ -3160,6 +3160,186 @@ int QgsSpatiaLiteProvider::computeMultiWKB3Dsize( const unsigned char *p_in, int
   return size;
 }
 
+bool QgsSpatiaLiteProvider::convertSpatiaLiteGeometry( const unsigned char *&p_in, const unsigned char *end,
+    int type, int little_endian, int endian_arch,
+    unsigned char *wkb, size_t &size )
+{
+// converting one geometry of a native BLOB, the geometry class type being already read
+// if wkb is NULL only the required size is computed
+  int inDims;
+  int outDims;
+  bool measure = false;
+  switch ( type / 1000 )
+  {
+    case 0:
+      inDims = outDims = 2;
+      break;
+    case 1:
+      inDims = outDims = 3;
+      break;
+    case 2:
+      // the M values are returned as Z = 0.0, like convertToGeosWKB does
+      inDims = outDims = 3;
+      measure = true;
+      break;
+    case 3:
+      inDims = 4;
+      outDims = 3;
+      break;
+    default:
+      // compressed geometries
+      return false;
+  }
+  int baseType = type % 1000;
+  if ( baseType < GAIA_POINT || baseType > GAIA_GEOMETRYCOLLECTION )
+    return false;
+
+  if ( wkb )
+  {
+    wkb[size] = 0x01; // little endian byte order
+    gaiaExport32( wkb + size + 1, outDims == 2 ? baseType : GEOS_3D_POINT + baseType - GAIA_POINT, 1, endian_arch );
+  }
+  size += 5;
+
+  int items = 1;
+  if ( baseType != GAIA_POINT )
+  {
+    if ( end - p_in < 4 )
+      return false;
+    items = gaiaImport32( p_in, little_endian, endian_arch );
+    if ( items < 0 )
+      return false;
+    if ( wkb )
+      gaiaExport32( wkb + size, items, 1, endian_arch );
+    p_in += 4;
+    size += 4;
+  }
+
+  if ( baseType >= GAIA_MULTIPOINT )
+  {
+    // the entities are marked by GAIA_MARK_ENTITY instead of the byte order
+    for ( int ie = 0; ie < items; ie++ )
+    {
+      if ( end - p_in < 5 || *p_in != GAIA_MARK_ENTITY )
+        return false;
+      int entityType = gaiaImport32( p_in + 1, little_endian, endian_arch );
+      if ( entityType / 1000 != type / 1000 || entityType % 1000 > GAIA_POLYGON )
+        return false;
+      p_in += 5;
+      if ( !convertSpatiaLiteGeometry( p_in, end, entityType, little_endian, endian_arch, wkb, size ) )
+        return false;
+    }
+    return true;
+  }
+
+  for ( int ib = 0; ib < ( baseType == GAIA_POLYGON ? items : 1 ); ib++ )
+  {
+    int points = items;
+    if ( baseType == GAIA_POLYGON )
+    {
+      if ( end - p_in < 4 )
+        return false;
+      points = gaiaImport32( p_in, little_endian, endian_arch );
+      if ( points < 0 )
+        return false;
+      if ( wkb )
+        gaiaExport32( wkb + size, points, 1, endian_arch );
+      p_in += 4;
+      size += 4;
+    }
+
+    size_t inPointSize = inDims * sizeof( double );
+    size_t outPointSize = outDims * sizeof( double );
+    if (( size_t )( end - p_in ) / inPointSize < ( size_t ) points )
+      return false;
+
+    if ( wkb )
+    {
+      unsigned char *p_out = wkb + size;
+      if ( little_endian == GAIA_LITTLE_ENDIAN && inDims == outDims && !measure )
+      {
+        // same layout: the coordinates are copied at once
+        memcpy( p_out, p_in, points * inPointSize );
+      }
+      else
+      {
+        const unsigned char *p_point = p_in;
+        for ( int iv = 0; iv < points; iv++ )
+        {
+          if ( little_endian == GAIA_LITTLE_ENDIAN && !measure )
+          {
+            memcpy( p_out, p_point, outPointSize );
+          }
+          else
+          {
+            gaiaExport64( p_out, gaiaImport64( p_point, little_endian, endian_arch ), 1, endian_arch );  // X
+            gaiaExport64( p_out + sizeof( double ), gaiaImport64( p_point + sizeof( double ), little_endian, endian_arch ), 1, endian_arch );  // Y
+            if ( outDims == 3 )
+              gaiaExport64( p_out + 2 * sizeof( double ), measure ? 0.0 : gaiaImport64( p_point + 2 * sizeof( double ), little_endian, endian_arch ), 1, endian_arch );  // Z
+          }
+          p_point += inPointSize;
+          p_out += outPointSize;
+        }
+      }
+    }
+    p_in += points * inPointSize;
+    size += points * outPointSize;
+  }
+
+  return true;
+}
+
+void QgsSpatiaLiteProvider::convertSpatiaLiteBlobToGeosWKB( const unsigned char *blob,
+    size_t blob_size,
+    unsigned char **wkb,
+    size_t *geom_size )
+{
+// converting a native SpatiaLite BLOB to the same WKB as convertToGeosWKB( AsBinary() )
+  int endian_arch = gaiaEndianArch();
+
+  *wkb = NULL;
+  *geom_size = 0;
+
+  // START, byte order, SRID, MBR, MBR_END, class type, geometry, END
+  if ( blob_size >= 44 && blob[0] == GAIA_MARK_START && blob[38] == GAIA_MARK_MBR
+       && blob[blob_size - 1] == GAIA_MARK_END
+       && ( blob[1] == GAIA_LITTLE_ENDIAN || blob[1] == GAIA_BIG_ENDIAN ) )
+  {
+    int little_endian = blob[1];
+    int type = gaiaImport32( blob + 39, little_endian, endian_arch );
+    const unsigned char *end = blob + blob_size - 1;
+    const unsigned char *p_in = blob + 43;
+    size_t size = 0;
+
+    // the first pass only computes the size, so that the WKB is allocated once
+    if ( convertSpatiaLiteGeometry( p_in, end, type, little_endian, endian_arch, NULL, size ) && p_in == end )
+    {
+      unsigned char *wkbGeom = new unsigned char[size];
+      p_in = blob + 43;
+      size = 0;
+      convertSpatiaLiteGeometry( p_in, end, type, little_endian, endian_arch, wkbGeom, size );
+      *wkb = wkbGeom;
+      *geom_size = size;
+      return;
+    }
+  }
+
+  // compressed geometries (or anything else) are decoded by SpatiaLite
+  gaiaGeomCollPtr geom = gaiaFromSpatiaLiteBlobWkb( blob, blob_size );
+  if ( !geom )
+    return;
+
+  unsigned char *ogcWkb = NULL;
+  int ogcSize = 0;
+  gaiaToWkb( geom, &ogcWkb, &ogcSize );
+  gaiaFreeGeomColl( geom );
+  if ( ogcWkb )
+  {
+    convertToGeosWKB( ogcWkb, ogcSize, wkb, geom_size );
+    free( ogcWkb );
+  }
+}
+
 QString QgsSpatiaLiteProvider::subsetString()
 {
   return mSubsetString;
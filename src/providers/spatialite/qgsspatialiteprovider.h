@@ -425,7 +425,16 @@ class QgsSpatiaLiteProvider: public QgsVectorDataProvider
                                   unsigned char **wkb, size_t *geom_size );
     static int computeMultiWKB3Dsize( const unsigned char *p_in, int little_endian,
                                       int endian_arch );
+    /** Convert a native SpatiaLite BLOB geometry to the WKB returned by convertToGeosWKB
+     * for AsBinary(), without the round trip through SQL
+     * @note added in 2.8
+     */
+    static void convertSpatiaLiteBlobToGeosWKB( const unsigned char *blob, size_t blob_size,
+        unsigned char **wkb, size_t *geom_size );
   private:
+    static bool convertSpatiaLiteGeometry( const unsigned char *&p_in, const unsigned char *end,
+                                           int type, int little_endian, int endian_arch,
+                                           unsigned char *wkb, size_t &size );
     int computeSizeFromMultiWKB2D( const unsigned char *p_in, int nDims,
                                    int little_endian,
                                    int endian_arch );
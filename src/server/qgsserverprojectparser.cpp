@@ -23,6 +23,7 @@
 #include "qgsdatasourceuri.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmslayercache.h"
+#include "qgsproviderregistry.h"
 #include "qgsrasterlayer.h"
 
 #include <QDomDocument>
@@ -78,8 +79,28 @@ void QgsServerProjectParser::projectLayerMap( QMap<QString, QgsMapLayer*>& layer
 {
   layerMap.clear();
 
+  //open the data providers of the layers which are not cached yet concurrently
+  QList< QPair<QString, QString> > sources;
   QList<QDomElement>::const_iterator layerElemIt = mProjectLayerElements.constBegin();
   for ( ; layerElemIt != mProjectLayerElements.constEnd(); ++layerElemIt )
+  {
+    QString type = layerElemIt->attribute( "type" );
+    QString provider = layerElemIt->firstChildElement( "provider" ).text();
+    if ( layerElemIt->attribute( "embedded" ) == "1" || ( type != "vector" && type != "raster" ) || provider.isEmpty() )
+    {
+      continue;
+    }
+
+    QString absoluteUri = absoluteDataSource( *layerElemIt );
+    if ( !QgsMSLayerCache::instance()->searchLayer( absoluteUri, layerId( *layerElemIt ) ) )
+    {
+      sources << qMakePair( provider, QgsMapLayer::dataSourceFromXML( *layerElemIt ) );
+    }
+  }
+  QgsProviderRegistry::instance()->preloadProviders( sources );
+
+  layerElemIt = mProjectLayerElements.constBegin();
+  for ( ; layerElemIt != mProjectLayerElements.constEnd(); ++layerElemIt )
   {
     QgsMapLayer *layer = createLayerFromElement( *layerElemIt );
     if ( layer )
@@ -87,6 +108,8 @@ void QgsServerProjectParser::projectLayerMap( QMap<QString, QgsMapLayer*>& layer
       layerMap.insert( layer->id(), layer );
     }
   }
+
+  QgsProviderRegistry::instance()->clearPreloadedProviders();
 }
 
 QString QgsServerProjectParser::convertToAbsolutePath( const QString& file ) const
@@ -141,16 +164,8 @@ QString QgsServerProjectParser::convertToAbsolutePath( const QString& file ) con
   return projElems.join( "/" );
 }
 
-QgsMapLayer* QgsServerProjectParser::createLayerFromElement( const QDomElement& elem, bool useCache ) const
+QString QgsServerProjectParser::absoluteDataSource( const QDomElement& elem ) const
 {
-  if ( elem.isNull() || !mXMLDoc )
-  {
-    return 0;
-  }
-
-  addJoinLayersForElement( elem, useCache );
-  addValueRelationLayersForElement( elem, useCache );
-
   QDomElement dataSourceElem = elem.firstChildElement( "datasource" );
   QString uri = dataSourceElem.text();
   QString absoluteUri;
@@ -202,6 +217,21 @@ QgsMapLayer* QgsServerProjectParser::createLayerFromElement( const QDomElement&
     }
   }
 
+  return absoluteUri;
+}
+
+QgsMapLayer* QgsServerProjectParser::createLayerFromElement( const QDomElement& elem, bool useCache ) const
+{
+  if ( elem.isNull() || !mXMLDoc )
+  {
+    return 0;
+  }
+
+  addJoinLayersForElement( elem, useCache );
+  addValueRelationLayersForElement( elem, useCache );
+
+  QString absoluteUri = absoluteDataSource( elem );
+
   QString id = layerId( elem );
   QgsMapLayer* layer = 0;
   if ( useCache )
@@ -46,6 +46,10 @@ class QgsServerProjectParser
     /**Converts a (possibly relative) path to absolute*/
     QString convertToAbsolutePath( const QString& file ) const;
 
+    /**Converts the data source of a <maplayer> element to absolute paths (the element is updated)
+    @return the data source with absolute paths*/
+    QString absoluteDataSource( const QDomElement& elem ) const;
+
     /**Creates a maplayer object from <maplayer> element. The layer cash owns the maplayer, so don't delete it
     @return the maplayer or 0 in case of error*/
     QgsMapLayer* createLayerFromElement( const QDomElement& elem, bool useCache = true ) const;
@@ -1192,7 +1192,11 @@ QImage* QgsWMSServer::getMap( HitTest* hitTest )
   if ( hitTest )
     runHitTest( &thePainter, *hitTest );
   else
+  {
+    // many points are drawn faster from sprites, vector output still gets exact symbols
+    mMapRenderer->rendererContext()->setUseMarkerSprites( true );
     mMapRenderer->render( &thePainter );
+  }
 
   if ( mConfigParser )
   {
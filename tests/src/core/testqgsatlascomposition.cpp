@@ -21,6 +21,7 @@
 #include "qgscomposermap.h"
 #include "qgscomposermapoverview.h"
 #include "qgsatlascomposition.h"
+#include "qgsatlasexporter.h"
 #include "qgscomposerlabel.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaprenderer.h"
@@ -66,6 +67,8 @@ class TestQgsAtlasComposition: public QObject
     void test_signals();
     // test removing coverage layer while atlas is enabled
     void test_remove_layer();
+    // test that the images written by the exporter match the sequential rendering
+    void exporter_render();
 
   private:
     QgsComposition* mComposition;
@@ -449,5 +452,40 @@ void TestQgsAtlasComposition::test_remove_layer()
   QVERIFY( spyToggled.count() == 1 );
 }
 
+void TestQgsAtlasComposition::exporter_render()
+{
+  mAtlasMap->setAtlasDriven( true );
+  mAtlasMap->setAtlasScalingMode( QgsComposerMap::Auto );
+  mAtlasMap->setAtlasMargin( 0.10 );
+  mAtlas->setFilenamePattern( "'exporter_' || $feature" );
+  mComposition->setPrintResolution( 96 );
+
+  QDir dir( QDir::tempPath() );
+  dir.mkpath( "qgis_atlas_exporter" );
+  dir.cd( "qgis_atlas_exporter" );
+
+  mAtlas->beginRender();
+  QgsAtlasExporter exporter( mComposition );
+  exporter.setThreadCount( 4 );
+  QVERIFY( exporter.exportImages( dir.path(), "png", ".png" ) );
+  QVERIFY( exporter.errorMessage().isEmpty() );
+  mAtlas->endRender();
+
+  mAtlas->beginRender();
+  QVERIFY( mAtlas->numFeatures() > 1 );
+  for ( int fit = 0; fit < mAtlas->numFeatures(); ++fit )
+  {
+    QVERIFY( mAtlas->prepareForFeature( fit ) );
+    QImage expected = mComposition->printPageAsRaster( 0 ).convertToFormat( QImage::Format_ARGB32 );
+
+    QString filename = dir.filePath( mAtlas->currentFilename() + ".png" );
+    QImage exported( filename );
+    QVERIFY( !exported.isNull() );
+    QCOMPARE( exported.convertToFormat( QImage::Format_ARGB32 ), expected );
+    QFile::remove( filename );
+  }
+  mAtlas->endRender();
+}
+
 QTEST_MAIN( TestQgsAtlasComposition )
 #include "testqgsatlascomposition.moc"
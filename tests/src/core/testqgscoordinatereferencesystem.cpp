@@ -46,6 +46,9 @@ class TestQgsCoordinateReferenceSystem: public QObject
     void createFromESRIWkt();
     void createFromSrsId();
     void createFromProj4();
+    void createFromProj4Normalized();
+    void createFromProj4SwappedParallels();
+    void findMatchingProj();
     void isValid();
     void validate();
     void equality();
@@ -286,6 +289,45 @@ void TestQgsCoordinateReferenceSystem::createFromProj4()
   QVERIFY( myCrs.createFromProj4( GEOPROJ4 ) );
   debugPrint( myCrs );
 }
+void TestQgsCoordinateReferenceSystem::createFromProj4Normalized()
+{
+  // parameters in different order and with standard parallels swapped
+  // should still match the system CRS (EPSG:3035 in srs.db)
+  QgsCoordinateReferenceSystem myCrs;
+  QVERIFY( myCrs.createFromProj4( "+units=m +lat_0=52 +lon_0=10 +proj=laea +x_0=4321000 +y_0=3210000 +ellps=GRS80 +towgs84=0,0,0,0,0,0,0 +no_defs" ) );
+  QCOMPARE( myCrs.authid(), QString( "EPSG:3035" ) );
+
+  QgsCoordinateReferenceSystem myCrs2;
+  QVERIFY( myCrs2.createFromOgcWmsCrs( "EPSG:4326" ) );
+  QCOMPARE( myCrs2.srsid(), ( long ) GEOCRS_ID );
+}
+void TestQgsCoordinateReferenceSystem::createFromProj4SwappedParallels()
+{
+  // standard parallels are ordered numerically: "+lat_1=8 +lat_2=18" in srs.db (EPSG:102007)
+  QgsCoordinateReferenceSystem myCrs;
+  QVERIFY( myCrs.createFromProj4( "+proj=aea +lat_1=18 +lat_2=8 +lat_0=13 +lon_0=-157 +x_0=0 +y_0=0 +datum=NAD83 +units=m +no_defs" ) );
+  QCOMPARE( myCrs.authid(), QString( "EPSG:102007" ) );
+
+  QgsCoordinateReferenceSystem myCrs2;
+  QVERIFY( myCrs2.createFromProj4( "+units=m +proj=aea +lat_2=8 +lat_1=18 +lat_0=13 +lon_0=-157 +x_0=0 +y_0=0 +datum=NAD83 +no_defs" ) );
+  QCOMPARE( myCrs2.authid(), QString( "EPSG:102007" ) );
+
+  // negative parallels (EPSG:3577)
+  QgsCoordinateReferenceSystem myCrs3;
+  QVERIFY( myCrs3.createFromProj4( "+proj=aea +lat_1=-36 +lat_2=-18 +lat_0=0 +lon_0=132 +x_0=0 +y_0=0 +ellps=GRS80 +towgs84=0,0,0,0,0,0,0 +units=m +no_defs" ) );
+  QCOMPARE( myCrs3.authid(), QString( "EPSG:3577" ) );
+}
+void TestQgsCoordinateReferenceSystem::findMatchingProj()
+{
+  // the system CRS with exactly the same proj4 definition is found
+  QgsCoordinateReferenceSystem myCrs;
+  QVERIFY( myCrs.createFromSrsId( GEOCRS_ID ) );
+  QCOMPARE( myCrs.findMatchingProj(), ( long ) GEOCRS_ID );
+
+  QgsCoordinateReferenceSystem myCrs2;
+  QVERIFY( myCrs2.createFromOgcWmsCrs( "EPSG:102007" ) );
+  QCOMPARE( myCrs2.findMatchingProj(), myCrs2.srsid() );
+}
 void TestQgsCoordinateReferenceSystem::isValid()
 {
   QgsCoordinateReferenceSystem myCrs;
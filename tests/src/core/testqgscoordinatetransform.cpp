@@ -15,9 +15,36 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgscoordinatetransform.h"
+#include "qgsapproximatetransform.h"
 #include "qgsapplication.h"
+#include "qgscsexception.h"
+#include "qgsgeometry.h"
 #include <QObject>
 #include <QtTest/QtTest>
+#include <QtConcurrentMap>
+
+// transforms a point with a new transform (used from several threads)
+static QgsPoint transformWithNewTransform( const QgsPoint& p )
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+  return tr.transform( p );
+}
+
+// transforms points (used from several threads)
+struct TransformPoint
+{
+  typedef QgsPoint result_type;
+
+  TransformPoint( const QgsCoordinateTransform& tr ) : mTransform( tr ) {}
+
+  QgsPoint operator()( const QgsPoint& p ) { return mTransform.transform( p ); }
+
+  const QgsCoordinateTransform& mTransform;
+};
 
 class TestQgsCoordinateTransform: public QObject
 {
@@ -27,6 +54,10 @@ class TestQgsCoordinateTransform: public QObject
     void initTestCase();
     void cleanupTestCase();
     void transformBoundingBox();
+    void transformInterleaved();
+    void transformInterleavedFailure();
+    void transformsOfOtherThreads();
+    void approximateTransform();
 
   private:
 
@@ -67,5 +98,135 @@ void TestQgsCoordinateTransform::transformBoundingBox()
   QVERIFY( qgsDoubleNear( resultRect.yMaximum(), expectedRect.yMaximum(), 0.001 ) );
 }
 
+void TestQgsCoordinateTransform::transformInterleaved()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  QList<QgsPoint> points;
+  QVector<double> xy;
+  for ( int i = 0; i < 1000; ++i )
+  {
+    QgsPoint p( -170 + i * 0.34, -80 + i * 0.16 );
+    points << p;
+    xy << p.x() << p.y();
+  }
+
+  // batched transform gives the same results as transforms of single points
+  tr.transformInPlace( points.count(), xy.data() );
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    QgsPoint p = tr.transform( points[i] );
+    QVERIFY( qgsDoubleNear( xy[2 * i], p.x(), 0.001 ) );
+    QVERIFY( qgsDoubleNear( xy[2 * i + 1], p.y(), 0.001 ) );
+  }
+
+  // the transform may be used by several threads at once
+  QList<QgsPoint> results = QtConcurrent::blockingMapped( points, TransformPoint( tr ) );
+  QCOMPARE( results.count(), points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    QVERIFY( qgsDoubleNear( xy[2 * i], results[i].x(), 0.001 ) );
+    QVERIFY( qgsDoubleNear( xy[2 * i + 1], results[i].y(), 0.001 ) );
+  }
+}
+
+void TestQgsCoordinateTransform::transformInterleavedFailure()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  // the pole cannot be projected to web mercator, a batched transform fails
+  // like the transform of the single point does
+  QVector<double> xy;
+  xy << 10 << 50 << 10 << 90 << 20 << 50;
+  bool thrown = false;
+  try
+  {
+    tr.transformInPlace( 3, xy.data() );
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    thrown = true;
+  }
+  QVERIFY( thrown );
+
+  QgsPolyline line;
+  line << QgsPoint( 10, 50 ) << QgsPoint( 10, 90 ) << QgsPoint( 20, 50 );
+  QScopedPointer<QgsGeometry> geom( QgsGeometry::fromPolyline( line ) );
+  thrown = false;
+  try
+  {
+    geom->transform( tr );
+  }
+  catch ( QgsCsException &cse )
+  {
+    Q_UNUSED( cse );
+    thrown = true;
+  }
+  QVERIFY( thrown );
+
+  // the bounding box of an extent reaching the pole is still computed from the valid points
+  QgsRectangle rect = tr.transformBoundingBox( QgsRectangle( 10, 50, 20, 90 ) );
+  QVERIFY( !rect.isEmpty() );
+  QVERIFY( rect.isFinite() );
+}
+
+void TestQgsCoordinateTransform::transformsOfOtherThreads()
+{
+  // the projections of transforms used and destroyed in worker threads
+  // are released in all threads, more transforms than the per-thread cache holds
+  QList<QgsPoint> points;
+  for ( int i = 0; i < 600; ++i )
+    points << QgsPoint( -170 + i * 0.5, -80 + i * 0.25 );
+
+  QList<QgsPoint> results = QtConcurrent::blockingMapped( points, transformWithNewTransform );
+  QCOMPARE( results.count(), points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    QgsPoint p = transformWithNewTransform( points[i] );
+    QVERIFY( qgsDoubleNear( results[i].x(), p.x(), 0.001 ) );
+    QVERIFY( qgsDoubleNear( results[i].y(), p.y(), 0.001 ) );
+  }
+}
+
+void TestQgsCoordinateTransform::approximateTransform()
+{
+  QgsCoordinateReferenceSystem sourceSrs;
+  sourceSrs.createFromSrid( 4326 );
+  QgsCoordinateReferenceSystem destSrs;
+  destSrs.createFromSrid( 3857 );
+  QgsCoordinateTransform tr( sourceSrs, destSrs );
+
+  // Europe, with tolerance of 1 km (a quarter of pixel of a map 1000 pixels wide)
+  QgsApproximateTransform approx( &tr, QgsRectangle( -10, 35, 30, 70 ), 1000 );
+  QVERIFY( approx.isValid() );
+
+  QPolygonF poly;
+  for ( int i = 0; i < 100; ++i )
+    poly << QPointF( -15 + i * 0.45, 30 + i * 0.42 ); // the first and last points are outside the grid
+  QPolygonF exact( poly );
+  tr.transformPolygon( exact );
+  approx.transformPolygon( poly );
+  for ( int i = 0; i < poly.count(); ++i )
+  {
+    QVERIFY( qgsDoubleNear( poly[i].x(), exact[i].x(), 1000 ) );
+    QVERIFY( qgsDoubleNear( poly[i].y(), exact[i].y(), 1000 ) );
+  }
+
+  double x = 12.5, y = 41.9;
+  approx.transformInPlace( x, y );
+  QgsPoint p = tr.transform( 12.5, 41.9 );
+  QVERIFY( qgsDoubleNear( x, p.x(), 1000 ) );
+  QVERIFY( qgsDoubleNear( y, p.y(), 1000 ) );
+}
+
 QTEST_MAIN( TestQgsCoordinateTransform )
 #include "testqgscoordinatetransform.moc"
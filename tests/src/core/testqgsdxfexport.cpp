@@ -0,0 +1,159 @@
+/***************************************************************************
+     testqgsdxfexport.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QBuffer>
+#include <QThreadPool>
+
+#include "qgis.h"
+#include "qgsapplication.h"
+#include "qgsdxfexport.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsvectorlayer.h"
+
+class TestQgsDxfExport: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void deterministicOutput();
+    void entityHandles();
+    void sameAsTextStreamWriter();
+
+  private:
+    QByteArray exportLayers( QgsDxfExport::SymbologyExport symbology );
+
+    QList<QgsVectorLayer*> mLayers;
+};
+
+void TestQgsDxfExport::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  QString dataDir( TEST_DATA_DIR ); //defined in CmakeLists.txt
+  foreach ( QString name, QStringList() << "points" << "lines" << "polys" )
+  {
+    QgsVectorLayer* layer = new QgsVectorLayer( dataDir + QDir::separator() + name + ".shp", name, "ogr" );
+    QVERIFY( layer->isValid() );
+    QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << layer );
+    mLayers << layer;
+  }
+}
+
+void TestQgsDxfExport::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QByteArray TestQgsDxfExport::exportLayers( QgsDxfExport::SymbologyExport symbology )
+{
+  QList< QPair<QgsVectorLayer*, int> > layers;
+  foreach ( QgsVectorLayer* layer, mLayers )
+    layers << qMakePair( layer, -1 );
+
+  QgsDxfExport dxf;
+  dxf.addLayers( layers );
+  dxf.setSymbologyScaleDenominator( 1000 );
+  dxf.setSymbologyExport( symbology );
+
+  QBuffer buffer;
+  buffer.open( QIODevice::WriteOnly );
+  dxf.writeToFile( &buffer );
+  return buffer.data();
+}
+
+void TestQgsDxfExport::deterministicOutput()
+{
+  // the layers are written in parallel, the file must not depend on the timing
+  QByteArray first = exportLayers( QgsDxfExport::SymbolLayerSymbology );
+  QVERIFY( first.startsWith( "999\nDXF created from QGIS\n" ) );
+  QVERIFY( first.endsWith( "  0\nEOF\n" ) );
+
+  for ( int i = 0; i < 5; ++i )
+    QCOMPARE( exportLayers( QgsDxfExport::SymbolLayerSymbology ), first );
+
+  // one layer written at a time
+  int maxThreadCount = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  QByteArray bounded = exportLayers( QgsDxfExport::SymbolLayerSymbology );
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreadCount );
+  QCOMPARE( bounded, first );
+}
+
+void TestQgsDxfExport::entityHandles()
+{
+  QList<QByteArray> lines = exportLayers( QgsDxfExport::FeatureSymbology ).split( '\n' );
+
+  int start = lines.indexOf( "ENTITIES" );
+  QVERIFY( start > 0 );
+
+  // entity handles are numbered in the order of the layers and features
+  int previous = -1;
+  int count = 0;
+  for ( int i = start + 1; i + 1 < lines.size() && lines[i + 1] != "ENDSEC"; i += 2 )
+  {
+    if ( lines[i] != "  5" )
+      continue;
+
+    bool ok;
+    int handle = lines[i + 1].toInt( &ok, 16 );
+    QVERIFY( ok );
+    if ( previous != -1 )
+      QCOMPARE( handle, previous + 1 );
+    previous = handle;
+    ++count;
+  }
+  QVERIFY( count > 0 );
+}
+
+void TestQgsDxfExport::sameAsTextStreamWriter()
+{
+  // every group is formatted like the former writer did through QTextStream
+  QList<QByteArray> lines = exportLayers( QgsDxfExport::SymbolLayerSymbology ).split( '\n' );
+  QVERIFY( lines.size() > 2 );
+  QVERIFY( lines.last().isEmpty() );
+  lines.removeLast();
+  QVERIFY( lines.size() % 2 == 0 );
+
+  for ( int i = 0; i < lines.size(); i += 2 )
+  {
+    bool ok;
+    int code = lines[i].trimmed().toInt( &ok );
+    QVERIFY( ok );
+    QCOMPARE( QString::fromLatin1( lines[i] ), QString( "%1" ).arg( code, 3, 10, QChar( ' ' ) ) );
+
+    QString value = QString::fromLatin1( lines[i + 1] );
+    if (( code >= 10 && code <= 59 ) || ( code >= 140 && code <= 147 ) || ( code >= 1010 && code <= 1059 ) )
+    {
+      double d = value.toDouble( &ok );
+      QVERIFY( ok );
+      QString expected( qgsDoubleToString( d ) );
+      if ( !expected.contains( "." ) )
+        expected += ".0";
+      QCOMPARE( value, expected );
+    }
+    else if (( code >= 60 && code <= 99 ) || ( code >= 420 && code <= 449 ) || code == 1071 )
+    {
+      int n = value.trimmed().toInt( &ok );
+      QVERIFY( ok );
+      QCOMPARE( value, QString( "%1" ).arg( n, 6, 10, QChar( ' ' ) ) );
+    }
+  }
+}
+
+QTEST_MAIN( TestQgsDxfExport )
+#include "testqgsdxfexport.moc"
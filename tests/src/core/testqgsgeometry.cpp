@@ -65,6 +65,7 @@ class TestQgsGeometry: public QObject
     void differenceCheck1();
     void differenceCheck2();
     void bufferCheck();
+    void preparedGeometryCheck();
 
   private:
     /** A helper method to do a render check to see if the geometry op is as expected */
@@ -437,6 +438,28 @@ bool TestQgsGeometry::renderCheck( QString theTestName, QString theComment , int
   return myResultFlag;
 }
 
+void TestQgsGeometry::preparedGeometryCheck()
+{
+  QgsPreparedGeometry prepared( *mpPolygonGeometryA );
+  QVERIFY( prepared.isValid() );
+  QVERIFY( prepared.intersects( mpPolygonGeometryB ) );
+  QVERIFY( !prepared.intersects( mpPolygonGeometryC ) );
+  QVERIFY( prepared.disjoint( mpPolygonGeometryC ) );
+  QVERIFY( prepared.overlaps( mpPolygonGeometryB ) );
+  QVERIFY( prepared.equals( mpPolygonGeometryA ) );
+  QVERIFY( prepared.contains( mPointA ) );
+  QVERIFY( !prepared.contains( mPointW ) );
+
+  QgsGeometry* point = QgsGeometry::fromPoint( mPointA );
+  QVERIFY( prepared.contains( point ) );
+  QVERIFY( prepared.covers( point ) );
+  delete point;
+
+  QgsPreparedGeometry preparedRect( QgsRectangle( 10, 10, 30, 30 ) );
+  QVERIFY( preparedRect.intersects( mpPolygonGeometryA ) );
+  QVERIFY( !preparedRect.intersects( mpPolygonGeometryC ) );
+}
+
 void TestQgsGeometry::dumpMultiPolygon( QgsMultiPolygon &theMultiPolygon )
 {
   qDebug( "Multipolygon Geometry Dump" );
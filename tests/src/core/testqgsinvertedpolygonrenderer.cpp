@@ -30,6 +30,7 @@
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
 #include <qgsmaplayerregistry.h>
+#include <qgsmaprenderersequentialjob.h>
 //qgis test includes
 #include "qgsmultirenderchecker.h"
 
@@ -48,12 +49,15 @@ class TestQgsInvertedPolygon: public QObject
     void singleSubRenderer();
     void graduatedSubRenderer();
     void preprocess();
+    void preprocessCached();
+    void preprocessCacheChangedFeatures();
     void projectionTest();
 
   private:
     bool mTestHasError;
     bool setQml( QString qmlFile );
     bool imageCheck( QString theType, const QgsRectangle* = 0 );
+    QImage render( const QgsRectangle& extent );
     QgsMapSettings mMapSettings;
     QgsVectorLayer * mpPolysLayer;
     QString mTestDataDir;
@@ -127,6 +131,38 @@ void TestQgsInvertedPolygon::preprocess()
   QVERIFY( imageCheck( "inverted_polys_preprocess" ) );
 }
 
+void TestQgsInvertedPolygon::preprocessCached()
+{
+  mReport += "<h2>Inverted polygon renderer, cached preprocessing test</h2>\n";
+  QVERIFY( setQml( "inverted_polys_preprocess.qml" ) );
+  QVERIFY( imageCheck( "inverted_polys_preprocess" ) );
+  // the second rendering of the same view uses the cached mask
+  QVERIFY( imageCheck( "inverted_polys_preprocess" ) );
+}
+
+void TestQgsInvertedPolygon::preprocessCacheChangedFeatures()
+{
+  QgsRectangle extent = mpPolysLayer->extent();
+  QVERIFY( setQml( "inverted_polys_preprocess.qml" ) );
+  QImage before = render( extent );
+
+  QgsFeature f;
+  QVERIFY( mpPolysLayer->getFeatures().nextFeature( f ) );
+  QVERIFY( mpPolysLayer->startEditing() );
+  QCOMPARE( mpPolysLayer->translateFeature( f.id(), extent.width() / 10, 0 ), 0 );
+
+  // same view, but the mask cached for the previous features must not be used
+  QImage cached = render( extent );
+  QVERIFY( cached != before );
+
+  // a new renderer has an empty cache
+  QVERIFY( setQml( "inverted_polys_preprocess.qml" ) );
+  QImage uncached = render( extent );
+  QVERIFY( cached == uncached );
+
+  mpPolysLayer->rollBack();
+}
+
 void TestQgsInvertedPolygon::projectionTest()
 {
   mReport += "<h2>Inverted polygon renderer, projection test</h2>\n";
@@ -160,6 +196,16 @@ bool TestQgsInvertedPolygon::setQml( QString qmlFile )
   return myStyleFlag;
 }
 
+QImage TestQgsInvertedPolygon::render( const QgsRectangle& extent )
+{
+  mMapSettings.setExtent( extent );
+  mMapSettings.setOutputSize( QSize( 400, 300 ) );
+  QgsMapRendererSequentialJob job( mMapSettings );
+  job.start();
+  job.waitForFinished();
+  return job.renderedImage();
+}
+
 bool TestQgsInvertedPolygon::imageCheck( QString theTestType, const QgsRectangle* extent )
 {
   //use the QgsRenderChecker test utility class to
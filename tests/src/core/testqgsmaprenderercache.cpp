@@ -0,0 +1,163 @@
+/***************************************************************************
+     testqgsmaprenderercache.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+//header for class being tested
+#include <qgsmaprenderercache.h>
+#include <qgsrectangle.h>
+
+class TestQgsMapRendererCache: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void exactImage();
+    void shiftedImage();
+    void previewImage();
+    void limits();
+    void overallLimit();
+
+  private:
+    QImage image( QColor color ) const;
+};
+
+QImage TestQgsMapRendererCache::image( QColor color ) const
+{
+  QImage img( 100, 100, QImage::Format_ARGB32_Premultiplied );
+  img.fill( color.rgba() );
+  return img;
+}
+
+void TestQgsMapRendererCache::exactImage()
+{
+  QgsMapRendererCache cache;
+  QVERIFY( !cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 ) );
+  cache.setCacheImage( "layer", image( Qt::red ) );
+  QVERIFY( !cache.cacheImage( "layer" ).isNull() );
+
+  // another view: the image is kept, but it is not the exact one
+  QVERIFY( !cache.init( QgsRectangle( 10, 0, 110, 100 ), 1000 ) );
+  QVERIFY( cache.cacheImage( "layer" ).isNull() );
+
+  // back to the first view
+  QVERIFY( !cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 ) );
+  QCOMPARE( cache.cacheImage( "layer" ).pixel( 50, 50 ), QColor( Qt::red ).rgba() );
+
+  cache.clearCacheImage( "layer" );
+  QVERIFY( cache.cacheImage( "layer" ).isNull() );
+}
+
+void TestQgsMapRendererCache::shiftedImage()
+{
+  QgsMapRendererCache cache;
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  cache.setCacheImage( "layer", image( Qt::red ) );
+
+  // pan by 10 pixels to the right and 5 pixels up
+  cache.init( QgsRectangle( 10, 5, 110, 105 ), 1000 );
+  QPoint offset;
+  QImage img = cache.shiftedCacheImage( "layer", QSize( 100, 100 ), offset );
+  QVERIFY( !img.isNull() );
+  QCOMPARE( offset, QPoint( -10, 5 ) );
+
+  // sub-pixel shift cannot be reused
+  cache.init( QgsRectangle( 10.5, 0, 110.5, 100 ), 1000 );
+  QVERIFY( cache.shiftedCacheImage( "layer", QSize( 100, 100 ), offset ).isNull() );
+
+  // different scale cannot be reused
+  cache.init( QgsRectangle( 0, 0, 200, 200 ), 2000 );
+  QVERIFY( cache.shiftedCacheImage( "layer", QSize( 100, 100 ), offset ).isNull() );
+
+  // no overlap
+  cache.init( QgsRectangle( 200, 0, 300, 100 ), 1000 );
+  QVERIFY( cache.shiftedCacheImage( "layer", QSize( 100, 100 ), offset ).isNull() );
+}
+
+void TestQgsMapRendererCache::previewImage()
+{
+  QgsMapRendererCache cache;
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  cache.setCacheImage( "layer", image( Qt::red ) );
+
+  // zoom out: the cached image covers the center of the view
+  cache.init( QgsRectangle( -50, -50, 150, 150 ), 2000 );
+  QImage preview = cache.previewImage( "layer", QSize( 100, 100 ) );
+  QVERIFY( !preview.isNull() );
+  QCOMPARE( preview.pixel( 50, 50 ), QColor( Qt::red ).rgba() );
+  QCOMPARE( qAlpha( preview.pixel( 5, 5 ) ), 0 );
+
+  // no overlapping image
+  cache.init( QgsRectangle( 500, 500, 600, 600 ), 1000 );
+  QVERIFY( cache.previewImage( "layer", QSize( 100, 100 ) ).isNull() );
+}
+
+void TestQgsMapRendererCache::limits()
+{
+  QgsMapRendererCache cache;
+  cache.setMaximumImagesPerLayer( 2 );
+  QCOMPARE( cache.maximumImagesPerLayer(), 2 );
+
+  for ( int i = 0; i < 3; ++i )
+  {
+    cache.init( QgsRectangle( i * 10, 0, i * 10 + 100, 100 ), 1000 );
+    cache.setCacheImage( "layer", image( Qt::red ) );
+  }
+
+  // the oldest image has been dropped
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  QVERIFY( cache.cacheImage( "layer" ).isNull() );
+  cache.init( QgsRectangle( 20, 0, 120, 100 ), 1000 );
+  QVERIFY( !cache.cacheImage( "layer" ).isNull() );
+
+  // the most recent image is kept even above the memory limit
+  cache.setMaximumLayerCacheSize( 1 );
+  QVERIFY( !cache.cacheImage( "layer" ).isNull() );
+  cache.init( QgsRectangle( 10, 0, 110, 100 ), 1000 );
+  QVERIFY( cache.cacheImage( "layer" ).isNull() );
+}
+
+void TestQgsMapRendererCache::overallLimit()
+{
+  // room for three images of 100x100 pixels
+  QgsMapRendererCache cache;
+  cache.setMaximumCacheSize( 3 * 100 * 100 * 4 );
+  QCOMPARE( cache.maximumCacheSize(), 3 * 100 * 100 * 4 );
+
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  cache.setCacheImage( "layer1", image( Qt::red ) );
+  cache.setCacheImage( "layer2", image( Qt::green ) );
+  cache.init( QgsRectangle( 10, 0, 110, 100 ), 1000 );
+  cache.setCacheImage( "layer1", image( Qt::blue ) );
+
+  // using the image of layer2 makes the first image of layer1 the least recently used one
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  QVERIFY( !cache.cacheImage( "layer2" ).isNull() );
+  cache.init( QgsRectangle( 20, 0, 120, 100 ), 1000 );
+  cache.setCacheImage( "layer3", image( Qt::black ) );
+
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  QVERIFY( cache.cacheImage( "layer1" ).isNull() );
+  QVERIFY( !cache.cacheImage( "layer2" ).isNull() );
+  cache.init( QgsRectangle( 10, 0, 110, 100 ), 1000 );
+  QVERIFY( !cache.cacheImage( "layer1" ).isNull() );
+
+  // the images of the current view are kept even above the limit
+  cache.setMaximumCacheSize( 0 );
+  QVERIFY( !cache.cacheImage( "layer1" ).isNull() );
+  cache.init( QgsRectangle( 20, 0, 120, 100 ), 1000 );
+  QVERIFY( cache.cacheImage( "layer3" ).isNull() );
+}
+
+QTEST_MAIN( TestQgsMapRendererCache )
+#include "testqgsmaprenderercache.moc"
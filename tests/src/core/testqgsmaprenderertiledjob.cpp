@@ -0,0 +1,190 @@
+/***************************************************************************
+     testqgsmaprenderertiledjob.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+#include <QPainter>
+
+#include "qgsapplication.h"
+#include "qgsfontutils.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsmaprenderercustompainterjob.h"
+#include "qgsmaprenderertiledjob.h"
+#include "qgspallabeling.h"
+#include "qgsvectorlayer.h"
+
+class TestQgsMapRendererTiledJob: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void sameAsCustomPainter_data();
+    void sameAsCustomPainter();
+    void labeling_data();
+    void labeling();
+
+  private:
+    //! render the map, with the custom painter job if the tile size is 0
+    QImage render( int tileSize, QgsLabelingResults** results = 0 );
+    //! number of pixels which differ more than antialiasing rounding
+    int mismatches( const QImage& image, const QImage& expected );
+
+    QgsMapSettings mMapSettings;
+    QgsVectorLayer* mPolysLayer;
+};
+
+void TestQgsMapRendererTiledJob::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  QString dataDir( TEST_DATA_DIR ); //defined in CmakeLists.txt
+  QStringList layerIds;
+  foreach ( QString name, QStringList() << "points" << "lines" << "polys" )
+  {
+    QgsVectorLayer* layer = new QgsVectorLayer( dataDir + QDir::separator() + name + ".shp", name, "ogr" );
+    QVERIFY( layer->isValid() );
+    QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer *>() << layer );
+    layerIds << layer->id();
+    if ( name == "polys" )
+      mPolysLayer = layer;
+  }
+
+  mMapSettings.setLayers( layerIds );
+  mMapSettings.setExtent( QgsRectangle( -118.8888888888888, 22.8002070393376, -83.3333333333333, 46.8719806763285 ) );
+  mMapSettings.setOutputSize( QSize( 600, 400 ) );
+  mMapSettings.setOutputDpi( 96 );
+  mMapSettings.setFlag( QgsMapSettings::Antialiasing );
+}
+
+void TestQgsMapRendererTiledJob::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QImage TestQgsMapRendererTiledJob::render( int tileSize, QgsLabelingResults** results )
+{
+  QImage image( mMapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+  QPainter painter( &image );
+
+  if ( tileSize > 0 )
+  {
+    QgsMapRendererTiledJob job( mMapSettings, &painter, tileSize );
+    job.start();
+    if ( results )
+      *results = job.takeLabelingResults();
+  }
+  else
+  {
+    QgsMapRendererCustomPainterJob job( mMapSettings, &painter );
+    job.renderSynchronously();
+    if ( results )
+      *results = job.takeLabelingResults();
+  }
+
+  painter.end();
+  return image;
+}
+
+void TestQgsMapRendererTiledJob::sameAsCustomPainter_data()
+{
+  QTest::addColumn<int>( "tileSize" );
+  QTest::newRow( "one tile" ) << 4096;
+  QTest::newRow( "tiles" ) << 128;
+  QTest::newRow( "tiles not dividing the size" ) << 150;
+}
+
+void TestQgsMapRendererTiledJob::sameAsCustomPainter()
+{
+  QFETCH( int, tileSize );
+
+  QImage expected = render( 0 );
+  QImage image = render( tileSize );
+  QCOMPARE( image.size(), expected.size() );
+
+  int count = mismatches( image, expected );
+  QVERIFY2( count < image.width() * image.height() / 1000, QString( "%1 pixels differ" ).arg( count ).toLocal8Bit().constData() );
+}
+
+void TestQgsMapRendererTiledJob::labeling_data()
+{
+  sameAsCustomPainter_data();
+}
+
+void TestQgsMapRendererTiledJob::labeling()
+{
+  QFETCH( int, tileSize );
+
+  QgsPalLayerSettings settings;
+  settings.enabled = true;
+  settings.fieldName = "Name";
+  settings.textFont = QgsFontUtils::getStandardTestFont();
+  settings.writeToLayer( mPolysLayer );
+  mMapSettings.setFlag( QgsMapSettings::DrawLabeling );
+
+  QgsLabelingResults* expectedResults = 0;
+  QImage expected = render( 0, &expectedResults );
+  QgsLabelingResults* results = 0;
+  QImage image = render( tileSize, &results );
+
+  mMapSettings.setFlag( QgsMapSettings::DrawLabeling, false );
+  settings.enabled = false;
+  settings.writeToLayer( mPolysLayer );
+
+  QVERIFY( expectedResults );
+  QVERIFY( results );
+  QList<QgsLabelPosition> expectedLabels = expectedResults->labelsWithinRect( mMapSettings.visibleExtent() );
+  QList<QgsLabelPosition> labels = results->labelsWithinRect( mMapSettings.visibleExtent() );
+  delete expectedResults;
+  delete results;
+
+  // every feature is labeled once, also the polygons crossing several tiles
+  QVERIFY( !expectedLabels.isEmpty() );
+  QCOMPARE( labels.count(), expectedLabels.count() );
+  QSet<int> expectedIds, ids;
+  foreach ( const QgsLabelPosition& label, expectedLabels )
+    expectedIds << label.featureId;
+  foreach ( const QgsLabelPosition& label, labels )
+    ids << label.featureId;
+  QCOMPARE( ids, expectedIds );
+
+  int count = mismatches( image, expected );
+  QVERIFY2( count < image.width() * image.height() / 1000, QString( "%1 pixels differ" ).arg( count ).toLocal8Bit().constData() );
+}
+
+int TestQgsMapRendererTiledJob::mismatches( const QImage& image, const QImage& expected )
+{
+  // allow for rounding differences of antialiased edges
+  int count = 0;
+  for ( int y = 0; y < image.height(); ++y )
+  {
+    const QRgb* line = ( const QRgb* ) image.constScanLine( y );
+    const QRgb* expectedLine = ( const QRgb* ) expected.constScanLine( y );
+    for ( int x = 0; x < image.width(); ++x )
+    {
+      if ( qAbs( qRed( line[x] ) - qRed( expectedLine[x] ) ) > 2 ||
+           qAbs( qGreen( line[x] ) - qGreen( expectedLine[x] ) ) > 2 ||
+           qAbs( qBlue( line[x] ) - qBlue( expectedLine[x] ) ) > 2 ||
+           qAbs( qAlpha( line[x] ) - qAlpha( expectedLine[x] ) ) > 2 )
+        ++count;
+    }
+  }
+  return count;
+}
+
+QTEST_MAIN( TestQgsMapRendererTiledJob )
+#include "testqgsmaprenderertiledjob.moc"
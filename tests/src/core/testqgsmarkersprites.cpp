@@ -0,0 +1,218 @@
+/***************************************************************************
+     testqgsmarkersprites.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+#include <QPainter>
+#include <QDomDocument>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsellipsesymbollayerv2.h>
+#include <qgsmarkersymbollayerv2.h>
+#include <qgsrendercontext.h>
+#include <qgssymbollayerv2utils.h>
+#include <qgssymbolv2.h>
+
+/** @ingroup UnitTests
+ * Compares marker symbols drawn from pre-rendered sprites with the direct rendering
+ */
+class TestQgsMarkerSprites: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void disabledByDefault();
+    void simpleMarker();
+    void ellipseMarker();
+    void translatedPainter();
+    void renderContextFlag();
+    void vectorOutput();
+    void savedWithSymbol();
+
+  private:
+    //! draw the symbol at a grid of points with quarter pixel offsets, returns the points drawn from sprites in spriteCount
+    QImage render( QgsMarkerSymbolV2* symbol, bool sprites, const QPointF& translation = QPointF(), int* spriteCount = 0, bool contextSprites = false );
+    //! check that both renderings match within a small color tolerance
+    bool compare( QgsMarkerSymbolV2* symbol, const QPointF& translation = QPointF() );
+};
+
+void TestQgsMarkerSprites::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+}
+
+void TestQgsMarkerSprites::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QImage TestQgsMarkerSprites::render( QgsMarkerSymbolV2* symbol, bool sprites, const QPointF& translation, int* spriteCount, bool contextSprites )
+{
+  QImage image( 300, 300, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+
+  QPainter p( &image );
+  p.setRenderHint( QPainter::Antialiasing, true );
+  p.translate( translation );
+
+  QgsRenderContext context;
+  context.setPainter( &p );
+  context.setScaleFactor( 96 / 25.4 );
+  context.setRasterScaleFactor( 1.0 );
+  context.setUseMarkerSprites( contextSprites );
+
+  symbol->setSpriteRenderingEnabled( sprites );
+  symbol->startRender( context );
+  for ( int i = 0; i < 10; ++i )
+  {
+    for ( int j = 0; j < 10; ++j )
+    {
+      symbol->renderPoint( QPointF( 15 + i * 27.25, 15 + j * 27.5 + i * 0.25 ), 0, context );
+    }
+  }
+  if ( spriteCount )
+    *spriteCount = symbol->spriteDrawCount();
+  symbol->stopRender( context );
+  p.end();
+  return image;
+}
+
+bool TestQgsMarkerSprites::compare( QgsMarkerSymbolV2* symbol, const QPointF& translation )
+{
+  int spriteCount;
+  QImage direct = render( symbol, false, translation, &spriteCount );
+  if ( spriteCount != 0 )
+    return false;
+
+  // all the points are drawn from sprites
+  QImage sprites = render( symbol, true, translation, &spriteCount );
+  if ( spriteCount != 100 )
+    return false;
+
+  // compositing through the sprite image may round colors differently
+  const int tolerance = 8;
+  int mismatches = 0;
+  for ( int y = 0; y < direct.height(); ++y )
+  {
+    const QRgb* directLine = ( const QRgb* ) direct.constScanLine( y );
+    const QRgb* spriteLine = ( const QRgb* ) sprites.constScanLine( y );
+    for ( int x = 0; x < direct.width(); ++x )
+    {
+      QRgb a = directLine[x], b = spriteLine[x];
+      if ( qAbs( qRed( a ) - qRed( b ) ) > tolerance || qAbs( qGreen( a ) - qGreen( b ) ) > tolerance ||
+           qAbs( qBlue( a ) - qBlue( b ) ) > tolerance || qAbs( qAlpha( a ) - qAlpha( b ) ) > tolerance )
+        mismatches++;
+    }
+  }
+  return mismatches == 0;
+}
+
+void TestQgsMarkerSprites::disabledByDefault()
+{
+  QgsMarkerSymbolV2 symbol;
+  QVERIFY( !symbol.isSpriteRenderingEnabled() );
+  symbol.setSpriteRenderingEnabled( true );
+  QScopedPointer<QgsSymbolV2> clone( symbol.clone() );
+  QVERIFY( static_cast<QgsMarkerSymbolV2*>( clone.data() )->isSpriteRenderingEnabled() );
+}
+
+void TestQgsMarkerSprites::simpleMarker()
+{
+  QgsSimpleMarkerSymbolLayerV2* layer = new QgsSimpleMarkerSymbolLayerV2( "circle", QColor( 200, 50, 50 ), QColor( 0, 0, 0 ), 4.3 );
+  QgsSymbolLayerV2List layers;
+  layers << layer;
+  QgsMarkerSymbolV2 symbol( layers );
+  QVERIFY( compare( &symbol ) );
+}
+
+void TestQgsMarkerSprites::ellipseMarker()
+{
+  QgsEllipseSymbolLayerV2* layer = new QgsEllipseSymbolLayerV2();
+  layer->setSymbolWidth( 5.1 );
+  layer->setSymbolHeight( 2.7 );
+  layer->setFillColor( QColor( 50, 50, 200, 150 ) );
+  QgsSymbolLayerV2List layers;
+  layers << layer;
+  QgsMarkerSymbolV2 symbol( layers );
+  QVERIFY( compare( &symbol ) );
+}
+
+void TestQgsMarkerSprites::translatedPainter()
+{
+  QgsSimpleMarkerSymbolLayerV2* layer = new QgsSimpleMarkerSymbolLayerV2( "star", QColor( 50, 200, 50 ), QColor( 0, 0, 0 ), 3.9 );
+  QgsSymbolLayerV2List layers;
+  layers << layer;
+  QgsMarkerSymbolV2 symbol( layers );
+  QVERIFY( compare( &symbol, QPointF( 3.5, -2.75 ) ) );
+}
+
+void TestQgsMarkerSprites::renderContextFlag()
+{
+  QgsSimpleMarkerSymbolLayerV2* layer = new QgsSimpleMarkerSymbolLayerV2( "square", QColor( 200, 50, 50 ), QColor( 0, 0, 0 ), 3.1 );
+  QgsSymbolLayerV2List layers;
+  layers << layer;
+  QgsMarkerSymbolV2 symbol( layers );
+
+  // the context enables sprites for symbols which did not opt in
+  int spriteCount;
+  render( &symbol, false, QPointF(), &spriteCount, true );
+  QCOMPARE( spriteCount, 100 );
+}
+
+void TestQgsMarkerSprites::vectorOutput()
+{
+  QgsSimpleMarkerSymbolLayerV2* layer = new QgsSimpleMarkerSymbolLayerV2( "circle", QColor( 200, 50, 50 ), QColor( 0, 0, 0 ), 4.3 );
+  QgsSymbolLayerV2List layers;
+  layers << layer;
+  QgsMarkerSymbolV2 symbol( layers );
+  symbol.setSpriteRenderingEnabled( true );
+
+  QImage image( 100, 100, QImage::Format_ARGB32_Premultiplied );
+  QPainter p( &image );
+  QgsRenderContext context;
+  context.setPainter( &p );
+  context.setForceVectorOutput( true );
+  context.setUseMarkerSprites( true );
+  symbol.startRender( context );
+  symbol.renderPoint( QPointF( 50, 50 ), 0, context );
+  QCOMPARE( symbol.spriteDrawCount(), 0 );
+  symbol.stopRender( context );
+  p.end();
+}
+
+void TestQgsMarkerSprites::savedWithSymbol()
+{
+  QgsMarkerSymbolV2 symbol;
+  symbol.setSpriteRenderingEnabled( true );
+
+  QDomDocument doc;
+  QDomElement elem = QgsSymbolLayerV2Utils::saveSymbol( "test", &symbol, doc );
+  QScopedPointer<QgsSymbolV2> loaded( QgsSymbolLayerV2Utils::loadSymbol( elem ) );
+  QVERIFY( loaded );
+  QVERIFY( static_cast<QgsMarkerSymbolV2*>( loaded.data() )->isSpriteRenderingEnabled() );
+
+  symbol.setSpriteRenderingEnabled( false );
+  elem = QgsSymbolLayerV2Utils::saveSymbol( "test", &symbol, doc );
+  loaded.reset( QgsSymbolLayerV2Utils::loadSymbol( elem ) );
+  QVERIFY( loaded );
+  QVERIFY( !static_cast<QgsMarkerSymbolV2*>( loaded.data() )->isSpriteRenderingEnabled() );
+}
+
+QTEST_MAIN( TestQgsMarkerSprites )
+#include "testqgsmarkersprites.moc"
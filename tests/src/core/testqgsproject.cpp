@@ -16,7 +16,9 @@
 #include <QObject>
 
 #include <qgsapplication.h>
+#include <qgsdataprovider.h>
 #include <qgsproject.h>
+#include <qgsproviderregistry.h>
 
 
 class TestQgsProject : public QObject
@@ -29,6 +31,7 @@ class TestQgsProject : public QObject
     void cleanup();// will be called after every testfunction.
 
     void testReadPath();
+    void testPreloadProviders();
 };
 
 void TestQgsProject::init()
@@ -43,12 +46,15 @@ void TestQgsProject::cleanup()
 void TestQgsProject::initTestCase()
 {
   // Runs once before any tests are run
+  QgsApplication::init();
+  QgsApplication::initQgis();
 }
 
 
 void TestQgsProject::cleanupTestCase()
 {
   // Runs once after all tests are run
+  QgsApplication::exitQgis();
 }
 
 void TestQgsProject::testReadPath()
@@ -72,6 +78,32 @@ void TestQgsProject::testReadPath()
 
 }
 
+void TestQgsProject::testPreloadProviders()
+{
+  QString myDataDir( TEST_DATA_DIR ); //defined in CmakeLists.txt
+  QList< QPair<QString, QString> > sources;
+  sources << qMakePair( QString( "ogr" ), myDataDir + "/points.shp" );
+  sources << qMakePair( QString( "ogr" ), myDataDir + "/lines.shp" );
+
+  QgsProviderRegistry* registry = QgsProviderRegistry::instance();
+  registry->preloadProviders( sources );
+
+  // the preloaded provider is handed over to the calling thread
+  QgsDataProvider* provider = registry->provider( "ogr", myDataDir + "/points.shp" );
+  QVERIFY( provider );
+  QVERIFY( provider->isValid() );
+  QCOMPARE( provider->thread(), QThread::currentThread() );
+
+  // and used only once
+  QgsDataProvider* provider2 = registry->provider( "ogr", myDataDir + "/points.shp" );
+  QVERIFY( provider2 );
+  QVERIFY( provider2 != provider );
+
+  delete provider;
+  delete provider2;
+  registry->clearPreloadedProviders();
+}
+
 
 QTEST_MAIN( TestQgsProject )
 #include "testqgsproject.moc"
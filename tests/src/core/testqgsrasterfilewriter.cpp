@@ -47,8 +47,9 @@ class TestQgsRasterFileWriter: public QObject
     void cleanup() {};// will be called after every testfunction.
 
     void writeTest();
+    void writeTiledTest();
   private:
-    bool writeTest( QString rasterName );
+    bool writeTest( QString rasterName, bool tiled = false );
     void log( QString msg );
     void logError( QString msg );
     QString mTestDataDir;
@@ -102,7 +103,14 @@ void TestQgsRasterFileWriter::writeTest()
   QVERIFY( allOK );
 }
 
-bool TestQgsRasterFileWriter::writeTest( QString theRasterName )
+void TestQgsRasterFileWriter::writeTiledTest()
+{
+  // the parts are read in parallel and written in order to the part files and the vrt
+  QVERIFY( writeTest( "raster/band3_byte_noct_epsg4326.tif", true ) );
+  QVERIFY( writeTest( "raster/band1_byte_ct_epsg4326.tif", true ) );
+}
+
+bool TestQgsRasterFileWriter::writeTest( QString theRasterName, bool tiled )
 {
   mReport += "<h2>" + theRasterName + "</h2>\n";
 
@@ -129,7 +137,17 @@ bool TestQgsRasterFileWriter::writeTest( QString theRasterName )
   qDebug() << "temporary output file: " << tmpName;
   mReport += "temporary output file: " + tmpName + "<br>";
 
+  QString outputName = tmpName;
   QgsRasterFileWriter fileWriter( tmpName );
+  if ( tiled )
+  {
+    // the output directory is created by the writer
+    QFile::remove( tmpName );
+    fileWriter.setTiledMode( true );
+    fileWriter.setMaxTileWidth( 4 );
+    fileWriter.setMaxTileHeight( 3 );
+    outputName = tmpName + "/" + QFileInfo( tmpName ).fileName() + ".vrt";
+  }
   QgsRasterPipe* pipe = new QgsRasterPipe();
   if ( !pipe->set( provider->clone() ) )
   {
@@ -166,7 +184,7 @@ bool TestQgsRasterFileWriter::writeTest( QString theRasterName )
   delete pipe;
 
   QgsRasterChecker checker;
-  bool ok = checker.runTest( "gdal", tmpName, "gdal", myRasterFileInfo.filePath() );
+  bool ok = checker.runTest( "gdal", outputName, "gdal", myRasterFileInfo.filePath() );
   mReport += checker.report();
 
   // All OK, we can delete the file
@@ -22,10 +22,12 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QPainter>
+#include <QThreadPool>
 #include <QTime>
 #include <QDesktopServices>
 
 #include "cpl_conv.h"
+#include "gdal.h"
 
 //qgis includes...
 #include <qgsrasterlayer.h>
@@ -36,6 +38,7 @@
 #include <qgsmaplayerregistry.h>
 #include <qgsapplication.h>
 #include <qgsmaprenderer.h>
+#include <qgsmaprendererparalleljob.h>
 #include <qgsmaplayerregistry.h>
 #include <qgssinglebandgrayrenderer.h>
 #include <qgssinglebandpseudocolorrenderer.h>
@@ -72,9 +75,15 @@ class TestQgsRasterLayer: public QObject
     void registry();
     void transparency();
     void setRenderer();
+    void repeatedBlockReads();
+    void tiledRendering();
   private:
     bool render( QString theFileName );
     bool setQml( QString theType );
+    //! read a whole band with GDALRasterIO into a buffer of the given size
+    QVector<double> gdalRead( QString theFileName, int theBandNo, int theBufWidth, int theBufHeight );
+    //! check that a block of the whole extent has the same values as a plain GDALRasterIO read
+    void compareWithGdal( QgsRasterLayer* theLayer, int theBufWidth, int theBufHeight );
     void populateColorRampShader( QgsColorRampShader* colorRampShader,
                                   QgsVectorColorRampV2* colorRamp,
                                   int numberOfEntries );
@@ -505,6 +514,41 @@ void TestQgsRasterLayer::registry()
 //
 
 
+QVector<double> TestQgsRasterLayer::gdalRead( QString theFileName, int theBandNo, int theBufWidth, int theBufHeight )
+{
+  QVector<double> values( theBufWidth * theBufHeight );
+  GDALDatasetH dataset = GDALOpen( theFileName.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return QVector<double>();
+
+  GDALRasterBandH band = GDALGetRasterBand( dataset, theBandNo );
+  CPLErr err = GDALRasterIO( band, GF_Read, 0, 0, GDALGetRasterXSize( dataset ), GDALGetRasterYSize( dataset ),
+                             values.data(), theBufWidth, theBufHeight, GDT_Float64, 0, 0 );
+  GDALClose( dataset );
+  return err == CE_None ? values : QVector<double>();
+}
+
+void TestQgsRasterLayer::compareWithGdal( QgsRasterLayer* theLayer, int theBufWidth, int theBufHeight )
+{
+  QgsRasterDataProvider* provider = theLayer->dataProvider();
+  QVector<double> expected = gdalRead( theLayer->source(), 1, theBufWidth, theBufHeight );
+  QVERIFY2( !expected.isEmpty(), "GDALRasterIO failed" );
+
+  QgsRasterBlock* block = provider->block( 1, provider->extent(), theBufWidth, theBufHeight );
+  int mismatches = 0;
+  for ( int row = 0; row < theBufHeight; ++row )
+  {
+    for ( int col = 0; col < theBufWidth; ++col )
+    {
+      if ( block->value( row, col ) != expected[row * theBufWidth + col] )
+        mismatches++;
+    }
+  }
+  delete block;
+
+  QVERIFY2( mismatches == 0, QString( "%1 of %2 cells differ from GDALRasterIO" ).arg( mismatches ).arg( theBufWidth * theBufHeight ).toLocal8Bit().constData() );
+}
+
 bool TestQgsRasterLayer::render( QString theTestType )
 {
   mReport += "<h2>" + theTestType + "</h2>\n";
@@ -584,5 +628,132 @@ void TestQgsRasterLayer::setRenderer()
   QCOMPARE( mpRasterLayer->renderer(), renderer );
 }
 
+void TestQgsRasterLayer::repeatedBlockReads()
+{
+  // the second reads are assembled from the decoded blocks cached by the provider
+  QgsRasterDataProvider* provider = mpLandsatRasterLayer->dataProvider();
+  QgsRectangle extent = provider->extent();
+  int width = provider->xSize();
+  int height = provider->ySize();
+
+  QgsRasterBlock* first = provider->block( 1, extent, width, height );
+  QgsRasterBlock* second = provider->block( 1, extent, width, height );
+  for ( int row = 0; row < height; ++row )
+  {
+    for ( int col = 0; col < width; ++col )
+    {
+      QCOMPARE( second->value( row, col ), first->value( row, col ) );
+    }
+  }
+
+  // a part of the raster at the native resolution
+  double xRes = extent.width() / width;
+  double yRes = extent.height() / height;
+  int partWidth = width / 2;
+  int partHeight = height / 2;
+  QgsRectangle partExtent( extent.xMinimum() + xRes, extent.yMaximum() - ( partHeight + 1 ) * yRes,
+                           extent.xMinimum() + ( partWidth + 1 ) * xRes, extent.yMaximum() - yRes );
+  QgsRasterBlock* part = provider->block( 1, partExtent, partWidth, partHeight );
+  for ( int row = 0; row < partHeight; ++row )
+  {
+    for ( int col = 0; col < partWidth; ++col )
+    {
+      QCOMPARE( part->value( row, col ), first->value( row + 1, col + 1 ) );
+    }
+  }
+
+  delete first;
+  delete second;
+  delete part;
+
+  // downsampled reads pick the same cells as GDALRasterIO
+  compareWithGdal( mpLandsatRasterLayer, width / 2, height / 2 );
+  compareWithGdal( mpLandsatRasterLayer, width / 3, height / 5 );
+
+  // and the same overview level
+  QString myTempPath = QDir::tempPath() + QDir::separator();
+  QFile::remove( myTempPath + "landsat_blocks.tif.ovr" );
+  QFile::remove( myTempPath + "landsat_blocks.tif" );
+  QVERIFY( QFile::copy( mTestDataDir + "landsat.tif", myTempPath + "landsat_blocks.tif" ) );
+  QgsRasterLayer* layer = new QgsRasterLayer( myTempPath + "landsat_blocks.tif", "landsat_blocks" );
+  QVERIFY( layer->isValid() );
+  QList< QgsRasterPyramid > pyramids = layer->dataProvider()->buildPyramidList();
+  for ( int i = 0; i < pyramids.count(); i++ )
+  {
+    pyramids[i].build = true;
+  }
+  QVERIFY( layer->dataProvider()->buildPyramids( pyramids, "NEAREST", QgsRaster::PyramidsGTiff ).isEmpty() );
+  delete layer;
+
+  layer = new QgsRasterLayer( myTempPath + "landsat_blocks.tif", "landsat_blocks" );
+  QVERIFY( layer->isValid() );
+  compareWithGdal( layer, width / 4, height / 4 );
+  // read twice, the second time from the cached overview blocks
+  compareWithGdal( layer, width / 4, height / 4 );
+  compareWithGdal( layer, width / 7, height / 6 );
+  compareWithGdal( layer, width / 2, height / 2 );
+  delete layer;
+
+  // external overviews rebuilt by another application are not taken from the cache
+  QVERIFY( QFile::remove( myTempPath + "landsat_blocks.tif.ovr" ) );
+  GDALDatasetH dataset = GDALOpen( QString( myTempPath + "landsat_blocks.tif" ).toUtf8().constData(), GA_ReadOnly );
+  QVERIFY( dataset );
+  int level = 2;
+  QVERIFY( GDALBuildOverviews( dataset, "AVERAGE", 1, &level, 0, 0, GDALDummyProgress, 0 ) == CE_None );
+  GDALClose( dataset );
+
+  layer = new QgsRasterLayer( myTempPath + "landsat_blocks.tif", "landsat_blocks" );
+  QVERIFY( layer->isValid() );
+  compareWithGdal( layer, width / 2, height / 2 );
+  delete layer;
+}
+
+void TestQgsRasterLayer::tiledRendering()
+{
+  if ( QThread::idealThreadCount() < 2 )
+    QSKIP( "This test requires several threads", SkipSingle );
+
+  // the output is large enough to be read in tiles by several threads
+  QgsRasterDataProvider* provider = mpLandsatRasterLayer->dataProvider();
+  QSize size( provider->xSize() * 6, provider->ySize() * 6 );
+
+  QgsMapSettings settings;
+  settings.setLayers( QStringList() << mpLandsatRasterLayer->id() );
+  settings.setExtent( provider->extent() );
+  settings.setOutputSize( size );
+
+  // the same as the layer read in a single thread, without tiles
+  QgsApplication::setMaxThreads( 1 );
+  QgsMapRendererParallelJob expectedJob( settings );
+  expectedJob.start();
+  expectedJob.waitForFinished();
+  QImage expected = expectedJob.renderedImage();
+
+  // the tile readers do not need a thread of the global pool, which is taken by the layer renderer
+  QgsApplication::setMaxThreads( -1 );
+  QThreadPool::globalInstance()->setMaxThreadCount( 1 );
+  QgsMapRendererParallelJob job( settings );
+  job.start();
+  job.waitForFinished();
+  QImage image = job.renderedImage();
+  QgsApplication::setMaxThreads( -1 );
+
+  QCOMPARE( image.size(), expected.size() );
+  int mismatches = 0;
+  QPoint firstMismatch;
+  for ( int y = 0; y < size.height(); ++y )
+  {
+    for ( int x = 0; x < size.width(); ++x )
+    {
+      if ( image.pixel( x, y ) != expected.pixel( x, y ) )
+      {
+        if ( mismatches++ == 0 )
+          firstMismatch = QPoint( x, y );
+      }
+    }
+  }
+  QVERIFY2( mismatches == 0, QString( "%1 pixels differ, the first at %2,%3" ).arg( mismatches ).arg( firstMismatch.x() ).arg( firstMismatch.y() ).toLocal8Bit().constData() );
+}
+
 QTEST_MAIN( TestQgsRasterLayer )
 #include "testqgsrasterlayer.moc"
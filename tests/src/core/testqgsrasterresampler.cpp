@@ -0,0 +1,149 @@
+/***************************************************************************
+     testqgsrasterresampler.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+
+#include "qgsbilinearrasterresampler.h"
+#include "qgscubicrasterresampler.h"
+
+class TestQgsRasterResampler: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void uniformImage_data();
+    void uniformImage();
+    void bilinearValues();
+    void cubicLinearGradient();
+    void premultipliedOutput();
+    void rowBands();
+
+  private:
+    static QRgb pixel( const QImage& image, int x, int y ) { return (( const QRgb* ) image.constScanLine( y ) )[x]; }
+};
+
+void TestQgsRasterResampler::uniformImage_data()
+{
+  QTest::addColumn<QString>( "type" );
+  QTest::addColumn<QSize>( "size" );
+  QTest::newRow( "bilinear zoom in" ) << "bilinear" << QSize( 97, 61 );
+  QTest::newRow( "bilinear zoom out" ) << "bilinear" << QSize( 7, 5 );
+  QTest::newRow( "cubic zoom in" ) << "cubic" << QSize( 97, 61 );
+  QTest::newRow( "cubic zoom out" ) << "cubic" << QSize( 7, 5 );
+}
+
+void TestQgsRasterResampler::uniformImage()
+{
+  QFETCH( QString, type );
+  QFETCH( QSize, size );
+
+  QImage src( 23, 17, QImage::Format_ARGB32_Premultiplied );
+  QRgb color = qRgba( 40, 80, 120, 160 );
+  src.fill( color );
+
+  QImage dst( size, QImage::Format_ARGB32_Premultiplied );
+  if ( type == "cubic" )
+    QgsCubicRasterResampler().resample( src, dst );
+  else
+    QgsBilinearRasterResampler().resample( src, dst );
+
+  QCOMPARE( dst.size(), size );
+  for ( int y = 0; y < dst.height(); ++y )
+    for ( int x = 0; x < dst.width(); ++x )
+      QCOMPARE( pixel( dst, x, y ), color );
+}
+
+void TestQgsRasterResampler::bilinearValues()
+{
+  QImage src( 2, 1, QImage::Format_ARGB32_Premultiplied );
+  (( QRgb* ) src.scanLine( 0 ) )[0] = qRgba( 0, 0, 0, 255 );
+  (( QRgb* ) src.scanLine( 0 ) )[1] = qRgba( 255, 255, 255, 255 );
+
+  QImage dst( 4, 1, QImage::Format_ARGB32_Premultiplied );
+  QgsBilinearRasterResampler().resample( src, dst );
+
+  // the pixel centers are at -0.25, 0.25, 0.75 and 1.25 source pixels
+  QCOMPARE( qRed( pixel( dst, 0, 0 ) ), 0 );
+  QCOMPARE( qRed( pixel( dst, 1, 0 ) ), 64 );
+  QCOMPARE( qRed( pixel( dst, 2, 0 ) ), 191 );
+  QCOMPARE( qRed( pixel( dst, 3, 0 ) ), 255 );
+}
+
+void TestQgsRasterResampler::cubicLinearGradient()
+{
+  // the cubic convolution reproduces linear gradients away from the edges
+  QImage src( 16, 4, QImage::Format_ARGB32_Premultiplied );
+  for ( int y = 0; y < src.height(); ++y )
+    for ( int x = 0; x < src.width(); ++x )
+      (( QRgb* ) src.scanLine( y ) )[x] = qRgba( x * 16, x * 16, x * 16, 255 );
+
+  QImage dst( 64, 16, QImage::Format_ARGB32_Premultiplied );
+  QgsCubicRasterResampler().resample( src, dst );
+
+  for ( int x = 8; x < 56; ++x )
+  {
+    double srcX = ( x + 0.5 ) / 4 - 0.5;
+    QVERIFY( qAbs( qRed( pixel( dst, x, 8 ) ) - srcX * 16 ) <= 1 );
+  }
+}
+
+void TestQgsRasterResampler::premultipliedOutput()
+{
+  // sharp edges make the cubic filter overshoot
+  QImage src( 8, 8, QImage::Format_ARGB32_Premultiplied );
+  for ( int y = 0; y < src.height(); ++y )
+    for ( int x = 0; x < src.width(); ++x )
+      (( QRgb* ) src.scanLine( y ) )[x] = ( x + y ) % 2 ? qRgba( 255, 0, 255, 255 ) : qRgba( 10, 10, 0, 20 );
+
+  QImage dst( 50, 50, QImage::Format_ARGB32_Premultiplied );
+  QgsCubicRasterResampler().resample( src, dst );
+
+  for ( int y = 0; y < dst.height(); ++y )
+  {
+    for ( int x = 0; x < dst.width(); ++x )
+    {
+      QRgb px = pixel( dst, x, y );
+      QVERIFY( qRed( px ) <= qAlpha( px ) && qGreen( px ) <= qAlpha( px ) && qBlue( px ) <= qAlpha( px ) );
+    }
+  }
+}
+
+void TestQgsRasterResampler::rowBands()
+{
+  // large enough to be resampled in several bands of rows
+  QImage src( 30, 200, QImage::Format_ARGB32_Premultiplied );
+  for ( int y = 0; y < src.height(); ++y )
+    for ( int x = 0; x < src.width(); ++x )
+      (( QRgb* ) src.scanLine( y ) )[x] = qRgba( y, 255 - y, y / 2, 255 );
+
+  QImage cubic( 45, 700, QImage::Format_ARGB32_Premultiplied );
+  QgsCubicRasterResampler().resample( src, cubic );
+  QImage bilinear( 45, 700, QImage::Format_ARGB32_Premultiplied );
+  QgsBilinearRasterResampler().resample( src, bilinear );
+
+  for ( int y = 0; y < bilinear.height(); ++y )
+  {
+    if ( y > 0 )
+      QVERIFY( qRed( pixel( bilinear, 0, y ) ) >= qRed( pixel( bilinear, 0, y - 1 ) ) );
+
+    for ( int x = 1; x < bilinear.width(); ++x )
+    {
+      QCOMPARE( pixel( bilinear, x, y ), pixel( bilinear, 0, y ) );
+      QCOMPARE( pixel( cubic, x, y ), pixel( cubic, 0, y ) );
+    }
+  }
+}
+
+QTEST_MAIN( TestQgsRasterResampler )
+#include "testqgsrasterresampler.moc"
@@ -17,6 +17,8 @@
 #include <QObject>
 #include <QString>
 #include <QObject>
+#include <QDir>
+#include <QtConcurrentMap>
 
 #include <qgsapplication.h>
 #include <qgsgeometry.h>
@@ -55,6 +57,18 @@ static QList<QgsFeature> _pointFeatures()
   return feats;
 }
 
+// runs queries of an index (used from several threads)
+struct IntersectQuery
+{
+  typedef int result_type;
+
+  IntersectQuery( const QgsSpatialIndex& index ) : mIndex( index ) {}
+
+  int operator()( const QgsRectangle& rect ) { return mIndex.intersects( rect ).count(); }
+
+  const QgsSpatialIndex& mIndex;
+};
+
 class TestQgsSpatialIndex : public QObject
 {
     Q_OBJECT
@@ -124,6 +138,141 @@ class TestQgsSpatialIndex : public QObject
       QVERIFY( fids[0] == 1 );
     }
 
+    void testDiskIndex()
+    {
+      QgsVectorLayer* vl = new QgsVectorLayer( "Point", "x", "memory" );
+      QgsFeatureList flist;
+      foreach ( const QgsFeature& f, _pointFeatures() )
+        flist << f;
+      vl->dataProvider()->addFeatures( flist );
+
+      QString fileBase = QDir::tempPath() + "/testqgsspatialindex";
+      QDateTime timestamp = QDateTime::currentDateTime();
+      {
+        QgsSpatialIndex index;
+        QVERIFY( index.createOnDisk( vl->getFeatures(), fileBase, timestamp ) );
+        QVERIFY( index.isOnDisk() );
+
+        QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+        QCOMPARE( fids.count(), 1 );
+      }
+      // metadata are written when the index is complete
+      QVERIFY( QFile::exists( QgsSpatialIndex::metadataFileName( fileBase ) ) );
+
+      QgsSpatialIndex outdatedIndex;
+      QVERIFY( !outdatedIndex.openOnDisk( fileBase, timestamp.addSecs( 60 ) ) );
+      QVERIFY( !outdatedIndex.isOnDisk() );
+
+      {
+        QgsSpatialIndex index;
+        QVERIFY( index.openOnDisk( fileBase, timestamp ) );
+        QVERIFY( index.isOnDisk() );
+
+        QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+        QCOMPARE( fids.count(), 1 );
+        QVERIFY( fids[0] == 1 );
+      }
+
+      QFile::remove( QgsSpatialIndex::metadataFileName( fileBase ) );
+      QFile::remove( fileBase + ".idx" );
+      QFile::remove( fileBase + ".dat" );
+      delete vl;
+    }
+
+    void testModifiedDiskIndex()
+    {
+      QgsVectorLayer* vl = new QgsVectorLayer( "Point", "x", "memory" );
+      QgsFeatureList flist;
+      foreach ( const QgsFeature& f, _pointFeatures() )
+        flist << f;
+      vl->dataProvider()->addFeatures( flist );
+
+      QString fileBase = QDir::tempPath() + "/testqgsspatialindexmodified";
+      QString metadataFile = QgsSpatialIndex::metadataFileName( fileBase );
+      QDateTime timestamp = QDateTime::currentDateTime();
+      {
+        QgsSpatialIndex index;
+        QVERIFY( index.createOnDisk( vl->getFeatures(), fileBase, timestamp ) );
+      }
+      QVERIFY( QFile::exists( metadataFile ) );
+
+      {
+        QgsSpatialIndex index;
+        QVERIFY( index.openOnDisk( fileBase, timestamp ) );
+        QVERIFY( QFile::exists( metadataFile ) );
+
+        // the files are incomplete while the reopened index is being modified
+        QVERIFY( index.insertFeature( _pointFeature( 5, 5, 5 ) ) );
+        QVERIFY( !QFile::exists( metadataFile ) );
+        QVERIFY( index.deleteFeature( _pointFeature( 2, -1, 1 ) ) );
+
+        // another session cannot use the index meanwhile
+        QgsSpatialIndex other;
+        QVERIFY( !other.openOnDisk( fileBase, timestamp ) );
+      }
+      // complete again once closed
+      QVERIFY( QFile::exists( metadataFile ) );
+
+      {
+        QgsSpatialIndex index;
+        QVERIFY( index.openOnDisk( fileBase, timestamp ) );
+
+        QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 0, 0, 10, 10 ) );
+        QCOMPARE( fids.count(), 2 );
+        QVERIFY( fids.contains( 1 ) );
+        QVERIFY( fids.contains( 5 ) );
+        QVERIFY( index.intersects( QgsRectangle( -10, 0, 0, 10 ) ).isEmpty() );
+      }
+
+      QFile::remove( metadataFile );
+      QFile::remove( fileBase + ".idx" );
+      QFile::remove( fileBase + ".dat" );
+      delete vl;
+    }
+
+    void testConcurrentQueries()
+    {
+      QgsSpatialIndex index;
+      index.setConcurrentQueriesEnabled( true );
+      QVERIFY( index.concurrentQueriesEnabled() );
+
+      for ( int i = 0; i < 1000; ++i )
+        index.insertFeature( _pointFeature( i, i % 100, i / 100 ) );
+
+      QList<QgsFeatureId> fids = index.intersects( QgsRectangle( 9.5, -1, 10.5, 100 ) );
+      QCOMPARE( fids.count(), 10 );
+
+      // changes after the snapshot was taken
+      index.insertFeature( _pointFeature( 2000, 10, 20 ) );
+      index.deleteFeature( _pointFeature( 10, 10, 0 ) );
+      fids = index.intersects( QgsRectangle( 9.5, -1, 10.5, 100 ) );
+      QCOMPARE( fids.count(), 10 );
+      QVERIFY( fids.contains( 2000 ) );
+      QVERIFY( !fids.contains( 10 ) );
+
+      QList<QgsFeatureId> nearest = index.nearestNeighbor( QgsPoint( 10, 19.4 ), 1 );
+      QCOMPARE( nearest.count(), 1 );
+      QVERIFY( nearest[0] == 2000 );
+      nearest = index.nearestNeighbor( QgsPoint( 55.1, 5.1 ), 3 );
+      QCOMPARE( nearest.count(), 3 );
+      QVERIFY( nearest[0] == 555 );
+
+      // batched queries give the same results as the serialized R-tree
+      QList<QgsRectangle> rects;
+      rects << QgsRectangle( 0, 0, 5, 5 ) << QgsRectangle( 9, 0, 11, 1 ) << QgsRectangle( 200, 200, 300, 300 );
+      QList< QList<QgsFeatureId> > results = index.intersects( rects );
+      index.setConcurrentQueriesEnabled( false );
+      QList< QList<QgsFeatureId> > expected = index.intersects( rects );
+      QCOMPARE( results.count(), 3 );
+      for ( int i = 0; i < results.count(); ++i )
+      {
+        qSort( results[i] );
+        qSort( expected[i] );
+        QCOMPARE( results[i], expected[i] );
+      }
+      QCOMPARE( results[2].count(), 0 );
+    }
+
     void benchmarkIntersect()
     {
       // add 50K features to the index
@@ -145,6 +294,32 @@ class TestQgsSpatialIndex : public QObject
       }
     }
 
+    void benchmarkConcurrentIntersect()
+    {
+      // add 50K features to the index
+      QgsSpatialIndex index;
+      index.setConcurrentQueriesEnabled( true );
+      for ( int i = 0; i < 100; ++i )
+      {
+        for ( int k = 0; k < 500; ++k )
+        {
+          QgsFeature f( i*1000 + k );
+          f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i / 10, i % 10 ) ) );
+          index.insertFeature( f );
+        }
+      }
+
+      QList<QgsRectangle> rects;
+      for ( int j = 0; j < 10; ++j )
+        for ( int i = 0; i < 100; ++i )
+          rects << QgsRectangle( i / 10, i % 10, i / 10 + 1, i % 10 + 1 );
+
+      QBENCHMARK
+      {
+        QtConcurrent::blockingMapped( rects, IntersectQuery( index ) );
+      }
+    }
+
     void benchmarkBulkLoad()
     {
       QgsVectorLayer* vl = new QgsVectorLayer( "Point", "x", "memory" );
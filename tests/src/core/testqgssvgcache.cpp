@@ -0,0 +1,143 @@
+/***************************************************************************
+     testqgssvgcache.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+#include <QThreadPool>
+#include <QtConcurrentRun>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgssvgcache.h>
+
+/** @ingroup UnitTests
+ * This is a unit test for the SVG cache
+ */
+class TestQgsSvgCache: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void concurrentLookups();
+    void prepareImage();
+    void tooBigForCache();
+    void imageOutlivesEntry();
+
+  private:
+    QString mSvgFile;
+};
+
+//! look up the image from another thread and return a copy of it
+static QImage lookupImage( QString file, double size )
+{
+  bool fitsInCache;
+  return QgsSvgCache::instance()->svgAsImage( file, size, Qt::red, Qt::black, 1, 1, 1, fitsInCache );
+}
+
+void TestQgsSvgCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mSvgFile = QString( TEST_DATA_DIR ) + QDir::separator() + "sample_svg.svg";
+}
+
+void TestQgsSvgCache::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsSvgCache::concurrentLookups()
+{
+  QgsSvgCache* cache = QgsSvgCache::instance();
+  cache->resetStatistics();
+
+  QList< QFuture<QImage> > futures;
+  for ( int i = 0; i < 16; ++i )
+  {
+    futures << QtConcurrent::run( lookupImage, mSvgFile, 31.0 );
+  }
+
+  QImage first = futures.first().result();
+  QVERIFY( !first.isNull() );
+  foreach ( QFuture<QImage> future, futures )
+  {
+    QCOMPARE( future.result(), first );
+  }
+
+  // the image is rendered once, the other threads wait for it
+  QCOMPARE( cache->cacheMisses(), qint64( 1 ) );
+  QCOMPARE( cache->cacheHits(), qint64( 15 ) );
+}
+
+void TestQgsSvgCache::prepareImage()
+{
+  QgsSvgCache* cache = QgsSvgCache::instance();
+  cache->resetStatistics();
+
+  cache->prepareImage( mSvgFile, 32, Qt::red, Qt::black, 1, 1, 1 );
+  QImage img = lookupImage( mSvgFile, 32 );
+  QVERIFY( !img.isNull() );
+  QThreadPool::globalInstance()->waitForDone();
+
+  // either the job or the lookup rendered the image, never both
+  QCOMPARE( cache->cacheMisses(), qint64( 1 ) );
+  QCOMPARE( cache->cacheHits(), qint64( 1 ) );
+
+  // already cached entries are not prepared again
+  cache->prepareImage( mSvgFile, 32, Qt::red, Qt::black, 1, 1, 1 );
+  QThreadPool::globalInstance()->waitForDone();
+  QCOMPARE( cache->cacheMisses(), qint64( 1 ) );
+  QCOMPARE( cache->cacheHits(), qint64( 1 ) );
+  QCOMPARE( lookupImage( mSvgFile, 32 ), img );
+}
+
+void TestQgsSvgCache::tooBigForCache()
+{
+  QgsSvgCache* cache = QgsSvgCache::instance();
+  cache->resetStatistics();
+
+  // the image would take more than half of the cache: only a picture is kept
+  bool fitsInCache = true;
+  QImage img = cache->svgAsImage( mSvgFile, 1000, Qt::red, Qt::black, 1, 1, 1, fitsInCache );
+  QVERIFY( !fitsInCache );
+  QVERIFY( img.isNull() );
+  QCOMPARE( cache->cacheMisses(), qint64( 1 ) );
+
+  // preparing the image in the background does not queue the picture-only entry
+  cache->prepareImage( mSvgFile, 1000, Qt::red, Qt::black, 1, 1, 1 );
+  QThreadPool::globalInstance()->waitForDone();
+  QCOMPARE( cache->cacheMisses(), qint64( 1 ) );
+}
+
+void TestQgsSvgCache::imageOutlivesEntry()
+{
+  QImage img = lookupImage( mSvgFile, 400 );
+  QVERIFY( !img.isNull() );
+  QImage copy = img.copy();
+
+  // the entry of the image is removed from the cache by the following ones
+  for ( int i = 1; i <= 8; ++i )
+  {
+    QVERIFY( !lookupImage( mSvgFile, 400 + i ).isNull() );
+  }
+  QVERIFY( QgsSvgCache::instance()->totalSize() < 20000000 );
+  QCOMPARE( img, copy );
+}
+
+QTEST_MAIN( TestQgsSvgCache )
+#include "testqgssvgcache.moc"
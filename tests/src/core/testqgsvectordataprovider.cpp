@@ -21,6 +21,7 @@
 #include <qgsgeometry.h>
 #include <qgsfeaturerequest.h>
 #include <qgsvectordataprovider.h>
+#include <qgsvectorfilewriter.h>
 #include <qgsvectorlayer.h>
 
 #if QT_VERSION < 0x40701
@@ -48,6 +49,9 @@ class TestQgsVectorDataProvider : public QObject
 
     void featureAtId();
 
+    // test iteration over many features (read ahead in background)
+    void readAhead();
+
   private:
 
     QgsVectorLayer* vlayerPoints;
@@ -226,6 +230,68 @@ void TestQgsVectorDataProvider::featureAtId()
   QVERIFY( !feature.isValid() );
 }
 
+void TestQgsVectorDataProvider::readAhead()
+{
+  const int count = 1000;
+
+  QString fileName = QDir::tempPath() + "/readahead.shp";
+  QVERIFY( QgsVectorFileWriter::deleteShapeFile( fileName ) );
+  {
+    QgsFields fields;
+    fields.append( QgsField( "num", QVariant::Int, "Integer", 10 ) );
+    QgsCoordinateReferenceSystem crs( GEOWKT );
+    QgsVectorFileWriter writer( fileName, "UTF-8", fields, QGis::WKBPoint, &crs );
+    QVERIFY( writer.hasError() == QgsVectorFileWriter::NoError );
+    for ( int i = 0; i < count; ++i )
+    {
+      QgsFeature f;
+      f.initAttributes( 1 );
+      f.setAttribute( 0, i );
+      f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i, -i ) ) );
+      QVERIFY( writer.addFeature( f ) );
+    }
+  }
+
+  QgsVectorLayer layer( fileName, "readahead", "ogr" );
+  QVERIFY( layer.isValid() );
+  QgsVectorDataProvider* pr = layer.dataProvider();
+
+  // all features in order, with their attributes and geometries
+  QgsFeatureIterator fi = pr->getFeatures();
+  QgsFeature f;
+  int n = 0;
+  while ( fi.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( "num" ).toInt(), n );
+    QVERIFY( f.geometry() );
+    QCOMPARE( f.geometry()->asPoint(), QgsPoint( n, -n ) );
+    ++n;
+  }
+  QCOMPARE( n, count );
+  QVERIFY( !f.isValid() );
+
+  // rewind in the middle
+  fi = pr->getFeatures( QgsFeatureRequest().setFlags( QgsFeatureRequest::NoGeometry ) );
+  for ( n = 0; n < 500; ++n )
+    QVERIFY( fi.nextFeature( f ) );
+  QVERIFY( fi.rewind() );
+  n = 0;
+  while ( fi.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( "num" ).toInt(), n );
+    QVERIFY( !f.geometry() );
+    ++n;
+  }
+  QCOMPARE( n, count );
+
+  // close before all features have been read
+  fi = pr->getFeatures();
+  for ( n = 0; n < 300; ++n )
+    QVERIFY( fi.nextFeature( f ) );
+  QVERIFY( fi.close() );
+  QVERIFY( !fi.nextFeature( f ) );
+}
+
 
 QTEST_MAIN( TestQgsVectorDataProvider )
 
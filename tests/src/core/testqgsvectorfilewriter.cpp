@@ -70,6 +70,8 @@ class TestQgsVectorFileWriter: public QObject
     void polygonGridTest();
     /** As above but using a projected CRS*/
     void projectedPlygonGridTest();
+    /** This method tests exporting a layer with more features than fit into one chunk */
+    void writeAsVectorFormatChunks();
 
   private:
     // a little util fn used by all tests
@@ -93,6 +95,7 @@ void TestQgsVectorFileWriter::initTestCase()
           "******************\n" );
   // init QGIS's paths - true means that all path will be inited from prefix
   QgsApplication::init();
+  QgsApplication::initQgis();
   QgsApplication::showSettings();
   //create some objects that will be used in all tests...
 
@@ -389,6 +392,50 @@ void TestQgsVectorFileWriter::projectedPlygonGridTest()
   }
 }
 
+void TestQgsVectorFileWriter::writeAsVectorFormatChunks()
+{
+  QgsVectorLayer* layer = new QgsVectorLayer( "Point?crs=epsg:4326&field=num:integer", "chunks", "memory" );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  for ( int i = 0; i < 5000; ++i )
+  {
+    QgsFeature f;
+    f.initAttributes( 1 );
+    f.setAttribute( 0, i );
+    f.setGeometry( QgsGeometry::fromPoint( QgsPoint( i % 100, i / 100 ) ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QString myFileName = QDir::tempPath() + "/testchunks.shp";
+  QVERIFY( QgsVectorFileWriter::deleteShapeFile( myFileName ) );
+
+  // the rows 10 to 19
+  QgsRectangle filterExtent( -0.5, 9.5, 99.5, 19.5 );
+  QString errorMessage;
+  QgsVectorFileWriter::WriterError error = QgsVectorFileWriter::writeAsVectorFormat(
+        layer, myFileName, mEncoding, &mCRS, "ESRI Shapefile", false, &errorMessage,
+        QStringList(), QStringList(), false, 0, QgsVectorFileWriter::NoSymbology, 1.0, &filterExtent );
+  QCOMPARE( error, QgsVectorFileWriter::NoError );
+  delete layer;
+
+  QgsVectorLayer written( myFileName, "written", "ogr" );
+  QVERIFY( written.isValid() );
+  QCOMPARE( written.featureCount(), ( long ) 1000 );
+
+  // the features are written in their original order
+  QgsFeatureIterator fit = written.getFeatures();
+  QgsFeature f;
+  int num = 1000;
+  while ( fit.nextFeature( f ) )
+  {
+    QCOMPARE( f.attribute( "num" ).toInt(), num );
+    QCOMPARE( f.geometry()->asPoint(), QgsPoint( num % 100, num / 100 ) );
+    ++num;
+  }
+  QCOMPARE( num, 2000 );
+}
+
 QTEST_MAIN( TestQgsVectorFileWriter )
 #include "testqgsvectorfilewriter.moc"
 
@@ -21,6 +21,8 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDesktopServices>
+#include <QDateTime>
+#include <QDomDocument>
 
 #include <iostream>
 //qgis includes...
@@ -702,6 +704,66 @@ class TestQgsVectorLayer: public QObject
       QCOMPARE( receiver.transparency, 50 );
       QCOMPARE( vLayer->layerTransparency(), 50 );
     }
+
+    void QgsVectorLayermetadataCache()
+    {
+      QgsVectorLayer* vLayer = new QgsVectorLayer( mTestDataDir + "points.shp", "points", "ogr" );
+      vLayer->setMetadataCacheEnabled( true );
+      QgsRectangle extent = vLayer->extent();
+      long count = vLayer->featureCount();
+
+      QDomDocument doc( "qgis" );
+      QDomElement layerElem = doc.createElement( "maplayer" );
+      QVERIFY( vLayer->writeLayerXML( layerElem, doc ) );
+      delete vLayer;
+
+      QDomElement cacheElem = layerElem.firstChildElement( "metadatacache" );
+      QVERIFY( !cacheElem.isNull() );
+      QCOMPARE( cacheElem.attribute( "featureCount" ).toLong(), count );
+
+      // the cached values are used instead of asking the provider
+      cacheElem.setAttribute( "featureCount", 12345 );
+      QgsVectorLayer layer2;
+      layer2.setMetadataCacheEnabled( true );
+      QVERIFY( layer2.readLayerXML( layerElem ) );
+      QCOMPARE( layer2.featureCount(), 12345L );
+      QVERIFY( layer2.extent() == extent );
+
+      // saving the cached values again keeps their original timestamp
+      QString timestamp = QFileInfo( mTestDataDir + "points.shp" ).lastModified().addSecs( 1 ).toString( Qt::ISODate );
+      cacheElem.setAttribute( "timestamp", timestamp );
+      QgsVectorLayer layer4;
+      layer4.setMetadataCacheEnabled( true );
+      QVERIFY( layer4.readLayerXML( layerElem ) );
+      QCOMPARE( layer4.featureCount(), 12345L );
+      QDomElement layerElem4 = doc.createElement( "maplayer" );
+      QVERIFY( layer4.writeLayerXML( layerElem4, doc ) );
+      QDomElement cacheElem4 = layerElem4.firstChildElement( "metadatacache" );
+      QCOMPARE( cacheElem4.attribute( "timestamp" ), timestamp );
+      QCOMPARE( cacheElem4.attribute( "featureCount" ).toLong(), 12345L );
+
+      // the feature count is not stored if nobody asked the provider for it
+      QgsVectorLayer* vLayer5 = new QgsVectorLayer( mTestDataDir + "points.shp", "points", "ogr" );
+      vLayer5->setMetadataCacheEnabled( true );
+      vLayer5->extent();
+      QDomElement layerElem5 = doc.createElement( "maplayer" );
+      QVERIFY( vLayer5->writeLayerXML( layerElem5, doc ) );
+      delete vLayer5;
+      QDomElement cacheElem5 = layerElem5.firstChildElement( "metadatacache" );
+      QVERIFY( !cacheElem5.isNull() );
+      QVERIFY( !cacheElem5.hasAttribute( "featureCount" ) );
+
+      // until the layer is reloaded
+      layer2.reload();
+      QCOMPARE( layer2.featureCount(), count );
+
+      // expired values are not used
+      cacheElem.setAttribute( "timestamp", QDateTime::currentDateTime().addDays( -2 ).toString( Qt::ISODate ) );
+      QgsVectorLayer layer3;
+      layer3.setMetadataCacheEnabled( true, 24 * 3600 );
+      QVERIFY( layer3.readLayerXML( layerElem ) );
+      QCOMPARE( layer3.featureCount(), count );
+    }
 };
 
 QTEST_MAIN( TestQgsVectorLayer )
@@ -0,0 +1,243 @@
+/***************************************************************************
+     testqgsvectorlayerrendercache.cpp
+     --------------------------------------
+    Date                 : October 2014
+    Copyright            : (C) 2014 by the QGIS team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include <QtTest/QtTest>
+#include <QObject>
+#include <QImage>
+#include <QPainter>
+
+//qgis includes...
+#include <qgsapplication.h>
+#include <qgsfeatureiterator.h>
+#include <qgsgeometry.h>
+#include <qgsmaplayerrenderer.h>
+#include <qgsrendercontext.h>
+#include <qgsvectordataprovider.h>
+#include <qgsvectorlayer.h>
+#include <qgsvectorlayerfeatureiterator.h>
+#include <qgsvectorlayerrendercache.h>
+
+/** @ingroup UnitTests
+ * This is a unit test for the render cache of vector layers
+ */
+class TestQgsVectorLayerRenderCache: public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void hit();
+    void invalidation();
+    void sizeLimit();
+    void largeCoordinates();
+    void disabledWhileRendering();
+
+  private:
+    //! add a grid of n x n points to the provider of the layer, bypassing the layer signals
+    void addPoints( int n, double offset = 0 );
+    //! fetch the features through the cache, returns -1 if they are not served by the cache
+    int fetch();
+
+    QgsVectorLayer* mLayer;
+    QgsVectorLayerRenderCache* mCache;
+    QgsRenderContext mContext;
+};
+
+void TestQgsVectorLayerRenderCache::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+
+  mContext.setExtent( QgsRectangle( 0, 0, 100, 100 ) );
+  mContext.setMapToPixel( QgsMapToPixel( 1.0, 100, 0, 0 ) );
+}
+
+void TestQgsVectorLayerRenderCache::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsVectorLayerRenderCache::init()
+{
+  mLayer = new QgsVectorLayer( "Point?field=id:integer", "points", "memory" );
+  QVERIFY( mLayer->isValid() );
+  addPoints( 10 );
+  mLayer->setRenderCacheEnabled( true );
+  mCache = mLayer->renderCache();
+  QVERIFY( mCache );
+}
+
+void TestQgsVectorLayerRenderCache::cleanup()
+{
+  delete mLayer;
+  mLayer = 0;
+  mCache = 0;
+}
+
+void TestQgsVectorLayerRenderCache::addPoints( int n, double offset )
+{
+  QgsFeatureList features;
+  for ( int i = 0; i < n; ++i )
+  {
+    for ( int j = 0; j < n; ++j )
+    {
+      QgsFeature f( mLayer->pendingFields() );
+      f.setAttribute( "id", i * n + j );
+      f.setGeometry( QgsGeometry::fromPoint( QgsPoint( 5 + i * 10 + offset, 5 + j * 10 + offset ) ) );
+      features << f;
+    }
+  }
+  QVERIFY( mLayer->dataProvider()->addFeatures( features ) );
+}
+
+int TestQgsVectorLayerRenderCache::fetch()
+{
+  QgsVectorLayerFeatureSource source( mLayer );
+  QgsFeatureIterator fit;
+  QgsRectangle destExtent;
+  if ( !mCache->getFeatures( &source, mContext, mContext.extent(), QStringList() << "id", mLayer->pendingFields(), 0, fit, destExtent ) )
+    return -1;
+
+  int count = 0;
+  QgsFeature f;
+  while ( fit.nextFeature( f ) )
+  {
+    if ( f.geometry() && f.attribute( "id" ).isValid() )
+      count++;
+  }
+  return count;
+}
+
+void TestQgsVectorLayerRenderCache::hit()
+{
+  // the miss fills the band while delivering the features
+  QCOMPARE( mCache->size(), 0 );
+  QCOMPARE( fetch(), 100 );
+  QVERIFY( mCache->size() > 0 );
+
+  // features added behind the back of the layer are not seen: served from the band
+  addPoints( 2, 1 );
+  QCOMPARE( fetch(), 100 );
+
+  // a smaller extent within the band is served from it too
+  mContext.setExtent( QgsRectangle( 0, 0, 50, 50 ) );
+  QCOMPARE( fetch(), 25 );
+  mContext.setExtent( QgsRectangle( 0, 0, 100, 100 ) );
+}
+
+void TestQgsVectorLayerRenderCache::invalidation()
+{
+  QCOMPARE( fetch(), 100 );
+  addPoints( 2, 1 );
+  QCOMPARE( fetch(), 100 );
+
+  mCache->invalidate();
+  QCOMPARE( mCache->size(), 0 );
+  QCOMPARE( fetch(), 104 );
+
+  // changes through the layer invalidate the cache
+  QgsFeature f( mLayer->pendingFields() );
+  f.setAttribute( "id", 1000 );
+  f.setGeometry( QgsGeometry::fromPoint( QgsPoint( 50, 50 ) ) );
+  QVERIFY( mLayer->startEditing() );
+  QVERIFY( mLayer->addFeature( f ) );
+  QCOMPARE( mCache->size(), 0 );
+  QCOMPARE( fetch(), 105 );
+  QVERIFY( mLayer->commitChanges() );
+  QCOMPARE( mCache->size(), 0 );
+  QCOMPARE( fetch(), 105 );
+}
+
+void TestQgsVectorLayerRenderCache::sizeLimit()
+{
+  mCache->setMaximumSize( 1000 );
+
+  // the band does not fit, the features are still delivered by the single fetch
+  QCOMPARE( fetch(), 100 );
+  QCOMPARE( mCache->size(), 0 );
+
+  // the key is known to be oversized, the caller fetches from the provider
+  QCOMPARE( fetch(), -1 );
+
+  // a new limit gives the band another chance
+  mCache->setMaximumSize( 1024 * 1024 );
+  QCOMPARE( fetch(), 100 );
+  QVERIFY( mCache->size() > 0 );
+  QVERIFY( mCache->size() <= mCache->maximumSize() );
+
+  // lowering the limit evicts the band
+  mCache->setMaximumSize( 1000 );
+  QCOMPARE( mCache->size(), 0 );
+}
+
+void TestQgsVectorLayerRenderCache::largeCoordinates()
+{
+  // a band spanning a large extent keeps the coordinates precise
+  const double offset = 12345678.123;
+  addPoints( 1, offset );
+  QgsRenderContext context = mContext;
+  context.setExtent( QgsRectangle( 0, 0, offset + 10, offset + 10 ) );
+  context.setMapToPixel( QgsMapToPixel( ( offset + 10 ) / 100, 100, 0, 0 ) );
+
+  for ( int i = 0; i < 2; ++i )
+  {
+    QgsVectorLayerFeatureSource source( mLayer );
+    QgsFeatureIterator fit;
+    QgsRectangle destExtent;
+    QVERIFY( mCache->getFeatures( &source, context, context.extent(), QStringList() << "id", mLayer->pendingFields(), 0, fit, destExtent ) );
+
+    int count = 0;
+    bool nearOrigin = false, farFromOrigin = false;
+    QgsFeature f;
+    while ( fit.nextFeature( f ) )
+    {
+      count++;
+      QgsPoint pt = f.geometry()->asPoint();
+      nearOrigin |= pt.x() == 5 && pt.y() == 5;
+      farFromOrigin |= pt.x() == 5 + offset && pt.y() == 5 + offset;
+    }
+    QCOMPARE( count, 101 );
+    QVERIFY( nearOrigin );
+    QVERIFY( farFromOrigin );
+  }
+  QVERIFY( mCache->size() > 0 );
+}
+
+void TestQgsVectorLayerRenderCache::disabledWhileRendering()
+{
+  QImage image( 100, 100, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+  QPainter p( &image );
+  QgsRenderContext context = mContext;
+  context.setPainter( &p );
+
+  // the renderer keeps drawing from the cache after the layer dropped it
+  QgsMapLayerRenderer* renderer = mLayer->createMapRenderer( context );
+  mLayer->setRenderCacheEnabled( false );
+  mCache = 0;
+  QVERIFY( !mLayer->renderCache() );
+  QVERIFY( renderer->render() );
+  delete renderer;
+  p.end();
+
+  QImage blank( 100, 100, QImage::Format_ARGB32_Premultiplied );
+  blank.fill( 0 );
+  QVERIFY( image != blank );
+}
+
+QTEST_MAIN( TestQgsVectorLayerRenderCache )
+#include "testqgsvectorlayerrendercache.moc"
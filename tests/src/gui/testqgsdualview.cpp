@@ -17,10 +17,12 @@
 #include <QtTest/QtTest>
 
 #include <editorwidgets/core/qgseditorwidgetregistry.h>
+#include <attributetable/qgsattributetablemodel.h>
 #include <attributetable/qgsattributetableview.h>
 #include <attributetable/qgsdualview.h>
 #include <qgsapplication.h>
 #include <qgsvectorlayer.h>
+#include <qgsvectorlayercache.h>
 #include <qgsmapcanvas.h>
 #include <qgsfeature.h>
 
@@ -35,6 +37,8 @@ class TestQgsDualView: public QObject
 
     void testSelectAll();
 
+    void testModelPages();
+
   private:
     QgsMapCanvas* mCanvas;
     QgsVectorLayer* mPointsLayer;
@@ -96,6 +100,34 @@ void TestQgsDualView::testSelectAll()
   QVERIFY( mPointsLayer->selectedFeatureCount() == 1 );
 }
 
+void TestQgsDualView::testModelPages()
+{
+  // a small cache, so that the attributes are fetched in pages of two features
+  QgsVectorLayerCache cache( mPointsLayer, 8 );
+  cache.setCacheGeometry( false );
+  QgsAttributeTableModel model( &cache );
+  model.loadLayer();
+
+  QCOMPARE( model.rowCount(), ( int ) mPointsLayer->featureCount() );
+
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    for ( int row = 0; row < model.rowCount(); ++row )
+    {
+      QgsFeature f;
+      QVERIFY( mPointsLayer->getFeatures( QgsFeatureRequest().setFilterFid( model.rowToId( row ) ) ).nextFeature( f ) );
+
+      for ( int col = 0; col < model.columnCount(); ++col )
+      {
+        QCOMPARE( model.data( model.index( row, col ), Qt::EditRole ), f.attribute( model.fieldIdx( col ) ) );
+      }
+    }
+
+    // let the pages read in the background arrive
+    QTest::qWait( 100 );
+  }
+}
+
 QTEST_MAIN( TestQgsDualView )
 #include "testqgsdualview.moc"
 
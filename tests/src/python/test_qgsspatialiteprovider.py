@@ -70,6 +70,54 @@ class TestQgsSpatialiteProvider(TestCase):
         sql +=    "VALUES (1, 'toto', GeomFromText('POLYGON((0 0,1 0,1 1,0 1,0 0))', 4326))"
         cur.execute(sql)
 
+        # table with a spatial index
+        sql = "CREATE TABLE test_rtree (id INTEGER NOT NULL PRIMARY KEY)"
+        cur.execute(sql)
+        sql = "SELECT AddGeometryColumn('test_rtree', 'geometry', 4326, 'POINT', 'XY')"
+        cur.execute(sql)
+        for i in range(10):
+            sql = "INSERT INTO test_rtree (id, geometry) VALUES (%d, MakePoint(%d, %d, 4326))" % (i, i, i)
+            cur.execute(sql)
+        sql = "SELECT CreateSpatialIndex('test_rtree', 'geometry')"
+        cur.execute(sql)
+
+        # table large enough to be read in parts
+        sql = "CREATE TABLE test_partition (id INTEGER NOT NULL PRIMARY KEY)"
+        cur.execute(sql)
+        sql = "SELECT AddGeometryColumn('test_partition', 'geometry', 4326, 'POINT', 'XY')"
+        cur.execute(sql)
+        sql = "INSERT INTO test_partition (id, geometry) VALUES (?, MakePoint(?, ?, 4326))"
+        cur.executemany(sql, [(i, i % 100, i / 100) for i in range(1, 10001)])
+        sql = "SELECT CreateSpatialIndex('test_partition', 'geometry')"
+        cur.execute(sql)
+
+        # same with a primary key which is not an alias of the ROWID
+        sql = "CREATE TABLE test_partition_bigint (id BIGINT NOT NULL PRIMARY KEY)"
+        cur.execute(sql)
+        sql = "SELECT AddGeometryColumn('test_partition_bigint', 'geometry', 4326, 'POINT', 'XY')"
+        cur.execute(sql)
+        sql = "INSERT INTO test_partition_bigint (id, geometry) VALUES (?, MakePoint(?, ?, 4326))"
+        cur.executemany(sql, [(1000000 - 7 * i, i % 100, i / 100) for i in range(1, 10001)])
+        sql = "SELECT CreateSpatialIndex('test_partition_bigint', 'geometry')"
+        cur.execute(sql)
+
+        # tables with 3D and multi geometries
+        sql = "CREATE TABLE test_z (id INTEGER NOT NULL PRIMARY KEY)"
+        cur.execute(sql)
+        sql = "SELECT AddGeometryColumn('test_z', 'geometry', 4326, 'LINESTRING', 'XYZ')"
+        cur.execute(sql)
+        sql = "INSERT INTO test_z (id, geometry) "
+        sql +=    "VALUES (1, GeomFromText('LINESTRINGZ(0 0 1,1 2 3)', 4326))"
+        cur.execute(sql)
+
+        sql = "CREATE TABLE test_multi (id INTEGER NOT NULL PRIMARY KEY)"
+        cur.execute(sql)
+        sql = "SELECT AddGeometryColumn('test_multi', 'geometry', 4326, 'MULTIPOLYGON', 'XY')"
+        cur.execute(sql)
+        sql = "INSERT INTO test_multi (id, geometry) "
+        sql +=    "VALUES (1, GeomFromText('MULTIPOLYGON(((0 0,1 0,1 1,0 0)),((2 2,3 2,3 3,2 2)))', 4326))"
+        cur.execute(sql)
+
         cur.execute( "COMMIT" )
         con.close()
 
@@ -101,6 +149,69 @@ class TestQgsSpatialiteProvider(TestCase):
             die("this commit should work")
         layer.featureCount() == 4 or die("we should have 4 features after 2 split")
 
+    def test_Geometries(self):
+        """Decode the geometry blobs"""
+        layer = QgsVectorLayer("dbname=%s table=test_z (geometry)" % self.dbname, "test_z", "spatialite")
+        assert(layer.isValid())
+        feat = QgsFeature()
+        layer.getFeatures().nextFeature(feat) or die("no feature")
+        feat.geometry().wkbType() == QGis.WKBLineString25D or die("wrong geometry type")
+        feat.geometry().asPolyline() == [QgsPoint(0, 0), QgsPoint(1, 2)] or die("wrong 3D linestring")
+
+        layer = QgsVectorLayer("dbname=%s table=test_multi (geometry)" % self.dbname, "test_multi", "spatialite")
+        assert(layer.isValid())
+        feat = QgsFeature()
+        layer.getFeatures().nextFeature(feat) or die("no feature")
+        polygons = feat.geometry().asMultiPolygon()
+        len(polygons) == 2 or die("wrong number of polygons")
+        polygons[1][0][1] == QgsPoint(3, 2) or die("wrong multipolygon")
+
+    def test_FilterRect(self):
+        """Filter with the spatial index, the statement is reused with other values"""
+        layer = QgsVectorLayer("dbname=%s table=test_rtree (geometry)" % self.dbname, "test_rtree", "spatialite")
+        assert(layer.isValid())
+        for rect, ids in [(QgsRectangle(1.5, 1.5, 4.5, 4.5), [2, 3, 4]),
+                          (QgsRectangle(6.5, 6.5, 20, 20), [7, 8, 9]),
+                          (QgsRectangle(1.5, 1.5, 4.5, 4.5), [2, 3, 4])]:
+            request = QgsFeatureRequest().setFilterRect(rect)
+            sorted([f.id() for f in layer.getFeatures(request)]) == ids or die("wrong features in %s" % rect.toString())
+
+        feat = QgsFeature()
+        layer.getFeatures(QgsFeatureRequest(5)).nextFeature(feat) or die("no feature")
+        feat.geometry().asPoint() == QgsPoint(5, 5) or die("wrong feature")
+
+    def test_PartitionRequest(self):
+        """Split the requests into ranges of ids"""
+        layer = QgsVectorLayer("dbname=%s table=test_partition (geometry)" % self.dbname, "test_partition", "spatialite")
+        assert(layer.isValid())
+        source = layer.dataProvider().featureSource()
+        for request in [QgsFeatureRequest(), QgsFeatureRequest(QgsRectangle(10.5, 10.5, 20.5, 80.5))]:
+            expected = sorted([f.id() for f in source.getFeatures(request)])
+            parts = source.partitionRequest(request, 4)
+            len(parts) > 1 or die("the request was not split")
+            ids = []
+            for part in parts:
+                part.hasFilterFidRange() or die("no range in the part")
+                ids += [f.id() for f in source.getFeatures(part)]
+            sorted(ids) == expected or die("the parts do not return the features of the request")
+
+        len(source.partitionRequest(QgsFeatureRequest(5), 4)) == 1 or die("a feature id request was split")
+
+    def test_PartitionRequestBigIntKey(self):
+        """Split the requests by ROWID when the primary key is not the ROWID"""
+        layer = QgsVectorLayer("dbname=%s table=test_partition_bigint (geometry)" % self.dbname, "test_partition_bigint", "spatialite")
+        assert(layer.isValid())
+        source = layer.dataProvider().featureSource()
+        for request in [QgsFeatureRequest(), QgsFeatureRequest(QgsRectangle(10.5, 10.5, 20.5, 80.5))]:
+            expected = sorted([(f.id(), f["id"]) for f in source.getFeatures(request)])
+            len(expected) > 0 or die("no features")
+            parts = source.partitionRequest(request, 4)
+            len(parts) > 1 or die("the request was not split")
+            features = []
+            for part in parts:
+                features += [(f.id(), f["id"]) for f in source.getFeatures(part)]
+            sorted(features) == expected or die("the parts do not return the features of the request")
+
     def xtest_SplitFeatureWithFailedCommit(self):
         """Create spatialite database"""
         layer = QgsVectorLayer("dbname=%s table=test_pg_mk (geometry)" % self.dbname, "test_pg_mk", "spatialite")